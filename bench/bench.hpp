@@ -0,0 +1,77 @@
+#ifndef _FLUENT_TRAY_BENCH_HPP
+#define _FLUENT_TRAY_BENCH_HPP
+
+#include "fluent_tray_core.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace bench
+{
+    /**
+     * @brief Measure the median elapsed time of a function.
+     * @param [in] repeat The number of measurements.
+     * @param [in] function Function to measure.
+     * @return The median elapsed time in nanoseconds.
+     */
+    template <typename Function>
+    double measure(std::size_t repeat, Function function) {
+        std::vector<double> times ;
+        for(std::size_t i = 0 ; i < repeat ; i ++) {
+            auto start = std::chrono::steady_clock::now() ;
+            function() ;
+            auto elapsed = std::chrono::steady_clock::now() - start ;
+            times.push_back(std::chrono::duration<double, std::nano>(elapsed).count()) ;
+        }
+        auto median = times.begin() + times.size() / 2 ;
+        std::nth_element(times.begin(), median, times.end()) ;
+        return *median ;
+    }
+
+    /**
+     * @brief Print a row of the results.
+     * @param [in] name The name of case.
+     * @param [in] size The size of input.
+     * @param [in] nanoseconds The elapsed time.
+     */
+    inline void report(const char* name, std::size_t size, double nanoseconds) {
+        std::printf(
+            "%-36s %10zu %14.1f us %10.2f ns/item\n",
+            name, size,
+            nanoseconds / 1000.0, nanoseconds / static_cast<double>((std::max)(size, static_cast<std::size_t>(1)))) ;
+    }
+
+    /**
+     * @brief Print a row of the results of a single operation.
+     * @param [in] name The name of case.
+     * @param [in] size The size of input.
+     * @param [in] nanoseconds The elapsed time of an operation.
+     */
+    inline void report_operation(const char* name, std::size_t size, double nanoseconds) {
+        std::printf("%-36s %10zu %14.1f ns/op\n", name, size, nanoseconds) ;
+    }
+
+    /**
+     * @brief Keep a result from being optimized away.
+     * @param [in] value The result.
+     */
+    inline void keep(std::size_t value) {
+        static volatile std::size_t sink = 0 ;
+        sink = sink + value ;
+    }
+
+    /**
+     * @brief Generate a pseudo-random number.
+     * @param [in, out] seed The state of generator.
+     * @return The next number.
+     */
+    inline std::uint32_t next_random(std::uint32_t& seed) noexcept {
+        seed = seed * 1664525u + 1013904223u ;
+        return seed >> 8 ;
+    }
+}
+
+#endif
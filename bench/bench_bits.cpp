@@ -0,0 +1,53 @@
+#include "bench.hpp"
+
+using namespace fluent_tray ;
+
+int main() {
+    std::printf("Focus change detection per tick versus menu count\n") ;
+
+    for(std::size_t size = 64 ; size <= 1048576 ; size *= 16) {
+        const std::size_t ticks = 100 ;
+
+        // The focus moves to a random menu on every tick.
+        std::vector<std::size_t> selections(ticks) ;
+        std::uint32_t seed = 1 ;
+        for(auto& selection : selections) {
+            selection = bench::next_random(seed) % size ;
+        }
+
+        // The former update() walked every menu and compared its focus with the selection.
+        std::vector<bool> status_if_focus(size, false) ;
+        auto walk = bench::measure(11, [&status_if_focus, &selections] {
+            std::size_t repainted = 0 ;
+            for(auto selection : selections) {
+                for(std::size_t i = 0 ; i < status_if_focus.size() ; i ++) {
+                    auto focused = i == selection ;
+                    if(status_if_focus[i] != focused) {
+                        repainted ++ ;
+                    }
+                    status_if_focus[i] = focused ;
+                }
+            }
+            bench::keep(repainted) ;
+        }) ;
+        bench::report_operation("walk every menu", size, walk / ticks) ;
+
+        StateBits focus_bits(size) ;
+        std::size_t previous = 0 ;
+        auto diff = bench::measure(11, [&focus_bits, &selections, &previous] {
+            std::size_t repainted = 0 ;
+            for(auto selection : selections) {
+                focus_bits.set(previous, false) ;
+                focus_bits.set(selection, true) ;
+                previous = selection ;
+                focus_bits.flush([&repainted] (std::size_t, bool) {
+                    repainted ++ ;
+                    return true ;
+                }) ;
+            }
+            bench::keep(repainted) ;
+        }) ;
+        bench::report_operation("StateBits set + flush", size, diff / ticks) ;
+    }
+    return 0 ;
+}
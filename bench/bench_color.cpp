@@ -0,0 +1,67 @@
+#include "bench.hpp"
+
+using namespace fluent_tray ;
+
+int main() {
+    std::printf("Luminance and contrast picking versus rgb2gray\n") ;
+
+    const std::size_t size = 100000 ;
+    std::vector<std::uint32_t> pixels(size) ;
+    std::uint32_t seed = 1 ;
+    for(auto& pixel : pixels) {
+        pixel = 0xFF000000 | bench::next_random(seed) ;
+    }
+    std::vector<std::uint16_t> luminances(size) ;
+
+    auto gray = bench::measure(101, [&pixels] {
+        std::size_t sum = 0 ;
+        for(auto pixel : pixels) {
+            sum += util::rgb2gray(util::argb2colorref(pixel)) ;
+        }
+        bench::keep(sum) ;
+    }) ;
+    bench::report("rgb2gray", size, gray) ;
+
+    auto scalar = bench::measure(101, [&pixels, &luminances] {
+        util::calculate_luminances_scalar(pixels.data(), pixels.size(), luminances.data()) ;
+        bench::keep(luminances[pixels.size() / 2]) ;
+    }) ;
+    bench::report("calculate_luminances_scalar", size, scalar) ;
+
+    auto batch = bench::measure(101, [&pixels, &luminances] {
+        util::calculate_luminances(pixels.data(), pixels.size(), luminances.data()) ;
+        bench::keep(luminances[pixels.size() / 2]) ;
+    }) ;
+    bench::report("calculate_luminances", size, batch) ;
+
+    // The former rule picked black or white by the gray threshold.
+    auto threshold = bench::measure(101, [&pixels] {
+        std::size_t sum = 0 ;
+        for(auto pixel : pixels) {
+            sum += util::rgb2gray(util::argb2colorref(pixel)) < 128 ? 0xFFFFFF : 0 ;
+        }
+        bench::keep(sum) ;
+    }) ;
+    bench::report("text color by gray < 128", size, threshold) ;
+
+    const std::uint32_t candidates[] = {util::rgb(0, 0, 0), util::rgb(0xFF, 0xFF, 0xFF)} ;
+    auto wcag = bench::measure(101, [&pixels, &candidates] {
+        std::size_t sum = 0 ;
+        for(auto pixel : pixels) {
+            sum += util::pick_contrast_color(
+                util::argb2colorref(pixel), candidates, 2, util::ContrastMetric::WCAG) ;
+        }
+        bench::keep(sum) ;
+    }) ;
+    bench::report("pick_contrast_color (WCAG)", size, wcag) ;
+
+    auto apca = bench::measure(101, [&pixels, &candidates] {
+        std::size_t sum = 0 ;
+        for(auto pixel : pixels) {
+            sum += util::pick_contrast_color(util::argb2colorref(pixel), candidates, 2) ;
+        }
+        bench::keep(sum) ;
+    }) ;
+    bench::report("pick_contrast_color (APCA)", size, apca) ;
+    return 0 ;
+}
@@ -0,0 +1,137 @@
+#include "bench.hpp"
+
+#include <string>
+
+using namespace fluent_tray ;
+
+namespace
+{
+    //! The keys of a tree after one percent of them are removed, inserted and moved.
+    std::vector<std::string> edit_keys(const std::vector<std::string>& live, std::uint32_t& seed) {
+        auto desired = live ;
+        auto changes = (std::max)(live.size() / 100, std::size_t(1)) ;
+        for(std::size_t i = 0 ; i < changes ; i ++) {
+            desired.erase(desired.begin() + bench::next_random(seed) % desired.size()) ;
+        }
+        for(std::size_t i = 0 ; i < changes ; i ++) {
+            auto position = bench::next_random(seed) % (desired.size() + 1) ;
+            desired.insert(desired.begin() + position, "new" + std::to_string(i)) ;
+        }
+        for(std::size_t i = 0 ; i < changes ; i ++) {
+            auto from = bench::next_random(seed) % desired.size() ;
+            auto key = desired[from] ;
+            desired.erase(desired.begin() + from) ;
+            desired.insert(desired.begin() + bench::next_random(seed) % (desired.size() + 1), key) ;
+        }
+        return desired ;
+    }
+
+    //! Apply the operations by handle, as apply_menu_diff does.
+    std::size_t apply_by_handle(
+            const KeyedDiff<std::string>& differ,
+            const std::vector<std::string>& live,
+            const std::vector<std::string>& desired,
+            const std::vector<DiffOp>& ops) {
+        SlotMap<std::string> menus ;
+        std::vector<SlotHandle> live_handles ;
+        for(const auto& key : live) {
+            live_handles.push_back(menus.push_back(key)) ;
+        }
+        std::vector<SlotHandle> placed(desired.size(), SlotHandle{0, 0}) ;
+        for(std::size_t i = 0 ; i < desired.size() ; i ++) {
+            std::size_t index ;
+            if(differ.find_live(i, index)) {
+                placed[i] = live_handles[index] ;
+            }
+        }
+        auto next_of = [&placed] (std::size_t source) {
+            return source + 1 < placed.size() ? placed[source + 1] : SlotHandle{0, 0} ;
+        } ;
+        for(const auto& op : ops) {
+            switch(op.type) {
+                case DiffOpType::REMOVE:
+                    menus.erase(live_handles[op.from]) ;
+                    break ;
+                case DiffOpType::INSERT:
+                    placed[op.source] = menus.insert_before(next_of(op.source), desired[op.source]) ;
+                    break ;
+                case DiffOpType::MOVE:
+                    menus.move_before(placed[op.source], next_of(op.source)) ;
+                    break ;
+            }
+        }
+        // The positions are rebuilt once, as the hot table is.
+        return menus.handle_at(menus.size() / 2).index ;
+    }
+
+    //! The former application, where each operation finds its neighbor linearly and shifts the menus.
+    std::size_t apply_by_position(
+            const std::vector<std::string>& live,
+            const std::vector<std::string>& desired,
+            const std::vector<DiffOp>& ops) {
+        auto menus = live ;
+        auto position_of = [&menus, &desired] (std::size_t source) {
+            if(source + 1 >= desired.size()) {
+                return menus.size() ;
+            }
+            return static_cast<std::size_t>(
+                std::find(menus.begin(), menus.end(), desired[source + 1]) - menus.begin()) ;
+        } ;
+        for(const auto& op : ops) {
+            switch(op.type) {
+                case DiffOpType::REMOVE:
+                    menus.erase(menus.begin() + static_cast<std::ptrdiff_t>(op.from)) ;
+                    break ;
+                case DiffOpType::INSERT: {
+                    auto to = position_of(op.source) ;
+                    menus.insert(menus.begin() + static_cast<std::ptrdiff_t>(to), desired[op.source]) ;
+                    break ;
+                }
+                case DiffOpType::MOVE: {
+                    auto from = std::find(menus.begin(), menus.end(), desired[op.source]) ;
+                    auto key = *from ;
+                    menus.erase(from) ;
+                    auto to = position_of(op.source) ;
+                    menus.insert(menus.begin() + static_cast<std::ptrdiff_t>(to), key) ;
+                    break ;
+                }
+            }
+        }
+        return menus.size() ;
+    }
+}
+
+int main() {
+    std::printf("Keyed diff of a large tree with one percent of changes versus size\n") ;
+
+    for(std::size_t size = 1000 ; size <= 100000 ; size *= 10) {
+        std::vector<std::string> live ;
+        for(std::size_t i = 0 ; i < size ; i ++) {
+            live.push_back("menu" + std::to_string(i)) ;
+        }
+        std::uint32_t seed = 1 ;
+        auto desired = edit_keys(live, seed) ;
+
+        KeyedDiff<std::string> differ ;
+        std::vector<DiffOp> ops ;
+        auto diff = bench::measure(11, [&differ, &live, &desired, &ops] {
+            differ.set_desired(desired) ;
+            differ.diff(live, ops) ;
+            bench::keep(ops.size()) ;
+        }) ;
+        bench::report("set_desired + diff", size, diff) ;
+
+        differ.set_desired(desired) ;
+        differ.diff(live, ops) ;
+        auto by_handle = bench::measure(11, [&differ, &live, &desired, &ops] {
+            bench::keep(apply_by_handle(differ, live, desired, ops)) ;
+        }) ;
+        bench::report("apply by handle", size, by_handle) ;
+
+        auto by_position = bench::measure(5, [&live, &desired, &ops] {
+            bench::keep(apply_by_position(live, desired, ops)) ;
+        }) ;
+        bench::report("apply by position (former)", size, by_position) ;
+    }
+    return 0 ;
+}
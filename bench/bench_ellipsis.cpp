@@ -0,0 +1,84 @@
+#include "bench.hpp"
+
+#include <string>
+
+using namespace fluent_tray ;
+
+namespace
+{
+    struct Label {
+        std::wstring text ;
+        std::vector<int> advances ;
+        std::vector<int> extents ;
+
+        Label()
+        : text(),
+          advances(),
+          extents()
+        {}
+    } ;
+
+    //! Emulate a text measurement, which sums the advances of the prefix every time.
+    int measure_prefix(const Label& label, std::size_t length) {
+        int width = 0 ;
+        for(std::size_t i = 0 ; i < length ; i ++) {
+            width += label.advances[i] ;
+        }
+        return width ;
+    }
+}
+
+int main() {
+    std::printf("Ellipsis truncation of 100k labels\n") ;
+
+    const std::size_t size = 100000 ;
+    const int max_width = 400 ;
+    const int ellipsis_width = 12 ;
+
+    // Labels of 20 to 200 characters with advances of 5 to 12 pixels, as file paths are.
+    std::vector<Label> labels(size) ;
+    std::uint32_t seed = 1 ;
+    for(auto& label : labels) {
+        auto length = 20 + bench::next_random(seed) % 181 ;
+        int width = 0 ;
+        for(std::size_t i = 0 ; i < length ; i ++) {
+            auto advance = static_cast<int>(5 + bench::next_random(seed) % 8) ;
+            label.text.push_back(static_cast<wchar_t>(L'a' + bench::next_random(seed) % 26)) ;
+            label.advances.push_back(advance) ;
+            width += advance ;
+            label.extents.push_back(width) ;
+        }
+    }
+
+    // Drop one character at a time and measure again until the label fits.
+    auto repeated = bench::measure(5, [&labels] {
+        std::size_t sum = 0 ;
+        for(const auto& label : labels) {
+            auto head = label.text.length() ;
+            while(head > 0 && measure_prefix(label, head) + ellipsis_width > max_width) {
+                head -- ;
+            }
+            sum += head ;
+        }
+        bench::keep(sum) ;
+    }) ;
+    bench::report("repeated measurement (end)", size, repeated) ;
+
+    const util::EllipsisMode modes[] = {util::EllipsisMode::END, util::EllipsisMode::MIDDLE} ;
+    const char* names[] = {"binary search (end)", "binary search (middle)"} ;
+    for(int m = 0 ; m < 2 ; m ++) {
+        auto mode = modes[m] ;
+        auto cached = bench::measure(11, [&labels, mode] {
+            std::size_t sum = 0 ;
+            for(const auto& label : labels) {
+                std::size_t head, tail ;
+                util::calculate_ellipsis_cut(
+                    label.text, label.extents, max_width, ellipsis_width, mode, head, tail) ;
+                sum += head + tail ;
+            }
+            bench::keep(sum) ;
+        }) ;
+        bench::report(names[m], size, cached) ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,131 @@
+#include "bench.hpp"
+
+#include <string>
+
+using namespace fluent_tray ;
+
+namespace
+{
+    //! Emulate labels such as file paths, with words joined by separators.
+    std::wstring make_label(std::uint32_t& seed) {
+        static const wchar_t* const words[] = {
+            L"report", L"photo", L"notes", L"backup", L"draft", L"invoice", L"music", L"archive"} ;
+        static const wchar_t separators[] = L" -_./" ;
+        std::wstring label ;
+        auto count = 2 + bench::next_random(seed) % 4 ;
+        for(std::uint32_t i = 0 ; i < count ; i ++) {
+            if(i > 0) {
+                label.push_back(separators[bench::next_random(seed) % 5]) ;
+            }
+            label += words[bench::next_random(seed) % 8] ;
+        }
+        return label + std::to_wstring(bench::next_random(seed) % 1000) ;
+    }
+
+    std::vector<std::uint16_t> to_units(const std::wstring& text) {
+        std::vector<std::uint16_t> units ;
+        for(auto c : PrefixIndex::fold(text)) {
+            units.push_back(static_cast<std::uint16_t>(c)) ;
+        }
+        return units ;
+    }
+}
+
+int main() {
+    std::printf("Fuzzy filtering of 100k labels\n") ;
+
+    const std::size_t size = 100000 ;
+    std::uint32_t seed = 1 ;
+    std::vector<std::wstring> labels ;
+    for(std::size_t i = 0 ; i < size ; i ++) {
+        labels.push_back(make_label(seed)) ;
+    }
+
+    // The scoring kernels on the same labels
+    std::vector<std::uint16_t> buffer ;
+    std::vector<std::size_t> offsets(1, 0) ;
+    for(const auto& label : labels) {
+        auto units = to_units(label) ;
+        buffer.insert(buffer.end(), units.begin(), units.end()) ;
+        offsets.push_back(buffer.size()) ;
+    }
+    std::vector<std::uint64_t> separators((buffer.size() + 63) / 64) ;
+    util::find_word_separators(buffer.data(), buffer.size(), separators.data()) ;
+    auto query = to_units(L"rpbk") ;
+
+    auto scalar = bench::measure(11, [&buffer, &offsets, &query] {
+        int sum = 0 ;
+        for(std::size_t i = 0 ; i + 1 < offsets.size() ; i ++) {
+            int score ;
+            if(util::fuzzy_score_scalar(
+                    buffer.data() + offsets[i], offsets[i + 1] - offsets[i],
+                    query.data(), query.size(), score)) {
+                sum += score ;
+            }
+        }
+        bench::keep(static_cast<std::size_t>(sum)) ;
+    }) ;
+    bench::report("score, scalar", size, scalar) ;
+
+    auto simd = bench::measure(11, [&buffer, &offsets, &separators, &query] {
+        int sum = 0 ;
+        for(std::size_t i = 0 ; i + 1 < offsets.size() ; i ++) {
+            int score ;
+            if(util::fuzzy_score(
+                    buffer.data() + offsets[i], offsets[i + 1] - offsets[i],
+                    separators.data(), offsets[i], query.data(), query.size(), score)) {
+                sum += score ;
+            }
+        }
+        bench::keep(static_cast<std::size_t>(sum)) ;
+    }) ;
+    bench::report("score, vectorized", size, simd) ;
+
+    std::vector<std::uint64_t> marked(separators.size()) ;
+    auto mark_scalar = bench::measure(11, [&buffer, &marked] {
+        util::find_word_separators_scalar(buffer.data(), buffer.size(), marked.data()) ;
+        bench::keep(marked[0]) ;
+    }) ;
+    bench::report("mark separators, scalar", size, mark_scalar) ;
+    auto mark = bench::measure(11, [&buffer, &marked] {
+        util::find_word_separators(buffer.data(), buffer.size(), marked.data()) ;
+        bench::keep(marked[0]) ;
+    }) ;
+    bench::report("mark separators, vectorized", size, mark) ;
+
+    // Typing a query character by character, and ranking the first page or the former limit
+    FuzzyMatcher matcher ;
+    matcher.assign(labels) ;
+    const std::wstring typed = L"rpbk" ;
+    auto type = [&matcher, &typed] (std::size_t count) {
+        std::size_t sum = 0 ;
+        matcher.reset() ;
+        for(std::size_t length = 1 ; length <= typed.size() ; length ++) {
+            matcher.filter(typed.substr(0, length)) ;
+            sum += matcher.rank(count) ;
+        }
+        return sum ;
+    } ;
+    auto page = bench::measure(11, [&type] {
+        bench::keep(type(20)) ;
+    }) ;
+    bench::report("type 4 characters, rank a page", size, page) ;
+    auto limit = bench::measure(11, [&type] {
+        bench::keep(type(1000)) ;
+    }) ;
+    bench::report("type 4 characters, rank 1000", size, limit) ;
+
+    // Scrolling through the matches ranks the next pages only.
+    matcher.filter(L"r") ;
+    auto scroll = bench::measure(11, [&matcher] {
+        matcher.filter(L"rp") ;
+        std::size_t sum = 0 ;
+        for(std::size_t shown = 20 ; shown <= 2000 ; shown += 20) {
+            sum += matcher.rank(shown) ;
+        }
+        matcher.filter(L"r") ;
+        bench::keep(sum) ;
+    }) ;
+    bench::report("filter and scroll 100 pages", size, scroll) ;
+    return 0 ;
+}
@@ -0,0 +1,128 @@
+#include "bench.hpp"
+
+#include <functional>
+#include <string>
+
+using namespace fluent_tray ;
+
+namespace
+{
+    using FakeWindow = std::uintptr_t ;
+
+    //! The former layout, where the hot fields sit among the labels and callbacks of each menu.
+    struct FatMenu {
+        std::wstring label ;
+        std::wstring icon_path ;
+        std::wstring checkmark ;
+        std::function<bool(void)> callback ;
+        std::function<bool(void)> unchecked_callback ;
+        std::uint32_t colors[4] ;
+        FakeWindow window ;
+        std::uint16_t id ;
+        bool slider ;
+        bool submenu ;
+
+        FatMenu()
+        : label(),
+          icon_path(),
+          checkmark(),
+          callback(),
+          unchecked_callback(),
+          colors(),
+          window(0),
+          id(0),
+          slider(false),
+          submenu(false)
+        {}
+    } ;
+}
+
+int main() {
+    std::printf("Per-tick menu lookups in the former layout and the hot table\n") ;
+
+    const std::size_t lookups = 1000 ;
+    // The identifiers of menus are 16 bits, so there are at most 65535 menus.
+    const std::size_t sizes[] = {16, 128, 1024, 8192, 65535} ;
+    for(auto size : sizes) {
+        std::vector<FatMenu> menus(size) ;
+        MenuHotTable<FakeWindow> hot ;
+        for(std::size_t i = 0 ; i < size ; i ++) {
+            menus[i].label = L"menu label " + std::to_wstring(i) ;
+            menus[i].window = 0x10000 + i * 16 ;
+            menus[i].id = static_cast<std::uint16_t>(i + 1) ;
+            menus[i].slider = i % 7 == 0 ;
+            hot.push_back(i + 1, menus[i].window) ;
+            hot.set_slider(i, menus[i].slider) ;
+        }
+
+        std::vector<std::size_t> targets(lookups) ;
+        std::uint32_t seed = 1 ;
+        for(auto& target : targets) {
+            target = bench::next_random(seed) % size ;
+        }
+
+        // The window under the cursor is searched by comparing the handles of menus.
+        auto fat_scan = bench::measure(11, [&menus, &targets] {
+            std::size_t sum = 0 ;
+            for(auto target : targets) {
+                auto window = menus[target].window ;
+                for(std::size_t i = 0 ; i < menus.size() ; i ++) {
+                    if(menus[i].window == window) {
+                        sum += i ;
+                        break ;
+                    }
+                }
+            }
+            bench::keep(sum) ;
+        }) ;
+        bench::report_operation("former layout, window scan", size, fat_scan / lookups) ;
+
+        auto hot_scan = bench::measure(11, [&hot, &targets] {
+            std::size_t sum = 0 ;
+            for(auto target : targets) {
+                auto window = hot.window(target) ;
+                for(std::size_t i = 0 ; i < hot.size() ; i ++) {
+                    if(hot.window(i) == window) {
+                        sum += i ;
+                        break ;
+                    }
+                }
+            }
+            bench::keep(sum) ;
+        }) ;
+        bench::report_operation("hot table, window scan", size, hot_scan / lookups) ;
+
+        // The control identifier of the window leads to the row directly.
+        auto hot_find = bench::measure(11, [&hot, &targets] {
+            std::size_t sum = 0 ;
+            for(auto target : targets) {
+                std::size_t index ;
+                if(hot.find_by_window(target + 1, hot.window(target), index)) {
+                    sum += index ;
+                }
+            }
+            bench::keep(sum) ;
+        }) ;
+        bench::report_operation("hot table, find_by_window", size, hot_find / lookups) ;
+
+        // Keyboard navigation skips the sliders on every key.
+        auto fat_flags = bench::measure(1001, [&menus] {
+            std::size_t sum = 0 ;
+            for(const auto& menu : menus) {
+                sum += menu.slider ? 1 : 0 ;
+            }
+            bench::keep(sum) ;
+        }) ;
+        bench::report("former layout, flag sweep", size, fat_flags) ;
+
+        auto hot_flags = bench::measure(1001, [&hot] {
+            std::size_t sum = 0 ;
+            for(std::size_t i = 0 ; i < hot.size() ; i ++) {
+                sum += hot.is_slider(i) ? 1 : 0 ;
+            }
+            bench::keep(sum) ;
+        }) ;
+        bench::report("hot table, flag sweep", size, hot_flags) ;
+    }
+    return 0 ;
+}
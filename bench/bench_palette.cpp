@@ -0,0 +1,68 @@
+#include "bench.hpp"
+
+using namespace fluent_tray ;
+
+namespace
+{
+    //! The former faded color, a gray shifted from the gray of the background.
+    std::uint32_t calculate_faded_color(std::uint32_t back_color, unsigned char color_decay) {
+        auto gray = static_cast<int>(util::rgb2gray(back_color)) ;
+        auto ash = gray < 128 ? (std::min)(gray + color_decay, 255) : (std::max)(gray - color_decay, 0) ;
+        auto value = static_cast<unsigned char>(ash) ;
+        return util::rgb(value, value, value) ;
+    }
+
+    // A fixed brand color costs nothing at runtime.
+    constexpr TonalPalette brand_palette(util::rgb(0x00, 0x3E, 0x92), 10 / 255.0) ;
+    static_assert(brand_palette.hover != brand_palette.base, "") ;
+}
+
+int main() {
+    std::printf("Tonal palette generation per base color\n") ;
+
+    const std::size_t size = 10000 ;
+    std::vector<std::uint32_t> colors(size) ;
+    std::uint32_t seed = 1 ;
+    for(auto& color : colors) {
+        color = bench::next_random(seed) & 0xFFFFFF ;
+    }
+
+    auto faded = bench::measure(101, [&colors] {
+        std::size_t sum = 0 ;
+        for(auto color : colors) {
+            sum += calculate_faded_color(color, 10) ;
+        }
+        bench::keep(sum) ;
+    }) ;
+    bench::report("former faded gray", size, faded) ;
+
+    auto generate = bench::measure(101, [&colors] {
+        std::size_t sum = 0 ;
+        for(auto color : colors) {
+            sum += TonalPalette(color, 10 / 255.0).separator ;
+        }
+        bench::keep(sum) ;
+    }) ;
+    bench::report("TonalPalette generation", size, generate) ;
+
+    // The theme is refreshed with the same background color most of the time.
+    TonalPaletteCache cache ;
+    auto hit = bench::measure(101, [&colors, &cache] {
+        std::size_t sum = 0 ;
+        for(std::size_t i = 0 ; i < colors.size() ; i ++) {
+            sum += cache.get(colors[i % 4], 10 / 255.0).separator ;
+        }
+        bench::keep(sum) ;
+    }) ;
+    bench::report("TonalPaletteCache hit", size, hit) ;
+
+    auto constant = bench::measure(101, [] {
+        std::size_t sum = 0 ;
+        for(std::size_t i = 0 ; i < size ; i ++) {
+            sum += brand_palette.separator ;
+        }
+        bench::keep(sum) ;
+    }) ;
+    bench::report("constexpr palette", size, constant) ;
+    return 0 ;
+}
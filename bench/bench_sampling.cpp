@@ -0,0 +1,40 @@
+#include "bench.hpp"
+
+using namespace fluent_tray ;
+
+int main() {
+    std::printf("Taskbar color reduction versus strip size\n") ;
+
+    // A taskbar strip with icons and wallpaper bleeding on a flat background.
+    const std::size_t sizes[] = {64 * 4, 256 * 8, 1920 * 16} ;
+    for(auto size : sizes) {
+        std::vector<std::uint32_t> pixels(size) ;
+        std::uint32_t seed = 1 ;
+        for(auto& pixel : pixels) {
+            auto r = bench::next_random(seed) ;
+            pixel = r % 8 == 0 ? (0xFF000000 | r) : 0xFF202020 + (r % 5) * 0x010101 ;
+        }
+
+        // The baseline is the former single GetPixel read, which costs only the read here.
+        auto single = bench::measure(1001, [&pixels] {
+            bench::keep(pixels[pixels.size() / 2] & 0xFFFFFF) ;
+        }) ;
+        bench::report("single pixel", size, single) ;
+
+        auto median = bench::measure(1001, [&pixels] {
+            bench::keep(util::calculate_median_color(pixels.data(), pixels.size())) ;
+        }) ;
+        bench::report("median", size, median) ;
+
+        auto scalar = bench::measure(1001, [&pixels] {
+            bench::keep(util::calculate_robust_mean_color_scalar(pixels.data(), pixels.size())) ;
+        }) ;
+        bench::report("robust mean (scalar)", size, scalar) ;
+
+        auto vectorized = bench::measure(1001, [&pixels] {
+            bench::keep(util::calculate_robust_mean_color(pixels.data(), pixels.size())) ;
+        }) ;
+        bench::report("robust mean", size, vectorized) ;
+    }
+    return 0 ;
+}
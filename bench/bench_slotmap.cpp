@@ -0,0 +1,48 @@
+#include "bench.hpp"
+
+using namespace fluent_tray ;
+
+int main() {
+    std::printf("Slot map insertion and erasure by handle versus size\n") ;
+
+    for(std::size_t size = 1000 ; size <= 1000000 ; size *= 10) {
+        SlotMap<std::size_t> slots ;
+        std::vector<SlotHandle> handles ;
+        for(std::size_t i = 0 ; i < size ; i ++) {
+            handles.push_back(slots.push_back(i)) ;
+        }
+
+        // Insert before and erase a menu in the middle, as insert_menu and remove_menu do.
+        const std::size_t operations = 1000 ;
+        std::uint32_t seed = 1 ;
+        auto by_handle = bench::measure(11, [&slots, &handles, &seed] {
+            for(std::size_t i = 0 ; i < operations ; i ++) {
+                auto& next = handles[bench::next_random(seed) % handles.size()] ;
+                auto inserted = slots.insert_before(next, i) ;
+                slots.erase(inserted) ;
+            }
+            bench::keep(slots.size()) ;
+        }) ;
+        bench::report_operation("insert_before + erase", size, by_handle / operations) ;
+
+        // Move a menu before another one.
+        auto move = bench::measure(11, [&slots, &handles, &seed] {
+            for(std::size_t i = 0 ; i < operations ; i ++) {
+                auto& handle = handles[bench::next_random(seed) % handles.size()] ;
+                auto& next = handles[bench::next_random(seed) % handles.size()] ;
+                slots.move_before(handle, next) ;
+            }
+            bench::keep(slots.size()) ;
+        }) ;
+        bench::report_operation("move_before", size, move / operations) ;
+
+        // The positional access rebuilds the order once after the changes.
+        auto positional = bench::measure(11, [&slots, &handles, &seed] {
+            auto& next = handles[bench::next_random(seed) % handles.size()] ;
+            slots.erase(slots.insert_before(next, 0)) ;
+            bench::keep(slots.handle_at(slots.size() / 2).index) ;
+        }) ;
+        bench::report("positional access after a change", size, positional) ;
+    }
+    return 0 ;
+}
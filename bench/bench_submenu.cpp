@@ -0,0 +1,95 @@
+#include "bench.hpp"
+
+#include <memory>
+#include <string>
+
+using namespace fluent_tray ;
+
+namespace
+{
+    //! Stand-in for a materialized item: the copied label and the state a window holds.
+    struct FakeItem {
+        std::string label ;
+        std::uint32_t colors[8] ;
+
+        FakeItem()
+        : label(),
+          colors()
+        {}
+    } ;
+
+    //! Stand-in for a submenu popup with the windows of its items.
+    struct FakeSubmenu {
+        std::vector<std::unique_ptr<FakeItem>> items ;
+
+        FakeSubmenu()
+        : items()
+        {}
+    } ;
+
+    bool materialize(const SubmenuTree& tree, std::size_t node, std::unique_ptr<FakeSubmenu>& submenu) {
+        submenu.reset(new FakeSubmenu()) ;
+        for(std::size_t i = 0 ; i < tree.count_items(node) ; i ++) {
+            std::unique_ptr<FakeItem> item(new FakeItem()) ;
+            item->label = tree.item(node, i).label ;
+            submenu->items.push_back(std::move(item)) ;
+        }
+        return true ;
+    }
+
+    //! Describe a tree with a nested submenu every ten items.
+    void build(std::size_t size, SubmenuTree& tree, LazyCache<FakeSubmenu>& cache) {
+        auto node = tree.add_root() ;
+        cache.add() ;
+        for(std::size_t i = 0 ; i < size ; i ++) {
+            if(i % 10 == 9) {
+                std::size_t nested = 0 ;
+                tree.add_nested(node, MenuSpec("", "nested submenu"), nested) ;
+                cache.add() ;
+                node = nested ;
+            }
+            else {
+                tree.add_item(node, MenuSpec("", "submenu item label")) ;
+            }
+        }
+    }
+}
+
+int main() {
+    std::printf("Startup cost of cascading submenus versus tree size\n") ;
+    for(std::size_t size = 1000 ; size <= 1000000 ; size *= 10) {
+        const std::size_t repeat = size >= 1000000 ? 3 : 11 ;
+
+        // Lazy: only the descriptions are built, and the first submenu is opened.
+        std::size_t created = 0 ;
+        auto lazy = bench::measure(repeat, [size, &created] {
+            SubmenuTree tree ;
+            LazyCache<FakeSubmenu> cache ;
+            build(size, tree, cache) ;
+            cache.get(0, [&tree] (std::unique_ptr<FakeSubmenu>& submenu) {
+                return materialize(tree, 0, submenu) ;
+            }) ;
+            created = cache.count_created() ;
+            bench::keep(cache.size()) ;
+        }) ;
+        bench::report("lazy (describe + open first)", size, lazy) ;
+        std::printf("%-36s %10zu created\n", "", created) ;
+
+        // Eager: every submenu is materialized up front, as flattening did.
+        auto eager = bench::measure(repeat, [size, &created] {
+            SubmenuTree tree ;
+            LazyCache<FakeSubmenu> cache ;
+            build(size, tree, cache) ;
+            for(std::size_t node = 0 ; node < tree.size() ; node ++) {
+                cache.get(node, [&tree, node] (std::unique_ptr<FakeSubmenu>& submenu) {
+                    return materialize(tree, node, submenu) ;
+                }) ;
+            }
+            created = cache.count_created() ;
+            bench::keep(cache.size()) ;
+        }) ;
+        bench::report("eager (materialize all)", size, eager) ;
+        std::printf("%-36s %10zu created\n", "", created) ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,116 @@
+#include "bench.hpp"
+
+#include <string>
+
+using namespace fluent_tray ;
+
+namespace
+{
+    //! Emulate the provider of labels with many shared prefixes, such as file names.
+    std::wstring provide(std::size_t item) {
+        static const wchar_t* const words[] = {L"report", L"photo", L"notes", L"backup", L"draft"} ;
+        return std::wstring(words[item % 5]) + L" " + std::to_wstring(item) ;
+    }
+}
+
+int main() {
+    std::printf("Type-ahead search of the virtual list versus item count\n") ;
+
+    for(std::size_t size = 1000 ; size <= 100000 ; size *= 10) {
+        std::vector<std::wstring> labels ;
+        for(std::size_t i = 0 ; i < size ; i ++) {
+            labels.push_back(provide(i)) ;
+        }
+
+        // The former index asked all labels again and sorted them on a keystroke.
+        auto reindex = bench::measure(11, [size] {
+            std::vector<std::wstring> asked(size) ;
+            for(std::size_t i = 0 ; i < size ; i ++) {
+                asked[i] = provide(i) ;
+            }
+            PrefixIndex index ;
+            index.assign(asked) ;
+            bench::keep(index.size()) ;
+        }) ;
+        bench::report("keystroke with reindex (former)", size, reindex) ;
+
+        PrefixIndex index ;
+        index.assign(labels) ;
+
+        // A keystroke cycles to the next match in display order with the prebuilt index.
+        const std::size_t keystrokes = 100 ;
+        std::size_t current = 0 ;
+        auto cycle = [&index, &current] (const std::wstring& prefix) {
+            for(std::size_t i = 0 ; i < keystrokes ; i ++) {
+                if(!index.next_item(prefix, current, false, current)) {
+                    index.next_item(prefix, 0, true, current) ;
+                }
+            }
+            bench::keep(current) ;
+        } ;
+        auto keystroke = bench::measure(11, [&cycle] {cycle(L"n") ;}) ;
+        bench::report_operation("keystroke, one in five matches", size, keystroke / keystrokes) ;
+
+        auto narrow = bench::measure(11, [&cycle] {cycle(L"notes 7") ;}) ;
+        bench::report_operation("keystroke, narrow prefix", size, narrow / keystrokes) ;
+
+        // The worst case, where all labels share the first letter.
+        PrefixIndex shared ;
+        std::vector<std::wstring> numbered ;
+        for(std::size_t i = 0 ; i < size ; i ++) {
+            numbered.push_back(L"Item " + std::to_wstring(i)) ;
+        }
+        shared.assign(numbered) ;
+        auto all = bench::measure(11, [&shared, &current] {
+            for(std::size_t i = 0 ; i < keystrokes ; i ++) {
+                if(!shared.next_item(L"i", current, false, current)) {
+                    shared.next_item(L"i", 0, true, current) ;
+                }
+            }
+            bench::keep(current) ;
+        }) ;
+        bench::report_operation("keystroke, all labels match", size, all / keystrokes) ;
+
+        // The former lookup scanned all matches for the smallest rank.
+        auto rank = [] (std::size_t item) {return item ;} ;
+        auto scan = bench::measure(5, [&shared, &rank, &current] {
+            for(std::size_t i = 0 ; i < keystrokes ; i ++) {
+                if(!shared.next_by_rank(L"i", rank, current, false, current)) {
+                    shared.next_by_rank(L"i", rank, 0, true, current) ;
+                }
+            }
+            bench::keep(current) ;
+        }) ;
+        bench::report_operation("keystroke, all match, scan (former)", size, scan / keystrokes) ;
+
+        // A changed item is indexed again alone.
+        FuzzyMatcher matcher ;
+        matcher.assign(labels) ;
+        std::uint32_t seed = 1 ;
+        auto refresh = bench::measure(11, [&index, &matcher, &labels, &seed] {
+            auto item = bench::next_random(seed) % labels.size() ;
+            auto text = provide(item + 1) ;
+            index.erase(item, labels[item]) ;
+            index.insert(item, text) ;
+            matcher.replace(item, text) ;
+            labels[item] = text ;
+            bench::keep(index.size()) ;
+        }) ;
+        bench::report("refresh one item", size, refresh) ;
+
+        // One percent of items are added, and only their labels are asked and merged.
+        auto grow = bench::measure(11, [&index, size] {
+            PrefixIndex grown(index) ;
+            std::vector<std::size_t> items ;
+            std::vector<std::wstring> added ;
+            for(auto i = size ; i < size + size / 100 ; i ++) {
+                items.push_back(i) ;
+                added.push_back(provide(i)) ;
+            }
+            grown.insert(items, added) ;
+            bench::keep(grown.size()) ;
+        }) ;
+        bench::report("add one percent of items", size, grow) ;
+    }
+    return 0 ;
+}
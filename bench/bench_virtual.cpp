@@ -0,0 +1,63 @@
+#include "bench.hpp"
+
+#include <string>
+
+using namespace fluent_tray ;
+
+namespace
+{
+    //! Emulate the provider of labels, such as recent jobs.
+    void provide(std::size_t item, std::string& label) {
+        label = "job " + std::to_string(item) ;
+    }
+
+    //! Bind the shown rows to labels, which is the work done per show or scroll.
+    std::size_t bind_rows(const VirtualList& list, std::vector<std::string>& rows) {
+        std::size_t sum = 0 ;
+        for(std::size_t row = 0 ; row < list.count_rows() ; row ++) {
+            if(list.is_bound(row)) {
+                provide(list.index_of(row), rows[row]) ;
+                sum += rows[row].size() ;
+            }
+        }
+        return sum ;
+    }
+}
+
+int main() {
+    std::printf("Show and scroll cost of the virtual list versus item count\n") ;
+
+    const std::size_t rows = 20 ;
+    for(std::size_t size = 1000 ; size <= 1000000 ; size *= 10) {
+        std::vector<std::string> bound(rows) ;
+
+        auto show = bench::measure(101, [size, &bound] {
+            VirtualList list(size, rows) ;
+            bench::keep(bind_rows(list, bound)) ;
+        }) ;
+        bench::report("virtual show", size, show) ;
+
+        VirtualList list(size, rows) ;
+        auto scroll = bench::measure(101, [&list, &bound] {
+            // One wheel notch of three lines, then back to the top at the end.
+            if(!list.scroll_by_wheel(-120, 3)) {
+                list.scroll_to(0) ;
+            }
+            bench::keep(bind_rows(list, bound)) ;
+        }) ;
+        bench::report("virtual scroll", size, scroll) ;
+
+        // Every item is materialized, as the flat menus did on each show.
+        auto eager = bench::measure(size >= 1000000 ? 3 : 11, [size] {
+            std::vector<std::string> labels(size) ;
+            std::size_t sum = 0 ;
+            for(std::size_t item = 0 ; item < size ; item ++) {
+                provide(item, labels[item]) ;
+                sum += labels[item].size() ;
+            }
+            bench::keep(sum) ;
+        }) ;
+        bench::report("eager show", size, eager) ;
+    }
+    return 0 ;
+}
@@ -67,29 +67,14 @@ typedef enum {
 
 #pragma comment(lib, "Dwmapi")
 
-#include <algorithm>
-#include <chrono>
-#include <cmath>
-#include <functional>
-#include <memory>
-#include <string>
-#include <vector>
+#include "fluent_tray_core.hpp"
 
 #if defined(__GNUC__)
 #pragma GCC diagnostic ignored "-Wold-style-cast"
 #endif
 
-
-/**
- * @namespace fluent_tray
- * @brief Base namespace
- */
 namespace fluent_tray
 {
-    /**
-     * @namespace fluent_tray::util
-     * @brief Utility namespace
-     */
     namespace util
     {
         /**
@@ -165,104 +150,351 @@ namespace fluent_tray
         }
 
         /**
-         * @brief Generates a mask with the specified number of lower bits set to 1.
-         * @param [in] bits Number of bits
-         * @return A generated bit mask.
+         * @brief Checks if the file exists.
+         * @param [in] path A input wide string of path.
+         * @return Returns true if the file exists, false if it does not.
          */
-        inline constexpr std::size_t bit2mask(std::size_t bits) noexcept {
-            return (static_cast<std::size_t>(1) << bits) - 1 ;
+        inline bool exists(const std::wstring& path) {
+            struct _stat buffer ;
+            return _wstat(path.c_str(), &buffer) == 0 ;
         }
 
         /**
-         * @brief Calculate the number of bits of type
-         * @return The number of bits.
+         * @brief Convert RECT to the rectangle used by the Win32-independent classes.
+         * @param [in] rect A input RECT.
+         * @return The rectangle with the same coordinates.
          */
-        template <typename Type>
-        inline constexpr int type2bit() noexcept {
-            return static_cast<int>(sizeof(Type) * CHAR_BIT) ;
+        inline Rect to_rect(const RECT& rect) noexcept {
+            return Rect{rect.left, rect.top, rect.right, rect.bottom} ;
         }
 
         /**
-         * @brief Divides the input value into upper and lower bits.
-         * @param [in] input A input value.
-         * @param [out] upper A output upper bits.
-         * @param [out] lower A outputs lower bits.
-         * @details The splits is performed by storing the lower bits of number of bits of OutType in lower and the remaining bits in upper.
-         * @sa concatenate_bits
+         * @brief Convert POINT to the point used by the Win32-independent classes.
+         * @param [in] point A input POINT.
+         * @return The point with the same coordinates.
          */
-        template <typename InType, typename OutType>
-        inline void split_bits(InType input, OutType& upper, OutType& lower) noexcept {
-            static constexpr auto bits = type2bit<OutType>() ;
-            static const auto lower_mask = util::bit2mask(bits) ;
-
-            upper = static_cast<OutType>((std::size_t)(input) >> bits) ;
-            lower = static_cast<OutType>((std::size_t)(input) & lower_mask) ;
+        inline Point to_point(const POINT& point) noexcept {
+            return Point{point.x, point.y} ;
         }
 
         /**
-         * @brief Generates a variable that combines the bits of two variables.
-         * @param [in] upper A input upper bits.
-         * @param [in] lower A input lower bits.
-         * @param [out] out A output value.
-         * @sa split_bits
+         * @brief Deleter to release a GDI object owned by std::unique_ptr.
          */
-        template <typename InType, typename OutType>
-        inline void concatenate_bits(InType upper, InType lower, OutType& out) noexcept {
-            static constexpr auto bits = type2bit<InType>() ;
-            static const auto lower_mask = util::bit2mask(bits) ;
+        struct GdiObjectDeleter {
+            void operator()(HGDIOBJ object) const noexcept {
+                DeleteObject(object) ;
+            }
+        } ;
+
+        /**
+         * @brief Move-only owner of a GDI object such as HBRUSH.
+         */
+        template <typename Handle>
+        using UniqueGdiObject = std::unique_ptr<
+            typename std::remove_pointer<Handle>::type, GdiObjectDeleter> ;
+
+        /**
+         * @brief Deleter to destroy an icon owned by std::unique_ptr.
+         */
+        struct IconDeleter {
+            void operator()(HICON icon) const noexcept {
+                DestroyIcon(icon) ;
+            }
+        } ;
+
+        /**
+         * @brief Move-only owner of an icon loaded by LoadImageW.
+         */
+        using UniqueIcon = std::unique_ptr<std::remove_pointer<HICON>::type, IconDeleter> ;
+
+        /**
+         * @brief Deleter to free a module owned by std::unique_ptr.
+         */
+        struct ModuleDeleter {
+            void operator()(HMODULE module) const noexcept {
+                FreeLibrary(module) ;
+            }
+        } ;
+
+        /**
+         * @brief Move-only owner of a module loaded by LoadLibraryW.
+         */
+        using UniqueModule = std::unique_ptr<std::remove_pointer<HMODULE>::type, ModuleDeleter> ;
+
+        /**
+         * @brief Deleter to unregister a power setting notification owned by std::unique_ptr.
+         */
+        struct PowerNotificationDeleter {
+            void operator()(HPOWERNOTIFY notification) const noexcept {
+                UnregisterPowerSettingNotification(notification) ;
+            }
+        } ;
+
+        /**
+         * @brief Move-only owner of a notification registered by RegisterPowerSettingNotification.
+         */
+        using UniquePowerNotification = std::unique_ptr<
+            std::remove_pointer<HPOWERNOTIFY>::type, PowerNotificationDeleter> ;
+
+        /**
+         * @brief Deleter to unregister the session notification of a window owned by std::unique_ptr.
+         * @details The function is loaded dynamically, so the deleter keeps it. Its module must be freed after the deleter is called.
+         */
+        struct SessionNotificationDeleter {
+            using Unregister = BOOL (WINAPI*)(HWND) ;
+            Unregister unregister ;
+
+            SessionNotificationDeleter(Unregister unregister_=nullptr) noexcept
+            : unregister(unregister_)
+            {}
+
+            void operator()(HWND hwnd) const noexcept {
+                if(unregister) {
+                    unregister(hwnd) ;
+                }
+            }
+        } ;
+
+        /**
+         * @brief Move-only owner of the session notification registered for a window by WTSRegisterSessionNotification.
+         */
+        using UniqueSessionNotification = std::unique_ptr<
+            std::remove_pointer<HWND>::type, SessionNotificationDeleter> ;
 
-            auto out_upper = static_cast<std::size_t>(upper) << bits ;
-            auto out_lower = static_cast<std::size_t>(lower) & lower_mask ;
-            out = (OutType)(out_upper | out_lower) ;
-        }
         /**
-         * @brief Calculate grayscale value from RGB
-         * @param [in] rgb A input rgb value.
-         * @return The grayscale value.
+         * @brief Read the pixels of icon as 32-bit ARGB.
+         * @param [in] hicon The handle of icon.
+         * @param [out] pixels The top-down pixels in 0xAARRGGBB format.
+         * @param [out] width The width of icon.
+         * @param [out] height The height of icon.
+         * @return Returns true on success, false on failure.
+         * @details If the icon has no alpha channel, the alpha is generated from the mask bitmap.
+         * @sa create_icon_from_pixels
          */
-        inline unsigned char rgb2gray(const COLORREF& rgb) {
-            auto r = GetRValue(rgb) ;
-            auto g = GetGValue(rgb) ;
-            auto b = GetBValue(rgb) ;
-            return static_cast<unsigned char>(0.2126 * r + 0.7152 * g + 0.0722 * b) ;
+        inline bool get_icon_pixels(
+                HICON hicon,
+                std::vector<std::uint32_t>& pixels,
+                int& width,
+                int& height) {
+            ICONINFO info ;
+            if(!GetIconInfo(hicon, &info)) {
+                return false ;
+            }
+
+            auto read_bitmap = [] (HBITMAP bitmap, int w, int h, std::vector<std::uint32_t>& out) {
+                BITMAPINFO bmi = {} ;
+                bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader) ;
+                bmi.bmiHeader.biWidth = w ;
+                bmi.bmiHeader.biHeight = -h ;  // top-down
+                bmi.bmiHeader.biPlanes = 1 ;
+                bmi.bmiHeader.biBitCount = 32 ;
+                bmi.bmiHeader.biCompression = BI_RGB ;
+
+                out.resize(static_cast<std::size_t>(w) * h) ;
+                auto hdc = GetDC(NULL) ;
+                if(!hdc) {
+                    return false ;
+                }
+                auto lines = GetDIBits(
+                    hdc, bitmap, 0, static_cast<UINT>(h),
+                    out.data(), &bmi, DIB_RGB_COLORS) ;
+                ReleaseDC(NULL, hdc) ;
+                return lines == h ;
+            } ;
+
+            auto result = false ;
+            BITMAP bm ;
+            if(info.hbmColor && GetObjectW(info.hbmColor, sizeof(bm), &bm)) {
+                width = bm.bmWidth ;
+                height = bm.bmHeight ;
+                result = read_bitmap(info.hbmColor, width, height, pixels) ;
+
+                auto has_alpha = std::any_of(
+                    pixels.begin(), pixels.end(),
+                    [] (std::uint32_t px) {return (px >> 24) != 0 ;}) ;
+                if(result && !has_alpha) {
+                    // The white pixels of the mask are transparent.
+                    std::vector<std::uint32_t> mask ;
+                    result = read_bitmap(info.hbmMask, width, height, mask) ;
+                    for(std::size_t i = 0 ; result && i < pixels.size() ; i ++) {
+                        auto alpha = (mask[i] & 0x00FFFFFF) ? 0x00000000u : 0xFF000000u ;
+                        pixels[i] = (pixels[i] & 0x00FFFFFF) | alpha ;
+                    }
+                }
+            }
+
+            if(info.hbmColor) {
+                DeleteObject(info.hbmColor) ;
+            }
+            if(info.hbmMask) {
+                DeleteObject(info.hbmMask) ;
+            }
+            return result ;
         }
 
         /**
-         * @brief Checks if the file exists.
-         * @param [in] path A input wide string of path.
-         * @return Returns true if the file exists, false if it does not.
+         * @brief Create an icon from 32-bit ARGB pixels.
+         * @param [in] pixels The top-down pixels in 0xAARRGGBB format.
+         * @param [in] width The width of icon.
+         * @param [in] height The height of icon.
+         * @return The handle of icon, or NULL on failure. It must be released by DestroyIcon.
+         * @sa get_icon_pixels
          */
-        inline bool exists(const std::wstring& path) {
-            struct _stat buffer ;
-            return _wstat(path.c_str(), &buffer) == 0 ;
+        inline HICON create_icon_from_pixels(
+                const std::uint32_t* pixels,
+                int width,
+                int height) {
+            BITMAPINFO bmi = {} ;
+            bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader) ;
+            bmi.bmiHeader.biWidth = width ;
+            bmi.bmiHeader.biHeight = -height ;  // top-down
+            bmi.bmiHeader.biPlanes = 1 ;
+            bmi.bmiHeader.biBitCount = 32 ;
+            bmi.bmiHeader.biCompression = BI_RGB ;
+
+            void* bits = nullptr ;
+            auto color = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &bits, NULL, 0) ;
+            if(!color) {
+                return NULL ;
+            }
+            std::memcpy(
+                bits, pixels,
+                static_cast<std::size_t>(width) * height * sizeof(std::uint32_t)) ;
+
+            // The mask is ignored for 32-bit icons with alpha, but it is required.
+            auto mask = CreateBitmap(width, height, 1, 1, NULL) ;
+            if(!mask) {
+                DeleteObject(color) ;
+                return NULL ;
+            }
+
+            ICONINFO info = {} ;
+            info.fIcon = TRUE ;
+            info.hbmColor = color ;
+            info.hbmMask = mask ;
+            auto hicon = CreateIconIndirect(&info) ;
+
+            DeleteObject(color) ;
+            DeleteObject(mask) ;
+            return hicon ;
         }
-    }
 
-    /**
-     * @brief Current tray status
-     */
-    enum class TrayStatus : unsigned char
-    {
-        //! The tray is working properly.
-        RUNNING,
+        /**
+         * @brief Copy a region of the screen as 32-bit ARGB pixels.
+         * @param [in] rect The region in screen coordinates.
+         * @param [out] pixels The top-down pixels in 0xAARRGGBB format.
+         * @return Returns true on success, false on failure.
+         * @details The region is copied into a DIB with a single BitBlt.
+         */
+        inline bool capture_screen_pixels(
+                const RECT& rect,
+                std::vector<std::uint32_t>& pixels) {
+            auto width = rect.right - rect.left ;
+            auto height = rect.bottom - rect.top ;
+            if(width <= 0 || height <= 0) {
+                return false ;
+            }
 
-        //! The tray is trying to exit successfully.
-        SHOULD_STOP,
+            BITMAPINFO bmi = {} ;
+            bmi.bmiHeader.biSize = sizeof(bmi.bmiHeader) ;
+            bmi.bmiHeader.biWidth = width ;
+            bmi.bmiHeader.biHeight = -height ;  // top-down
+            bmi.bmiHeader.biPlanes = 1 ;
+            bmi.bmiHeader.biBitCount = 32 ;
+            bmi.bmiHeader.biCompression = BI_RGB ;
 
-        //! The tray has errors.
-        FAILED,
+            auto screen_dc = GetDC(NULL) ;
+            if(!screen_dc) {
+                return false ;
+            }
+            auto result = false ;
+            if(auto memory_dc = CreateCompatibleDC(screen_dc)) {
+                void* bits = nullptr ;
+                if(auto dib = CreateDIBSection(
+                        memory_dc, &bmi, DIB_RGB_COLORS, &bits, NULL, 0)) {
+                    auto original_obj = SelectObject(memory_dc, dib) ;
+                    if(BitBlt(
+                            memory_dc, 0, 0, width, height,
+                            screen_dc, rect.left, rect.top, SRCCOPY)) {
+                        auto src = static_cast<const std::uint32_t*>(bits) ;
+                        pixels.assign(src, src + static_cast<std::size_t>(width) * height) ;
+                        result = true ;
+                    }
+                    SelectObject(memory_dc, original_obj) ;
+                    DeleteObject(dib) ;
+                }
+                DeleteDC(memory_dc) ;
+            }
+            ReleaseDC(NULL, screen_dc) ;
+            return result ;
+        }
 
-        //! The tray is stopped successfully.
-        STOPPED,
-    } ;
+        /**
+         * @brief Get the effective DPI of the monitor at the point.
+         * @param [in] point The point in screen coordinates.
+         * @return The DPI. If the per-monitor DPI is not available, the system DPI is returned.
+         */
+        inline UINT get_dpi_for_point(POINT point) {
+            // Shcore is loaded dynamically so as not to add a link dependency.
+            using GetDpiForMonitorType = HRESULT (WINAPI*)(HMONITOR, int, UINT*, UINT*) ;
+            static const auto GetDpiForMonitor = [] {
+                auto hmodule = LoadLibraryW(L"shcore.dll") ;
+                return hmodule ? reinterpret_cast<GetDpiForMonitorType>(
+                    reinterpret_cast<void*>(GetProcAddress(hmodule, "GetDpiForMonitor"))) : nullptr ;
+            }() ;
+
+            if(GetDpiForMonitor) {
+                if(auto hmonitor = MonitorFromPoint(point, MONITOR_DEFAULTTONEAREST)) {
+                    UINT dpi_x, dpi_y ;
+                    if(GetDpiForMonitor(hmonitor, 0, &dpi_x, &dpi_y) == S_OK) {  // MDT_EFFECTIVE_DPI
+                        return dpi_y ;
+                    }
+                }
+            }
+
+            UINT dpi = default_dpi ;
+            if(auto hdc = GetDC(NULL)) {
+                dpi = static_cast<UINT>(GetDeviceCaps(hdc, LOGPIXELSY)) ;
+                ReleaseDC(NULL, hdc) ;
+            }
+            return dpi ;
+        }
+
+        /**
+         * @brief Set the DPI awareness of the windows created by the current thread.
+         * @param [in] context A input DPI_AWARENESS_CONTEXT value.
+         * @return The previous context. If not supported, returns NULL.
+         * @details It is available on Windows 10 version 1607 or later.
+         */
+        inline void* set_thread_dpi_awareness_context(void* context) {
+            using SetThreadDpiAwarenessContextType = void* (WINAPI*)(void*) ;
+            if(auto hmodule = GetModuleHandleW(L"user32.dll")) {
+                const auto SetThreadDpiAwarenessContext = reinterpret_cast<SetThreadDpiAwarenessContextType>(
+                        reinterpret_cast<void*>(GetProcAddress(hmodule, "SetThreadDpiAwarenessContext"))) ;
+                if(SetThreadDpiAwarenessContext) {
+                    return SetThreadDpiAwarenessContext(context) ;
+                }
+            }
+            return NULL ;
+        }
+    }
 
     /**
      * @brief Class with information on each menu.
      */
     class FluentMenu {
     private:
+        std::string key_ ;
         std::wstring label_ ;
+        std::vector<int> label_extents_ ;
+        LONG label_offset_ ;
+        LONG required_width_ ;
+        std::wstring display_label_ ;
+        LONG max_label_width_ ;
+        util::EllipsisMode ellipsis_mode_ ;
         HICON hicon_ ;
+        util::UniqueIcon loaded_icon_ ;
+        std::wstring icon_path_ ;
 
         bool toggleable_ ;
         bool checked_ ;
@@ -273,13 +505,21 @@ namespace fluent_tray
 
         bool under_line_ ;
 
+        BarStyle bar_style_ ;
+        ValueBar bar_ ;
+        LONG bar_length_ ;
+        LONG bar_thickness_ ;
+        LONG bar_margin_ ;
+
         COLORREF text_color_ ;
         COLORREF back_color_ ;
         COLORREF border_color_ ;
-        HBRUSH back_brush_ ;
+        COLORREF pressed_color_ ;
+        util::UniqueGdiObject<HBRUSH> back_brush_ ;
 
         std::function<bool(void)> callback_ ;
         std::function<bool(void)> unchecked_callback_ ;
+        std::function<bool(int)> value_callback_ ;
 
     public:
         /**
@@ -293,33 +533,47 @@ namespace fluent_tray
             bool toggleable=false,
             const std::function<bool(void)>& callback=[] {return true ;},
             const std::function<bool(void)>& unchecked_callback=[] {return true ;})
-        : label_(),
+        : key_(),
+          label_(),
+          label_extents_(),
+          label_offset_(0),
+          required_width_(0),
+          display_label_(),
+          max_label_width_(0),
+          ellipsis_mode_(util::EllipsisMode::END),
           hicon_(NULL),
+          loaded_icon_(),
+          icon_path_(),
           toggleable_(toggleable),
           checked_(false),
           checkmark_(),
           hwnd_(NULL),
           hmenu_(NULL),
           under_line_(false),
+          bar_style_(BarStyle::NONE),
+          bar_(),
+          bar_length_(0),
+          bar_thickness_(0),
+          bar_margin_(0),
           text_color_(RGB(0, 0, 0)),
           back_color_(RGB(255, 255, 255)),
           border_color_(RGB(128, 128, 128)),
-          back_brush_(NULL),
+          pressed_color_(CLR_INVALID),
+          back_brush_(),
           callback_(callback),
-          unchecked_callback_(unchecked_callback)
+          unchecked_callback_(unchecked_callback),
+          value_callback_([] (int) {return true ;})
         {}
 
-        FluentMenu(const FluentMenu&) = default ;
-        FluentMenu& operator=(const FluentMenu&) = default ;
+        // Copy
+        FluentMenu(const FluentMenu&) = delete ;
+        FluentMenu& operator=(const FluentMenu&) = delete ;
 
+        // Move. The moved-from menu no longer owns the brush and the loaded icon.
         FluentMenu(FluentMenu&&) = default ;
         FluentMenu& operator=(FluentMenu&&) = default ;
 
-        ~FluentMenu() noexcept {
-            if(back_brush_) {
-                DeleteObject(back_brush_) ;
-            }
-        }
+        ~FluentMenu() = default ;
 
         /**
          * @brief Creates a menu window.
@@ -364,25 +618,44 @@ namespace fluent_tray
                 hwnd_, WM_CHANGEUISTATE,
                 WPARAM(MAKELONG(UIS_SET, UISF_HIDEFOCUS)), 0) ;
 
-            if(!icon_path.empty()) {
-                std::wstring icon_path_wide ;
-                if(!util::string2wstring(icon_path, icon_path_wide)) {
-                    return false ;
-                }
+            return load_icon(icon_path) ;
+        }
 
-                if(!util::exists(icon_path_wide)) {
-                    return false ;
-                }
+        /**
+         * @brief Take over a hidden menu window of a removed menu instead of creating a new one.
+         * @param [in] hwnd The window handle of the removed menu.
+         * @param [in] id A new unique identifier.
+         * @param [in] label_text A label text.
+         * @param [in] icon_path An icon path to show next to the label.
+         * @param [in] checkmark A checkmark string.
+         * @return Returns true on success, false on failure.
+         */
+        bool reuse_menu(
+                HWND hwnd,
+                std::size_t id,
+                const std::string& label_text="",
+                const std::string& icon_path="",
+                const std::string& checkmark="✓") {
+            if(!util::string2wstring(label_text, label_)) {
+                return false ;
+            }
+            if(!util::string2wstring(checkmark, checkmark_)) {
+                return false ;
+            }
 
-                hicon_ = static_cast<HICON>(LoadImageW(
-                        NULL, icon_path_wide.c_str(),
-                        IMAGE_ICON, 0, 0, LR_LOADFROMFILE)) ;
-                if(!hicon_) {
-                    return false ;
-                }
+            // WM_COMMAND carries the new identifier from now on.
+            SetLastError(0) ;
+            if(!SetWindowLongPtrW(hwnd, GWLP_ID, static_cast<LONG_PTR>(id))
+                    && GetLastError() != 0) {
+                return false ;
+            }
+            if(!SetWindowTextW(hwnd, label_.c_str())) {
+                return false ;
             }
+            hmenu_ = reinterpret_cast<HMENU>(id) ;
+            hwnd_ = hwnd ;
 
-            return true ;
+            return load_icon(icon_path) ;
         }
 
         /**
@@ -400,6 +673,109 @@ namespace fluent_tray
             return callback_() ;
         }
 
+        /**
+         * @brief Show a value bar in the menu.
+         * @param [in] style The style of bar.
+         * @param [in] bar The range and initial value.
+         * @param [in] value_callback Function called when the value of a slider is changed by the user.
+         * @details The bar is drawn at the right end of the menu. The callback function must be a function with a bool return value and the new value as an argument. The tray will exit successfully if the callback function returns false.
+         */
+        void set_bar(
+                BarStyle style,
+                const ValueBar& bar=ValueBar(),
+                const std::function<bool(int)>& value_callback=[] (int) {return true ;}) {
+            bar_style_ = style ;
+            bar_ = bar ;
+            value_callback_ = value_callback ;
+        }
+
+        /**
+         * @brief Refer to the style of value bar.
+         * @return The style of bar.
+         */
+        BarStyle bar_style() const noexcept {
+            return bar_style_ ;
+        }
+
+        /**
+         * @brief Refer to the value of bar.
+         * @return The current value.
+         */
+        int value() const noexcept {
+            return bar_.value() ;
+        }
+
+        /**
+         * @brief Change the value of bar.
+         * @param [in] value The new value. It is clamped into the range.
+         * @param [out] dirty_rect The client area to be redrawn. It is empty if nothing has to be redrawn.
+         * @return Returns true on success, false on failure.
+         * @details Only the span between the old and new filled edges is reported as dirty, so no relayout is needed.
+         */
+        bool set_value(int value, RECT& dirty_rect) {
+            dirty_rect = RECT{0, 0, 0, 0} ;
+            auto old_value = bar_.value() ;
+            if(!bar_.set_value(value)) {
+                return true ;
+            }
+            if(!hwnd_ || bar_length_ <= 0) {
+                // Not laid out yet.
+                return true ;
+            }
+
+            RECT bar_rect ;
+            if(!get_bar_rect(bar_rect)) {
+                return false ;
+            }
+
+            int left, right ;
+            auto thumb_width = bar_style_ == BarStyle::SLIDER ? 2 * bar_thickness_ : 0 ;
+            if(bar_.calculate_dirty_span(
+                    old_value, bar_.value(), bar_length_, thumb_width, left, right)) {
+                dirty_rect = bar_rect ;
+                dirty_rect.left = bar_rect.left + left ;
+                dirty_rect.right = bar_rect.left + right ;
+            }
+            return true ;
+        }
+
+        /**
+         * @brief Calculate the value of slider at a position in the menu.
+         * @param [in] pos The position in the client coordinates of the menu.
+         * @param [out] value The value snapped to the step.
+         * @return Returns true if the position is on the bar, false otherwise or on failure.
+         * @details The thumb overhangs the ends of the bar, so its half width is also accepted on both sides.
+         */
+        bool calculate_value_from_position(POINT pos, int& value) const {
+            RECT bar_rect ;
+            if(!get_bar_rect(bar_rect)) {
+                return false ;
+            }
+            if(pos.x < bar_rect.left - bar_thickness_ || pos.x >= bar_rect.right + bar_thickness_
+                    || pos.y < bar_rect.top || pos.y >= bar_rect.bottom) {
+                return false ;
+            }
+            value = bar_.from_pixels(
+                static_cast<int>(pos.x - bar_rect.left), static_cast<int>(bar_length_)) ;
+            return true ;
+        }
+
+        /**
+         * @brief Refer to the step of value bar.
+         * @return The step.
+         */
+        int step() const noexcept {
+            return bar_.step() ;
+        }
+
+        /**
+         * @brief Execute the process when the value of slider is changed by the user.
+         * @return Returns true on success, false on failure.
+         */
+        bool process_value_event() {
+            return value_callback_(bar_.value()) ;
+        }
+
         /**
          * @brief Checks the menu if it is toggleable.
          * @details Update only the current state without calling the callback function.
@@ -431,6 +807,50 @@ namespace fluent_tray
             return checked_ ;
         }
 
+        /**
+         * @brief Refer to the label.
+         * @return The wide string of label.
+         */
+        const std::wstring& label() const noexcept {
+            return label_ ;
+        }
+
+        /**
+         * @brief Refer to the checkmark string.
+         * @return The wide string of checkmark.
+         */
+        const std::wstring& checkmark() const noexcept {
+            return checkmark_ ;
+        }
+
+        /**
+         * @brief Replace the functions called when the menu is clicked.
+         * @param [in] callback Function called when a click on the menu or a check is enabled.
+         * @param [in] unchecked_callback Function called when a check is disabled.
+         */
+        void set_callbacks(
+                const std::function<bool(void)>& callback,
+                const std::function<bool(void)>& unchecked_callback) {
+            callback_ = callback ;
+            unchecked_callback_ = unchecked_callback ;
+        }
+
+        /**
+         * @brief Refer to the key to match the menu with a MenuSpec.
+         * @return The key. It is empty if the menu is not added by FluentTray::reconcile_menus.
+         */
+        const std::string& key() const noexcept {
+            return key_ ;
+        }
+
+        /**
+         * @brief Change the key to match the menu with a MenuSpec.
+         * @param [in] key The key.
+         */
+        void set_key(const std::string& key) {
+            key_ = key ;
+        }
+
         /**
          * @brief Check if the menu is toggleable.
          * @return Returns true if the menu is toggleable, false otherwise.
@@ -472,76 +892,217 @@ namespace fluent_tray
         }
 
         /**
-         * @brief Show a separator line under the menu.
-         */
-        void show_separator_line() noexcept {
-            under_line_ = true ;
-        }
-
-        /**
-         * @brief Hide a separator line under the menu.
+         * @brief Set menu label from UTF-8 string.
+         * @param [in] label_text The UTF-8 encoded label text.
+         * @return Returns true on success, false on failure.
+         * @details The label is measured again when the menu is shown. Use update_label to change the label of the menu being shown.
          */
-        void hide_separator_line() noexcept {
-            under_line_ = false ;
+        bool set_label(const std::string& label_text) {
+            if(!util::string2wstring(label_text, label_)) {
+                return false ;
+            }
+            label_extents_.clear() ;
+            return true ;
         }
 
         /**
-         * @brief Set the menu color.
-         * @param [in] text_color The color for label text.
-         * @param [in] back_color The color for background.
-         * @param [in] border_color The color for separator line.
+         * @brief Change the label and re-measure only this menu.
+         * @param [in] label_text The UTF-8 encoded label text.
+         * @param [in] font The handle of font.
+         * @param [out] dirty_rect The client area to be redrawn. It is empty if the label is not changed.
          * @return Returns true on success, false on failure.
-         * @details If the set value is CLR_INVALID, the value is not changed.
          */
-        bool set_color(
-                const COLORREF& text_color=CLR_INVALID,
-                const COLORREF& back_color=CLR_INVALID,
-                const COLORREF& border_color=CLR_INVALID) noexcept {
-            if(text_color != CLR_INVALID) {
-                text_color_ = text_color ;
-            }
-            if(back_color != CLR_INVALID) {
-                back_color_ = back_color ;
+        bool update_label(
+                const std::string& label_text,
+                HFONT font,
+                RECT& dirty_rect) {
+            std::wstring new_label ;
+            if(!util::string2wstring(label_text, new_label)) {
+                return false ;
             }
-            if(border_color != CLR_INVALID) {
-                border_color_ = border_color ;
+
+            auto old_label = std::move(label_) ;
+            auto old_extents = std::move(label_extents_) ;
+            auto old_truncated = !display_label_.empty() ;
+            label_ = std::move(new_label) ;
+            if(!measure_label(font)) {
+                return false ;
             }
 
-            // Create brush handle to draw a background of window.
-            if(back_brush_) {
-                // Release old handle.
-                if(!DeleteObject(back_brush_)) {
-                    return false ;
-                }
+            dirty_rect = RECT{0, 0, 0, 0} ;
+            int left, right ;
+            if(!util::calculate_dirty_span(
+                    old_label, old_extents, label_, label_extents_, left, right)) {
+                return true ;
+            }
+            if(old_truncated || !display_label_.empty()) {
+                // The ellipsis may move, so redraw the whole label.
+                left = 0 ;
+                right = (std::max)(
+                    old_extents.empty() ? 0 : old_extents.back(),
+                    label_extents_.empty() ? 0 : label_extents_.back()) ;
             }
-            back_brush_ = CreateSolidBrush(back_color_) ;
-            if(back_brush_ == NULL) {
+            if(!GetClientRect(hwnd_, &dirty_rect)) {
                 return false ;
             }
-
+            dirty_rect.left = label_offset_ + left ;
+            dirty_rect.right = (std::min)(dirty_rect.right, label_offset_ + right) ;
             return true ;
         }
 
         /**
-         * @brief Draws a menu using drawing information and the specified font.
-         * @param [in] info Structure that holds drawing information.
+         * @brief Measure the label and cache the extents of each character.
          * @param [in] font The handle of font.
          * @return Returns true on success, false on failure.
-         * @details info is the <a href="https://learn.microsoft.com/en-us/windows/win32/api/winuser/ns-winuser-drawitemstruct">DRAWITEMSTRUCT</a> obtained when the owner window receives a <a href="https://learn.microsoft.com/en-us/windows/win32/controls/wm-drawitem">WM_DRAWITEM</a> message.
+         * @sa required_width
          */
-        bool draw_menu(LPDRAWITEMSTRUCT info, HFONT font) const {
-            if(SetTextColor(info->hDC, text_color_) == CLR_INVALID) {
+        bool measure_label(HFONT font) {
+            auto hdc = GetDC(hwnd_) ;
+            if(!hdc) {
                 return false ;
             }
 
-            if(SetBkColor(info->hDC, back_color_) == CLR_INVALID) {
+            auto result = measure_label_with_dc(hdc, font) ;
+            if(!ReleaseDC(hwnd_, hdc)) {
                 return false ;
             }
+            return result ;
+        }
 
-            if(font) {
-                if(!SelectObject(info->hDC, font)) {
-                    return false ;
-                }
+        /**
+         * @brief Limit the width of label and omit the overflow with an ellipsis.
+         * @param [in] max_width The maximum width of label in pixels. Zero means no limit.
+         * @param [in] mode The position of the ellipsis.
+         * @details It takes effect from the next measure_label or update_label.
+         */
+        void set_max_label_width(
+                LONG max_width,
+                util::EllipsisMode mode=util::EllipsisMode::END) noexcept {
+            max_label_width_ = max_width ;
+            ellipsis_mode_ = mode ;
+        }
+
+        /**
+         * @brief Check if the label is truncated.
+         * @return Returns true if truncated with an ellipsis, false otherwise.
+         */
+        bool is_label_truncated() const noexcept {
+            return !display_label_.empty() ;
+        }
+
+        /**
+         * @brief Refer to the width required to show the menu.
+         * @return The width measured by the last measure_label or update_label.
+         */
+        LONG required_width() const noexcept {
+            return required_width_ ;
+        }
+
+        /**
+         * @brief Show a separator line under the menu.
+         */
+        void show_separator_line() noexcept {
+            under_line_ = true ;
+        }
+
+        /**
+         * @brief Get the path of the icon.
+         * @return The wide string of path. If the menu has no icon, it is empty.
+         */
+        const std::wstring& icon_path() const noexcept {
+            return icon_path_ ;
+        }
+
+        /**
+         * @brief Change the icon drawn next to the label.
+         * @param [in] hicon The icon handle. It is not released by the menu.
+         * @details It is used to draw the icon prepared for the DPI of the monitor. The icon loaded by the menu is released because it is no longer drawn.
+         */
+        void set_icon(HICON hicon) noexcept {
+            if(hicon != loaded_icon_.get()) {
+                loaded_icon_.reset() ;
+            }
+            hicon_ = hicon ;
+        }
+
+        /**
+         * @brief Hide a separator line under the menu.
+         */
+        void hide_separator_line() noexcept {
+            under_line_ = false ;
+        }
+
+        /**
+         * @brief Check if a separator line is shown under the menu.
+         * @return Returns true if the separator line is shown, false otherwise.
+         */
+        bool has_separator_line() const noexcept {
+            return under_line_ ;
+        }
+
+        /**
+         * @brief Set the menu color.
+         * @param [in] text_color The color for label text.
+         * @param [in] back_color The color for background.
+         * @param [in] border_color The color for separator line.
+         * @param [in] pressed_color The color for background while pressed.
+         * @return Returns true on success, false on failure.
+         * @details If the set value is CLR_INVALID, the value is not changed.
+         */
+        bool set_color(
+                const COLORREF& text_color=CLR_INVALID,
+                const COLORREF& back_color=CLR_INVALID,
+                const COLORREF& border_color=CLR_INVALID,
+                const COLORREF& pressed_color=CLR_INVALID) noexcept {
+            if(text_color != CLR_INVALID) {
+                text_color_ = text_color ;
+            }
+            if(back_color != CLR_INVALID) {
+                back_color_ = back_color ;
+            }
+            if(border_color != CLR_INVALID) {
+                border_color_ = border_color ;
+            }
+            if(pressed_color != CLR_INVALID) {
+                pressed_color_ = pressed_color ;
+            }
+
+            // Create brush handle to draw a background of window. The old handle is released.
+            back_brush_.reset(CreateSolidBrush(back_color_)) ;
+            if(!back_brush_) {
+                return false ;
+            }
+
+            return true ;
+        }
+
+        /**
+         * @brief Draws a menu using drawing information and the specified font.
+         * @param [in] info Structure that holds drawing information.
+         * @param [in] font The handle of font.
+         * @return Returns true on success, false on failure.
+         * @details info is the <a href="https://learn.microsoft.com/en-us/windows/win32/api/winuser/ns-winuser-drawitemstruct">DRAWITEMSTRUCT</a> obtained when the owner window receives a <a href="https://learn.microsoft.com/en-us/windows/win32/controls/wm-drawitem">WM_DRAWITEM</a> message.
+         */
+        bool draw_menu(LPDRAWITEMSTRUCT info, HFONT font) const {
+            if(SetTextColor(info->hDC, text_color_) == CLR_INVALID) {
+                return false ;
+            }
+
+            auto back_color = back_color_ ;
+            if((info->itemState & ODS_SELECTED) && pressed_color_ != CLR_INVALID) {
+                back_color = pressed_color_ ;
+                if(!fill_rect(info->hDC, info->rcItem, back_color)) {
+                    return false ;
+                }
+            }
+            if(SetBkColor(info->hDC, back_color) == CLR_INVALID) {
+                return false ;
+            }
+
+            if(font) {
+                if(!SelectObject(info->hDC, font)) {
+                    return false ;
+                }
             }
 
             LONG checkmark_size, label_height, icon_size, margin ;
@@ -567,16 +1128,17 @@ namespace fluent_tray
 
             if(hicon_) {
                 if(!DrawIconEx(
-                        info->hDC, x, y_center - SM_CYICON / 2, hicon_,
+                        info->hDC, x, y_center - icon_size / 2, hicon_,
                         icon_size, icon_size, 0, NULL, DI_NORMAL)) {
                     return false ;
                 }
             }
             x += icon_size + margin ;
 
+            const auto& label = display_label_.empty() ? label_ : display_label_ ;
             if(!TextOutW(
-                    info->hDC, x, y_center - label_height / 2, label_.c_str(),
-                    static_cast<int>(label_.length()))) {
+                    info->hDC, x, y_center - label_height / 2, label.c_str(),
+                    static_cast<int>(label.length()))) {
                 return false ;
             }
 
@@ -599,6 +1161,12 @@ namespace fluent_tray
                 }
             }
 
+            if(bar_style_ != BarStyle::NONE) {
+                if(!draw_bar(info->hDC, info->rcItem)) {
+                    return false ;
+                }
+            }
+
             return true ;
         }
         /**
@@ -607,7 +1175,7 @@ namespace fluent_tray
          * @details Used for the return value of <a href="https://learn.microsoft.com/en-us/windows/win32/controls/wm-ctlcolorbtn">WM_CTLCOLORBTN</a> message.
          */
         HBRUSH background_brush() const noexcept {
-            return back_brush_ ;
+            return back_brush_.get() ;
         }
         /**
          * @brief Calculates the size of the bounding box surrounding the menu based on the font information and the length of the label.
@@ -636,12 +1204,167 @@ namespace fluent_tray
             }
 
             size.cx += margin + checkmark_size + margin + icon_size + margin ;
+            if(bar_style_ != BarStyle::NONE) {
+                size.cx += calculate_bar_length(label_height) + margin ;
+            }
 
             return true ;
         }
 
 
     private:
+        bool load_icon(const std::string& icon_path) {
+            if(icon_path.empty()) {
+                return true ;
+            }
+            std::wstring icon_path_wide ;
+            if(!util::string2wstring(icon_path, icon_path_wide)) {
+                return false ;
+            }
+
+            if(!util::exists(icon_path_wide)) {
+                return false ;
+            }
+
+            // The icon loaded before, such as by a reused window, is destroyed here.
+            loaded_icon_.reset(static_cast<HICON>(LoadImageW(
+                    NULL, icon_path_wide.c_str(),
+                    IMAGE_ICON, 0, 0, LR_LOADFROMFILE))) ;
+            hicon_ = loaded_icon_.get() ;
+            if(!hicon_) {
+                return false ;
+            }
+            icon_path_ = std::move(icon_path_wide) ;
+            return true ;
+        }
+
+        bool measure_label_with_dc(HDC hdc, HFONT font) {
+            if(font) {
+                if(!SelectObject(hdc, font)) {
+                    return false ;
+                }
+            }
+
+            SIZE size = {0, 0} ;
+            label_extents_.resize(label_.length()) ;
+            if(!label_.empty()) {
+                if(!GetTextExtentExPointW(
+                        hdc, label_.c_str(), static_cast<int>(label_.length()),
+                        0, NULL, label_extents_.data(), &size)) {
+                    return false ;
+                }
+            }
+
+            LONG checkmark_size, label_height, icon_size, margin ;
+            if(!calculate_layouts(
+                    hdc, checkmark_size, label_height, icon_size, margin)) {
+                return false ;
+            }
+
+            // Omit the overflow without measuring the text again.
+            display_label_.clear() ;
+            std::size_t head, tail ;
+            if(max_label_width_ > 0 && util::calculate_ellipsis_cut(
+                    label_, label_extents_, max_label_width_, 0, ellipsis_mode_, head, tail)) {
+                const wchar_t ellipsis[] = L"\u2026" ;
+                SIZE ellipsis_size ;
+                if(!GetTextExtentPoint32W(hdc, ellipsis, 1, &ellipsis_size)) {
+                    return false ;
+                }
+                util::calculate_ellipsis_cut(
+                    label_, label_extents_, max_label_width_, ellipsis_size.cx,
+                    ellipsis_mode_, head, tail) ;
+
+                auto len = label_.length() ;
+                display_label_.reserve(head + 1 + tail) ;
+                display_label_.append(label_, 0, head) ;
+                display_label_.append(ellipsis) ;
+                display_label_.append(label_, len - tail, tail) ;
+
+                auto head_width = head == 0 ? 0 : label_extents_[head - 1] ;
+                auto tail_width = tail == 0 ? 0 : label_extents_[len - 1] - label_extents_[len - tail - 1] ;
+                size.cx = head_width + ellipsis_size.cx + tail_width ;
+            }
+
+            label_offset_ = margin + checkmark_size + margin + icon_size + margin ;
+            required_width_ = label_offset_ + size.cx ;
+
+            if(bar_style_ != BarStyle::NONE) {
+                bar_length_ = calculate_bar_length(label_height) ;
+                bar_thickness_ = (std::max)(label_height / 4, static_cast<LONG>(2)) ;
+                bar_margin_ = margin ;
+                required_width_ += bar_length_ + margin ;
+            }
+            return true ;
+        }
+
+        static LONG calculate_bar_length(LONG label_height) noexcept {
+            return 6 * label_height ;
+        }
+
+        bool get_bar_rect(RECT& bar_rect) const {
+            RECT client_rect ;
+            if(!GetClientRect(hwnd_, &client_rect)) {
+                return false ;
+            }
+            calculate_bar_rect(client_rect, bar_rect) ;
+            return true ;
+        }
+
+        void calculate_bar_rect(const RECT& item_rect, RECT& bar_rect) const noexcept {
+            // The bar is aligned to the right end so that bars of all menus line up.
+            auto y_center = item_rect.top + (item_rect.bottom - item_rect.top) / 2 ;
+            auto thumb_height = 2 * bar_thickness_ ;
+            bar_rect.right = item_rect.right - bar_margin_ ;
+            bar_rect.left = bar_rect.right - bar_length_ ;
+            bar_rect.top = y_center - thumb_height / 2 ;
+            bar_rect.bottom = bar_rect.top + thumb_height ;
+        }
+
+        bool draw_bar(HDC hdc, const RECT& item_rect) const {
+            RECT bar_rect ;
+            calculate_bar_rect(item_rect, bar_rect) ;
+
+            auto y_center = bar_rect.top + (bar_rect.bottom - bar_rect.top) / 2 ;
+            auto fill = static_cast<LONG>(bar_.to_pixels(static_cast<int>(bar_length_))) ;
+
+            // Track with the separator color and filled part with the text color.
+            RECT track = {
+                bar_rect.left, y_center - bar_thickness_ / 2,
+                bar_rect.right, y_center - bar_thickness_ / 2 + bar_thickness_} ;
+            if(!fill_rect(hdc, track, border_color_)) {
+                return false ;
+            }
+
+            RECT filled = track ;
+            filled.right = bar_rect.left + fill ;
+            if(filled.left < filled.right) {
+                if(!fill_rect(hdc, filled, text_color_)) {
+                    return false ;
+                }
+            }
+
+            if(bar_style_ == BarStyle::SLIDER) {
+                RECT thumb = bar_rect ;
+                thumb.left = (std::max)(bar_rect.left + fill - bar_thickness_, bar_rect.left) ;
+                thumb.right = (std::min)(bar_rect.left + fill + bar_thickness_, bar_rect.right) ;
+                if(!fill_rect(hdc, thumb, text_color_)) {
+                    return false ;
+                }
+            }
+            return true ;
+        }
+
+        static bool fill_rect(HDC hdc, const RECT& rect, COLORREF color) {
+            if(SetDCBrushColor(hdc, color) == CLR_INVALID) {
+                return false ;
+            }
+            if(!FillRect(hdc, &rect, static_cast<HBRUSH>(GetStockObject(DC_BRUSH)))) {
+                return false ;
+            }
+            return true ;
+        }
+
         bool calculate_layouts(
                 HDC hdc,
                 LONG& checkmark_size,
@@ -674,12 +1397,53 @@ namespace fluent_tray
         bool visible_ ;
         NOTIFYICONDATAW icon_data_ ;
 
+        HICON base_icon_ ;
+        std::vector<std::uint32_t> base_icon_pixels_ ;
+        int base_icon_width_ ;
+        int base_icon_height_ ;
+        BadgeRenderer badge_ ;
+        int badge_count_ ;
+        bool badge_dot_ ;
+        util::UniqueIcon badge_icon_ ;
+        std::vector<std::uint32_t> badge_pixels_ ;
+
+        std::vector<HICON> animation_frames_ ;
+        FrameScheduler animation_ ;
+        bool animation_notification_ ;
+        // The session notification is declared after its module so that it is unregistered first.
+        util::UniqueModule wtsapi_module_ ;
+        util::UniqueSessionNotification session_notification_ ;
+        util::UniquePowerNotification display_notification_ ;
+
         TrayStatus status_ ;
 
-        std::vector<FluentMenu> menus_ ;
-        std::vector<bool> status_if_focus ;
-        std::size_t next_menu_id_ ;
+        SlotMap<FluentMenu> menus_ ;
+        MenuHotTable<HWND> hot_ ;
+        StateBits focus_bits_ ;
+        int focus_index_ ;
+        //! The check states of menus, whose applied states are the painted ones
+        StateBits checked_bits_ ;
+        GridLayout grid_ ;
+        VirtualList list_ ;
+        std::size_t list_first_ ;
+        std::function<bool(std::size_t, std::string&)> list_provider_ ;
+        std::function<bool(std::size_t)> list_callback_ ;
+        PrefixIndex menu_labels_ ;
+        PrefixIndex list_labels_ ;
+        std::vector<std::wstring> list_texts_ ;
+        TypeAhead type_ahead_ ;
+        std::size_t list_count_ ;
+        FuzzyMatcher list_matcher_ ;
+        std::wstring list_query_ ;
+        std::size_t list_filter_limit_ ;
+        bool type_to_filter_ ;
+        MenuIdAllocator menu_ids_ ;
+        std::vector<HWND> spare_windows_ ;
+        KeyedDiff<std::string> menu_diff_ ;
         int select_index_ ;
+        HoverCoalescer hover_ ;
+        UpdateBatch batch_ ;
+        std::size_t count_layout_passes_ ;
 
         POINT previous_mouse_pos_ ;
 
@@ -692,13 +1456,58 @@ namespace fluent_tray
         COLORREF text_color_ ;
         COLORREF back_color_ ;
         COLORREF border_color_ ;
-        unsigned char color_decay_ ;
-        HBRUSH back_brush_ ;
+        COLORREF hover_color_ ;
+        COLORREF pressed_color_ ;
+        ThemeCache theme_ ;
+        TonalPaletteCache palettes_ ;
+        IconTint icon_tint_ ;
+        TintCache<HICON, HICON> icon_tints_ ;
+        unsigned char tone_step_ ;
+        util::UniqueGdiObject<HBRUSH> back_brush_ ;
         int autocolorpick_offset_ ;
 
         LONG menu_font_size_ ;
         HFONT font_ ;
 
+        struct DpiResources {
+            HFONT font ;
+            MenuMetrics metrics ;
+            std::vector<std::pair<std::wstring, HICON>> icons ;
+        } ;
+        std::vector<MonitorTopology> monitors_ ;
+        bool topology_stale_ ;
+        Point popup_anchor_ ;
+
+        LONG max_label_width_ ;
+        util::EllipsisMode ellipsis_mode_ ;
+
+        UINT dpi_ ;
+        LOGFONTW logfont_ ;
+        MenuMetrics base_metrics_ ;
+        DpiCache<DpiResources> dpi_resources_ ;
+
+        struct Submenu {
+            HWND hwnd ;
+            UINT dpi ;
+            LONG width ;
+            LONG height ;
+            std::vector<FluentMenu> menus ;
+        } ;
+        SubmenuTree submenu_tree_ ;
+        LazyCache<Submenu> submenus_ ;
+        CascadeState cascade_ ;
+        std::size_t warm_submenu_capacity_ ;
+
+        struct MenuSection {
+            std::size_t first ;
+            std::size_t count ;
+            std::size_t version ;
+            SectionCache cache ;
+            std::function<ProviderResult(std::vector<MenuSpec>&)> provider ;
+        } ;
+        std::vector<MenuSection> sections_ ;
+        int patching_section_ ;
+
         static unsigned int message_id_ ;
 
     public:
@@ -708,7 +1517,7 @@ namespace fluent_tray
          * @param [in] menu_y_margin Vertical margins outside menus.
          * @param [in] menu_x_pad Horizontal paddings inside menus.
          * @param [in] menu_y_pad Vertical paddings inside menus.
-         * @param [in] autofadedborder_from_backcolor Decay value from the background color to determine the background color of the currently selected menu and the color of the separator line.
+         * @param [in] autofadedborder_from_backcolor Lightness step in 1/255 units of the tonal palette derived from the background color. The palette determines the background colors of the selected and pressed menus and the color of the separator line.
          * @param [in] autocolorpick_offset Pixel offset to determine the background color.
          * @param [in] message_id_offset Unique message identifier.
          */
@@ -725,11 +1534,48 @@ namespace fluent_tray
           hwnd_(NULL),
           visible_(false),
           icon_data_(),
+          base_icon_(NULL),
+          base_icon_pixels_(),
+          base_icon_width_(0),
+          base_icon_height_(0),
+          badge_(),
+          badge_count_(0),
+          badge_dot_(false),
+          badge_icon_(),
+          badge_pixels_(),
+          animation_frames_(),
+          animation_(),
+          animation_notification_(false),
+          wtsapi_module_(),
+          session_notification_(),
+          display_notification_(),
           status_(TrayStatus::STOPPED),
           menus_(),
-          status_if_focus(),
-          next_menu_id_(1),
+          hot_(),
+          focus_bits_(),
+          focus_index_(-1),
+          checked_bits_(),
+          grid_(),
+          list_(),
+          list_first_(0),
+          list_provider_(),
+          list_callback_(),
+          menu_labels_(),
+          list_labels_(),
+          list_texts_(),
+          type_ahead_(),
+          list_count_(0),
+          list_matcher_(),
+          list_query_(),
+          list_filter_limit_(1000),
+          type_to_filter_(false),
+          menu_ids_(),
+          spare_windows_(),
+          menu_diff_(),
           select_index_(-1),
+          hover_(),
+          batch_(),
+          count_layout_passes_(0),
           previous_mouse_pos_(),
           menu_x_margin_(menu_x_margin),
           menu_y_margin_(menu_y_margin),
@@ -738,11 +1584,32 @@ namespace fluent_tray
           text_color_(CLR_INVALID),
           back_color_(CLR_INVALID),
           border_color_(CLR_INVALID),
-          color_decay_(autofadedborder_from_backcolor),
-          back_brush_(NULL),
+          hover_color_(CLR_INVALID),
+          pressed_color_(CLR_INVALID),
+          theme_(),
+          palettes_(),
+          icon_tint_(IconTint::NONE),
+          icon_tints_(),
+          tone_step_(autofadedborder_from_backcolor),
+          back_brush_(),
           autocolorpick_offset_(autocolorpick_offset),
           menu_font_size_(0),
-          font_(NULL)
+          font_(NULL),
+          monitors_(),
+          topology_stale_(true),
+          popup_anchor_{0, 0},
+          max_label_width_(0),
+          ellipsis_mode_(util::EllipsisMode::END),
+          dpi_(util::default_dpi),
+          logfont_(),
+          base_metrics_{0, menu_x_margin, menu_y_margin, menu_x_pad, menu_y_pad},
+          dpi_resources_(),
+          submenu_tree_(),
+          submenus_(),
+          cascade_(),
+          warm_submenu_capacity_(4),
+          sections_(),
+          patching_section_(-1)
         {
             message_id_ = WM_APP + message_id_offset ;
         }
@@ -756,12 +1623,10 @@ namespace fluent_tray
         FluentTray& operator=(FluentTray&&) = default ;
 
         virtual ~FluentTray() noexcept {
-            if(font_ != NULL) {
-                DeleteObject(font_) ;
-            }
-            if(back_brush_ != NULL) {
-                DeleteObject(back_brush_) ;
-            }
+            release_dpi_resources() ;
+            icon_tints_.clear(destroy_tinted_icon) ;
+            release_animation_frames() ;
+            unregister_animation_notification() ;
         }
 
         /**
@@ -797,30 +1662,23 @@ namespace fluent_tray
                 return false ;
             }
 
-            hwnd_ = CreateWindowExW(
-                WS_EX_TOOLWINDOW | WS_EX_LAYERED,
-                app_name_.c_str(),
-                app_name_.c_str(),
-                WS_POPUPWINDOW,
-                0, 0, 100, 100,
-                NULL, NULL,
-                hinstance_, NULL
-            ) ;
-            if(!hwnd_) {
+            if(!create_per_monitor_dpi_aware([this] {
+                    hwnd_ = CreateWindowExW(
+                        WS_EX_TOOLWINDOW | WS_EX_LAYERED,
+                        app_name_.c_str(),
+                        app_name_.c_str(),
+                        WS_POPUPWINDOW,
+                        0, 0, 100, 100,
+                        NULL, NULL,
+                        hinstance_, NULL
+                    ) ;
+                    return hwnd_ != NULL ;
+                })) {
                 return false ;
             }
+            dpi_ = util::to_dpi_bucket(util::get_dpi_for_point(POINT{0, 0})) ;
 
-            // To access the this pointer inside the callback function,
-            // the address divide into the two part address.
-            LONG upper_addr, lower_addr ;
-            util::split_bits(this, upper_addr, lower_addr) ;
-
-            SetLastError(0) ;
-            if(!SetWindowLongW(hwnd_, 0, upper_addr) && GetLastError() != 0) {
-                return false ;
-            }
-            SetLastError(0) ;
-            if(!SetWindowLongW(hwnd_, sizeof(LONG), lower_addr) && GetLastError() != 0) {
+            if(!bind_instance(hwnd_)) {
                 return false ;
             }
 
@@ -899,406 +1757,1060 @@ namespace fluent_tray
                 const std::string& checkmark="✓",
                 const std::function<bool(void)>& callback=[] {return true ;},
                 const std::function<bool(void)>& unchecked_callback=[] {return true ;}) {
-            FluentMenu menu(toggleable, callback, unchecked_callback) ;
-            if(!menu.create_menu(
-                    hinstance_, hwnd_, next_menu_id_,
-                    label_text, icon_path, checkmark)) {
-                return false ;
-            }
-
-            menus_.push_back(std::move(menu)) ;
-            status_if_focus.push_back(false) ;
-            next_menu_id_ ++ ;
-            return true ;
+            return insert_menu(
+                menus_.size(), label_text, icon_path,
+                toggleable, checkmark, callback, unchecked_callback) ;
         }
 
         /**
-         * @brief Add a separator line under the last menu item added.
+         * @brief Insert a menu before a position.
+         * @param [in] position The index of menu to insert before. The number of menus appends the menu.
+         * @param [in] label_text The UTF-8 encoded string of the button label.
+         * @param [in] icon_path An icon path to show next to the label.
+         * @param [in] toggleable Create a switchable menu
+         * @param [in] checkmark A checkmark string.
+         * @param [in] callback Function called when a click on the menu or a check is enabled.
+         * @param [in] unchecked_callback Function called when a check is disabled.
+         * @return Returns true on success, false on failure or if the position is inside the virtual menus.
+         * @details The identifier and the window of a removed menu are reused. While the menu window is shown, only the new menu is measured and only the columns from it are arranged again.
          */
-        void add_separator() {
-            if(!menus_.empty()) {
-                menus_.back().show_separator_line() ;
-            }
+        bool insert_menu(
+                std::size_t position,
+                const std::string& label_text="",
+                const std::string& icon_path="",
+                bool toggleable=false,
+                const std::string& checkmark="✓",
+                const std::function<bool(void)>& callback=[] {return true ;},
+                const std::function<bool(void)>& unchecked_callback=[] {return true ;}) {
+            return insert_configured_menu(
+                position, label_text, icon_path,
+                toggleable, checkmark, callback, unchecked_callback,
+                [] (FluentMenu&) {}) ;
         }
 
         /**
-         * @brief Get window message and update tray.
-         * @return Returns true on success, false on failure.
+         * @brief Remove a menu.
+         * @param [in] index The index of menu.
+         * @return Returns true on success, false on failure or if the menu is one of the virtual menus.
+         * @details The window of the menu is hidden and kept for the next insertion, and its identifier is released for reuse.
          */
-        bool update() {
-            if(status_ == TrayStatus::FAILED) {
+        bool remove_menu(std::size_t index) {
+            if(index >= menus_.size() || is_virtual_menu(index)) {
                 return false ;
             }
-
-            MSG msg ;
-            get_message(msg) ;
-
-            if(GetForegroundWindow() != hwnd_ && visible_) {
-                if(!hide_menu_window()) {
-                    fail() ;
-                    return false ;
-                }
+            if(!clear_focus()) {
+                return false ;
             }
-
-            POINT pos ;
-            if(GetCursorPos(&pos)) {
-                if(pos.x != previous_mouse_pos_.x || pos.y != previous_mouse_pos_.y) {
-                    // The mouse cursor is moved, so switch to the mouse-mode.
-                    for(int i = 0 ; i < static_cast<int>(menus_.size()) ; i ++) {
-                        auto& menu = menus_[i] ;
-                        auto detected_hwnd = WindowFromPoint(pos) ;
-                        if(!detected_hwnd) {
-                            return false ;
-                        }
-                        // Checks whether the mouse cursor is over the menu or not.
-                        if(detected_hwnd == menu.window_handle()) {
-                            // Start selection by key from the currently selected menu.
-                            select_index_ = i ;
-                            break ;
-                        }
-                    }
-                    previous_mouse_pos_ = pos ;
-                }
+            if(hot_.is_submenu(index) && !close_submenus(0)) {
+                return false ;
             }
 
-            if(select_index_ < 0) {
-                return true ;
+            auto hwnd = menus_[index].window_handle() ;
+            ShowWindow(hwnd, SW_HIDE) ;
+            spare_windows_.push_back(hwnd) ;
+            menu_labels_.erase(hot_.id(index), menus_[index].label()) ;
+            menu_ids_.release(hot_.id(index)) ;
+            hot_.erase(index) ;
+            menus_.erase(menus_.handle_at(index)) ;
+            shift_sections_for_remove(index) ;
+
+            if(list_.count_rows() > 0 && index < list_first_) {
+                list_first_ -- ;
             }
-
-            // Update the color of only changed menu.
-            for(int i = 0 ; i < static_cast<int>(menus_.size()) ; i ++) {
-                if(i == select_index_) {
-                    if(!status_if_focus[i]) {
-                        // OFF -> ON
-                        if(!change_menu_back_color(menus_[i], border_color_)) {
-                            fail() ;
-                            return false ;
-                        }
-                    }
-                    status_if_focus[i] = true ;
-                }
-                else {
-                    if(status_if_focus[i]) {
-                        // ON -> OFF
-                        if(!change_menu_back_color(menus_[i], back_color_)) {
-                            fail() ;
-                            return false ;
-                        }
-                    }
-                    status_if_focus[i] = false ;
-                }
+            if(select_index_ == static_cast<int>(index)) {
+                select_index_ = -1 ;
             }
-
-            return true ;
+            else if(select_index_ > static_cast<int>(index)) {
+                select_index_ -- ;
+            }
+            return rearrange_menus(index) ;
         }
 
         /**
-         * @brief Create a message loop to update the tray.
-         * @param [in] sleep_time
-         * @return Returns true on success, false on failure.
+         * @brief Move a menu to another position.
+         * @param [in] from The current index of menu.
+         * @param [in] to The new index of menu.
+         * @return Returns true on success, false on failure or if the virtual menus would be split.
+         * @details The menu keeps its window, identifier and handle. Only the columns from the upper position are arranged again.
          */
-        bool update_with_loop(
-            std::chrono::milliseconds sleep_time=std::chrono::milliseconds(1)) {
-
-            while(true) {
-                if(status_ == TrayStatus::SHOULD_STOP) {
-                    status_ = TrayStatus::STOPPED ;
-                    break ;
-                }
-
-                if(!update()) {
-                    return false ;
-                }
+        bool move_menu(std::size_t from, std::size_t to) {
+            if(from >= menus_.size() || to >= menus_.size() || is_virtual_menu(from)) {
+                return false ;
+            }
+            if(from == to) {
+                return true ;
+            }
+            auto list_first = list_first_ ;
+            if(list_.count_rows() > 0 && from < list_first) {
+                list_first -- ;
+            }
+            if(!shift_virtual_menus(to, list_first)) {
+                return false ;
+            }
+            if(!clear_focus()) {
+                return false ;
+            }
 
-                Sleep(static_cast<int>(sleep_time.count())) ;
+            hot_.move(from, to) ;
+            menus_.move(from, to) ;
+            list_first_ = list_first ;
+            shift_sections_for_remove(from) ;
+            shift_sections_for_insert(to) ;
+
+            auto select = select_index_ ;
+            auto f = static_cast<int>(from) ;
+            auto t = static_cast<int>(to) ;
+            if(select == f) {
+                select_index_ = t ;
             }
-            return true ;
+            else if(f < select && select <= t) {
+                select_index_ -- ;
+            }
+            else if(t <= select && select < f) {
+                select_index_ ++ ;
+            }
+            return rearrange_menus((std::min)(from, to)) ;
         }
 
         /**
-         * @brief Refer to the handle of menu window.
-         * @return The handle of window.
+         * @brief Make the menus match a complete description.
+         * @param [in] specs The descriptions of all menus from the top. The keys must be unique and not empty.
+         * @return Returns true on success, false on failure or if the tray has virtual menus or sections.
+         * @details The menus are matched with the descriptions by key, and only the insertions, removals, moves and changed properties are applied in a single update transaction, so the kept menus do not flicker and their icons are not loaded again. The fewest menus are moved. The menus not added by this function, the menus with value bars, and the menus whose icon, checkmark or toggleability is changed are created again.
          */
-        HWND window_handle() const noexcept {
-            return hwnd_ ;
+        bool reconcile_menus(const std::vector<MenuSpec>& specs) {
+            if(list_.count_rows() > 0 || !sections_.empty()) {
+                return false ;
+            }
+            begin_update() ;
+            auto result = reconcile_range(0, menus_.size(), specs) ;
+            return end_update() && result ;
         }
 
         /**
-         * @brief Show the menu window above the tray icon
+         * @brief Add a section of menus filled by a provider when the menu window is opened.
+         * @param [in] provider Function to fill the descriptions of menus in the section. The keys must be unique and not empty. It is called on a worker thread, so it must not touch the tray. A provider waiting for data returns ProviderResult::PENDING and is called again by the same worker until it is done or the time budget runs out.
+         * @param [in] max_age The age of the descriptions after which they are refreshed on opening.
+         * @param [in] budget The time a pending refresh may take before it is abandoned.
+         * @param [out] section The identifier of section.
          * @return Returns true on success, false on failure.
+         * @details The section starts after the current menus. On opening, the cached menus are shown at once while a stale section is refreshed, and the menus from the refresh are patched in place by key in a single update transaction.
          */
-        bool show_menu_window() {
-            // Initialize the color settings.
-            if(back_color_ == CLR_INVALID) {
-                // If the color is CLR_INVALID, it is determined from the theme.
-                back_color_ = extract_taskbar_color() ;
-                if(back_color_ == CLR_INVALID) {
-                    return false ;
-                }
-                if(!update_background_brush()) {
-                    return false ;
-                }
-            }
-            if(text_color_ == CLR_INVALID) {
-                // The text color is automatically determined from the background color.
-                text_color_ = calculate_text_color_(back_color_) ;
-                if(text_color_ == CLR_INVALID) {
-                    return false ;
-                }
+        bool add_menu_section(
+                const std::function<ProviderResult(std::vector<MenuSpec>&)>& provider,
+                std::chrono::milliseconds max_age,
+                std::chrono::milliseconds budget,
+                std::size_t& section) {
+            if(!provider) {
+                return false ;
             }
-            if(border_color_ == CLR_INVALID) {
-                // The border color is automatically determined from the background color.
-                border_color_ = calculate_faded_color_(back_color_, color_decay_) ;
-                if(border_color_ == CLR_INVALID) {
-                    return false ;
-                }
+            section = sections_.size() ;
+            sections_.push_back(MenuSection{
+                menus_.size(), 0, 0, SectionCache(max_age, budget), provider}) ;
+            return true ;
+        }
+
+        /**
+         * @brief Make the menus of a section stale so that they are refreshed on the next opening.
+         * @param [in] section The identifier of section.
+         * @return Returns true on success, false if there is no such section.
+         */
+        bool invalidate_menu_section(std::size_t section) noexcept {
+            if(section >= sections_.size()) {
+                return false ;
             }
+            sections_[section].cache.invalidate() ;
+            return true ;
+        }
 
-            LONG max_label_size = 0 ;
-            for(auto& menu : menus_) {
-                SIZE size ;
-                if(!menu.calculate_required_dims(font_, size)) {
-                    return false ;
-                }
-                if(max_label_size < size.cx) {
-                    max_label_size = size.cx ;
-                }
+        /**
+         * @brief Refer to the position of the menus of a section.
+         * @param [in] section The identifier of section.
+         * @param [out] first The index of the first menu of the section.
+         * @param [out] count The number of menus in the section.
+         * @return Returns true on success, false if there is no such section.
+         */
+        bool get_menu_section(
+                std::size_t section,
+                std::size_t& first,
+                std::size_t& count) const noexcept {
+            if(section >= sections_.size()) {
+                return false ;
             }
+            first = sections_[section].first ;
+            count = sections_[section].count ;
+            return true ;
+        }
 
-            // Update the sizes
-            auto menu_width = max_label_size + 2 * menu_x_pad_ ;
-            auto menu_height = menu_font_size_ + 2 * menu_y_pad_ ;
-            auto popup_width = 2 * menu_x_margin_ + menu_width ;
-            auto popup_height = static_cast<LONG>(
-                menus_.size() * (menu_y_margin_ + menu_height) + menu_y_margin_) ;
+        /**
+         * @brief Add a menu with a read-only progress bar.
+         * @param [in] label_text The UTF-8 encoded string of the button label.
+         * @param [in] icon_path An icon path to show next to the label.
+         * @param [in] minimum The minimum value of progress.
+         * @param [in] maximum The maximum value of progress.
+         * @param [in] callback Function called when a click on the menu.
+         * @return Returns true on success, false on failure.
+         * @sa set_menu_value
+         */
+        bool add_progress_menu(
+                const std::string& label_text="",
+                const std::string& icon_path="",
+                int minimum=0,
+                int maximum=100,
+                const std::function<bool(void)>& callback=[] {return true ;}) {
+            return insert_configured_menu(
+                menus_.size(), label_text, icon_path, false, "", callback, [] {return true ;},
+                [minimum, maximum] (FluentMenu& menu) {
+                    menu.set_bar(BarStyle::PROGRESS, ValueBar(minimum, maximum, minimum)) ;
+                }) ;
+        }
 
-            POINT cursor_pos ;
-            if(!GetCursorPos(&cursor_pos)) {
+        /**
+         * @brief Add a menu with a slider.
+         * @param [in] label_text The UTF-8 encoded string of the button label.
+         * @param [in] icon_path An icon path to show next to the label.
+         * @param [in] minimum The minimum value of slider.
+         * @param [in] maximum The maximum value of slider.
+         * @param [in] value The initial value of slider.
+         * @param [in] step The increment of value by the left and right keys.
+         * @param [in] value_callback Function called with the new value when the slider is changed by the user.
+         * @return Returns true on success, false on failure.
+         * @details The slider is changed by a click on the bar or the left and right keys. The menu window is kept open while the slider is changed.
+         */
+        bool add_slider_menu(
+                const std::string& label_text="",
+                const std::string& icon_path="",
+                int minimum=0,
+                int maximum=100,
+                int value=0,
+                int step=1,
+                const std::function<bool(int)>& value_callback=[] (int) {return true ;}) {
+            auto position = menus_.size() ;
+            if(!insert_configured_menu(
+                    position, label_text, icon_path, false, "✓",
+                    [] {return true ;}, [] {return true ;},
+                    [minimum, maximum, value, step, &value_callback] (FluentMenu& menu) {
+                        menu.set_bar(
+                            BarStyle::SLIDER, ValueBar(minimum, maximum, value, step),
+                            value_callback) ;
+                    })) {
                 return false ;
             }
+            hot_.set_slider(position, true) ;
+            return true ;
+        }
 
-            RECT work_rect ;
-            if(!SystemParametersInfo(
-                    SPI_GETWORKAREA, 0, reinterpret_cast<PVOID>(&work_rect), 0)) {
+        /**
+         * @brief Change the value of a progress bar or slider.
+         * @param [in] index The index of menu.
+         * @param [in] value The new value.
+         * @return Returns true on success, false on failure.
+         * @details Only the changed span of the bar is redrawn.
+         */
+        bool set_menu_value(std::size_t index, int value) {
+            if(index >= menus_.size()) {
                 return false ;
             }
+            return change_menu_value(menus_[index], value) ;
+        }
 
-            auto screen_width = GetSystemMetrics(SM_CXSCREEN) ;
-            auto screen_height = GetSystemMetrics(SM_CYSCREEN) ;
-
-            auto work_width = work_rect.right - work_rect.left ;
-            auto work_height = work_rect.bottom - work_rect.top ;
+        /**
+         * @brief Change the check status of a toggleable menu without calling its callback.
+         * @param [in] index The index of menu.
+         * @param [in] checked Whether the menu is checked.
+         * @return Returns true on success, false on failure.
+         */
+        bool set_checked(std::size_t index, bool checked) {
+            if(index >= menus_.size()) {
+                return false ;
+            }
+            auto& menu = menus_[index] ;
+            if(checked) {
+                menu.check() ;
+            }
+            else {
+                menu.uncheck() ;
+            }
+            checked_bits_.set(index, menu.is_checked()) ;
+            if(batch_.is_open()) {
+                // Only the changed menus are repainted when the transaction ends.
+                return true ;
+            }
+            return apply_checks() ;
+        }
 
-            auto taskbar_width = screen_width - work_width ;
-            auto taskbar_height = screen_height - work_height ;
+        /**
+         * @brief Begin a transaction to change many menus at once.
+         * @details Until the outermost end_update(), changing labels, values, check status, colors and layout settings only records what to update. The transactions can be nested.
+         */
+        void begin_update() noexcept {
+            batch_.begin() ;
+        }
 
-            auto pos = cursor_pos ;
-            if(taskbar_width == 0) {  // horizontal taskbar
-                if(cursor_pos.y <= taskbar_height) {
-                    //top
-                    pos.y = taskbar_height ;
-                }
-                else {
-                    //bottom
-                    // add 20% offset
-                    pos.y = screen_height - (popup_height + 12 * taskbar_height / 10) ;
-                }
-                pos.x = cursor_pos.x - popup_width / 2 ;
+        /**
+         * @brief End a transaction and apply the deferred updates.
+         * @return Returns true on success, false on failure or if no transaction is in progress.
+         * @details When the outermost transaction ends while the menu window is shown, the theme is applied, the menus are measured and arranged at most once, and the window is repainted once, however many changes were made.
+         */
+        bool end_update() {
+            if(!batch_.is_open()) {
+                return false ;
             }
-            else {  // vertical taskbar
-                if(pos.x <= taskbar_width) {
-                    //left
-                    pos.x = taskbar_width ;
-                }
-                else {
-                    //right
-                    // add 20% offset
-                    pos.x = popup_width + 12 * taskbar_width / 10 ;
-                }
-
-                pos.y = cursor_pos.y - popup_height / 2 ;
+            if(!batch_.end()) {
+                return true ;
             }
-
-            if(!SetWindowPos(
-                    hwnd_, HWND_TOP,
-                    pos.x, pos.y, popup_width, popup_height,
-                    SWP_SHOWWINDOW)) {
+            if(!apply_checks()) {
                 return false ;
             }
-
-            for(std::size_t i = 0 ; i < menus_.size() ; i ++) {
-                auto& menu = menus_[i] ;
-                auto y = \
-                     menu_y_margin_
-                     + static_cast<LONG>(i) * (menu_height + menu_y_margin_) ;
-                if(!SetWindowPos(
-                        menu.window_handle(), HWND_TOP,
-                        menu_x_margin_, y,
-                        menu_width, menu_height,
-                        SWP_SHOWWINDOW)) {
+            if(!visible_) {
+                // Everything is measured and styled when the menu window is shown.
+                return batch_.commit([] (bool, bool) {return true ;}) ;
+            }
+            if(theme_.is_stale()) {
+                if(!refresh_theme(false)) {
                     return false ;
                 }
-
-                if(!menu.set_color(text_color_, back_color_, border_color_)) {
+                batch_.defer_repaint() ;
+            }
+            return batch_.commit([this] (bool layout, bool repaint) {
+                if(layout && !update_layout()) {
                     return false ;
                 }
-            }
-            std::fill(status_if_focus.begin(), status_if_focus.end(), false) ;
+                if(repaint) {
+                    if(!RedrawWindow(
+                            hwnd_, NULL, NULL,
+                            RDW_INVALIDATE | RDW_ERASE | RDW_ALLCHILDREN)) {
+                        return false ;
+                    }
+                }
+                return true ;
+            }) ;
+        }
 
-            if(!SetForegroundWindow(hwnd_)) {
+        /**
+         * @brief Get the number of times the menus are arranged.
+         * @return The number of layout passes.
+         */
+        std::size_t count_layout_passes() const noexcept {
+            return count_layout_passes_ ;
+        }
+
+        /**
+         * @brief Add a scrollable list of menus whose labels are provided on demand.
+         * @param [in] count The number of items.
+         * @param [in] rows The number of menus shown at once.
+         * @param [in] label_provider Function called with the index of an item to get its UTF-8 encoded label.
+         * @param [in] callback Function called with the index of an item when the item is clicked.
+         * @return Returns true on success, false on failure.
+         * @details Only the given number of menus are created and appended to the menus, and they are rebound to the items shown by scrolling with the mouse wheel, the up and down keys at the edges, and the page up and page down keys. So the memory and the cost of showing do not depend on the number of items. The menus not bound to any item are shown empty. The labels of all items are asked once here to index them for typed characters. Only one list can be added.
+         */
+        bool add_virtual_menus(
+                std::size_t count,
+                std::size_t rows,
+                const std::function<bool(std::size_t, std::string&)>& label_provider,
+                const std::function<bool(std::size_t)>& callback=[] (std::size_t) {return true ;}) {
+            if(list_.count_rows() > 0 || rows == 0) {
                 return false ;
             }
 
-            visible_ = true ;
+            auto first = menus_.size() ;
+            for(std::size_t row = 0 ; row < rows ; row ++) {
+                auto on_click = [this, row] {
+                    return !list_.is_bound(row) || list_callback_(list_item(list_.index_of(row))) ;
+                } ;
+                if(!add_menu("", "", false, "", on_click)) {
+                    return false ;
+                }
+            }
 
-            return true ;
+            list_ = VirtualList(count, rows) ;
+            list_count_ = count ;
+            list_first_ = first ;
+            list_provider_ = label_provider ;
+            list_callback_ = callback ;
+            list_texts_.clear() ;
+            list_labels_.clear() ;
+            list_matcher_.truncate(0) ;
+            return index_virtual_menus(count) && bind_virtual_menus() ;
         }
 
         /**
-         * @brief Hide the menu window above the tray icon.
+         * @brief Change the number of items in the list and provide the labels of the shown items again.
+         * @param [in] count The number of items.
          * @return Returns true on success, false on failure.
+         * @details Only the labels of the added items are asked and indexed, and the labels of the removed items are dropped from the index. Call it with the same number to ask the labels of all items again after they are changed, or refresh_virtual_menu for a single changed item.
          */
-        bool hide_menu_window() {
-            ShowWindow(hwnd_, SW_HIDE) ;
-            visible_ = false ;
-            select_index_ = -1 ;
-            std::fill(status_if_focus.begin(), status_if_focus.end(), false) ;
-            return true ;
+        bool set_virtual_menu_count(std::size_t count) {
+            if(list_.count_rows() == 0) {
+                return false ;
+            }
+            if(count == list_count_) {
+                list_texts_.clear() ;
+                list_labels_.clear() ;
+                list_matcher_.truncate(0) ;
+            }
+            else if(count < list_count_) {
+                list_texts_.resize(count) ;
+                list_labels_.truncate(count) ;
+                list_matcher_.truncate(count) ;
+            }
+            list_count_ = count ;
+            if(!index_virtual_menus(count)) {
+                return false ;
+            }
+            if(!list_query_.empty()) {
+                return apply_list_filter() ;
+            }
+            list_.resize(count) ;
+            return bind_virtual_menus() ;
         }
 
         /**
-         * @brief Shows a balloon tip that is placed in the notification area.
-         * @param [in] title The UTF-8 string of title.
-         * @param [in] message The UTF-8 string of message.
-         * @return Returns true on success, false on failure.
-         * @details  Titles longer than 48 characters and messages longer than 200 characters will be trimmed.
+         * @brief Provide the label of an item of the list again after the item is changed.
+         * @param [in] item The index of item.
+         * @return Returns true on success, false on failure or if there is no such item.
+         * @details Only the label of this item is asked and indexed again.
          */
-        bool show_balloon_tip(const std::string& title, const std::string& message) {
-            NOTIFYICONDATAW notify_data = {} ;
-            notify_data.cbSize = sizeof(notify_data) ;
-            notify_data.hWnd = hwnd_ ;
-            notify_data.uFlags = NIF_INFO ;
-
-            std::wstring title_wide ;
-            if(!util::string2wstring(title, title_wide)) {
+        bool refresh_virtual_menu(std::size_t item) {
+            if(item >= list_texts_.size()) {
                 return false ;
             }
-
-            std::wstring message_wide ;
-            if(!util::string2wstring(message, message_wide)) {
+            std::string label ;
+            std::wstring text ;
+            if(!list_provider_(item, label) || !util::string2wstring(label, text)) {
                 return false ;
             }
+            list_labels_.erase(item, list_texts_[item]) ;
+            list_labels_.insert(item, text) ;
+            list_matcher_.replace(item, text) ;
+            list_texts_[item] = std::move(text) ;
+            if(!list_query_.empty()) {
+                return apply_list_filter() ;
+            }
+            return bind_virtual_menus() ;
+        }
 
-            auto title_len = title_wide.length() > 47 ? 47 : title_wide.length() ;
-            std::wmemcpy(
-                notify_data.szInfoTitle, title_wide.c_str(), title_len) ;
-            notify_data.szInfoTitle[title_len] = L'\0' ;
-
-            auto message_len = message_wide.length() > 199 ? 199 : message_wide.length() ;
-            std::wmemcpy(
-                notify_data.szInfo, message_wide.c_str(), message_len) ;
-            notify_data.szInfo[message_len] = L'\0' ;
-
-            if(Shell_NotifyIconW(NIM_MODIFY, &notify_data) == FALSE) {
+        /**
+         * @brief Show only the items of the list whose labels contain the characters of a query in order.
+         * @param [in] query The UTF-8 encoded query. The case is ignored. An empty query shows all items again.
+         * @param [in] limit The maximum number of items shown.
+         * @return Returns true on success, false on failure or if there is no list.
+         * @details The matched items are shown in descending order of score, which prefers consecutive characters and the starts of words. If the query extends the previous one, only the previous matches are tested. While the list is filtered, the indices given to scroll_to_virtual_menu and returned by virtual_menu_offset are the positions in the filtered list, and the callback is still called with the index of item.
+         */
+        bool filter_virtual_menus(const std::string& query, std::size_t limit=1000) {
+            if(list_.count_rows() == 0) {
                 return false ;
             }
-            return true ;
+            if(!util::string2wstring(query, list_query_)) {
+                return false ;
+            }
+            list_filter_limit_ = limit ;
+            return apply_list_filter() ;
         }
 
         /**
-         * @brief Get the current status of tray.
-         * @return The status.
+         * @brief Filter the list by the typed characters instead of jumping to a label.
+         * @param [in] enabled True to filter by typing.
+         * @param [in] limit The maximum number of items shown.
+         * @details The backspace key removes the last character of the query, and the query is cleared when the menu window is hidden.
+         * @sa filter_virtual_menus
          */
-        TrayStatus status() const noexcept {
-            return status_ ;
+        void set_type_to_filter(bool enabled, std::size_t limit=1000) noexcept {
+            type_to_filter_ = enabled ;
+            list_filter_limit_ = limit ;
         }
 
         /**
-         * @brief Exit the tray successfully.
+         * @brief Scroll the list so that an item is shown.
+         * @param [in] index The index of item.
+         * @return Returns true on success, false on failure.
          */
-        void stop() noexcept {
-            status_ = TrayStatus::SHOULD_STOP ;
+        bool scroll_to_virtual_menu(std::size_t index) {
+            if(index >= list_.size()) {
+                return false ;
+            }
+            if(!list_.scroll_to(index)) {
+                return true ;
+            }
+            return bind_virtual_menus() ;
         }
 
         /**
-         * @brief Returns an iterator to the beginning of menus.
-         * @return Iterator to the first element.
+         * @brief Refer to the index of the item shown in the first menu of the list.
+         * @return The index of item.
          */
-        std::vector<FluentMenu>::iterator begin() noexcept {
-            return menus_.begin() ;
+        std::size_t virtual_menu_offset() const noexcept {
+            return list_.offset() ;
         }
 
         /**
-         * @brief Returns an iterator to the end of menus.
-         * @return Iterator to the last element.
+         * @brief Add a separator line under the last menu item added.
          */
-        std::vector<FluentMenu>::iterator end() noexcept {
-            return menus_.end() ;
+        void add_separator() {
+            if(!menus_.empty()) {
+                menus_.back().show_separator_line() ;
+            }
         }
 
         /**
-         * @brief Returns a constant iterator to the beginning of menus.
-         * @return Constant iterator to the first element.
+         * @brief Add a menu opening a cascading submenu.
+         * @param [in] label_text The UTF-8 encoded string of the button label.
+         * @param [in] icon_path An icon path to show next to the label.
+         * @param [out] submenu The identifier of the submenu to add items to.
+         * @return Returns true on success, false on failure.
+         * @details The window, icons and layout of the submenu are created when it is opened for the first time. Until then, the submenu costs only the descriptions of its items.
          */
-        std::vector<FluentMenu>::const_iterator cbegin() const noexcept {
-            return menus_.cbegin() ;
+        bool add_submenu(
+                const std::string& label_text,
+                const std::string& icon_path,
+                std::size_t& submenu) {
+            if(!add_menu(label_text, icon_path)) {
+                return false ;
+            }
+            auto node = submenu_tree_.add_root() ;
+            submenus_.add() ;
+
+            auto index = menus_.size() - 1 ;
+            auto handle = menus_.handle_at(index) ;
+            menus_[index].set_callbacks(
+                [this, node, handle] {
+                    auto menu = find_menu(handle) ;
+                    return menu == nullptr || open_submenu(0, node, menu->window_handle()) ;
+                },
+                [] {return true ;}) ;
+            hot_.set_submenu(index, true) ;
+            submenu = node ;
+            return true ;
         }
 
         /**
-         * @brief Returns a constant iterator to the end of menus.
-         * @return Constant iterator to the last element.
+         * @brief Append an item to a submenu.
+         * @param [in] submenu The identifier of submenu.
+         * @param [in] spec The description of item. The key is not used.
+         * @return Returns true on success, false on failure.
+         * @details If the submenu is already created, it is created again with the item when opened next.
          */
-        std::vector<FluentMenu>::const_iterator cend() const noexcept {
-            return menus_.cend() ;
+        bool add_submenu_menu(std::size_t submenu, const MenuSpec& spec) {
+            if(!submenu_tree_.add_item(submenu, spec)) {
+                return false ;
+            }
+            return release_submenu(submenu) ;
         }
 
         /**
-         * @brief Returns the reference to the beginning of menus.
-         * @return Reference to the first element.
+         * @brief Append an item opening a nested submenu to a submenu.
+         * @param [in] submenu The identifier of submenu.
+         * @param [in] spec The description of item. The key and the callbacks are not used.
+         * @param [out] nested The identifier of the nested submenu to add items to.
+         * @return Returns true on success, false on failure.
          */
-        FluentMenu& front() {
-            return menus_.front() ;
+        bool add_nested_submenu(
+                std::size_t submenu,
+                const MenuSpec& spec,
+                std::size_t& nested) {
+            if(!submenu_tree_.add_nested(submenu, spec, nested)) {
+                return false ;
+            }
+            submenus_.add() ;
+            return release_submenu(submenu) ;
         }
 
         /**
-         * @brief Returns the const reference to the beginning of menus.
-         * @return Const reference to the first element.
+         * @brief Change the number of closed submenus kept for the next opening.
+         * @param [in] count The number of submenus. The least recently opened ones are released first.
          */
-        const FluentMenu& front() const {
-            return menus_.front() ;
+        void set_warm_submenu_count(std::size_t count) {
+            warm_submenu_capacity_ = count ;
+            trim_submenus(count) ;
         }
 
         /**
-         * @brief Returns the reference to the last of menus.
-         * @return Reference to the first element.
+         * @brief Release the windows and icons of the least recently opened submenus.
+         * @param [in] keep The number of submenus to keep. The open submenus are always kept.
+         * @return The number of released submenus.
+         * @details It is also called with zero when the system is low on memory.
          */
-        FluentMenu& back() {
-            return menus_.back() ;
+        std::size_t trim_submenus(std::size_t keep) {
+            return submenus_.trim(keep, [this] (std::size_t node, Submenu& submenu) {
+                if(cascade_.is_open(node)) {
+                    return false ;
+                }
+                // The windows of items are destroyed together.
+                DestroyWindow(submenu.hwnd) ;
+                return true ;
+            }) ;
         }
 
         /**
-         * @brief Returns the const reference to the last of menus.
-         * @return Const reference to the first element.
+         * @brief Get the number of created submenus.
+         * @return The number of submenus whose windows exist.
          */
-        const FluentMenu& back() const {
-            return menus_.back() ;
+        std::size_t count_warm_submenus() const noexcept {
+            return submenus_.count_live() ;
         }
 
         /**
-         * @brief Returns the number of menus.
-         * @return The number of menus.
+         * @brief Get the number of submenus created so far.
+         * @return The number of times submenu windows were created, including the released ones.
+         * @details Only opening a submenu creates its window, so it does not grow with the number of described submenus.
          */
-        std::size_t count_menus() const noexcept {
-            return menus_.size() ;
+        std::size_t count_created_submenus() const noexcept {
+            return submenus_.count_created() ;
         }
 
         /**
-         * @brief Set font information to draw menus.
-         * @param [in] font_size The height of fonts.
-         * @param [in] font_weight The value from 0 to 1000 to determine font weight.
-         * @param [in] font_name The UTF-8 encoded font name for label rendering.
+         * @brief Get window message and update tray.
          * @return Returns true on success, false on failure.
-         * @details For font_weight, you can use the constant value specified for lfWeght in <a href="https://learn.microsoft.com/en-us/windows/win32/api/wingdi/ns-wingdi-logfontw">LOGFONT</a>. The default value used is FW_MEDIUM(500).
+         */
+        bool update() {
+            if(status_ == TrayStatus::FAILED) {
+                return false ;
+            }
+
+            MSG msg ;
+            get_message(msg) ;
+
+            if((visible_ || icon_tint_ != IconTint::NONE) && theme_.is_stale() && !batch_.is_open()) {
+                // The theme is changed while showing the menus or the tray icon is recolored.
+                if(!refresh_theme()) {
+                    fail() ;
+                    return false ;
+                }
+            }
+
+            if(GetForegroundWindow() != hwnd_ && visible_) {
+                if(!hide_menu_window()) {
+                    fail() ;
+                    return false ;
+                }
+            }
+
+            auto now = std::chrono::steady_clock::now() ;
+
+            // The refreshed sections are patched in place.
+            if(!poll_menu_sections(now)) {
+                fail() ;
+                return false ;
+            }
+
+            POINT pos ;
+            if(GetCursorPos(&pos)) {
+                if(pos.x != previous_mouse_pos_.x || pos.y != previous_mouse_pos_.y) {
+                    // The mouse cursor is moved, so switch to the mouse-mode.
+                    auto detected_hwnd = WindowFromPoint(pos) ;
+                    if(!detected_hwnd) {
+                        return false ;
+                    }
+                    // Checks whether the mouse cursor is over the menu or not.
+                    auto index = get_menu_index_from_window(detected_hwnd) ;
+                    if(index >= 0) {
+                        // The selection is applied later by the coalescer.
+                        hover_.request(index, now) ;
+                    }
+                    else if(cascade_.depth() > 0) {
+                        if(!hover_submenu_item(detected_hwnd)) {
+                            fail() ;
+                            return false ;
+                        }
+                    }
+                    previous_mouse_pos_ = pos ;
+                }
+            }
+
+            // Apply at most one hover transition per frame.
+            int hovered_index ;
+            if(hover_.poll(now, hovered_index)) {
+                // Start selection by key from the currently selected menu.
+                select_index_ = hovered_index ;
+            }
+
+            if(select_index_ < 0) {
+                return true ;
+            }
+
+            // Move the focus and update the color of only changed menus.
+            if(select_index_ != focus_index_) {
+                if(focus_index_ >= 0) {
+                    focus_bits_.set(static_cast<std::size_t>(focus_index_), false) ;
+                }
+                focus_bits_.set(static_cast<std::size_t>(select_index_), true) ;
+                focus_index_ = select_index_ ;
+            }
+            if(!apply_focus()) {
+                fail() ;
+                return false ;
+            }
+
+            return true ;
+        }
+
+        /**
+         * @brief Create a message loop to update the tray.
+         * @param [in] sleep_time
+         * @return Returns true on success, false on failure.
+         */
+        bool update_with_loop(
+            std::chrono::milliseconds sleep_time=std::chrono::milliseconds(1)) {
+
+            while(true) {
+                if(status_ == TrayStatus::SHOULD_STOP) {
+                    status_ = TrayStatus::STOPPED ;
+                    break ;
+                }
+
+                if(!update()) {
+                    return false ;
+                }
+
+                Sleep(static_cast<int>(sleep_time.count())) ;
+            }
+            return true ;
+        }
+
+        /**
+         * @brief Refer to the handle of menu window.
+         * @return The handle of window.
+         */
+        HWND window_handle() const noexcept {
+            return hwnd_ ;
+        }
+
+        /**
+         * @brief Set the policy to coalesce hover transitions by the mouse.
+         * @param [in] frame_interval Minimum interval between two hover transitions.
+         * @param [in] intent_delay Time for which the cursor must rest on a menu before it is selected.
+         */
+        void set_hover_policy(
+                std::chrono::milliseconds frame_interval=std::chrono::milliseconds(16),
+                std::chrono::milliseconds intent_delay=std::chrono::milliseconds(0)) noexcept {
+            hover_.set_policy(frame_interval, intent_delay) ;
+        }
+
+        /**
+         * @brief Refer to the number of menu repaints skipped by hover coalescing.
+         * @return The number of avoided repaints.
+         */
+        std::size_t count_avoided_repaints() const noexcept {
+            return hover_.count_avoided_repaints() ;
+        }
+
+        /**
+         * @brief Show the menu window above the tray icon
+         * @return Returns true on success, false on failure.
+         */
+        bool show_menu_window() {
+            // The colors are recomputed only after the theme is changed.
+            if(theme_.is_stale()) {
+                if(!refresh_theme()) {
+                    return false ;
+                }
+            }
+
+            // The cached sections are shown at once while the stale ones are refreshed.
+            if(!open_menu_sections(std::chrono::steady_clock::now())) {
+                return false ;
+            }
+
+            POINT cursor_pos ;
+            if(!GetCursorPos(&cursor_pos)) {
+                return false ;
+            }
+
+            // Use the resources for the DPI of the monitor under the cursor.
+            if(!apply_dpi(util::get_dpi_for_point(cursor_pos))) {
+                return false ;
+            }
+
+            if(!measure_menus()) {
+                return false ;
+            }
+
+            // The popup is placed again from the same point whenever its size is changed.
+            popup_anchor_ = util::to_point(cursor_pos) ;
+            if(!place_popup(SWP_SHOWWINDOW)) {
+                return false ;
+            }
+
+            if(!layout_menus()) {
+                return false ;
+            }
+
+            if(!SetForegroundWindow(hwnd_)) {
+                return false ;
+            }
+
+            visible_ = true ;
+
+            return true ;
+        }
+
+        /**
+         * @brief Change the label of a menu.
+         * @param [in] index The index of menu.
+         * @param [in] label_text The UTF-8 encoded label text.
+         * @return Returns true on success, false on failure.
+         * @details While the menu window is shown, only this menu is measured again and only the changed part of the label is redrawn. The widths of all menus are reflowed only if the widest label is changed.
+         */
+        bool set_label(std::size_t index, const std::string& label_text) {
+            if(index >= menus_.size()) {
+                return false ;
+            }
+            auto& menu = menus_[index] ;
+            if(!is_virtual_menu(index)) {
+                // The labels of virtual menus are indexed by item.
+                menu_labels_.erase(hot_.id(index), menu.label()) ;
+            }
+            bool result ;
+            if(!visible_) {
+                result = menu.set_label(label_text) ;
+            }
+            else {
+                auto reflow_column = grid_.count_columns() ;
+                result = relabel_menu(index, label_text, reflow_column)
+                    && reflow_menus(reflow_column) ;
+            }
+            if(!is_virtual_menu(index)) {
+                menu_labels_.insert(hot_.id(index), menu.label()) ;
+            }
+            return result ;
+        }
+
+        /**
+         * @brief Change the time after which a typed character starts a new prefix.
+         * @param [in] timeout The timeout of typing.
+         * @details While the menu window is shown, typed characters select the next menu whose label starts with them, including the items of the virtual menus. Typing the same character repeatedly cycles through the labels starting with it.
+         */
+        void set_type_ahead_timeout(std::chrono::milliseconds timeout) noexcept {
+            type_ahead_.set_timeout(timeout) ;
+        }
+
+        /**
+         * @brief Hide the menu window above the tray icon.
+         * @return Returns true on success, false on failure.
+         */
+        bool hide_menu_window() {
+            ShowWindow(hwnd_, SW_HIDE) ;
+            visible_ = false ;
+            select_index_ = -1 ;
+            hover_.reset() ;
+            type_ahead_.reset() ;
+
+            // The submenus are kept for the next opening.
+            if(!close_submenus(0)) {
+                return false ;
+            }
+
+            if(type_to_filter_ && !list_query_.empty()) {
+                list_query_.clear() ;
+                if(!apply_list_filter()) {
+                    return false ;
+                }
+            }
+
+            // Restore the background of focused menus for the next showing.
+            return clear_focus() ;
+        }
+
+        /**
+         * @brief Shows a balloon tip that is placed in the notification area.
+         * @param [in] title The UTF-8 string of title.
+         * @param [in] message The UTF-8 string of message.
+         * @return Returns true on success, false on failure.
+         * @details  Titles longer than 48 characters and messages longer than 200 characters will be trimmed.
+         */
+        bool show_balloon_tip(const std::string& title, const std::string& message) {
+            NOTIFYICONDATAW notify_data = {} ;
+            notify_data.cbSize = sizeof(notify_data) ;
+            notify_data.hWnd = hwnd_ ;
+            notify_data.uFlags = NIF_INFO ;
+
+            std::wstring title_wide ;
+            if(!util::string2wstring(title, title_wide)) {
+                return false ;
+            }
+
+            std::wstring message_wide ;
+            if(!util::string2wstring(message, message_wide)) {
+                return false ;
+            }
+
+            auto title_len = title_wide.length() > 47 ? 47 : title_wide.length() ;
+            std::wmemcpy(
+                notify_data.szInfoTitle, title_wide.c_str(), title_len) ;
+            notify_data.szInfoTitle[title_len] = L'\0' ;
+
+            auto message_len = message_wide.length() > 199 ? 199 : message_wide.length() ;
+            std::wmemcpy(
+                notify_data.szInfo, message_wide.c_str(), message_len) ;
+            notify_data.szInfo[message_len] = L'\0' ;
+
+            if(Shell_NotifyIconW(NIM_MODIFY, &notify_data) == FALSE) {
+                return false ;
+            }
+            return true ;
+        }
+
+        /**
+         * @brief Get the current status of tray.
+         * @return The status.
+         */
+        TrayStatus status() const noexcept {
+            return status_ ;
+        }
+
+        /**
+         * @brief Exit the tray successfully.
+         */
+        void stop() noexcept {
+            status_ = TrayStatus::SHOULD_STOP ;
+        }
+
+        /**
+         * @brief Returns an iterator to the beginning of menus.
+         * @return Iterator to the first element.
+         * @details The references to menus are not invalidated by adding menus.
+         */
+        SlotMap<FluentMenu>::iterator begin() {
+            return menus_.begin() ;
+        }
+
+        /**
+         * @brief Returns an iterator to the end of menus.
+         * @return Iterator to the last element.
+         */
+        SlotMap<FluentMenu>::iterator end() {
+            return menus_.end() ;
+        }
+
+        /**
+         * @brief Returns a constant iterator to the beginning of menus.
+         * @return Constant iterator to the first element.
+         */
+        SlotMap<FluentMenu>::const_iterator cbegin() const noexcept {
+            return menus_.cbegin() ;
+        }
+
+        /**
+         * @brief Returns a constant iterator to the end of menus.
+         * @return Constant iterator to the last element.
+         */
+        SlotMap<FluentMenu>::const_iterator cend() const noexcept {
+            return menus_.cend() ;
+        }
+
+        /**
+         * @brief Returns the reference to the beginning of menus.
+         * @return Reference to the first element.
+         */
+        FluentMenu& front() {
+            return menus_.front() ;
+        }
+
+        /**
+         * @brief Returns the const reference to the beginning of menus.
+         * @return Const reference to the first element.
+         */
+        const FluentMenu& front() const {
+            return menus_.front() ;
+        }
+
+        /**
+         * @brief Returns the reference to the last of menus.
+         * @return Reference to the first element.
+         */
+        FluentMenu& back() {
+            return menus_.back() ;
+        }
+
+        /**
+         * @brief Returns the const reference to the last of menus.
+         * @return Const reference to the first element.
+         */
+        const FluentMenu& back() const {
+            return menus_.back() ;
+        }
+
+        /**
+         * @brief Returns the number of menus.
+         * @return The number of menus.
+         */
+        std::size_t count_menus() const noexcept {
+            return menus_.size() ;
+        }
+
+        /**
+         * @brief Get the handle of a menu, which keeps referring to the menu while menus are added.
+         * @param [in] index The index of menu.
+         * @return The handle of menu, or a null handle if the index is out of range.
+         * @sa find_menu
+         */
+        SlotHandle get_menu_handle(std::size_t index) const {
+            if(index >= menus_.size()) {
+                return SlotHandle{0, 0} ;
+            }
+            return menus_.handle_at(index) ;
+        }
+
+        /**
+         * @brief Refer to a menu by handle.
+         * @param [in] handle The handle of menu.
+         * @return The pointer to the menu, or nullptr if the menu no longer exists.
+         */
+        FluentMenu* find_menu(const SlotHandle& handle) noexcept {
+            return menus_.find(handle) ;
+        }
+
+        /**
+         * @brief Refer to a menu by handle.
+         * @param [in] handle The handle of menu.
+         * @return The pointer to the menu, or nullptr if the menu no longer exists.
+         */
+        const FluentMenu* find_menu(const SlotHandle& handle) const noexcept {
+            return menus_.find(handle) ;
+        }
+
+        /**
+         * @brief Arrange menus in multiple columns so that many menus do not run off the screen.
+         * @param [in] max_rows The maximum number of menus in a column. Zero means a single column.
+         * @return Returns true on success, false on failure.
+         * @details The menus are filled column by column from the top. The left and right keys move the selection between columns.
+         */
+        bool set_max_rows(std::size_t max_rows) {
+            grid_.set_max_rows(max_rows) ;
+            return update_layout() ;
+        }
+
+        /**
+         * @brief Limit the width of labels so that a long label does not widen the popup.
+         * @param [in] max_width The maximum width of labels in pixels at 96 DPI. Zero means no limit.
+         * @param [in] mode The position of the ellipsis replacing the overflow.
+         * @return Returns true on success, false on failure.
+         */
+        bool set_max_label_width(
+                LONG max_width,
+                util::EllipsisMode mode=util::EllipsisMode::END) {
+            max_label_width_ = (std::max)(max_width, static_cast<LONG>(0)) ;
+            ellipsis_mode_ = mode ;
+            return update_layout() ;
+        }
+
+        /**
+         * @brief Recolor monochrome icons to be visible on the background.
+         * @param [in] tint The color to draw monochrome icons.
+         * @details The icons of menus and the tray icon whose visible pixels have a single color, such as glyph icons, are recolored, so one icon set works on both light and dark taskbars. The recolored icons are cached until the theme is changed.
+         */
+        void set_icon_tint(IconTint tint) noexcept {
+            icon_tint_ = tint ;
+            theme_.invalidate() ;
+        }
+
+        /**
+         * @brief Set font information to draw menus.
+         * @param [in] font_size The height of fonts.
+         * @param [in] font_weight The value from 0 to 1000 to determine font weight.
+         * @param [in] font_name The UTF-8 encoded font name for label rendering.
+         * @return Returns true on success, false on failure.
+         * @details For font_weight, you can use the constant value specified for lfWeght in <a href="https://learn.microsoft.com/en-us/windows/win32/api/wingdi/ns-wingdi-logfontw">LOGFONT</a>. The default value used is FW_MEDIUM(500).
          */
         bool set_font(
                 LONG font_size=0,
@@ -1307,295 +2819,2337 @@ namespace fluent_tray
             NONCLIENTMETRICSW metrics ;
             metrics.cbSize = sizeof(metrics) ;
 
-            if(!SystemParametersInfoW(
-                    SPI_GETNONCLIENTMETRICS,
-                    metrics.cbSize, &metrics, 0)) {
+            if(!SystemParametersInfoW(
+                    SPI_GETNONCLIENTMETRICS,
+                    metrics.cbSize, &metrics, 0)) {
+                return false ;
+            }
+
+            auto& logfont = metrics.lfCaptionFont ;
+            if(font_size != 0) {
+                logfont.lfHeight = font_size ;
+            }
+            else {
+                logfont.lfHeight = 20 ;
+            }
+            if(font_weight != 0) {
+                logfont.lfWeight = font_weight ;
+            }
+            else {
+                logfont.lfWeight = FW_MEDIUM ;
+            }
+
+            if(!font_name.empty()) {
+                std::wstring font_name_wide ;
+                if(!util::string2wstring(font_name, font_name_wide)) {
+                    return false ;
+                }
+                auto& dst = logfont.lfFaceName ;
+
+                if(font_name_wide.size() < LF_FACESIZE) {
+                    std::wmemcpy(
+                        dst, font_name_wide.c_str(), font_name_wide.length()) ;
+                    dst[font_name_wide.size()] = L'\0' ;
+                }
+                else {
+                    std::wmemcpy(
+                        dst, font_name_wide.c_str(), LF_FACESIZE - 1) ;
+                    dst[LF_FACESIZE - 1] = L'\0' ;
+                }
+            }
+
+            // The font is created per DPI from this base.
+            logfont_ = logfont ;
+            base_metrics_.font_size = std::abs(logfont.lfHeight) ;
+
+            // The submenus are created again with the new font when opened.
+            if(!close_submenus(0)) {
+                return false ;
+            }
+            trim_submenus(0) ;
+            release_dpi_resources() ;
+            return apply_dpi(dpi_) ;
+        }
+
+        /**
+         * @brief Set colors to draw menus.
+         * @param [in] text_color The color for label text.
+         * @param [in] back_color The color for background.
+         * @param [in] border_color The color for border.
+         * @return Returns true on success, false on failure.
+         */
+        bool set_color(
+                COLORREF text_color=CLR_INVALID,
+                COLORREF back_color=CLR_INVALID,
+                COLORREF border_color=CLR_INVALID) {
+            if(back_color != CLR_INVALID) {
+                back_color_ = back_color ;
+                theme_.pin(ThemeColor::BACK) ;
+                if(!update_background_brush()) {
+                    return false ;
+                }
+            }
+            if(text_color != CLR_INVALID) {
+                text_color_ = text_color ;
+                theme_.pin(ThemeColor::TEXT) ;
+            }
+            if(border_color != CLR_INVALID) {
+                border_color_ = border_color ;
+                theme_.pin(ThemeColor::BORDER) ;
+            }
+
+            // The menus are restyled in the next showing or update, or at the end of the transaction.
+            theme_.invalidate() ;
+            return true ;
+        }
+
+        /**
+         * @brief Load the image file and change the icon.
+         * @return Returns true on success, false on failure.
+         */
+        bool change_icon(const std::string& icon_path) {
+            if(icon_data_.cbSize > 0) {
+                if(!Shell_NotifyIconW(NIM_DELETE, &icon_data_)) {
+                    return false ;
+                }
+            }
+
+            ZeroMemory(&icon_data_, sizeof(icon_data_)) ;
+
+            if(icon_path.empty()) {
+                icon_data_.cbSize = 0 ;
+                return true ;
+            }
+
+            std::wstring icon_path_wide ;
+            if(!util::string2wstring(icon_path, icon_path_wide)) {
+                return false ;
+            }
+
+            if(!util::exists(icon_path_wide)) {
+                return false ;
+            }
+
+            icon_data_.cbSize = sizeof(icon_data_) ;
+            icon_data_.hWnd = hwnd_ ;
+            icon_data_.uFlags = NIF_ICON | NIF_MESSAGE | NIF_TIP ;
+            icon_data_.uCallbackMessage = message_id_ ;
+            icon_data_.hIcon = static_cast<HICON>(
+                LoadImageW(
+                    NULL, icon_path_wide.c_str(),
+                    IMAGE_ICON, 0, 0, LR_LOADFROMFILE)) ;
+            wcscpy_s(icon_data_.szTip, app_name_.c_str()) ;
+            icon_data_.dwState = NIS_SHAREDICON ;
+            icon_data_.dwStateMask = NIS_SHAREDICON ;
+
+            icon_tints_.erase(base_icon_, destroy_tinted_icon) ;
+            base_icon_ = icon_data_.hIcon ;
+            base_icon_pixels_.clear() ;
+            if(!tint_icon(base_icon_, icon_data_.hIcon)) {
+                return false ;
+            }
+
+            if(!Shell_NotifyIconW(NIM_ADD, &icon_data_)) {
+                return false ;
+            }
+
+            if(badge_dot_ || badge_count_ > 0) {
+                // Keep the badge on the new icon.
+                if(!update_badge_icon()) {
+                    return false ;
+                }
+            }
+
+            if(!hide_menu_window()) {
+                return false ;
+            }
+
+            return true ;
+        }
+
+        /**
+         * @brief Show a count badge on the tray icon.
+         * @param [in] count The count. Counts greater than nine are shown as "9+". The badge is removed if the count is not positive.
+         * @return Returns true on success, false on failure.
+         * @details The badge is composed onto the loaded icon in memory and the icon is updated with a single NIM_MODIFY.
+         */
+        bool set_badge(int count) {
+            auto changed = badge_dot_
+                || BadgeRenderer::format_count(count) != BadgeRenderer::format_count(badge_count_) ;
+            badge_count_ = count ;
+            badge_dot_ = false ;
+            if(!changed) {
+                return true ;
+            }
+            return update_badge_icon() ;
+        }
+
+        /**
+         * @brief Show a dot badge on the tray icon.
+         * @return Returns true on success, false on failure.
+         */
+        bool set_badge_dot() {
+            if(badge_dot_) {
+                return true ;
+            }
+            badge_count_ = 0 ;
+            badge_dot_ = true ;
+            return update_badge_icon() ;
+        }
+
+        /**
+         * @brief Remove the badge from the tray icon.
+         * @return Returns true on success, false on failure.
+         */
+        bool clear_badge() {
+            return set_badge(0) ;
+        }
+
+        /**
+         * @brief Set the colors of badge.
+         * @param [in] back_color The color of badge.
+         * @param [in] text_color The color of count.
+         * @return Returns true on success, false on failure.
+         */
+        bool set_badge_color(
+                COLORREF back_color=RGB(196, 43, 28),
+                COLORREF text_color=RGB(255, 255, 255)) {
+            badge_.set_colors(
+                util::colorref2argb(back_color), util::colorref2argb(text_color)) ;
+            if(badge_dot_ || badge_count_ > 0) {
+                return update_badge_icon() ;
+            }
+            return true ;
+        }
+
+        /**
+         * @brief Start an animation of the tray icon.
+         * @param [in] frame_paths UTF-8 encoded paths to the icons of each frame.
+         * @param [in] frame_interval The interval between frames.
+         * @param [in] max_rate The maximum number of icon updates per second. Zero means no limit.
+         * @return Returns true on success, false on failure.
+         * @details All frames are loaded once when the animation starts, and each frame is shown with a single NIM_MODIFY. The animation pauses automatically while the session is locked or the display is off.
+         */
+        bool start_icon_animation(
+                const std::vector<std::string>& frame_paths,
+                std::chrono::milliseconds frame_interval=std::chrono::milliseconds(100),
+                unsigned int max_rate=20) {
+            if(icon_data_.cbSize == 0 || frame_paths.empty()) {
+                // There is no icon to animate.
+                return false ;
+            }
+
+            std::vector<HICON> frames ;
+            for(const auto& path : frame_paths) {
+                std::wstring path_wide ;
+                HICON hicon = NULL ;
+                if(util::string2wstring(path, path_wide) && util::exists(path_wide)) {
+                    hicon = static_cast<HICON>(LoadImageW(
+                        NULL, path_wide.c_str(),
+                        IMAGE_ICON, 0, 0, LR_LOADFROMFILE)) ;
+                }
+                if(!hicon) {
+                    for(auto frame : frames) {
+                        DestroyIcon(frame) ;
+                    }
+                    return false ;
+                }
+                frames.push_back(hicon) ;
+            }
+
+            if(!register_animation_notification()) {
+                for(auto frame : frames) {
+                    DestroyIcon(frame) ;
+                }
+                return false ;
+            }
+
+            KillTimer(hwnd_, animation_timer_id_) ;
+            release_animation_frames() ;
+            animation_frames_ = std::move(frames) ;
+
+            auto now = std::chrono::steady_clock::now() ;
+            animation_.set_max_rate(max_rate) ;
+            animation_.start(animation_frames_.size(), frame_interval, now) ;
+            if(!show_animation_frame(0)) {
+                return false ;
+            }
+            return restart_animation_timer() ;
+        }
+
+        /**
+         * @brief Stop the animation and restore the tray icon.
+         * @return Returns true on success, false on failure.
+         */
+        bool stop_icon_animation() {
+            if(!animation_.is_running()) {
+                return true ;
+            }
+            animation_.stop() ;
+            KillTimer(hwnd_, animation_timer_id_) ;
+
+            auto result = restore_static_icon() ;
+            release_animation_frames() ;
+            return result ;
+        }
+
+        /**
+         * @brief Check if the tray icon is animating.
+         * @return Returns true if the animation is started, false otherwise.
+         */
+        bool is_icon_animating() const noexcept {
+            return animation_.is_running() ;
+        }
+
+    private:
+        static constexpr UINT_PTR animation_timer_id_ = 1 ;
+
+        bool register_animation_notification() {
+            if(animation_notification_) {
+                return true ;
+            }
+
+            // Wtsapi32 is loaded dynamically so as not to add a link dependency.
+            // The module is kept to unregister the window before it is destroyed.
+            using WTSRegisterType = BOOL (WINAPI*)(HWND, DWORD) ;
+            using WTSUnRegisterType = util::SessionNotificationDeleter::Unregister ;
+            constexpr DWORD notify_for_this_session = 0 ;  // NOTIFY_FOR_THIS_SESSION in wtsapi32.h
+            wtsapi_module_.reset(LoadLibraryW(L"wtsapi32.dll")) ;
+            if(wtsapi_module_) {
+                const auto WTSRegisterSessionNotification = reinterpret_cast<WTSRegisterType>(
+                        reinterpret_cast<void*>(GetProcAddress(wtsapi_module_.get(), "WTSRegisterSessionNotification"))) ;
+                const auto WTSUnRegisterSessionNotification = reinterpret_cast<WTSUnRegisterType>(
+                        reinterpret_cast<void*>(GetProcAddress(wtsapi_module_.get(), "WTSUnRegisterSessionNotification"))) ;
+                if(WTSRegisterSessionNotification && WTSUnRegisterSessionNotification
+                        && WTSRegisterSessionNotification(hwnd_, notify_for_this_session)) {
+                    session_notification_ = util::UniqueSessionNotification(
+                        hwnd_, util::SessionNotificationDeleter(WTSUnRegisterSessionNotification)) ;
+                }
+            }
+
+            // GUID_CONSOLE_DISPLAY_STATE
+            static const GUID display_state_guid = {
+                0x6fe69556, 0x704a, 0x47a0, {0x8f, 0x24, 0xc2, 0x8d, 0x93, 0x6f, 0xda, 0x47}} ;
+            display_notification_.reset(RegisterPowerSettingNotification(
+                hwnd_, &display_state_guid, DEVICE_NOTIFY_WINDOW_HANDLE)) ;
+
+            // The animation works without the notifications, so failures are ignored.
+            animation_notification_ = true ;
+            return true ;
+        }
+
+        void unregister_animation_notification() noexcept {
+            // The session notification is unregistered before its module is freed.
+            session_notification_.reset() ;
+            wtsapi_module_.reset() ;
+            display_notification_.reset() ;
+            animation_notification_ = false ;
+        }
+
+        bool restart_animation_timer() {
+            KillTimer(hwnd_, animation_timer_id_) ;
+            if(!animation_.is_active()) {
+                // No wake-ups while paused.
+                return true ;
+            }
+            auto interval = static_cast<UINT>(animation_.update_interval().count()) ;
+            return SetTimer(hwnd_, animation_timer_id_, interval, NULL) != 0 ;
+        }
+
+        bool show_animation_frame(std::size_t frame) {
+            icon_data_.hIcon = animation_frames_[frame] ;
+            return Shell_NotifyIconW(NIM_MODIFY, &icon_data_) != FALSE ;
+        }
+
+        bool update_animation() {
+            std::size_t frame ;
+            if(!animation_.tick(std::chrono::steady_clock::now(), frame)) {
+                return true ;
+            }
+            return show_animation_frame(frame) ;
+        }
+
+        bool restore_static_icon() {
+            if(icon_data_.cbSize == 0) {
+                return true ;
+            }
+            if(badge_dot_ || badge_count_ > 0) {
+                return update_badge_icon() ;
+            }
+            if(!tint_icon(base_icon_, icon_data_.hIcon)) {
+                return false ;
+            }
+            return Shell_NotifyIconW(NIM_MODIFY, &icon_data_) != FALSE ;
+        }
+
+        void release_animation_frames() noexcept {
+            for(auto frame : animation_frames_) {
+                DestroyIcon(frame) ;
+            }
+            animation_frames_.clear() ;
+        }
+
+        bool update_badge_icon() {
+            if(icon_data_.cbSize == 0 || !base_icon_) {
+                // There is no icon to put the badge on.
+                return false ;
+            }
+            if(animation_.is_running()) {
+                // The badge is shown when the animation is stopped.
+                return true ;
+            }
+
+            // The badge is put on the recolored icon.
+            HICON static_icon ;
+            if(!tint_icon(base_icon_, static_icon)) {
+                return false ;
+            }
+            if(base_icon_pixels_.empty()) {
+                if(!util::get_icon_pixels(
+                        static_icon, base_icon_pixels_,
+                        base_icon_width_, base_icon_height_)) {
+                    base_icon_pixels_.clear() ;
+                    return false ;
+                }
+            }
+
+            HICON new_icon = static_icon ;
+            if(badge_dot_ || badge_count_ > 0) {
+                if(badge_dot_) {
+                    badge_.compose_dot(
+                        base_icon_pixels_.data(),
+                        base_icon_width_, base_icon_height_, badge_pixels_) ;
+                }
+                else {
+                    badge_.compose_count(
+                        base_icon_pixels_.data(),
+                        base_icon_width_, base_icon_height_,
+                        badge_count_, badge_pixels_) ;
+                }
+                new_icon = util::create_icon_from_pixels(
+                    badge_pixels_.data(), base_icon_width_, base_icon_height_) ;
+                if(!new_icon) {
+                    return false ;
+                }
+            }
+
+            icon_data_.hIcon = new_icon ;
+            if(!Shell_NotifyIconW(NIM_MODIFY, &icon_data_)) {
+                if(new_icon != static_icon) {
+                    DestroyIcon(new_icon) ;
+                }
+                return false ;
+            }
+
+            badge_icon_.reset(new_icon != static_icon ? new_icon : NULL) ;
+            return true ;
+        }
+
+        static LRESULT CALLBACK callback(
+                HWND hwnd,
+                UINT msg,
+                WPARAM wparam,
+                LPARAM lparam) {
+            auto get_instance = [hwnd]() -> FluentTray* {
+                auto upper_addr = GetWindowLongW(hwnd, 0) ;
+                if(!upper_addr) {
+                    return nullptr ;
+                }
+
+                auto lower_addr = GetWindowLongW(hwnd, sizeof(LONG)) ;
+                if(!lower_addr) {
+                    return nullptr ;
+                }
+
+                FluentTray* self ;
+                util::concatenate_bits(upper_addr, lower_addr, self) ;
+                return self ;
+            } ;
+
+            if(msg == WM_DESTROY || msg == WM_QUIT || msg == WM_CLOSE) {
+                if(auto self = get_instance()) {
+                    if(hwnd != self->hwnd_) {
+                        // A submenu window is destroyed when it is released.
+                        return DefWindowProc(hwnd, msg, wparam, lparam) ;
+                    }
+                    if(msg == WM_DESTROY) {
+                        // The session notification must be unregistered while the window exists.
+                        self->unregister_animation_notification() ;
+                    }
+                    self->stop() ;
+                    return 0 ;
+                }
+            }
+            else if(msg == WM_COMPACTING) {
+                if(auto self = get_instance()) {
+                    // Release the closed submenus under memory pressure.
+                    self->trim_submenus(0) ;
+                    return 0 ;
+                }
+            }
+            else if(msg == WM_ACTIVATE && wparam == WA_INACTIVE) {
+                if(auto self = get_instance()) {
+                    if(!self->hide_menu_window()) {
+                        self->fail() ;
+                    }
+                    return 0 ;
+                }
+            }
+            else if(msg == WM_DRAWITEM) {
+                if(auto self = get_instance()) {
+                    auto item = reinterpret_cast<LPDRAWITEMSTRUCT>(lparam) ;
+                    FluentMenu* menu ;
+                    if(hwnd != self->hwnd_) {
+                        menu = self->find_submenu_item(hwnd, item->hwndItem) ;
+                    }
+                    else {
+                        auto menu_idx = self->get_menu_index_from_window(item->hwndItem) ;
+                        menu = menu_idx < 0 ? nullptr : &self->menus_[menu_idx] ;
+                    }
+                    if(!menu) {
+                        return FALSE ;
+                    }
+                    if(!menu->draw_menu(item, self->font_)) {
+                        self->fail() ;
+                        return FALSE ;
+                    }
+                    return TRUE ;
+                }
+            }
+            else if(msg == WM_CTLCOLORBTN) {
+                if(auto self = get_instance()) {
+                    auto item_hwnd = reinterpret_cast<HWND>(lparam) ;
+                    FluentMenu* menu ;
+                    if(hwnd != self->hwnd_) {
+                        menu = self->find_submenu_item(hwnd, item_hwnd) ;
+                    }
+                    else {
+                        auto menu_idx = self->get_menu_index_from_window(item_hwnd) ;
+                        menu = menu_idx < 0 ? nullptr : &self->menus_[menu_idx] ;
+                    }
+                    if(!menu) {
+                        return DefWindowProc(hwnd, msg, wparam, lparam) ;
+                    }
+                    return reinterpret_cast<LRESULT>(menu->background_brush()) ;
+                }
+            }
+            else if(msg == WM_COMMAND) {
+                if(auto self = get_instance()) {
+                    if(hwnd != self->hwnd_) {
+                        std::size_t level ;
+                        if(!self->find_submenu_level(hwnd, level)) {
+                            return FALSE ;
+                        }
+                        auto index = static_cast<std::size_t>(LOWORD(wparam)) - 1 ;
+                        if(!self->activate_submenu_item(level, index)) {
+                            return FALSE ;
+                        }
+                        return TRUE ;
+                    }
+
+                    auto menu_idx = self->get_menu_index_from_id(LOWORD(wparam)) ;
+                    if(menu_idx < 0) {
+                        return FALSE ;
+                    }
+                    auto& menu = self->menus_[menu_idx] ;
+                    if(menu.bar_style() == BarStyle::SLIDER) {
+                        // Keep the menu window open while the slider is changed.
+                        // A click outside the bar, such as on the label, does not change the value.
+                        POINT pos ;
+                        int value ;
+                        if(GetCursorPos(&pos)
+                                && ScreenToClient(menu.window_handle(), &pos)
+                                && menu.calculate_value_from_position(pos, value)) {
+                            if(!self->process_slider_event(menu, value)) {
+                                self->stop() ;
+                                return FALSE ;
+                            }
+                        }
+                        return TRUE ;
+                    }
+                    if(!self->click_menu(static_cast<std::size_t>(menu_idx))) {
+                        self->stop() ;
+                        return FALSE ;
+                    }
+                    if(self->hot_.is_submenu(static_cast<std::size_t>(menu_idx))) {
+                        // Keep the menu window open while the submenu is open.
+                        return TRUE ;
+                    }
+                    if(!self->hide_menu_window()) {
+                        return FALSE ;
+                    }
+                    return TRUE ;
+                }
+            }
+            else if(msg == WM_KEYDOWN) {
+                if(auto self = get_instance()) {
+                    if(self->cascade_.depth() > 0) {
+                        // The keys operate the deepest open submenu.
+                        bool handled ;
+                        if(!self->process_submenu_key(wparam, handled)) {
+                            self->fail() ;
+                            return FALSE ;
+                        }
+                        if(handled) {
+                            return TRUE ;
+                        }
+                    }
+
+                    if(wparam == VK_DOWN || wparam == VK_UP) {
+                        // The selection stays at the edge of the list while the list is scrolled.
+                        bool scrolled ;
+                        if(!self->scroll_virtual_menus_past_edge(wparam == VK_DOWN, scrolled)) {
+                            self->fail() ;
+                            return FALSE ;
+                        }
+                        if(scrolled) {
+                            return TRUE ;
+                        }
+                    }
+
+                    if(wparam == VK_DOWN) {
+                        if(self->select_index_ < 0) {
+                            // Initialize the position of bounding box cursor
+                            self->select_index_ = 0 ;
+                        }
+                        else {
+                            self->select_index_ = (self->select_index_ + 1) % self->menus_.size() ;
+                        }
+                        self->hover_.commit(
+                            self->select_index_, std::chrono::steady_clock::now()) ;
+                        return TRUE;
+                    }
+                    else if(wparam == VK_UP) {
+                        if(self->select_index_ < 0) {
+                            // Initialize the position of bounding box cursor
+                            self->select_index_ = static_cast<int>(self->menus_.size() - 1) ;
+                        }
+                        else {
+                            auto mod = static_cast<int>(self->menus_.size()) ;
+                            self->select_index_ = ((self->select_index_ - 1) % mod + mod) % mod ;  // to be positive
+                        }
+                        self->hover_.commit(
+                            self->select_index_, std::chrono::steady_clock::now()) ;
+                        return TRUE;
+                    }
+                    else if(wparam == VK_LEFT || wparam == VK_RIGHT) {
+                        if(self->select_index_ < 0) {
+                            if(self->menus_.empty()) {
+                                return TRUE ;
+                            }
+                            // Initialize the position of bounding box cursor
+                            self->select_index_ = 0 ;
+                        }
+                        else {
+                            auto index = static_cast<std::size_t>(self->select_index_) ;
+                            if(wparam == VK_RIGHT && self->hot_.is_submenu(index)) {
+                                if(!self->click_menu(index)
+                                        || !self->select_first_submenu_item()) {
+                                    self->fail() ;
+                                    return FALSE ;
+                                }
+                                return TRUE ;
+                            }
+                            if(self->hot_.is_slider(static_cast<std::size_t>(self->select_index_))) {
+                                auto& menu = self->menus_[self->select_index_] ;
+                                auto steps = wparam == VK_LEFT ? -1 : 1 ;
+                                auto value = menu.value() + steps * menu.step() ;
+                                if(!self->process_slider_event(menu, value)) {
+                                    self->stop() ;
+                                    return FALSE ;
+                                }
+                                return TRUE ;
+                            }
+                            // Move to the adjacent column.
+                            self->select_index_ = static_cast<int>(self->grid_.move_horizontally(
+                                static_cast<std::size_t>(self->select_index_), wparam == VK_RIGHT)) ;
+                        }
+                        self->hover_.commit(
+                            self->select_index_, std::chrono::steady_clock::now()) ;
+                        return TRUE ;
+                    }
+                    else if(wparam == VK_PRIOR || wparam == VK_NEXT) {
+                        auto rows = static_cast<long>(self->list_.count_rows()) ;
+                        if(!self->scroll_virtual_menus(wparam == VK_PRIOR ? -rows : rows)) {
+                            self->fail() ;
+                            return FALSE ;
+                        }
+                        return TRUE ;
+                    }
+                    else if(wparam == VK_ESCAPE) {
+                        if(!self->hide_menu_window()) {
+                            return FALSE ;
+                        }
+                        return TRUE;
+                    }
+                    else if((wparam == VK_SPACE && !self->is_typing_query()) || wparam == VK_RETURN) {
+                        if(self->select_index_ >= 0) {
+                            if(!self->click_menu(static_cast<std::size_t>(self->select_index_))) {
+                                self->stop() ;
+                                return FALSE ;
+                            }
+                            if(self->hot_.is_submenu(static_cast<std::size_t>(self->select_index_))) {
+                                if(!self->select_first_submenu_item()) {
+                                    self->fail() ;
+                                    return FALSE ;
+                                }
+                                return TRUE ;
+                            }
+                            if(!self->hide_menu_window()) {
+                                return FALSE ;
+                            }
+                        }
+                        return TRUE;
+                    }
+                }
+            }
+            else if(msg == WM_CHAR) {
+                if(auto self = get_instance()) {
+                    if(self->cascade_.depth() == 0 && self->type_to_filter_ && self->list_.count_rows() > 0) {
+                        bool handled ;
+                        if(!self->type_filter(static_cast<wchar_t>(wparam), handled)) {
+                            self->fail() ;
+                            return FALSE ;
+                        }
+                        if(handled) {
+                            return TRUE ;
+                        }
+                    }
+                    // The printable characters jump to the menu whose label starts with them.
+                    else if(self->cascade_.depth() == 0 && wparam > 0x20 && wparam != 0x7F) {
+                        if(!self->type_ahead(static_cast<wchar_t>(wparam))) {
+                            self->fail() ;
+                            return FALSE ;
+                        }
+                        return TRUE ;
+                    }
+                }
+            }
+            else if(msg == WM_MOUSEWHEEL) {
+                if(auto self = get_instance()) {
+                    UINT lines = 3 ;
+                    SystemParametersInfoW(SPI_GETWHEELSCROLLLINES, 0, &lines, 0) ;
+                    auto lines_per_notch = lines == WHEEL_PAGESCROLL
+                        ? static_cast<long>(self->list_.count_rows()) : static_cast<long>(lines) ;
+                    if(self->list_.scroll_by_wheel(GET_WHEEL_DELTA_WPARAM(wparam), lines_per_notch)) {
+                        if(!self->bind_virtual_menus()) {
+                            self->fail() ;
+                        }
+                    }
+                    return 0 ;
+                }
+            }
+            else if(msg == WM_TIMER && wparam == animation_timer_id_) {
+                if(auto self = get_instance()) {
+                    if(!self->update_animation()) {
+                        self->fail() ;
+                    }
+                    return 0 ;
+                }
+            }
+            else if(msg == WM_WTSSESSION_CHANGE) {
+                if(auto self = get_instance()) {
+                    if(wparam == WTS_SESSION_LOCK || wparam == WTS_SESSION_UNLOCK) {
+                        self->animation_.set_session_locked(
+                            wparam == WTS_SESSION_LOCK, std::chrono::steady_clock::now()) ;
+                        if(!self->restart_animation_timer()) {
+                            self->fail() ;
+                        }
+                    }
+                    return 0 ;
+                }
+            }
+            else if(msg == WM_POWERBROADCAST && wparam == PBT_POWERSETTINGCHANGE) {
+                if(auto self = get_instance()) {
+                    auto setting = reinterpret_cast<const POWERBROADCAST_SETTING*>(lparam) ;
+                    if(setting && setting->DataLength >= sizeof(DWORD)) {
+                        // 0: off, 1: on, 2: dimmed
+                        DWORD state ;
+                        std::memcpy(&state, setting->Data, sizeof(state)) ;
+                        self->animation_.set_display_off(
+                            state == 0, std::chrono::steady_clock::now()) ;
+                        if(!self->restart_animation_timer()) {
+                            self->fail() ;
+                        }
+                    }
+                    return TRUE ;
+                }
+            }
+            else if(msg == WM_THEMECHANGED
+                    || msg == WM_SYSCOLORCHANGE
+                    || msg == WM_DWMCOLORIZATIONCOLORCHANGED
+                    || (msg == WM_SETTINGCHANGE
+                        && ThemeCache::is_theme_setting(reinterpret_cast<const wchar_t*>(lparam)))) {
+                if(auto self = get_instance()) {
+                    self->theme_.invalidate() ;
+                }
+            }
+            else if(msg == WM_DISPLAYCHANGE
+                    || (msg == WM_SETTINGCHANGE
+                        && (wparam == SPI_SETWORKAREA
+                            || util::is_setting_area(reinterpret_cast<const wchar_t*>(lparam), L"TraySettings")))) {
+                if(auto self = get_instance()) {
+                    self->topology_stale_ = true ;
+                }
+            }
+            else if(msg == WM_DPICHANGED) {
+                if(auto self = get_instance()) {
+                    if(hwnd != self->hwnd_) {
+                        // The submenus follow the DPI of the menu window when opened.
+                        return 0 ;
+                    }
+                    // The popup is placed again around the center of the suggested rectangle,
+                    // so it stays next to the taskbar of the monitor chosen by the system.
+                    const auto suggested = reinterpret_cast<const RECT*>(lparam) ;
+                    self->popup_anchor_ = Point{
+                        suggested->left + (suggested->right - suggested->left) / 2,
+                        suggested->top + (suggested->bottom - suggested->top) / 2} ;
+                    // The taskbar is also scaled for the new DPI.
+                    self->topology_stale_ = true ;
+                    if(!self->apply_dpi(HIWORD(wparam)) || !self->update_layout()) {
+                        self->fail() ;
+                    }
+                    return 0 ;
+                }
+            }
+            else if(msg == message_id_) {  //On NotifyIcon
+                if(auto self = get_instance()) {
+                    if(lparam == WM_LBUTTONUP || lparam == WM_RBUTTONUP) {
+                        self->show_menu_window() ;
+                        return 0 ;
+                    }
+                }
+            }
+
+            return DefWindowProc(hwnd, msg, wparam, lparam) ;
+        }
+
+        int get_menu_index_from_window(HWND hwnd) const {
+            // The control identifier of a menu window is the identifier of the menu.
+            auto id = GetDlgCtrlID(hwnd) ;
+            std::size_t index ;
+            if(id <= 0 || !hot_.find_by_window(static_cast<std::size_t>(id), hwnd, index)) {
+                return -1 ;
+            }
+            return static_cast<int>(index) ;
+        }
+
+        int get_menu_index_from_id(WORD id) const {
+            std::size_t index ;
+            if(!hot_.find_by_id(id, index)) {
+                return -1 ;
+            }
+            return static_cast<int>(index) ;
+        }
+
+        LONG calculate_menu_width(std::size_t column) const noexcept {
+            return grid_.column_width(column) + 2 * menu_x_pad_ ;
+        }
+
+        LONG calculate_menu_height() const noexcept {
+            return menu_font_size_ + 2 * menu_y_pad_ ;
+        }
+
+        void calculate_popup_size(LONG& popup_width, LONG& popup_height) const noexcept {
+            popup_width = menu_x_margin_ ;
+            for(std::size_t column = 0 ; column < grid_.count_columns() ; column ++) {
+                popup_width += calculate_menu_width(column) + menu_x_margin_ ;
+            }
+            if(grid_.count_columns() == 0) {
+                popup_width += 2 * menu_x_pad_ + menu_x_margin_ ;
+            }
+            popup_height = static_cast<LONG>(
+                grid_.count_rows() * (menu_y_margin_ + calculate_menu_height()) + menu_y_margin_) ;
+        }
+
+        bool place_popup(UINT flags) {
+            LONG popup_width, popup_height ;
+            calculate_popup_size(popup_width, popup_height) ;
+
+            // The topology is queried only after the displays or the taskbar are changed.
+            if(topology_stale_) {
+                if(!refresh_display_topology()) {
+                    return false ;
+                }
+            }
+
+            Rect popup_rect ;
+            if(!PopupPlacement::solve(
+                    monitors_, popup_anchor_, popup_width, popup_height, popup_rect)) {
+                return false ;
+            }
+
+            if(!SetWindowPos(
+                    hwnd_, HWND_TOP,
+                    popup_rect.left, popup_rect.top, popup_width, popup_height,
+                    flags)) {
+                return false ;
+            }
+            return true ;
+        }
+
+        bool layout_menus(std::size_t first_column=0) {
+            count_layout_passes_ ++ ;
+            auto menu_height = calculate_menu_height() ;
+            auto x = menu_x_margin_ ;
+            for(std::size_t column = 0 ; column < grid_.count_columns() ; column ++) {
+                auto menu_width = calculate_menu_width(column) ;
+                if(column >= first_column) {
+                    // The columns on the left are not moved.
+                    auto first = grid_.first_of(column) ;
+                    auto last = column + 1 < grid_.count_columns()
+                        ? grid_.first_of(column + 1) : grid_.size() ;
+                    for(auto i = first ; i < last ; i ++) {
+                        auto y = \
+                             menu_y_margin_
+                             + static_cast<LONG>(grid_.row_of(i)) * (menu_height + menu_y_margin_) ;
+                        if(!SetWindowPos(
+                                menus_[i].window_handle(), HWND_TOP,
+                                x, y,
+                                menu_width, menu_height,
+                                SWP_SHOWWINDOW)) {
+                            return false ;
+                        }
+                    }
+                }
+                x += menu_width + menu_x_margin_ ;
+            }
+            return true ;
+        }
+
+        bool relabel_menu(
+                std::size_t index,
+                const std::string& label_text,
+                std::size_t& reflow_column) {
+            auto& menu = menus_[index] ;
+            if(batch_.is_open()) {
+                // The menus are measured again at the end of the transaction.
+                batch_.defer_layout() ;
+                return menu.set_label(label_text) ;
+            }
+            RECT dirty_rect ;
+            if(!menu.update_label(label_text, font_, dirty_rect)) {
+                return false ;
+            }
+
+            std::size_t column ;
+            if(grid_.update(index, menu.required_width(), column)) {
+                // The widest label in the column is changed, so the columns from it are reflowed later.
+                reflow_column = (std::min)(reflow_column, column) ;
+                return true ;
+            }
+
+            if(dirty_rect.left < dirty_rect.right) {
+                if(!InvalidateRect(menu.window_handle(), &dirty_rect, TRUE)) {
+                    return false ;
+                }
+            }
+            return true ;
+        }
+
+        bool reflow_menus(std::size_t first_column) {
+            if(first_column >= grid_.count_columns()) {
+                return true ;
+            }
+            // A grown popup is moved so that it stays on the work area.
+            if(!place_popup(SWP_NOZORDER | SWP_NOACTIVATE)) {
+                return false ;
+            }
+            return layout_menus(first_column) ;
+        }
+
+        bool bind_virtual_menus() {
+            if(!list_query_.empty()) {
+                list_matcher_.rank(list_.offset() + list_.count_rows()) ;
+            }
+            // Only the shown rows ask the provider, and the popup is reflowed at most once.
+            auto reflow_column = grid_.count_columns() ;
+            for(std::size_t row = 0 ; row < list_.count_rows() ; row ++) {
+                std::string label ;
+                if(list_.is_bound(row) && !list_provider_(list_item(list_.index_of(row)), label)) {
+                    return false ;
+                }
+                auto index = list_first_ + row ;
+                if(!visible_) {
+                    // Measured when the menu window is shown.
+                    if(!menus_[index].set_label(label)) {
+                        return false ;
+                    }
+                }
+                else if(!relabel_menu(index, label, reflow_column)) {
+                    return false ;
+                }
+            }
+            return reflow_menus(reflow_column) ;
+        }
+
+        bool index_virtual_menus(std::size_t count) {
+            // Only the labels of the new items are asked, and typed characters search them in O(log n).
+            std::vector<std::size_t> items ;
+            std::vector<std::wstring> labels ;
+            std::string label ;
+            for(auto i = list_texts_.size() ; i < count ; i ++) {
+                std::wstring text ;
+                label.clear() ;
+                if(!list_provider_(i, label) || !util::string2wstring(label, text)) {
+                    return false ;
+                }
+                items.push_back(i) ;
+                labels.push_back(std::move(text)) ;
+            }
+            list_labels_.insert(items, labels) ;
+            list_matcher_.append(labels) ;
+            list_texts_.insert(
+                list_texts_.end(),
+                std::make_move_iterator(labels.begin()), std::make_move_iterator(labels.end())) ;
+            return true ;
+        }
+
+        bool is_typing_query() const noexcept {
+            // The space is typed into the query instead of clicking the selected menu.
+            return type_to_filter_ && !list_query_.empty() ;
+        }
+
+        std::size_t list_item(std::size_t position) const noexcept {
+            return list_query_.empty() ? position : list_matcher_.ranked(position).item ;
+        }
+
+        bool apply_list_filter() {
+            if(list_query_.empty()) {
+                list_matcher_.reset() ;
+                list_.resize(list_count_) ;
+            }
+            else {
+                // The matches are ranked page by page when they are bound.
+                list_matcher_.filter(list_query_) ;
+                list_.resize((std::min)(list_matcher_.matches().size(), list_filter_limit_)) ;
+            }
+            // The best match is shown at the top.
+            list_.scroll_to(0) ;
+            return bind_virtual_menus() ;
+        }
+
+        bool type_filter(wchar_t c, bool& handled) {
+            handled = true ;
+            if(c == 0x08) {
+                if(list_query_.empty()) {
+                    return true ;
+                }
+                list_query_.pop_back() ;
+            }
+            else if((c > 0x20 && c != 0x7F) || (c == 0x20 && !list_query_.empty())) {
+                // A space separates words in the query, while it still clicks the selected menu before typing.
+                list_query_.push_back(c) ;
+            }
+            else {
+                handled = false ;
+                return true ;
+            }
+            if(!apply_list_filter()) {
+                return false ;
+            }
+            select_index_ = list_.size() > 0 ? static_cast<int>(list_first_) : -1 ;
+            hover_.commit(select_index_, std::chrono::steady_clock::now()) ;
+            return true ;
+        }
+
+        bool type_ahead(wchar_t c) {
+            if(menus_.empty()) {
+                return true ;
+            }
+            auto now = std::chrono::steady_clock::now() ;
+            type_ahead_.type(c, now) ;
+            auto prefix = type_ahead_.prefix() ;
+
+            // The matches are ordered by display position, where all items of the list are in place of its rows.
+            // The filtered list is not searched because its positions are not items.
+            auto rows = list_.count_rows() ;
+            auto search_list = rows > 0 && list_query_.empty() ;
+            auto menu_rank = [this, rows] (std::size_t id) {
+                std::size_t index = 0 ;
+                hot_.find_by_id(id, index) ;
+                return index < list_first_ || rows == 0 ? index : index - rows + list_count_ ;
+            } ;
+            auto list_rank = [this] (std::size_t item) {
+                return list_first_ + item ;
+            } ;
+            // The rank of the list grows with the item, so the list is searched by item without scanning the matches.
+            auto next_in_list = [this, &prefix, search_list] (std::size_t after, bool inclusive, std::size_t& item) {
+                if(!search_list) {
+                    return false ;
+                }
+                if(after < list_first_) {
+                    return list_labels_.next_item(prefix, 0, true, item) ;
+                }
+                return list_labels_.next_item(prefix, after - list_first_, inclusive, item) ;
+            } ;
+
+            std::size_t found_id = 0 ;
+            std::size_t found_item = 0 ;
+            bool in_menus ;
+            bool in_list ;
+            if(select_index_ < 0) {
+                // Without a selection, the menus are searched before the list.
+                in_menus = menu_labels_.next_by_rank(prefix, menu_rank, 0, true, found_id) ;
+                in_list = !in_menus && next_in_list(0, true, found_item) ;
+            }
+            else {
+                auto index = static_cast<std::size_t>(select_index_) ;
+                auto current = is_virtual_menu(index)
+                    ? list_rank(list_.index_of(index - list_first_)) : menu_rank(hot_.id(index)) ;
+                auto inclusive = type_ahead_.extends() ;
+                in_menus = menu_labels_.next_by_rank(prefix, menu_rank, current, inclusive, found_id) ;
+                in_list = next_in_list(current, inclusive, found_item) ;
+                if(!in_menus && !in_list) {
+                    // Wrap around to the top.
+                    in_menus = menu_labels_.next_by_rank(prefix, menu_rank, 0, true, found_id) ;
+                    in_list = next_in_list(0, true, found_item) ;
+                }
+            }
+            if(in_menus && in_list) {
+                in_list = list_rank(found_item) < menu_rank(found_id) ;
+                in_menus = !in_list ;
+            }
+
+            std::size_t index ;
+            if(in_menus) {
+                if(!hot_.find_by_id(found_id, index)) {
+                    return false ;
+                }
+            }
+            else if(in_list) {
+                if(!scroll_to_virtual_menu(found_item)) {
+                    return false ;
+                }
+                index = list_first_ + (found_item - list_.offset()) ;
+            }
+            else {
+                return true ;
+            }
+            select_index_ = static_cast<int>(index) ;
+            hover_.commit(select_index_, now) ;
+            return true ;
+        }
+
+        bool scroll_virtual_menus(long lines) {
+            if(!list_.scroll_by(lines)) {
+                return true ;
+            }
+            return bind_virtual_menus() ;
+        }
+
+        bool scroll_virtual_menus_past_edge(bool forward, bool& scrolled) {
+            scrolled = false ;
+            if(select_index_ < 0 || list_.count_rows() == 0) {
+                return true ;
+            }
+            auto index = static_cast<std::size_t>(select_index_) ;
+            if(index < list_first_ || index >= list_first_ + list_.count_rows()) {
+                return true ;
+            }
+            if(!list_.scroll_past_edge(index - list_first_, forward)) {
+                return true ;
+            }
+            scrolled = true ;
+            return bind_virtual_menus() ;
+        }
+
+        void get_message(MSG& message) {
+            // The submenus are top-level windows owned by the tray window, not its children,
+            // so the open ones are peeked for separately. The other messages of the thread are left to the application.
+            auto found = PeekMessage(&message, hwnd_, 0, 0, PM_REMOVE) != FALSE ;
+            for(std::size_t level = 0 ; !found && level < cascade_.depth() ; level ++) {
+                auto submenu = submenus_.find(cascade_.node_at(level)) ;
+                if(submenu) {
+                    found = PeekMessage(&message, submenu->hwnd, 0, 0, PM_REMOVE) != FALSE ;
+                }
+            }
+            if(found) {
+                // Generate WM_CHAR for the type-ahead.
+                TranslateMessage(&message) ;
+                DispatchMessage(&message) ;
+            }
+        }
+
+        void fail() noexcept {
+            status_ = TrayStatus::FAILED ;
+        }
+
+        bool change_menu_value(FluentMenu& menu, int value) {
+            RECT dirty_rect ;
+            if(!menu.set_value(value, dirty_rect)) {
+                return false ;
+            }
+            if(visible_ && dirty_rect.left < dirty_rect.right) {
+                if(batch_.is_open()) {
+                    batch_.defer_repaint() ;
+                    return true ;
+                }
+                if(!InvalidateRect(menu.window_handle(), &dirty_rect, TRUE)) {
+                    return false ;
+                }
+            }
+            return true ;
+        }
+
+        bool process_slider_event(FluentMenu& menu, int value) {
+            auto old_value = menu.value() ;
+            if(!change_menu_value(menu, value)) {
+                return false ;
+            }
+            if(menu.value() != old_value) {
+                return menu.process_value_event() ;
+            }
+            return true ;
+        }
+
+        template <typename Create>
+        static bool create_per_monitor_dpi_aware(Create create) {
+            // DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2
+            auto previous_context = util::set_thread_dpi_awareness_context(
+                reinterpret_cast<void*>(static_cast<std::intptr_t>(-4))) ;
+            auto result = create() ;
+            if(previous_context) {
+                util::set_thread_dpi_awareness_context(previous_context) ;
+            }
+            return result ;
+        }
+
+        static BOOL CALLBACK enumerate_monitor(HMONITOR hmonitor, HDC, LPRECT, LPARAM lparam) {
+            reinterpret_cast<std::vector<HMONITOR>*>(lparam)->push_back(hmonitor) ;
+            return TRUE ;
+        }
+
+        bool refresh_display_topology() {
+            std::vector<HMONITOR> hmonitors ;
+            if(!EnumDisplayMonitors(
+                    NULL, NULL, &FluentTray::enumerate_monitor,
+                    reinterpret_cast<LPARAM>(&hmonitors))) {
+                return false ;
+            }
+
+            // The position of the primary taskbar is also valid while auto-hidden.
+            APPBARDATA abd = {} ;
+            abd.cbSize = sizeof(abd) ;
+            auto has_taskbar = SHAppBarMessage(ABM_GETTASKBARPOS, &abd) != 0 ;
+            auto taskbar_edge = has_taskbar && abd.uEdge <= ABE_BOTTOM
+                ? static_cast<TaskbarEdge>(abd.uEdge) : TaskbarEdge::BOTTOM ;
+
+            monitors_.clear() ;
+            for(auto hmonitor : hmonitors) {
+                MONITORINFO info ;
+                info.cbSize = sizeof(info) ;
+                if(!GetMonitorInfoW(hmonitor, &info)) {
+                    return false ;
+                }
+
+                MonitorTopology topology ;
+                topology.monitor = util::to_rect(info.rcMonitor) ;
+                topology.work = util::to_rect(info.rcWork) ;
+
+                RECT overlap ;
+                if(has_taskbar && IntersectRect(&overlap, &abd.rc, &info.rcMonitor)) {
+                    topology.edge = taskbar_edge ;
+                    auto vertical = taskbar_edge == TaskbarEdge::LEFT || taskbar_edge == TaskbarEdge::RIGHT ;
+                    topology.taskbar_thickness = vertical
+                        ? overlap.right - overlap.left : overlap.bottom - overlap.top ;
+                }
+                else {
+                    // Secondary taskbars are usually docked on the same edge.
+                    topology.edge = PopupPlacement::detect_taskbar_edge(
+                        topology.monitor, topology.work, taskbar_edge) ;
+                    topology.taskbar_thickness = PopupPlacement::calculate_inset(
+                        topology.monitor, topology.work, topology.edge) ;
+                }
+                monitors_.push_back(topology) ;
+            }
+
+            topology_stale_ = false ;
+            return true ;
+        }
+
+        bool create_dpi_resources(UINT bucket, DpiResources& res) const {
+            res.metrics = base_metrics_.scale(bucket) ;
+            auto logfont = logfont_ ;
+            logfont.lfHeight = util::scale_for_dpi(logfont_.lfHeight, bucket) ;
+            res.font = CreateFontIndirectW(&logfont) ;
+            return res.font != NULL ;
+        }
+
+        bool apply_dpi(UINT dpi) {
+            auto resources = dpi_resources_.get(dpi, [this] (UINT bucket, DpiResources& res) {
+                return create_dpi_resources(bucket, res) ;
+            }) ;
+            if(!resources) {
+                return false ;
+            }
+
+            dpi_ = util::to_dpi_bucket(dpi) ;
+            font_ = resources->font ;
+            menu_font_size_ = resources->metrics.font_size ;
+            menu_x_margin_ = resources->metrics.x_margin ;
+            menu_y_margin_ = resources->metrics.y_margin ;
+            menu_x_pad_ = resources->metrics.x_pad ;
+            menu_y_pad_ = resources->metrics.y_pad ;
+
+            for(auto& menu : menus_) {
+                if(!apply_menu_icon(*resources, menu)) {
+                    return false ;
+                }
+            }
+            return true ;
+        }
+
+        bool apply_menu_icon(DpiResources& resources, FluentMenu& menu) {
+            const auto& path = menu.icon_path() ;
+            if(path.empty()) {
+                return true ;
+            }
+            auto itr = std::find_if(
+                resources.icons.begin(), resources.icons.end(),
+                [&path] (const std::pair<std::wstring, HICON>& icon) {
+                    return icon.first == path ;
+                }) ;
+            if(itr == resources.icons.end()) {
+                // Load the icons at the drawn size to avoid blurry stretching.
+                auto icon_size = 4 * menu_font_size_ / 5 ;
+                auto hicon = static_cast<HICON>(LoadImageW(
+                        NULL, path.c_str(),
+                        IMAGE_ICON, icon_size, icon_size, LR_LOADFROMFILE)) ;
+                if(!hicon) {
+                    return false ;
+                }
+                resources.icons.emplace_back(path, hicon) ;
+                itr = resources.icons.end() - 1 ;
+            }
+            HICON icon ;
+            if(!tint_icon(itr->second, icon)) {
+                return false ;
+            }
+            menu.set_icon(icon) ;
+            return true ;
+        }
+
+        void release_dpi_resources() noexcept {
+            dpi_resources_.clear([this] (DpiResources& res) {
+                if(res.font) {
+                    DeleteObject(res.font) ;
+                }
+                for(auto& icon : res.icons) {
+                    icon_tints_.erase(icon.second, destroy_tinted_icon) ;
+                    DestroyIcon(icon.second) ;
+                }
+            }) ;
+            font_ = NULL ;
+        }
+
+        bool tint_icon(HICON source, HICON& icon) {
+            icon = source ;
+            if(!source || icon_tints_.color() == CLR_INVALID) {
+                return true ;
+            }
+            auto tinted = icon_tints_.get(source, [] (HICON src, COLORREF color, HICON& out) {
+                std::vector<std::uint32_t> pixels ;
+                int width, height ;
+                if(!util::get_icon_pixels(src, pixels, width, height)) {
+                    return false ;
+                }
+                if(!util::is_monochrome_pixels(pixels.data(), pixels.size())) {
+                    // Colored icons are drawn as-is.
+                    out = NULL ;
+                    return true ;
+                }
+                util::recolor_pixels(pixels.data(), pixels.data(), pixels.size(), color) ;
+                out = util::create_icon_from_pixels(pixels.data(), width, height) ;
+                return out != NULL ;
+            }) ;
+            if(!tinted) {
+                return false ;
+            }
+            if(*tinted) {
+                icon = *tinted ;
+            }
+            return true ;
+        }
+
+        static void destroy_tinted_icon(HICON& icon) noexcept {
+            if(icon) {
+                DestroyIcon(icon) ;
+            }
+        }
+
+        COLORREF calculate_icon_tint_color() const {
+            if(icon_tint_ == IconTint::NONE) {
+                return CLR_INVALID ;
+            }
+            if(icon_tint_ == IconTint::ACCENT) {
+                DWORD colorization = 0 ;
+                BOOL opaque = FALSE ;
+                if(SUCCEEDED(DwmGetColorizationColor(&colorization, &opaque))) {
+                    auto accent = util::argb2colorref(colorization) ;
+                    // Graphical objects require a contrast ratio of at least 3:1 in WCAG 2.
+                    auto ratio = util::calculate_contrast_ratio(
+                        util::calculate_luminance(accent),
+                        util::calculate_luminance(back_color_)) ;
+                    if(ratio >= 3.0) {
+                        return accent ;
+                    }
+                }
+            }
+            return text_color_ ;
+        }
+
+        bool retint_icons() {
+            // The icons of menus are picked again from the cache of the current DPI.
+            if(!apply_dpi(dpi_)) {
                 return false ;
             }
+            // The items of the warm and open submenus held the destroyed tints too. The open ones are redrawn by restyle_submenus.
+            auto resources = dpi_resources_.get(dpi_, [this] (UINT bucket, DpiResources& res) {
+                return create_dpi_resources(bucket, res) ;
+            }) ;
+            if(!resources) {
+                return false ;
+            }
+            for(auto node : submenus_.keys()) {
+                for(auto& menu : submenus_.find(node)->menus) {
+                    if(!apply_menu_icon(*resources, menu)) {
+                        return false ;
+                    }
+                }
+            }
+            base_icon_pixels_.clear() ;
+            if(animation_.is_running()) {
+                // The static icon is restored when the animation is stopped.
+                return true ;
+            }
+            return restore_static_icon() ;
+        }
 
-            auto& logfont = metrics.lfCaptionFont ;
-            if(font_size != 0) {
-                logfont.lfHeight = font_size ;
+        bool measure_menus() {
+            auto max_label_width = util::scale_for_dpi(max_label_width_, dpi_) ;
+            grid_.clear() ;
+            for(auto& menu : menus_) {
+                menu.set_max_label_width(max_label_width, ellipsis_mode_) ;
+                if(!menu.measure_label(font_)) {
+                    return false ;
+                }
+                grid_.push_back(menu.required_width()) ;
             }
-            else {
-                logfont.lfHeight = 20 ;
+            return true ;
+        }
+
+        bool update_layout() {
+            if(!visible_) {
+                return true ;
             }
-            if(font_weight != 0) {
-                logfont.lfWeight = font_weight ;
+            if(batch_.is_open()) {
+                batch_.defer_layout() ;
+                return true ;
+            }
+            if(!measure_menus()) {
+                return false ;
+            }
+            // A grown popup is moved so that it stays on the work area.
+            if(!place_popup(SWP_NOZORDER | SWP_NOACTIVATE)) {
+                return false ;
+            }
+            return layout_menus() ;
+        }
+
+        bool refresh_theme(bool redraw=true) {
+            // Only the colors not set by the user are determined from the theme.
+            if(!theme_.is_pinned(ThemeColor::BACK)) {
+                auto back_color = extract_taskbar_color() ;
+                if(back_color == CLR_INVALID) {
+                    return false ;
+                }
+                if(back_color != back_color_ || !back_brush_) {
+                    back_color_ = back_color ;
+                    if(!update_background_brush()) {
+                        return false ;
+                    }
+                }
+            }
+            if(!theme_.is_pinned(ThemeColor::TEXT)) {
+                text_color_ = calculate_text_color_(back_color_) ;
+                if(text_color_ == CLR_INVALID) {
+                    return false ;
+                }
+            }
+
+            // The state colors are drawn from the tonal ramp of the background.
+            const auto& palette = palettes_.get(back_color_, tone_step_ / 255.0) ;
+            if(!theme_.is_pinned(ThemeColor::BORDER)) {
+                border_color_ = palette.separator ;
+            }
+            hover_color_ = theme_.is_pinned(ThemeColor::BORDER) ? border_color_ : palette.hover ;
+            pressed_color_ = palette.pressed ;
+
+            // The icons are recolored only when the color of the theme is changed.
+            if(icon_tints_.set_color(calculate_icon_tint_color(), destroy_tinted_icon)) {
+                if(!retint_icons()) {
+                    return false ;
+                }
+            }
+
+            // Restyle all menus in one batch.
+            for(std::size_t i = 0 ; i < menus_.size() ; i ++) {
+                auto back_color = focus_bits_.test(i) ? hover_color_ : back_color_ ;
+                if(!menus_[i].set_color(
+                        text_color_, back_color, border_color_, pressed_color_)) {
+                    return false ;
+                }
+            }
+            if(!restyle_submenus()) {
+                return false ;
+            }
+            if(visible_ && redraw) {
+                if(!RedrawWindow(
+                        hwnd_, NULL, NULL,
+                        RDW_INVALIDATE | RDW_ERASE | RDW_ALLCHILDREN)) {
+                    return false ;
+                }
+            }
+
+            theme_.validate() ;
+            return true ;
+        }
+
+        bool is_reconcilable(
+                const FluentMenu& menu,
+                const MenuSpec& spec,
+                bool& reconcilable) const {
+            std::wstring icon_path, checkmark ;
+            if(!util::string2wstring(spec.icon_path, icon_path)) {
+                return false ;
+            }
+            if(!util::string2wstring(spec.checkmark, checkmark)) {
+                return false ;
+            }
+            reconcilable = menu.bar_style() == BarStyle::NONE
+                && menu.is_toggleable() == spec.toggleable
+                && menu.icon_path() == icon_path
+                && menu.checkmark() == checkmark ;
+            return true ;
+        }
+
+        template <typename Configure>
+        bool insert_configured_menu(
+                std::size_t position,
+                const std::string& label_text,
+                const std::string& icon_path,
+                bool toggleable,
+                const std::string& checkmark,
+                const std::function<bool(void)>& callback,
+                const std::function<bool(void)>& unchecked_callback,
+                Configure configure) {
+            if(position > menus_.size()) {
+                return false ;
+            }
+            auto list_first = list_first_ ;
+            if(!shift_virtual_menus(position, list_first)) {
+                return false ;
+            }
+
+            // The focus is cleared before anything is allocated, so its failure leaks nothing.
+            if(!clear_focus()) {
+                return false ;
+            }
+
+            FluentMenu menu(toggleable, callback, unchecked_callback) ;
+            std::size_t id ;
+            if(!prepare_menu(menu, label_text, icon_path, checkmark, id)) {
+                return false ;
+            }
+            // The bar is set before the menu is measured, so that its width is included.
+            configure(menu) ;
+            hot_.insert(position, id, menu.window_handle()) ;
+            menus_.insert(position, std::move(menu)) ;
+            list_first_ = list_first ;
+            shift_sections_for_insert(position) ;
+            menu_labels_.insert(id, menus_[position].label()) ;
+            if(select_index_ >= static_cast<int>(position)) {
+                select_index_ ++ ;
+            }
+
+            if(visible_) {
+                auto& inserted = menus_[position] ;
+                inserted.set_max_label_width(
+                    util::scale_for_dpi(max_label_width_, dpi_), ellipsis_mode_) ;
+                if(!inserted.measure_label(font_)) {
+                    return false ;
+                }
+                if(!inserted.icon_path().empty() && !apply_dpi(dpi_)) {
+                    return false ;
+                }
+            }
+            return rearrange_menus(position) ;
+        }
+
+        bool prepare_menu(
+                FluentMenu& menu,
+                const std::string& label_text,
+                const std::string& icon_path,
+                const std::string& checkmark,
+                std::size_t& id) {
+            if(!menu_ids_.allocate(id)) {
+                return false ;
+            }
+            HWND spare_hwnd = NULL ;
+            bool created ;
+            if(!spare_windows_.empty()) {
+                spare_hwnd = spare_windows_.back() ;
+                spare_windows_.pop_back() ;
+                created = menu.reuse_menu(
+                    spare_hwnd, id, label_text, icon_path, checkmark) ;
             }
             else {
-                logfont.lfWeight = FW_MEDIUM ;
+                created = create_per_monitor_dpi_aware([&] {
+                    return menu.create_menu(
+                        hinstance_, hwnd_, id,
+                        label_text, icon_path, checkmark) ;
+                }) ;
             }
 
-            if(!font_name.empty()) {
-                std::wstring font_name_wide ;
-                if(!util::string2wstring(font_name, font_name_wide)) {
+            // On failure, the identifier is released and the window is kept for the next insertion.
+            auto roll_back = [this, &menu, spare_hwnd, id] {
+                auto hwnd = spare_hwnd ? spare_hwnd : menu.window_handle() ;
+                if(hwnd) {
+                    ShowWindow(hwnd, SW_HIDE) ;
+                    spare_windows_.push_back(hwnd) ;
+                }
+                menu_ids_.release(id) ;
+                return false ;
+            } ;
+            if(!created) {
+                return roll_back() ;
+            }
+
+            if(!theme_.is_stale()) {
+                // Other menus are already styled, so only the new one is styled.
+                if(!menu.set_color(
+                        text_color_, back_color_, border_color_, pressed_color_)) {
+                    return roll_back() ;
+                }
+            }
+            return true ;
+        }
+
+        bool reconcile_range(
+                std::size_t first,
+                std::size_t count,
+                const std::vector<MenuSpec>& specs) {
+            std::vector<std::string> desired ;
+            desired.reserve(specs.size()) ;
+            for(const auto& spec : specs) {
+                if(spec.key.empty()) {
                     return false ;
                 }
-                auto& dst = logfont.lfFaceName ;
+                desired.push_back(spec.key) ;
+            }
+            if(!menu_diff_.set_desired(desired)) {
+                return false ;
+            }
 
-                if(font_name_wide.size() < LF_FACESIZE) {
-                    std::wmemcpy(
-                        dst, font_name_wide.c_str(), font_name_wide.length()) ;
-                    dst[font_name_wide.size()] = L'\0' ;
+            // The menus which cannot be changed in place are unmatched to be created again.
+            std::vector<std::string> live ;
+            live.reserve(count) ;
+            for(std::size_t i = first ; i < first + count ; i ++) {
+                const auto& menu = menus_[i] ;
+                std::size_t index ;
+                bool matched ;
+                if(!menu_diff_.find(menu.key(), index)) {
+                    matched = false ;
                 }
-                else {
-                    std::wmemcpy(
-                        dst, font_name_wide.c_str(), LF_FACESIZE - 1) ;
-                    dst[LF_FACESIZE - 1] = L'\0' ;
+                else if(!is_reconcilable(menu, specs[index], matched)) {
+                    return false ;
+                }
+                live.push_back(matched ? menu.key() : std::string()) ;
+            }
+
+            std::vector<DiffOp> ops ;
+            menu_diff_.diff(live, ops) ;
+            return apply_menu_diff(first, count, specs, ops) ;
+        }
+
+        bool apply_menu_diff(
+                std::size_t first,
+                std::size_t count,
+                const std::vector<MenuSpec>& specs,
+                const std::vector<DiffOp>& ops) {
+            if(!clear_focus()) {
+                return false ;
+            }
+            for(const auto& op : ops) {
+                if(op.type == DiffOpType::REMOVE && hot_.is_submenu(first + op.from)) {
+                    if(!close_submenus(0)) {
+                        return false ;
+                    }
+                    break ;
+                }
+            }
+
+            // The operations are applied by handle, so each of them is O(1),
+            // and the tables indexed by position are rebuilt once at the end.
+            std::vector<SlotHandle> live_handles ;
+            live_handles.reserve(count) ;
+            for(std::size_t i = first ; i < first + count ; i ++) {
+                live_handles.push_back(menus_.handle_at(i)) ;
+            }
+            auto end_handle = first + count < menus_.size()
+                ? menus_.handle_at(first + count) : SlotHandle{0, 0} ;
+            auto selected = select_index_ >= 0
+                ? menus_.handle_at(static_cast<std::size_t>(select_index_)) : SlotHandle{0, 0} ;
+            std::vector<SlotHandle> placed(specs.size(), SlotHandle{0, 0}) ;
+            for(std::size_t i = 0 ; i < specs.size() ; i ++) {
+                std::size_t live ;
+                if(menu_diff_.find_live(i, live)) {
+                    placed[i] = live_handles[live] ;
+                }
+            }
+            auto next_of = [&placed, &end_handle] (std::size_t source) {
+                return source + 1 < placed.size() ? placed[source + 1] : end_handle ;
+            } ;
+
+            auto old_size = menus_.size() ;
+            auto has_icon = false ;
+            auto apply = [&] {
+                for(const auto& op : ops) {
+                    switch(op.type) {
+                        case DiffOpType::REMOVE: {
+                            // The removals come first, so the hot table still has the original rows.
+                            auto index = first + op.from ;
+                            auto hwnd = hot_.window(index) ;
+                            ShowWindow(hwnd, SW_HIDE) ;
+                            spare_windows_.push_back(hwnd) ;
+                            menu_ids_.release(hot_.id(index)) ;
+                            menus_.erase(live_handles[op.from]) ;
+                            break ;
+                        }
+                        case DiffOpType::INSERT: {
+                            const auto& spec = specs[op.source] ;
+                            FluentMenu menu(spec.toggleable, spec.callback, spec.unchecked_callback) ;
+                            std::size_t id ;
+                            if(!prepare_menu(menu, spec.label, spec.icon_path, spec.checkmark, id)) {
+                                return false ;
+                            }
+                            menu.set_key(spec.key) ;
+                            if(visible_) {
+                                menu.set_max_label_width(
+                                    util::scale_for_dpi(max_label_width_, dpi_), ellipsis_mode_) ;
+                                if(!menu.measure_label(font_)) {
+                                    return false ;
+                                }
+                                has_icon = has_icon || !menu.icon_path().empty() ;
+                            }
+                            placed[op.source] = menus_.insert_before(next_of(op.source), std::move(menu)) ;
+                            break ;
+                        }
+                        case DiffOpType::MOVE:
+                            if(!menus_.move_before(placed[op.source], next_of(op.source))) {
+                                return false ;
+                            }
+                            break ;
+                    }
+                }
+                return true ;
+            } ;
+            auto applied = apply() ;
+
+            // The tables are rebuilt even after a failure, so that they always match the menus.
+            std::vector<std::size_t> ids ;
+            std::vector<HWND> windows ;
+            ids.reserve(menus_.size()) ;
+            windows.reserve(menus_.size()) ;
+            for(const auto& menu : menus_) {
+                ids.push_back(menu.id()) ;
+                windows.push_back(menu.window_handle()) ;
+            }
+            hot_.assign(ids, windows) ;
+            if(list_.count_rows() > 0 && list_first_ >= first + count) {
+                list_first_ = list_first_ + menus_.size() - old_size ;
+            }
+            shift_sections_for_patch(first, old_size, menus_.size()) ;
+            std::size_t position ;
+            select_index_ = menus_.find_position(selected, position) ? static_cast<int>(position) : -1 ;
+
+            // The menus are in the order of specs here, so only the changed properties are applied.
+            auto reflow_column = grid_.count_columns() ;
+            auto update = [&] {
+                std::string label ;
+                for(std::size_t i = 0 ; i < specs.size() ; i ++) {
+                    auto& menu = menus_[first + i] ;
+                    const auto& spec = specs[i] ;
+                    menu.set_callbacks(spec.callback, spec.unchecked_callback) ;
+                    if(!menu.get_label(label)) {
+                        return false ;
+                    }
+                    if(label != spec.label) {
+                        auto relabeled = visible_
+                            ? relabel_menu(first + i, spec.label, reflow_column)
+                            : menu.set_label(spec.label) ;
+                        if(!relabeled) {
+                            return false ;
+                        }
+                    }
+                    if(menu.is_toggleable() && menu.is_checked() != spec.checked) {
+                        if(!set_checked(first + i, spec.checked)) {
+                            return false ;
+                        }
+                    }
+                    if(menu.has_separator_line() != spec.separator) {
+                        if(spec.separator) {
+                            menu.show_separator_line() ;
+                        }
+                        else {
+                            menu.hide_separator_line() ;
+                        }
+                        if(visible_) {
+                            batch_.defer_repaint() ;
+                        }
+                    }
+                }
+                return true ;
+            } ;
+            auto updated = applied && (!has_icon || apply_dpi(dpi_)) && update() ;
+
+            // The labels are indexed once for all changes.
+            index_menu_labels() ;
+            if(!updated) {
+                rearrange_menus(first) ;
+                return false ;
+            }
+            return reflow_menus(reflow_column) && rearrange_menus(first) ;
+        }
+
+        void index_menu_labels() {
+            // The labels of virtual menus are indexed by item.
+            std::vector<std::size_t> ids ;
+            std::vector<std::wstring> labels ;
+            for(std::size_t i = 0 ; i < menus_.size() ; i ++) {
+                if(!is_virtual_menu(i)) {
+                    ids.push_back(hot_.id(i)) ;
+                    labels.push_back(menus_[i].label()) ;
+                }
+            }
+            menu_labels_.assign(ids, labels) ;
+        }
+
+        bool bind_instance(HWND hwnd) {
+            // To access the this pointer inside the callback function,
+            // the address divide into the two part address.
+            LONG upper_addr, lower_addr ;
+            util::split_bits(this, upper_addr, lower_addr) ;
+
+            SetLastError(0) ;
+            if(!SetWindowLongW(hwnd, 0, upper_addr) && GetLastError() != 0) {
+                return false ;
+            }
+            SetLastError(0) ;
+            if(!SetWindowLongW(hwnd, sizeof(LONG), lower_addr) && GetLastError() != 0) {
+                return false ;
+            }
+            return true ;
+        }
+
+        bool open_submenu(std::size_t level, std::size_t node, HWND anchor) {
+            if(cascade_.depth() > level && cascade_.node_at(level) == node) {
+                return true ;
+            }
+            if(!close_submenus(level)) {
+                return false ;
+            }
+            if(!materialize_submenu(node)) {
+                return false ;
+            }
+            const auto& submenu = *submenus_.find(node) ;
+
+            RECT item ;
+            if(!GetWindowRect(anchor, &item)) {
+                return false ;
+            }
+            if(topology_stale_) {
+                if(!refresh_display_topology()) {
+                    return false ;
+                }
+            }
+            auto monitor = PopupPlacement::find_monitor(monitors_, Point{item.right, item.top}) ;
+            if(monitor >= monitors_.size()) {
+                return false ;
+            }
+            auto rect = PopupPlacement::solve_cascade(
+                monitors_[monitor].work, util::to_rect(item), submenu.width, submenu.height) ;
+            if(!SetWindowPos(
+                    submenu.hwnd, HWND_TOPMOST,
+                    rect.left, rect.top, submenu.width, submenu.height,
+                    SWP_SHOWWINDOW | SWP_NOACTIVATE)) {
+                return false ;
+            }
+
+            cascade_.open(level, node, [] (std::size_t, int) {return true ;}) ;
+            trim_submenus(warm_submenu_capacity_) ;
+            return true ;
+        }
+
+        bool close_submenus(std::size_t level) {
+            return cascade_.close_from(level, [this] (std::size_t node, int selection) {
+                auto& submenu = *submenus_.find(node) ;
+                ShowWindow(submenu.hwnd, SW_HIDE) ;
+                if(selection < 0) {
+                    return true ;
+                }
+                // Restore the background of the selected item for the next opening.
+                return change_menu_back_color(
+                    submenu.menus[static_cast<std::size_t>(selection)], back_color_) ;
+            }) ;
+        }
+
+        bool release_submenu(std::size_t node) {
+            std::size_t level ;
+            if(cascade_.find_level(node, level)) {
+                if(!close_submenus(level)) {
+                    return false ;
+                }
+            }
+            submenus_.release(node, [] (Submenu& submenu) {
+                DestroyWindow(submenu.hwnd) ;
+            }) ;
+            return true ;
+        }
+
+        bool materialize_submenu(std::size_t node) {
+            auto existing = submenus_.find(node) ;
+            if(existing && existing->dpi != dpi_) {
+                // Created for another DPI.
+                if(!release_submenu(node)) {
+                    return false ;
+                }
+            }
+
+            auto created = submenus_.get(node, [this, node] (std::unique_ptr<Submenu>& result) {
+                std::unique_ptr<Submenu> submenu(
+                    new Submenu{NULL, dpi_, 0, 0, std::vector<FluentMenu>()}) ;
+                if(!create_per_monitor_dpi_aware([this, &submenu] {
+                        submenu->hwnd = CreateWindowExW(
+                            WS_EX_TOOLWINDOW | WS_EX_NOACTIVATE | WS_EX_TOPMOST,
+                            app_name_.c_str(),
+                            app_name_.c_str(),
+                            WS_POPUPWINDOW,
+                            0, 0, 100, 100,
+                            hwnd_, NULL,
+                            hinstance_, NULL
+                        ) ;
+                        return submenu->hwnd != NULL ;
+                    })) {
+                    return false ;
+                }
+                if(!bind_instance(submenu->hwnd) || !create_submenu_menus(node, *submenu)) {
+                    DestroyWindow(submenu->hwnd) ;
+                    return false ;
+                }
+                result = std::move(submenu) ;
+                return true ;
+            }) ;
+            return created != nullptr ;
+        }
+
+        bool create_submenu_menus(std::size_t node, Submenu& submenu) {
+            auto resources = dpi_resources_.get(dpi_, [this] (UINT bucket, DpiResources& res) {
+                return create_dpi_resources(bucket, res) ;
+            }) ;
+            if(!resources) {
+                return false ;
+            }
+
+            auto max_label_width = util::scale_for_dpi(max_label_width_, dpi_) ;
+            auto count = submenu_tree_.count_items(node) ;
+            LONG label_width = 0 ;
+            submenu.menus.reserve(count) ;
+            for(std::size_t i = 0 ; i < count ; i ++) {
+                const auto& spec = submenu_tree_.item(node, i) ;
+                FluentMenu menu(spec.toggleable, spec.callback, spec.unchecked_callback) ;
+                if(!create_per_monitor_dpi_aware([&] {
+                        return menu.create_menu(
+                            hinstance_, submenu.hwnd, i + 1,
+                            spec.label, spec.icon_path, spec.checkmark) ;
+                    })) {
+                    return false ;
+                }
+                if(spec.checked) {
+                    menu.check() ;
+                }
+                if(spec.separator) {
+                    menu.show_separator_line() ;
+                }
+                if(!menu.set_color(
+                        text_color_, back_color_, border_color_, pressed_color_)) {
+                    return false ;
+                }
+                if(!apply_menu_icon(*resources, menu)) {
+                    return false ;
+                }
+                menu.set_max_label_width(max_label_width, ellipsis_mode_) ;
+                if(!menu.measure_label(font_)) {
+                    return false ;
+                }
+                label_width = (std::max)(label_width, menu.required_width()) ;
+                submenu.menus.push_back(std::move(menu)) ;
+            }
+
+            // The items are arranged in a single column.
+            auto menu_width = label_width + 2 * menu_x_pad_ ;
+            auto menu_height = calculate_menu_height() ;
+            for(std::size_t i = 0 ; i < count ; i ++) {
+                auto y = menu_y_margin_ + static_cast<LONG>(i) * (menu_height + menu_y_margin_) ;
+                if(!SetWindowPos(
+                        submenu.menus[i].window_handle(), HWND_TOP,
+                        menu_x_margin_, y,
+                        menu_width, menu_height,
+                        SWP_SHOWWINDOW)) {
+                    return false ;
                 }
             }
+            submenu.width = menu_width + 2 * menu_x_margin_ ;
+            submenu.height = static_cast<LONG>(count) * (menu_height + menu_y_margin_) + menu_y_margin_ ;
+            return true ;
+        }
 
-            auto font = CreateFontIndirectW(&logfont) ;
-            if(!font) {
-                return false ;
+        Submenu* find_submenu(HWND hwnd) const noexcept {
+            // Only the created submenus are searched, which are a few.
+            for(auto node : submenus_.keys()) {
+                auto submenu = submenus_.find(node) ;
+                if(submenu->hwnd == hwnd) {
+                    return submenu ;
+                }
             }
-            font_ = font ;
-            menu_font_size_ = std::abs(logfont.lfHeight) ;
+            return nullptr ;
+        }
 
-            return true;
+        FluentMenu* find_submenu_item(HWND submenu_hwnd, HWND item_hwnd) const {
+            auto submenu = find_submenu(submenu_hwnd) ;
+            if(!submenu) {
+                return nullptr ;
+            }
+            auto id = GetDlgCtrlID(item_hwnd) ;
+            if(id <= 0 || static_cast<std::size_t>(id) > submenu->menus.size()) {
+                return nullptr ;
+            }
+            auto& menu = submenu->menus[static_cast<std::size_t>(id) - 1] ;
+            return menu.window_handle() == item_hwnd ? &menu : nullptr ;
         }
 
-        /**
-         * @brief Set colors to draw menus.
-         * @param [in] text_color The color for label text.
-         * @param [in] back_color The color for background.
-         * @param [in] border_color The color for border.
-         * @return Returns true on success, false on failure.
-         */
-        bool set_color(
-                COLORREF text_color=CLR_INVALID,
-                COLORREF back_color=CLR_INVALID,
-                COLORREF border_color=CLR_INVALID) {
-            if(back_color != CLR_INVALID) {
-                back_color_ = back_color ;
-                if(!update_background_brush()) {
-                    return false ;
+        bool find_submenu_level(HWND hwnd, std::size_t& level) const noexcept {
+            for(std::size_t i = 0 ; i < cascade_.depth() ; i ++) {
+                if(submenus_.find(cascade_.node_at(i))->hwnd == hwnd) {
+                    level = i ;
+                    return true ;
                 }
             }
-            if(text_color != CLR_INVALID) {
-                text_color_ = text_color ;
+            return false ;
+        }
+
+        bool activate_submenu_item(std::size_t level, std::size_t index) {
+            auto node = cascade_.node_at(level) ;
+            auto& submenu = *submenus_.find(node) ;
+            if(index >= submenu.menus.size()) {
+                return true ;
             }
-            if(border_color != CLR_INVALID) {
-                border_color_ = border_color ;
+            std::size_t child ;
+            if(submenu_tree_.find_child(node, index, child)) {
+                return open_submenu(level + 1, child, submenu.menus[index].window_handle()) ;
             }
-            return true ;
+            if(!submenu.menus[index].process_click_event()) {
+                stop() ;
+                return true ;
+            }
+            return hide_menu_window() ;
         }
 
-        /**
-         * @brief Load the image file and change the icon.
-         * @return Returns true on success, false on failure.
-         */
-        bool change_icon(const std::string& icon_path) {
-            if(icon_data_.cbSize > 0) {
-                if(!Shell_NotifyIconW(NIM_DELETE, &icon_data_)) {
+        bool reselect_submenu_item(std::size_t level, int previous) {
+            auto& submenu = *submenus_.find(cascade_.node_at(level)) ;
+            auto current = cascade_.selection(level) ;
+            if(previous == current) {
+                return true ;
+            }
+            if(previous >= 0) {
+                if(!change_menu_back_color(
+                        submenu.menus[static_cast<std::size_t>(previous)], back_color_)) {
                     return false ;
                 }
             }
+            if(current >= 0) {
+                if(!change_menu_back_color(
+                        submenu.menus[static_cast<std::size_t>(current)], hover_color_)) {
+                    return false ;
+                }
+            }
+            return true ;
+        }
 
-            ZeroMemory(&icon_data_, sizeof(icon_data_)) ;
-
-            if(icon_path.empty()) {
-                icon_data_.cbSize = 0 ;
+        bool select_first_submenu_item() {
+            if(cascade_.depth() == 0) {
                 return true ;
             }
+            auto level = cascade_.depth() - 1 ;
+            auto count = submenus_.find(cascade_.node_at(level))->menus.size() ;
+            auto previous = cascade_.select(level, -1) ;
+            cascade_.step(count, true) ;
+            return reselect_submenu_item(level, previous) ;
+        }
 
-            std::wstring icon_path_wide ;
-            if(!util::string2wstring(icon_path, icon_path_wide)) {
-                return false ;
+        bool hover_submenu_item(HWND item_hwnd) {
+            auto submenu_hwnd = GetParent(item_hwnd) ;
+            std::size_t level ;
+            if(!submenu_hwnd || !find_submenu_level(submenu_hwnd, level)) {
+                return true ;
+            }
+            auto id = GetDlgCtrlID(item_hwnd) ;
+            if(id <= 0) {
+                return true ;
             }
+            auto previous = cascade_.select(level, id - 1) ;
+            return reselect_submenu_item(level, previous) ;
+        }
 
-            if(!util::exists(icon_path_wide)) {
-                return false ;
+        bool process_submenu_key(WPARAM key, bool& handled) {
+            handled = true ;
+            auto level = cascade_.depth() - 1 ;
+            auto node = cascade_.node_at(level) ;
+            switch(key) {
+                case VK_DOWN:
+                case VK_UP: {
+                    auto count = submenus_.find(node)->menus.size() ;
+                    auto previous = cascade_.step(count, key == VK_DOWN) ;
+                    return reselect_submenu_item(level, previous) ;
+                }
+                case VK_RIGHT:
+                case VK_SPACE:
+                case VK_RETURN: {
+                    auto selection = cascade_.selection(level) ;
+                    if(selection < 0) {
+                        return true ;
+                    }
+                    auto index = static_cast<std::size_t>(selection) ;
+                    std::size_t child ;
+                    if(key == VK_RIGHT && !submenu_tree_.find_child(node, index, child)) {
+                        return true ;
+                    }
+                    if(!activate_submenu_item(level, index)) {
+                        return false ;
+                    }
+                    // Start selection by key in the opened submenu.
+                    if(cascade_.depth() > level + 1) {
+                        return select_first_submenu_item() ;
+                    }
+                    return true ;
+                }
+                case VK_LEFT:
+                case VK_ESCAPE:
+                    return close_submenus(level) ;
+                default:
+                    handled = false ;
+                    return true ;
             }
+        }
 
-            icon_data_.cbSize = sizeof(icon_data_) ;
-            icon_data_.hWnd = hwnd_ ;
-            icon_data_.uFlags = NIF_ICON | NIF_MESSAGE | NIF_TIP ;
-            icon_data_.uCallbackMessage = message_id_ ;
-            icon_data_.hIcon = static_cast<HICON>(
-                LoadImageW(
-                    NULL, icon_path_wide.c_str(),
-                    IMAGE_ICON, 0, 0, LR_LOADFROMFILE)) ;
-            wcscpy_s(icon_data_.szTip, app_name_.c_str()) ;
-            icon_data_.dwState = NIS_SHAREDICON ;
-            icon_data_.dwStateMask = NIS_SHAREDICON ;
+        bool restyle_submenus() {
+            for(auto node : submenus_.keys()) {
+                std::size_t level ;
+                auto open = cascade_.find_level(node, level) ;
+                auto& menus = submenus_.find(node)->menus ;
+                for(std::size_t i = 0 ; i < menus.size() ; i ++) {
+                    auto selected = open && cascade_.selection(level) == static_cast<int>(i) ;
+                    if(!menus[i].set_color(
+                            text_color_, selected ? hover_color_ : back_color_,
+                            border_color_, pressed_color_)) {
+                        return false ;
+                    }
+                }
+                if(open) {
+                    if(!RedrawWindow(
+                            submenus_.find(node)->hwnd, NULL, NULL,
+                            RDW_INVALIDATE | RDW_ERASE | RDW_ALLCHILDREN)) {
+                        return false ;
+                    }
+                }
+            }
+            return true ;
+        }
 
-            if(!Shell_NotifyIconW(NIM_ADD, &icon_data_)) {
-                return false ;
+        bool clear_focus() {
+            if(focus_index_ >= 0) {
+                focus_bits_.set(static_cast<std::size_t>(focus_index_), false) ;
+                focus_index_ = -1 ;
             }
+            return apply_focus() ;
+        }
 
-            if(!hide_menu_window()) {
+        bool is_virtual_menu(std::size_t index) const noexcept {
+            return index >= list_first_ && index < list_first_ + list_.count_rows() ;
+        }
+
+        bool shift_virtual_menus(std::size_t position, std::size_t& list_first) const noexcept {
+            // The virtual menus must stay contiguous.
+            if(list_.count_rows() == 0 || position > list_first + list_.count_rows()) {
+                return true ;
+            }
+            if(position > list_first && position < list_first + list_.count_rows()) {
                 return false ;
             }
-
+            if(position <= list_first) {
+                list_first ++ ;
+            }
             return true ;
         }
 
-    private:
-        static LRESULT CALLBACK callback(
-                HWND hwnd,
-                UINT msg,
-                WPARAM wparam,
-                LPARAM lparam) {
-            auto get_instance = [hwnd]() -> FluentTray* {
-                auto upper_addr = GetWindowLongW(hwnd, 0) ;
-                if(!upper_addr) {
-                    return nullptr ;
+        void shift_sections_for_insert(std::size_t position) noexcept {
+            for(std::size_t i = 0 ; i < sections_.size() ; i ++) {
+                auto& section = sections_[i] ;
+                auto end = section.first + section.count ;
+                if(static_cast<int>(i) == patching_section_) {
+                    if(position >= section.first && position <= end) {
+                        section.count ++ ;
+                    }
+                    continue ;
                 }
-
-                auto lower_addr = GetWindowLongW(hwnd, sizeof(LONG)) ;
-                if(!lower_addr) {
-                    return nullptr ;
+                // A menu at the start of an empty section is placed after it,
+                // unless an earlier section at the same position is being filled.
+                auto before = position < section.first
+                    || (position == section.first
+                        && (section.count > 0
+                            || (patching_section_ >= 0 && patching_section_ < static_cast<int>(i)))) ;
+                if(before) {
+                    section.first ++ ;
                 }
-
-                FluentTray* self ;
-                util::concatenate_bits(upper_addr, lower_addr, self) ;
-                return self ;
-            } ;
-
-            if(msg == WM_DESTROY || msg == WM_QUIT || msg == WM_CLOSE) {
-                if(auto self = get_instance()) {
-                    self->stop() ;
-                    return 0 ;
+                else if(position < end) {
+                    section.count ++ ;
                 }
             }
-            else if(msg == WM_ACTIVATE && wparam == WA_INACTIVE) {
-                if(auto self = get_instance()) {
-                    if(!self->hide_menu_window()) {
-                        self->fail() ;
-                    }
-                    return 0 ;
+        }
+
+        void shift_sections_for_remove(std::size_t index) noexcept {
+            for(auto& section : sections_) {
+                if(index < section.first) {
+                    section.first -- ;
                 }
-            }
-            else if(msg == WM_DRAWITEM) {
-                if(auto self = get_instance()) {
-                    auto item = reinterpret_cast<LPDRAWITEMSTRUCT>(lparam) ;
-                    auto menu_idx = self->get_menu_index_from_window(item->hwndItem) ;
-                    if(menu_idx < 0) {
-                        return FALSE ;
-                    }
-                    auto& menu = self->menus_[menu_idx] ;
-                    if(!menu.draw_menu(item, self->font_)) {
-                        self->fail() ;
-                        return FALSE ;
-                    }
-                    return TRUE ;
+                else if(index < section.first + section.count) {
+                    section.count -- ;
                 }
             }
-            else if(msg == WM_CTLCOLORBTN) {
-                if(auto self = get_instance()) {
-                    auto menu_idx = self->get_menu_index_from_window(reinterpret_cast<HWND>(lparam)) ;
-                    if(menu_idx < 0) {
-                        return DefWindowProc(hwnd, msg, wparam, lparam) ;
-                    }
-                    auto& menu = self->menus_[menu_idx] ;
-                    return reinterpret_cast<LRESULT>(menu.background_brush()) ;
+        }
+
+        void shift_sections_for_patch(std::size_t first, std::size_t old_size, std::size_t new_size) noexcept {
+            for(std::size_t i = 0 ; i < sections_.size() ; i ++) {
+                auto& section = sections_[i] ;
+                if(static_cast<int>(i) == patching_section_) {
+                    section.count = section.count + new_size - old_size ;
+                    continue ;
                 }
-            }
-            else if(msg == WM_COMMAND) {
-                if(auto self = get_instance()) {
-                    auto menu_idx = self->get_menu_index_from_id(LOWORD(wparam)) ;
-                    if(menu_idx < 0) {
-                        return FALSE ;
-                    }
-                    auto& menu = self->menus_[menu_idx] ;
-                    if(!menu.process_click_event()) {
-                        self->stop() ;
-                        return FALSE ;
-                    }
-                    if(!self->hide_menu_window()) {
-                        return FALSE ;
-                    }
-                    return TRUE ;
+                // The same rule as shift_sections_for_insert decides the sections after the patched one.
+                auto after = section.first > first
+                    || (section.first == first
+                        && (section.count > 0
+                            || (patching_section_ >= 0 && patching_section_ < static_cast<int>(i)))) ;
+                if(after) {
+                    section.first = section.first + new_size - old_size ;
                 }
             }
-            else if(msg == WM_KEYDOWN) {
-                if(auto self = get_instance()) {
-                    if(wparam == VK_DOWN) {
-                        if(self->select_index_ < 0) {
-                            // Initialize the position of bounding box cursor
-                            self->select_index_ = 0 ;
-                        }
-                        else {
-                            self->select_index_ = (self->select_index_ + 1) % self->menus_.size() ;
-                        }
-                        return TRUE;
-                    }
-                    else if(wparam == VK_UP) {
-                        if(self->select_index_ < 0) {
-                            // Initialize the position of bounding box cursor
-                            self->select_index_ = static_cast<int>(self->menus_.size() - 1) ;
-                        }
-                        else {
-                            auto mod = static_cast<int>(self->menus_.size()) ;
-                            self->select_index_ = ((self->select_index_ - 1) % mod + mod) % mod ;  // to be positive
-                        }
-                        return TRUE;
-                    }
-                    else if(wparam == VK_ESCAPE) {
-                        if(!self->hide_menu_window()) {
-                            return FALSE ;
-                        }
-                        return TRUE;
-                    }
-                    else if(wparam == VK_SPACE || wparam == VK_RETURN) {
-                        if(self->select_index_ >= 0) {
-                            auto& menu = self->menus_[self->select_index_] ;
-                            if(!menu.process_click_event()) {
-                                self->stop() ;
-                                return FALSE ;
-                            }
-                            if(!self->hide_menu_window()) {
-                                return FALSE ;
-                            }
-                        }
-                        return TRUE;
-                    }
+        }
+
+        bool patch_menu_section(std::size_t index) {
+            auto& section = sections_[index] ;
+            section.version = section.cache.version() ;
+            patching_section_ = static_cast<int>(index) ;
+            begin_update() ;
+            auto result = reconcile_range(
+                section.first, section.count, section.cache.items()) ;
+            patching_section_ = -1 ;
+            return end_update() && result ;
+        }
+
+        bool open_menu_sections(std::chrono::steady_clock::time_point now) {
+            for(std::size_t i = 0 ; i < sections_.size() ; i ++) {
+                auto& section = sections_[i] ;
+                // The provider starts on a worker thread, and the cached menus are shown meanwhile.
+                if(section.cache.open(now)) {
+                    section.cache.poll(now, section.provider) ;
                 }
-            }
-            else if(msg == message_id_) {  //On NotifyIcon
-                if(auto self = get_instance()) {
-                    if(lparam == WM_LBUTTONUP || lparam == WM_RBUTTONUP) {
-                        self->show_menu_window() ;
-                        return 0 ;
+                if(section.version != section.cache.version()) {
+                    if(!patch_menu_section(i)) {
+                        return false ;
                     }
                 }
             }
-
-            return DefWindowProc(hwnd, msg, wparam, lparam) ;
+            return true ;
         }
 
-        int get_menu_index_from_window(HWND hwnd) {
-            int i = 0 ;
-            for(auto& m : menus_) {
-                if(m.window_handle() == hwnd) {
-                    return i ;
+        bool poll_menu_sections(std::chrono::steady_clock::time_point now) {
+            for(std::size_t i = 0 ; i < sections_.size() ; i ++) {
+                if(sections_[i].cache.poll(now, sections_[i].provider)) {
+                    if(!patch_menu_section(i)) {
+                        return false ;
+                    }
                 }
-                i ++ ;
             }
-            return -1 ;
+            return true ;
         }
 
-        int get_menu_index_from_id(WORD id) {
-            int i = 0 ;
-            for(auto& m : menus_) {
-                if(m.id() == static_cast<std::size_t>(id)) {
-                    return i ;
-                }
-                i ++ ;
+        bool rearrange_menus(std::size_t position) {
+            hover_.reset() ;
+            focus_bits_.resize(menus_.size()) ;
+            // The checks follow the menus from the changed position, which are placed and painted again.
+            checked_bits_.resize(menus_.size()) ;
+            for(auto i = position ; i < menus_.size() ; i ++) {
+                checked_bits_.assign(i, menus_[i].is_checked()) ;
+            }
+            if(!visible_) {
+                return true ;
+            }
+            if(batch_.is_open()) {
+                batch_.defer_layout() ;
+                return true ;
+            }
+
+            // The widths of menus are cached, so no menu is measured here.
+            grid_.clear() ;
+            for(const auto& menu : menus_) {
+                grid_.push_back(menu.required_width()) ;
             }
-            return -1 ;
+            // A grown popup is moved so that it stays on the work area.
+            if(!place_popup(SWP_NOZORDER | SWP_NOACTIVATE)) {
+                return false ;
+            }
+            // The columns before the changed position are not moved.
+            auto column = position < grid_.size()
+                ? grid_.column_of(position) : grid_.count_columns() ;
+            return layout_menus(column) ;
         }
 
-        void get_message(MSG& message) {
-            if(PeekMessage(&message, hwnd_, 0, 0, PM_REMOVE)) {
-                DispatchMessage(&message) ;
+        bool apply_checks() {
+            // Only the words of the changed checks are visited.
+            return checked_bits_.flush([this] (std::size_t index, bool) {
+                return !visible_ || InvalidateRect(menus_[index].window_handle(), NULL, TRUE) != FALSE ;
+            }) ;
+        }
+
+        bool click_menu(std::size_t index) {
+            if(!menus_[index].process_click_event()) {
+                return false ;
+            }
+            // The toggled check is painted when the menu window is shown again, and the callback may have removed the menu.
+            if(index < menus_.size()) {
+                checked_bits_.assign(index, menus_[index].is_checked()) ;
             }
+            return true ;
         }
 
-        void fail() noexcept {
-            status_ = TrayStatus::FAILED ;
+        bool apply_focus() {
+            // Only the words of the moved focus are visited.
+            return focus_bits_.flush([this] (std::size_t index, bool focused) {
+                return change_menu_back_color(
+                    menus_[index], focused ? hover_color_ : back_color_) ;
+            }) ;
         }
 
         bool change_menu_back_color(FluentMenu& menu, COLORREF new_color) {
@@ -1618,67 +5172,44 @@ namespace fluent_tray
                 return CLR_INVALID ;
             }
 
-            COLORREF color = CLR_INVALID ;
-            if(auto dc = GetDC(NULL)) {
-                // Get Taskbar color
-                color = GetPixel(
-                    dc,
-                    abd.rc.left + autocolorpick_offset_,
-                    abd.rc.top + autocolorpick_offset_) ;
-                if(color == CLR_INVALID) {
-                    // if failed, use COLOR_WINDOW color.
-                    color = GetSysColor(COLOR_WINDOW) ;
-                }
-                if(!ReleaseDC(NULL, dc)) {
-                    return CLR_INVALID ;
-                }
-            }
-            return color ;
-        }
-
-        static COLORREF calculate_faded_color_(
-                COLORREF back_color,
-                unsigned char color_decay=10) {
-            auto back_gray_color = util::rgb2gray(back_color) ;
-
-            unsigned char ash_value = back_gray_color ;
-            if(back_gray_color < 128) {
-                ash_value = static_cast<decltype(ash_value)>(
-                    (std::min)(ash_value + color_decay, 255)) ;
+            // Sample a thin strip along the taskbar, offset from its edge.
+            const LONG thickness = 2 ;
+            auto strip = abd.rc ;
+            if(strip.right - strip.left >= strip.bottom - strip.top) {
+                strip.top = (std::min)(strip.top + autocolorpick_offset_, strip.bottom - thickness) ;
+                strip.bottom = strip.top + thickness ;
             }
             else {
-                ash_value = static_cast<decltype(ash_value)>(
-                    (std::max)(ash_value - color_decay, 0)) ;
+                strip.left = (std::min)(strip.left + autocolorpick_offset_, strip.right - thickness) ;
+                strip.right = strip.left + thickness ;
+            }
+
+            std::vector<std::uint32_t> pixels ;
+            if(!util::capture_screen_pixels(strip, pixels)) {
+                // if failed, use COLOR_WINDOW color.
+                return GetSysColor(COLOR_WINDOW) ;
             }
-            return RGB(ash_value, ash_value, ash_value) ;
+            return util::argb2colorref(
+                util::calculate_robust_mean_color(pixels.data(), pixels.size())) ;
         }
 
         static COLORREF calculate_text_color_(COLORREF back_color) {
-            auto back_gray_color = util::rgb2gray(back_color) ;
-
+            // Use the system text color or its inverse, whichever is more legible.
             auto text_color = GetSysColor(COLOR_WINDOWTEXT) ;
-            if(back_gray_color < 128) {
-                // if dark background, use light text color.
-                text_color = 0x00FFFFFF & ~text_color ;
-            }
-            return text_color ;
+            const COLORREF candidates[] = {text_color, 0x00FFFFFF & ~text_color} ;
+            return util::pick_contrast_color(back_color, candidates, 2) ;
         }
 
         bool update_background_brush() {
-            if(back_brush_) {
-                // Release old handle.
-                if(!DeleteObject(back_brush_)) {
-                    return false ;
-                }
-            }
-            back_brush_ = CreateSolidBrush(back_color_) ;
-            if(back_brush_ == NULL) {
+            // The old handle is released.
+            back_brush_.reset(CreateSolidBrush(back_color_)) ;
+            if(!back_brush_) {
                 return false ;
             }
 
             if(!SetClassLongPtr(
                     hwnd_, GCLP_HBRBACKGROUND,
-                    reinterpret_cast<LONG_PTR>(back_brush_))) {
+                    reinterpret_cast<LONG_PTR>(back_brush_.get()))) {
                 return false ;
             }
 
@@ -0,0 +1,6132 @@
+/**
+ * @file fluent_tray_core.hpp
+ * @brief Win32-independent kernels of fluent_tray
+ * @author pit-ray
+ * @date 2024
+ *
+ * @details The layouts, caches and pixel kernels do not depend on windows.h, so they are built and tested on any platform.
+ **/
+
+/*
+ * MIT License
+ *
+ * Copyright (c) 2024 pit-ray
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _FLUENT_TRAY_CORE_HPP
+#define _FLUENT_TRAY_CORE_HPP
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#if !defined(_FLUENT_TRAY_NO_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define _FLUENT_TRAY_USE_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wold-style-cast"
+#endif
+
+/**
+ * @namespace fluent_tray
+ * @brief Base namespace
+ */
+namespace fluent_tray
+{
+    /**
+     * @brief Rectangle in pixels with the same members as RECT.
+     */
+    struct Rect {
+        //! The x-coordinate of the upper-left corner
+        long left ;
+        //! The y-coordinate of the upper-left corner
+        long top ;
+        //! The x-coordinate of the lower-right corner, which is exclusive
+        long right ;
+        //! The y-coordinate of the lower-right corner, which is exclusive
+        long bottom ;
+    } ;
+
+    /**
+     * @brief Point in pixels with the same members as POINT.
+     */
+    struct Point {
+        //! The x-coordinate
+        long x ;
+        //! The y-coordinate
+        long y ;
+    } ;
+
+    /**
+     * @namespace fluent_tray::util
+     * @brief Utility namespace
+     */
+    namespace util
+    {
+        /**
+         * @brief The color value meaning no color, which is the same as CLR_INVALID.
+         */
+        constexpr std::uint32_t invalid_color = 0xFFFFFFFF ;
+
+        /**
+         * @brief Pack the components into a color value in the COLORREF layout, 0x00BBGGRR.
+         * @param [in] r The red component.
+         * @param [in] g The green component.
+         * @param [in] b The blue component.
+         * @return The color value, which is the same as RGB(r, g, b).
+         */
+        inline constexpr std::uint32_t rgb(unsigned char r, unsigned char g, unsigned char b) noexcept {
+            return static_cast<std::uint32_t>(r)
+                 | (static_cast<std::uint32_t>(g) << 8)
+                 | (static_cast<std::uint32_t>(b) << 16) ;
+        }
+
+        /**
+         * @brief Extract the red component of a color value in the COLORREF layout.
+         * @param [in] color A input color value.
+         * @return The red component, which is the same as GetRValue(color).
+         */
+        inline constexpr unsigned char red_of(std::uint32_t color) noexcept {
+            return static_cast<unsigned char>(color & 0xFF) ;
+        }
+
+        /**
+         * @brief Extract the green component of a color value in the COLORREF layout.
+         * @param [in] color A input color value.
+         * @return The green component, which is the same as GetGValue(color).
+         */
+        inline constexpr unsigned char green_of(std::uint32_t color) noexcept {
+            return static_cast<unsigned char>((color >> 8) & 0xFF) ;
+        }
+
+        /**
+         * @brief Extract the blue component of a color value in the COLORREF layout.
+         * @param [in] color A input color value.
+         * @return The blue component, which is the same as GetBValue(color).
+         */
+        inline constexpr unsigned char blue_of(std::uint32_t color) noexcept {
+            return static_cast<unsigned char>((color >> 16) & 0xFF) ;
+        }
+
+        /**
+         * @brief Generates a mask with the specified number of lower bits set to 1.
+         * @param [in] bits Number of bits
+         * @return A generated bit mask.
+         */
+        inline constexpr std::size_t bit2mask(std::size_t bits) noexcept {
+            return (static_cast<std::size_t>(1) << bits) - 1 ;
+        }
+
+        /**
+         * @brief Calculate the number of bits of type
+         * @return The number of bits.
+         */
+        template <typename Type>
+        inline constexpr int type2bit() noexcept {
+            return static_cast<int>(sizeof(Type) * CHAR_BIT) ;
+        }
+
+        /**
+         * @brief Divides the input value into upper and lower bits.
+         * @param [in] input A input value.
+         * @param [out] upper A output upper bits.
+         * @param [out] lower A outputs lower bits.
+         * @details The splits is performed by storing the lower bits of number of bits of OutType in lower and the remaining bits in upper.
+         * @sa concatenate_bits
+         */
+        template <typename InType, typename OutType>
+        inline void split_bits(InType input, OutType& upper, OutType& lower) noexcept {
+            static constexpr auto bits = type2bit<OutType>() ;
+            static const auto lower_mask = util::bit2mask(bits) ;
+
+            upper = static_cast<OutType>((std::size_t)(input) >> bits) ;
+            lower = static_cast<OutType>((std::size_t)(input) & lower_mask) ;
+        }
+
+        /**
+         * @brief Generates a variable that combines the bits of two variables.
+         * @param [in] upper A input upper bits.
+         * @param [in] lower A input lower bits.
+         * @param [out] out A output value.
+         * @sa split_bits
+         */
+        template <typename InType, typename OutType>
+        inline void concatenate_bits(InType upper, InType lower, OutType& out) noexcept {
+            static constexpr auto bits = type2bit<InType>() ;
+            static const auto lower_mask = util::bit2mask(bits) ;
+
+            auto out_upper = static_cast<std::size_t>(upper) << bits ;
+            auto out_lower = static_cast<std::size_t>(lower) & lower_mask ;
+            out = (OutType)(out_upper | out_lower) ;
+        }
+
+        /**
+         * @brief Count the number of trailing zero bits.
+         * @param [in] value A non-zero value.
+         * @return The index of the lowest set bit.
+         */
+        inline int count_trailing_zeros(std::uint64_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            return __builtin_ctzll(value) ;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+            unsigned long index ;
+            _BitScanForward64(&index, value) ;
+            return static_cast<int>(index) ;
+#elif defined(_MSC_VER)
+            unsigned long index ;
+            if(_BitScanForward(&index, static_cast<unsigned long>(value))) {
+                return static_cast<int>(index) ;
+            }
+            _BitScanForward(&index, static_cast<unsigned long>(value >> 32)) ;
+            return static_cast<int>(index) + 32 ;
+#else
+            int count = 0 ;
+            while(!(value & 1)) {
+                value >>= 1 ;
+                count ++ ;
+            }
+            return count ;
+#endif
+        }
+
+        /**
+         * @brief Find the highest set bit.
+         * @param [in] value A non-zero value.
+         * @return The index of the highest set bit.
+         */
+        inline int find_highest_bit(std::uint32_t value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            return 31 - __builtin_clz(value) ;
+#elif defined(_MSC_VER)
+            unsigned long index ;
+            _BitScanReverse(&index, static_cast<unsigned long>(value)) ;
+            return static_cast<int>(index) ;
+#else
+            int index = 0 ;
+            while(value >>= 1) {
+                index ++ ;
+            }
+            return index ;
+#endif
+        }
+        /**
+         * @brief Calculate grayscale value from RGB
+         * @param [in] rgb A input rgb value.
+         * @return The grayscale value.
+         */
+        inline unsigned char rgb2gray(const std::uint32_t& rgb) {
+            auto r = red_of(rgb) ;
+            auto g = green_of(rgb) ;
+            auto b = blue_of(rgb) ;
+            return static_cast<unsigned char>(0.2126 * r + 0.7152 * g + 0.0722 * b) ;
+        }
+
+        /**
+         * @brief Checks if the setting area of WM_SETTINGCHANGE is the name.
+         * @param [in] area The name of the changed setting area. It may be NULL.
+         * @param [in] name The expected name.
+         * @return Returns true if matched, false otherwise.
+         */
+        inline bool is_setting_area(const wchar_t* area, const wchar_t* name) noexcept {
+            if(!area) {
+                return false ;
+            }
+            std::size_t i = 0 ;
+            while(name[i] != L'\0' && area[i] == name[i]) {
+                i ++ ;
+            }
+            return name[i] == L'\0' && area[i] == L'\0' ;
+        }
+
+        /**
+         * @brief Calculate the horizontal span of a label to be redrawn when the text is changed.
+         * @param [in] old_text The label text before the change.
+         * @param [in] old_extents The cumulative widths of each prefix of old_text.
+         * @param [in] new_text The label text after the change.
+         * @param [in] new_extents The cumulative widths of each prefix of new_text.
+         * @param [out] left The left edge of the span relative to the label origin.
+         * @param [out] right The right edge of the span relative to the label origin.
+         * @return Returns true if there is a span to be redrawn, false if the label is not changed.
+         * @details The i-th extent is the width of the first i + 1 characters, as obtained by <a href="https://learn.microsoft.com/en-us/windows/win32/api/wingdi/nf-wingdi-gettextextentexpointw">GetTextExtentExPointW</a>. The common suffix is excluded if it stays at the same position.
+         */
+        template <typename CharType>
+        inline bool calculate_dirty_span(
+                const std::basic_string<CharType>& old_text,
+                const std::vector<int>& old_extents,
+                const std::basic_string<CharType>& new_text,
+                const std::vector<int>& new_extents,
+                int& left,
+                int& right) {
+            auto old_len = old_text.length() ;
+            auto new_len = new_text.length() ;
+            auto width = [](const std::vector<int>& extents, std::size_t n) {
+                return n == 0 ? 0 : extents[n - 1] ;
+            } ;
+
+            if(old_extents.size() != old_len || new_extents.size() != new_len) {
+                // Not measured yet, so redraw the whole label.
+                left = 0 ;
+                right = (std::max)(width(old_extents, old_extents.size()),
+                                   width(new_extents, new_extents.size())) ;
+                return true ;
+            }
+
+            std::size_t prefix = 0 ;
+            auto min_len = (std::min)(old_len, new_len) ;
+            while(prefix < min_len && old_text[prefix] == new_text[prefix]) {
+                prefix ++ ;
+            }
+            if(prefix == old_len && prefix == new_len) {
+                return false ;
+            }
+
+            std::size_t suffix = 0 ;
+            while(suffix < min_len - prefix
+                    && old_text[old_len - suffix - 1] == new_text[new_len - suffix - 1]) {
+                suffix ++ ;
+            }
+
+            left = width(new_extents, prefix) ;
+
+            auto old_mid_end = width(old_extents, old_len - suffix) ;
+            auto new_mid_end = width(new_extents, new_len - suffix) ;
+            if(old_mid_end == new_mid_end) {
+                // The common suffix is not moved.
+                right = new_mid_end ;
+            }
+            else {
+                right = (std::max)(width(old_extents, old_len),
+                                   width(new_extents, new_len)) ;
+            }
+            return left < right ;
+        }
+
+        /**
+         * @brief Positions to omit a part of a long label.
+         */
+        enum class EllipsisMode : unsigned char
+        {
+            //! Keep the beginning of label.
+            END,
+            //! Keep both the beginning and the end of label, which is suitable for paths.
+            MIDDLE,
+        } ;
+
+        /**
+         * @brief Calculate the characters kept when a label is truncated with an ellipsis.
+         * @param [in] text The label text.
+         * @param [in] extents The cumulative widths of each prefix of text.
+         * @param [in] max_width The maximum width of the truncated label including the ellipsis.
+         * @param [in] ellipsis_width The width of the ellipsis.
+         * @param [in] mode The position of the ellipsis.
+         * @param [out] head The number of characters kept at the beginning.
+         * @param [out] tail The number of characters kept at the end.
+         * @return Returns true if the label must be truncated, false if it fits.
+         * @details The cut points are found by binary search over the cached extents, so the text is not measured again. A surrogate pair is never split.
+         */
+        template <typename CharType>
+        inline bool calculate_ellipsis_cut(
+                const std::basic_string<CharType>& text,
+                const std::vector<int>& extents,
+                int max_width,
+                int ellipsis_width,
+                EllipsisMode mode,
+                std::size_t& head,
+                std::size_t& tail) {
+            auto len = (std::min)(text.length(), extents.size()) ;
+            head = len ;
+            tail = 0 ;
+            if(len == 0 || extents[len - 1] <= max_width) {
+                return false ;
+            }
+
+            auto is_high_surrogate = [] (CharType c) {
+                return c >= 0xD800 && c <= 0xDBFF ;
+            } ;
+            auto is_low_surrogate = [] (CharType c) {
+                return c >= 0xDC00 && c <= 0xDFFF ;
+            } ;
+
+            auto available = (std::max)(max_width - ellipsis_width, 0) ;
+            auto head_budget = mode == EllipsisMode::MIDDLE ? available / 2 : available ;
+
+            // The longest prefix within the budget
+            auto end = extents.begin() + static_cast<std::ptrdiff_t>(len) ;
+            head = static_cast<std::size_t>(
+                std::upper_bound(extents.begin(), end, head_budget) - extents.begin()) ;
+            if(head > 0 && is_high_surrogate(text[head - 1])) {
+                head -- ;
+            }
+
+            if(mode == EllipsisMode::MIDDLE) {
+                auto head_width = head == 0 ? 0 : extents[head - 1] ;
+                auto total = extents[len - 1] ;
+
+                // The suffix after the first k characters has the width total - extents[k - 1],
+                // so find the smallest k whose suffix is within the budget.
+                auto k = static_cast<std::size_t>(
+                    std::lower_bound(extents.begin(), end, total - (available - head_width))
+                    - extents.begin()) + 1 ;
+                k = (std::max)(k, head) ;
+                tail = len - (std::min)(k, len) ;
+                if(tail > 0 && is_low_surrogate(text[len - tail])) {
+                    tail -- ;
+                }
+            }
+            return true ;
+        }
+
+        /**
+         * @brief Convert COLORREF to a 32-bit ARGB pixel.
+         * @param [in] color A input rgb value.
+         * @param [in] alpha The alpha value of the pixel.
+         * @return The pixel in 0xAARRGGBB format.
+         */
+        inline std::uint32_t colorref2argb(std::uint32_t color, unsigned char alpha=255) noexcept {
+            return (static_cast<std::uint32_t>(alpha) << 24)
+                 | (static_cast<std::uint32_t>(red_of(color)) << 16)
+                 | (static_cast<std::uint32_t>(green_of(color)) << 8)
+                 | static_cast<std::uint32_t>(blue_of(color)) ;
+        }
+
+        /**
+         * @brief Convert a 32-bit ARGB pixel to COLORREF.
+         * @param [in] pixel The pixel in 0xAARRGGBB format.
+         * @return The color without alpha.
+         */
+        inline std::uint32_t argb2colorref(std::uint32_t pixel) noexcept {
+            return rgb((pixel >> 16) & 0xFF, (pixel >> 8) & 0xFF, pixel & 0xFF) ;
+        }
+
+        /**
+         * @brief Calculate the per-channel median color of pixels.
+         * @param [in] pixels The pixels in 0xAARRGGBB format.
+         * @param [in] n The number of pixels.
+         * @return The median color in 0x00RRGGBB format, or zero if n is zero.
+         * @details It runs in O(n) with 256-bin histograms.
+         */
+        inline std::uint32_t calculate_median_color(
+                const std::uint32_t* pixels,
+                std::size_t n) {
+            if(n == 0) {
+                return 0 ;
+            }
+            // A flat strip increments the same bins over and over, so consecutive pixels are
+            // counted in separate copies of the histograms to avoid waiting on the previous store.
+            const std::size_t copies = 4 ;
+            const std::size_t block = 0x10000000 ;
+            std::uint32_t partial[copies][3 * 256] ;
+            std::vector<std::size_t> histogram(3 * 256, 0) ;
+            for(std::size_t first = 0 ; first < n ; first += block) {
+                std::memset(partial, 0, sizeof(partial)) ;
+                auto last = (std::min)(n, first + block) ;
+                for(auto i = first ; i < last ; i ++) {
+                    auto bins = partial[i % copies] ;
+                    bins[(pixels[i] >> 16) & 0xFF] ++ ;
+                    bins[256 + ((pixels[i] >> 8) & 0xFF)] ++ ;
+                    bins[512 + (pixels[i] & 0xFF)] ++ ;
+                }
+                for(std::size_t bin = 0 ; bin < histogram.size() ; bin ++) {
+                    histogram[bin] += partial[0][bin] + partial[1][bin] + partial[2][bin] + partial[3][bin] ;
+                }
+            }
+
+            std::uint32_t color = 0 ;
+            for(int c = 0 ; c < 3 ; c ++) {
+                std::size_t acc = 0 ;
+                std::uint32_t value = 0 ;
+                while(value < 255) {
+                    acc += histogram[c * 256 + value] ;
+                    if(2 * acc > n) {
+                        break ;
+                    }
+                    value ++ ;
+                }
+                color |= value << (16 - 8 * c) ;
+            }
+            return color ;
+        }
+
+        /**
+         * @brief Calculate the mean color of pixels close to the median color without SIMD.
+         * @param [in] pixels The pixels in 0xAARRGGBB format.
+         * @param [in] n The number of pixels.
+         * @param [in] tolerance The maximum difference of each channel from the median.
+         * @return The mean color in 0x00RRGGBB format.
+         * @details This is the reference implementation of calculate_robust_mean_color.
+         * @sa calculate_robust_mean_color
+         */
+        inline std::uint32_t calculate_robust_mean_color_scalar(
+                const std::uint32_t* pixels,
+                std::size_t n,
+                unsigned char tolerance=24) {
+            auto median = calculate_median_color(pixels, n) ;
+            std::uint64_t sums[3] = {0, 0, 0} ;
+            std::uint64_t count = 0 ;
+            for(std::size_t i = 0 ; i < n ; i ++) {
+                bool inlier = true ;
+                for(int shift = 0 ; shift <= 16 ; shift += 8) {
+                    auto a = static_cast<int>((pixels[i] >> shift) & 0xFF) ;
+                    auto b = static_cast<int>((median >> shift) & 0xFF) ;
+                    if(std::abs(a - b) > tolerance) {
+                        inlier = false ;
+                    }
+                }
+                if(inlier) {
+                    sums[0] += (pixels[i] >> 16) & 0xFF ;
+                    sums[1] += (pixels[i] >> 8) & 0xFF ;
+                    sums[2] += pixels[i] & 0xFF ;
+                    count ++ ;
+                }
+            }
+            if(count == 0) {
+                return median ;
+            }
+            auto round_div = [count] (std::uint64_t sum) {
+                return static_cast<std::uint32_t>((sum + count / 2) / count) ;
+            } ;
+            return (round_div(sums[0]) << 16) | (round_div(sums[1]) << 8) | round_div(sums[2]) ;
+        }
+
+        /**
+         * @brief Calculate the mean color of pixels close to the median color.
+         * @param [in] pixels The pixels in 0xAARRGGBB format.
+         * @param [in] n The number of pixels.
+         * @param [in] tolerance The maximum difference of each channel from the median.
+         * @return The mean color in 0x00RRGGBB format.
+         * @details The pixels such as icons or wallpaper bleeding, which differ from the median, are excluded from the mean. The masked sums are computed four pixels at a time with SSE2 if available.
+         */
+        inline std::uint32_t calculate_robust_mean_color(
+                const std::uint32_t* pixels,
+                std::size_t n,
+                unsigned char tolerance=24) {
+#if defined(_FLUENT_TRAY_USE_SSE2)
+            auto median = calculate_median_color(pixels, n) ;
+
+            const auto median_v = _mm_set1_epi32(static_cast<int>(median)) ;
+            const auto tolerance_v = _mm_set1_epi8(static_cast<char>(tolerance)) ;
+            const auto alpha_v = _mm_set1_epi32(static_cast<int>(0xFF000000)) ;
+            const auto ones_v = _mm_set1_epi32(-1) ;
+            const auto byte_v = _mm_set1_epi32(0xFF) ;
+            const auto zero_v = _mm_setzero_si128() ;
+
+            auto sum_r = _mm_setzero_si128() ;
+            auto sum_g = _mm_setzero_si128() ;
+            auto sum_b = _mm_setzero_si128() ;
+            auto sum_n = _mm_setzero_si128() ;
+
+            std::size_t i = 0 ;
+            for( ; i + 4 <= n ; i += 4) {
+                auto px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i)) ;
+
+                // |px - median| <= tolerance for every color channel.
+                auto diff = _mm_or_si128(
+                    _mm_subs_epu8(px, median_v), _mm_subs_epu8(median_v, px)) ;
+                auto within = _mm_cmpeq_epi8(_mm_max_epu8(diff, tolerance_v), tolerance_v) ;
+                auto mask = _mm_cmpeq_epi32(_mm_or_si128(within, alpha_v), ones_v) ;
+
+                auto masked = _mm_and_si128(px, mask) ;
+                sum_b = _mm_add_epi64(sum_b, _mm_sad_epu8(_mm_and_si128(masked, byte_v), zero_v)) ;
+                sum_g = _mm_add_epi64(sum_g, _mm_sad_epu8(
+                    _mm_and_si128(_mm_srli_epi32(masked, 8), byte_v), zero_v)) ;
+                sum_r = _mm_add_epi64(sum_r, _mm_sad_epu8(
+                    _mm_and_si128(_mm_srli_epi32(masked, 16), byte_v), zero_v)) ;
+                sum_n = _mm_add_epi64(sum_n, _mm_sad_epu8(
+                    _mm_and_si128(mask, _mm_set1_epi32(1)), zero_v)) ;
+            }
+
+            auto horizontal_sum = [] (__m128i v) {
+                std::uint64_t lanes[2] ;
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), v) ;
+                return lanes[0] + lanes[1] ;
+            } ;
+            std::uint64_t sums[3] = {
+                horizontal_sum(sum_r), horizontal_sum(sum_g), horizontal_sum(sum_b)} ;
+            auto count = horizontal_sum(sum_n) ;
+
+            for( ; i < n ; i ++) {
+                bool inlier = true ;
+                for(int shift = 0 ; shift <= 16 ; shift += 8) {
+                    auto a = static_cast<int>((pixels[i] >> shift) & 0xFF) ;
+                    auto b = static_cast<int>((median >> shift) & 0xFF) ;
+                    if(std::abs(a - b) > tolerance) {
+                        inlier = false ;
+                    }
+                }
+                if(inlier) {
+                    sums[0] += (pixels[i] >> 16) & 0xFF ;
+                    sums[1] += (pixels[i] >> 8) & 0xFF ;
+                    sums[2] += pixels[i] & 0xFF ;
+                    count ++ ;
+                }
+            }
+            if(count == 0) {
+                return median ;
+            }
+            auto round_div = [count] (std::uint64_t sum) {
+                return static_cast<std::uint32_t>((sum + count / 2) / count) ;
+            } ;
+            return (round_div(sums[0]) << 16) | (round_div(sums[1]) << 8) | round_div(sums[2]) ;
+#else
+            return calculate_robust_mean_color_scalar(pixels, n, tolerance) ;
+#endif
+        }
+
+        /**
+         * @brief Check whether the visible pixels of an icon are drawn in a single color.
+         * @param [in] pixels The pixels in 0xAARRGGBB format.
+         * @param [in] n The number of pixels.
+         * @param [in] tolerance The maximum difference of each channel from the first visible pixel.
+         * @param [in] min_alpha The minimum alpha of pixels to be checked. The fainter pixels such as antialiased edges are ignored.
+         * @return Returns true if the icon is monochrome, false if it has multiple colors or no visible pixel.
+         */
+        inline bool is_monochrome_pixels(
+                const std::uint32_t* pixels,
+                std::size_t n,
+                unsigned char tolerance=16,
+                unsigned char min_alpha=64) {
+            auto visible = std::find_if(
+                pixels, pixels + n,
+                [min_alpha] (std::uint32_t px) {return (px >> 24) >= min_alpha ;}) ;
+            if(visible == pixels + n) {
+                return false ;
+            }
+            auto reference = *visible ;
+            return std::all_of(visible, pixels + n, [=] (std::uint32_t px) {
+                if((px >> 24) < min_alpha) {
+                    return true ;
+                }
+                for(int shift = 0 ; shift <= 16 ; shift += 8) {
+                    auto a = static_cast<int>((px >> shift) & 0xFF) ;
+                    auto b = static_cast<int>((reference >> shift) & 0xFF) ;
+                    if(std::abs(a - b) > tolerance) {
+                        return false ;
+                    }
+                }
+                return true ;
+            }) ;
+        }
+
+        /**
+         * @brief Replace the color of pixels while keeping their alpha without SIMD.
+         * @param [in] src The pixels in 0xAARRGGBB format.
+         * @param [out] dst The recolored pixels. It may be the same as src.
+         * @param [in] n The number of pixels.
+         * @param [in] color The new color.
+         * @details This is the reference implementation of recolor_pixels.
+         * @sa recolor_pixels
+         */
+        inline void recolor_pixels_scalar(
+                const std::uint32_t* src,
+                std::uint32_t* dst,
+                std::size_t n,
+                std::uint32_t color) noexcept {
+            auto rgb = colorref2argb(color, 0) ;
+            for(std::size_t i = 0 ; i < n ; i ++) {
+                dst[i] = (src[i] & 0xFF000000) | rgb ;
+            }
+        }
+
+        /**
+         * @brief Replace the color of pixels while keeping their alpha.
+         * @param [in] src The pixels in 0xAARRGGBB format.
+         * @param [out] dst The recolored pixels. It may be the same as src.
+         * @param [in] n The number of pixels.
+         * @param [in] color The new color.
+         * @details The alpha works as the coverage of the glyph, so a monochrome icon is drawn in the new color with the same antialiasing. Four pixels are processed at a time with SSE2 if available.
+         */
+        inline void recolor_pixels(
+                const std::uint32_t* src,
+                std::uint32_t* dst,
+                std::size_t n,
+                std::uint32_t color) noexcept {
+#if defined(_FLUENT_TRAY_USE_SSE2)
+            auto rgb = colorref2argb(color, 0) ;
+            const auto alpha_v = _mm_set1_epi32(static_cast<int>(0xFF000000)) ;
+            const auto rgb_v = _mm_set1_epi32(static_cast<int>(rgb)) ;
+
+            std::size_t i = 0 ;
+            for( ; i + 4 <= n ; i += 4) {
+                auto px = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)) ;
+                _mm_storeu_si128(
+                    reinterpret_cast<__m128i*>(dst + i),
+                    _mm_or_si128(_mm_and_si128(px, alpha_v), rgb_v)) ;
+            }
+            recolor_pixels_scalar(src + i, dst + i, n - i, color) ;
+#else
+            recolor_pixels_scalar(src, dst, n, color) ;
+#endif
+        }
+
+        /**
+         * @brief sRGB to linear conversion table.
+         * @details linear[v] is the linear-light value of the 8-bit sRGB channel v scaled to 0 - 65535. The literal table is generated from the piecewise sRGB transfer function, so no floating-point math is needed at runtime.
+         */
+        template <typename Dummy=void>
+        struct SRGBTable {
+            static constexpr std::uint16_t linear[256] = {
+                0, 20, 40, 60, 80, 99, 119, 139, 159, 179, 199, 219,
+                241, 264, 288, 313, 340, 367, 396, 427, 458, 491, 526, 562,
+                599, 637, 677, 718, 761, 805, 851, 898, 947, 997, 1048, 1101,
+                1156, 1212, 1270, 1330, 1391, 1453, 1517, 1583, 1651, 1720, 1790, 1863,
+                1937, 2013, 2090, 2170, 2250, 2333, 2418, 2504, 2592, 2681, 2773, 2866,
+                2961, 3058, 3157, 3258, 3360, 3464, 3570, 3678, 3788, 3900, 4014, 4129,
+                4247, 4366, 4488, 4611, 4736, 4864, 4993, 5124, 5257, 5392, 5530, 5669,
+                5810, 5953, 6099, 6246, 6395, 6547, 6700, 6856, 7014, 7174, 7335, 7500,
+                7666, 7834, 8004, 8177, 8352, 8528, 8708, 8889, 9072, 9258, 9445, 9635,
+                9828, 10022, 10219, 10417, 10619, 10822, 11028, 11235, 11446, 11658, 11873, 12090,
+                12309, 12530, 12754, 12980, 13209, 13440, 13673, 13909, 14146, 14387, 14629, 14874,
+                15122, 15371, 15623, 15878, 16135, 16394, 16656, 16920, 17187, 17456, 17727, 18001,
+                18277, 18556, 18837, 19121, 19407, 19696, 19987, 20281, 20577, 20876, 21177, 21481,
+                21787, 22096, 22407, 22721, 23038, 23357, 23678, 24002, 24329, 24658, 24990, 25325,
+                25662, 26001, 26344, 26688, 27036, 27386, 27739, 28094, 28452, 28813, 29176, 29542,
+                29911, 30282, 30656, 31033, 31412, 31794, 32179, 32567, 32957, 33350, 33745, 34143,
+                34544, 34948, 35355, 35764, 36176, 36591, 37008, 37429, 37852, 38278, 38706, 39138,
+                39572, 40009, 40449, 40891, 41337, 41785, 42236, 42690, 43147, 43606, 44069, 44534,
+                45002, 45473, 45947, 46423, 46903, 47385, 47871, 48359, 48850, 49344, 49841, 50341,
+                50844, 51349, 51858, 52369, 52884, 53401, 53921, 54445, 54971, 55500, 56032, 56567,
+                57105, 57646, 58190, 58737, 59287, 59840, 60396, 60955, 61517, 62082, 62650, 63221,
+                63795, 64372, 64952, 65535
+            } ;
+        } ;
+
+        template <typename Dummy>
+        constexpr std::uint16_t SRGBTable<Dummy>::linear[256] ;
+
+        /**
+         * @brief Convert an 8-bit sRGB channel to linear light.
+         * @param [in] value The gamma-encoded channel.
+         * @return The linear-light value in 0 - 65535.
+         */
+        inline constexpr std::uint16_t srgb2linear(unsigned char value) noexcept {
+            return SRGBTable<>::linear[value] ;
+        }
+
+        /**
+         * @brief Rec. 709 luminance weights in Q16. The sum is 65536.
+         */
+        constexpr std::uint32_t luminance_weight_r = 13933 ;
+        constexpr std::uint32_t luminance_weight_g = 46871 ;
+        constexpr std::uint32_t luminance_weight_b = 4732 ;
+
+        /**
+         * @brief Calculate the relative luminance in fixed point.
+         * @param [in] rgb A input rgb value.
+         * @return The relative luminance in 0 - 65535.
+         */
+        inline constexpr std::uint16_t calculate_luminance(std::uint32_t rgb) noexcept {
+            return static_cast<std::uint16_t>(
+                ((srgb2linear(red_of(rgb)) * luminance_weight_r) >> 16)
+                + ((srgb2linear(green_of(rgb)) * luminance_weight_g) >> 16)
+                + ((srgb2linear(blue_of(rgb)) * luminance_weight_b) >> 16)) ;
+        }
+
+        /**
+         * @brief Calculate the relative luminance of pixels one at a time.
+         * @param [in] pixels The pixels in 0xAARRGGBB format.
+         * @param [in] n The number of pixels.
+         * @param [out] luminances The relative luminances in 0 - 65535. It must have n elements.
+         */
+        inline void calculate_luminances_scalar(
+                const std::uint32_t* pixels,
+                std::size_t n,
+                std::uint16_t* luminances) noexcept {
+            for(std::size_t i = 0 ; i < n ; i ++) {
+                luminances[i] = calculate_luminance(argb2colorref(pixels[i])) ;
+            }
+        }
+
+        /**
+         * @brief Calculate the relative luminance of pixels.
+         * @param [in] pixels The pixels in 0xAARRGGBB format.
+         * @param [in] n The number of pixels.
+         * @param [out] luminances The relative luminances in 0 - 65535. It must have n elements.
+         * @details The channels are linearized by the table, and the weighted sums are computed eight pixels at a time with SSE2 if available. The result is identical to calculate_luminances_scalar.
+         */
+        inline void calculate_luminances(
+                const std::uint32_t* pixels,
+                std::size_t n,
+                std::uint16_t* luminances) noexcept {
+#if defined(_FLUENT_TRAY_USE_SSE2)
+            const auto weight_r = _mm_set1_epi16(static_cast<short>(luminance_weight_r)) ;
+            const auto weight_g = _mm_set1_epi16(static_cast<short>(luminance_weight_g)) ;
+            const auto weight_b = _mm_set1_epi16(static_cast<short>(luminance_weight_b)) ;
+
+            std::size_t i = 0 ;
+            for( ; i + 8 <= n ; i += 8) {
+                // SSE2 has no gather, so the table lookups are scalar.
+                std::uint16_t r[8], g[8], b[8] ;
+                for(std::size_t j = 0 ; j < 8 ; j ++) {
+                    auto px = pixels[i + j] ;
+                    r[j] = srgb2linear(static_cast<unsigned char>(px >> 16)) ;
+                    g[j] = srgb2linear(static_cast<unsigned char>(px >> 8)) ;
+                    b[j] = srgb2linear(static_cast<unsigned char>(px)) ;
+                }
+                auto y = _mm_add_epi16(
+                    _mm_add_epi16(
+                        _mm_mulhi_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(r)), weight_r),
+                        _mm_mulhi_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(g)), weight_g)),
+                    _mm_mulhi_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b)), weight_b)) ;
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(luminances + i), y) ;
+            }
+            calculate_luminances_scalar(pixels + i, n - i, luminances + i) ;
+#else
+            calculate_luminances_scalar(pixels, n, luminances) ;
+#endif
+        }
+
+        /**
+         * @brief Find a UTF-16 code unit one at a time.
+         * @param [in] text The code units.
+         * @param [in] n The number of code units.
+         * @param [in] c The code unit to find.
+         * @return The index of the first found code unit, or n if not found.
+         */
+        inline std::size_t find_code_unit_scalar(
+                const std::uint16_t* text,
+                std::size_t n,
+                std::uint16_t c) noexcept {
+            for(std::size_t i = 0 ; i < n ; i ++) {
+                if(text[i] == c) {
+                    return i ;
+                }
+            }
+            return n ;
+        }
+
+        /**
+         * @brief Find a UTF-16 code unit.
+         * @param [in] text The code units.
+         * @param [in] n The number of code units.
+         * @param [in] c The code unit to find.
+         * @return The index of the first found code unit, or n if not found.
+         * @details Eight code units are compared at a time with SSE2 if available. The result is identical to find_code_unit_scalar.
+         */
+        inline std::size_t find_code_unit(
+                const std::uint16_t* text,
+                std::size_t n,
+                std::uint16_t c) noexcept {
+#if defined(_FLUENT_TRAY_USE_SSE2)
+            const auto needle = _mm_set1_epi16(static_cast<short>(c)) ;
+            std::size_t i = 0 ;
+            for( ; i + 8 <= n ; i += 8) {
+                auto units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i)) ;
+                auto bits = _mm_movemask_epi8(_mm_cmpeq_epi16(units, needle)) ;
+                if(bits != 0) {
+                    // Each code unit sets two bits of the mask.
+                    return i + static_cast<std::size_t>(
+                        count_trailing_zeros(static_cast<std::uint64_t>(bits)) / 2) ;
+                }
+            }
+            return i + find_code_unit_scalar(text + i, n - i, c) ;
+#else
+            return find_code_unit_scalar(text, n, c) ;
+#endif
+        }
+
+        /**
+         * @brief Find the last UTF-16 code unit one at a time.
+         * @param [in] text The code units.
+         * @param [in] n The number of code units.
+         * @param [in] c The code unit to find.
+         * @return The index of the last found code unit, or n if not found.
+         */
+        inline std::size_t find_last_code_unit_scalar(
+                const std::uint16_t* text,
+                std::size_t n,
+                std::uint16_t c) noexcept {
+            for(auto i = n ; i > 0 ; i --) {
+                if(text[i - 1] == c) {
+                    return i - 1 ;
+                }
+            }
+            return n ;
+        }
+
+        /**
+         * @brief Find the last UTF-16 code unit.
+         * @param [in] text The code units.
+         * @param [in] n The number of code units.
+         * @param [in] c The code unit to find.
+         * @return The index of the last found code unit, or n if not found.
+         * @details Eight code units are compared at a time from the end with SSE2 if available. The result is identical to find_last_code_unit_scalar.
+         */
+        inline std::size_t find_last_code_unit(
+                const std::uint16_t* text,
+                std::size_t n,
+                std::uint16_t c) noexcept {
+#if defined(_FLUENT_TRAY_USE_SSE2)
+            const auto needle = _mm_set1_epi16(static_cast<short>(c)) ;
+            auto i = n ;
+            for( ; i >= 8 ; i -= 8) {
+                auto units = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i - 8)) ;
+                auto bits = _mm_movemask_epi8(_mm_cmpeq_epi16(units, needle)) ;
+                if(bits != 0) {
+                    // Each code unit sets two bits of the mask.
+                    return i - 8 + static_cast<std::size_t>(
+                        find_highest_bit(static_cast<std::uint32_t>(bits)) / 2) ;
+                }
+            }
+            auto found = find_last_code_unit_scalar(text, i, c) ;
+            return found == i ? n : found ;
+#else
+            return find_last_code_unit_scalar(text, n, c) ;
+#endif
+        }
+
+        /**
+         * @brief Collect the labels having all characters of a query one at a time.
+         * @param [in] masks The character masks of labels.
+         * @param [in] n The number of labels.
+         * @param [in] query The character mask of query.
+         * @param [out] items The indices of the labels whose masks contain the query mask.
+         */
+        inline void filter_by_mask_scalar(
+                const std::uint64_t* masks,
+                std::size_t n,
+                std::uint64_t query,
+                std::vector<std::uint32_t>& items) {
+            items.clear() ;
+            for(std::size_t i = 0 ; i < n ; i ++) {
+                if((masks[i] & query) == query) {
+                    items.push_back(static_cast<std::uint32_t>(i)) ;
+                }
+            }
+        }
+
+        /**
+         * @brief Collect the labels having all characters of a query.
+         * @param [in] masks The character masks of labels.
+         * @param [in] n The number of labels.
+         * @param [in] query The character mask of query.
+         * @param [out] items The indices of the labels whose masks contain the query mask.
+         * @details Two masks are tested at a time with SSE2 if available. The result is identical to filter_by_mask_scalar.
+         */
+        inline void filter_by_mask(
+                const std::uint64_t* masks,
+                std::size_t n,
+                std::uint64_t query,
+                std::vector<std::uint32_t>& items) {
+#if defined(_FLUENT_TRAY_USE_SSE2)
+            items.clear() ;
+            auto lower = static_cast<int>(static_cast<std::uint32_t>(query)) ;
+            auto upper = static_cast<int>(static_cast<std::uint32_t>(query >> 32)) ;
+            const auto query_v = _mm_set_epi32(upper, lower, upper, lower) ;
+            std::size_t i = 0 ;
+            for( ; i + 2 <= n ; i += 2) {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks + i)) ;
+                // SSE2 has no 64-bit comparison, so both halves of a mask must be equal.
+                auto equal = _mm_movemask_ps(_mm_castsi128_ps(
+                    _mm_cmpeq_epi32(_mm_and_si128(v, query_v), query_v))) ;
+                if((equal & 0x3) == 0x3) {
+                    items.push_back(static_cast<std::uint32_t>(i)) ;
+                }
+                if((equal & 0xC) == 0xC) {
+                    items.push_back(static_cast<std::uint32_t>(i + 1)) ;
+                }
+            }
+            if(i < n && (masks[i] & query) == query) {
+                items.push_back(static_cast<std::uint32_t>(i)) ;
+            }
+#else
+            filter_by_mask_scalar(masks, n, query, items) ;
+#endif
+        }
+
+        /**
+         * @brief Check whether a code unit separates words for fuzzy scoring.
+         * @param [in] c The code unit.
+         * @return Returns true if the code unit is a separator, false otherwise.
+         */
+        inline bool is_word_separator(std::uint16_t c) noexcept {
+            return c == ' ' || c == '-' || c == '_' || c == '.' || c == '/'
+                || c == '\\' || c == ':' || c == '(' || c == '[' ;
+        }
+
+        /**
+         * @brief Mark the word separators one at a time.
+         * @param [in] text The code units.
+         * @param [in] n The number of code units.
+         * @param [out] bits The bits set for the separators, where the bit i % 64 of bits[i / 64] is for text[i]. It must have (n + 63) / 64 elements.
+         */
+        inline void find_word_separators_scalar(
+                const std::uint16_t* text,
+                std::size_t n,
+                std::uint64_t* bits) noexcept {
+            std::fill(bits, bits + (n + 63) / 64, std::uint64_t(0)) ;
+            for(std::size_t i = 0 ; i < n ; i ++) {
+                if(is_word_separator(text[i])) {
+                    bits[i / 64] |= std::uint64_t(1) << (i % 64) ;
+                }
+            }
+        }
+
+        /**
+         * @brief Mark the word separators.
+         * @param [in] text The code units.
+         * @param [in] n The number of code units.
+         * @param [out] bits The bits set for the separators, where the bit i % 64 of bits[i / 64] is for text[i]. It must have (n + 63) / 64 elements.
+         * @details Sixteen code units are classified at a time with SSE2 if available. The result is identical to find_word_separators_scalar.
+         */
+        inline void find_word_separators(
+                const std::uint16_t* text,
+                std::size_t n,
+                std::uint64_t* bits) noexcept {
+#if defined(_FLUENT_TRAY_USE_SSE2)
+            std::fill(bits, bits + (n + 63) / 64, std::uint64_t(0)) ;
+            const __m128i separators[] = {
+                _mm_set1_epi16(' '), _mm_set1_epi16('-'), _mm_set1_epi16('_'),
+                _mm_set1_epi16('.'), _mm_set1_epi16('/'), _mm_set1_epi16('\\'),
+                _mm_set1_epi16(':'), _mm_set1_epi16('('), _mm_set1_epi16('[')} ;
+            auto classify = [&separators] (const std::uint16_t* units) {
+                auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(units)) ;
+                auto any = _mm_setzero_si128() ;
+                for(const auto& separator : separators) {
+                    any = _mm_or_si128(any, _mm_cmpeq_epi16(v, separator)) ;
+                }
+                return any ;
+            } ;
+            std::size_t i = 0 ;
+            for( ; i + 16 <= n ; i += 16) {
+                // The matches of 16-bit lanes are packed into bytes, so each code unit sets one bit.
+                auto packed = _mm_packs_epi16(classify(text + i), classify(text + i + 8)) ;
+                auto mask = static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm_movemask_epi8(packed))) ;
+                bits[i / 64] |= mask << (i % 64) ;
+            }
+            for( ; i < n ; i ++) {
+                if(is_word_separator(text[i])) {
+                    bits[i / 64] |= std::uint64_t(1) << (i % 64) ;
+                }
+            }
+#else
+            find_word_separators_scalar(text, n, bits) ;
+#endif
+        }
+
+        /**
+         * @brief Score a label containing a query as a subsequence.
+         * @param [in] text The case-folded code units of label.
+         * @param [in] n The number of code units of label.
+         * @param [in] query The case-folded code units of query.
+         * @param [in] m The number of code units of query.
+         * @param [out] score The score. A higher score is a better match.
+         * @param [in] find Function to find a code unit with the signature of find_code_unit.
+         * @param [in] find_last Function to find the last code unit with the signature of find_last_code_unit.
+         * @param [in] follows_separator Function with the signature `bool(std::size_t k)` to check whether text[k - 1] is a word separator, where k is greater than zero.
+         * @return Returns true if the label contains the query, false otherwise.
+         * @details The shortest window ending at the earliest match is scored. Each matched character earns points, with bonuses for the start of a word and consecutive characters and a penalty for gaps.
+         */
+        template <typename Find, typename FindLast, typename FollowsSeparator>
+        inline bool score_subsequence(
+                const std::uint16_t* text,
+                std::size_t n,
+                const std::uint16_t* query,
+                std::size_t m,
+                int& score,
+                Find find,
+                FindLast find_last,
+                FollowsSeparator follows_separator) noexcept {
+            score = 0 ;
+            if(m == 0) {
+                return true ;
+            }
+
+            // The forward pass finds the earliest end of a match.
+            std::size_t pos = 0 ;
+            for(std::size_t qi = 0 ; qi < m ; qi ++) {
+                auto found = find(text + pos, n - pos, query[qi]) ;
+                if(found == n - pos) {
+                    return false ;
+                }
+                pos += found + 1 ;
+            }
+            auto end = pos ;
+
+            // The backward pass finds the latest start, which gives the shortest window.
+            auto start = end ;
+            for(auto qi = m ; qi > 0 ; qi --) {
+                start = find_last(text, start, query[qi - 1]) ;
+            }
+
+            pos = start ;
+            std::size_t previous = 0 ;
+            for(std::size_t qi = 0 ; qi < m ; qi ++) {
+                auto k = pos + find(text + pos, end - pos, query[qi]) ;
+                score += 16 ;
+                if(k == 0 || follows_separator(k)) {
+                    score += 8 ;
+                }
+                if(qi > 0) {
+                    if(k == previous + 1) {
+                        score += 6 ;
+                    }
+                    else {
+                        score -= 3 + static_cast<int>(k - previous - 2) ;
+                    }
+                }
+                previous = k ;
+                pos = k + 1 ;
+            }
+            return true ;
+        }
+
+        /**
+         * @brief Score a label containing a query as a subsequence, searching one code unit at a time.
+         * @param [in] text The case-folded code units of label.
+         * @param [in] n The number of code units of label.
+         * @param [in] query The case-folded code units of query.
+         * @param [in] m The number of code units of query.
+         * @param [out] score The score. A higher score is a better match.
+         * @return Returns true if the label contains the query, false otherwise.
+         */
+        inline bool fuzzy_score_scalar(
+                const std::uint16_t* text,
+                std::size_t n,
+                const std::uint16_t* query,
+                std::size_t m,
+                int& score) noexcept {
+            return score_subsequence(
+                text, n, query, m, score, find_code_unit_scalar, find_last_code_unit_scalar,
+                [text] (std::size_t k) {return is_word_separator(text[k - 1]) ;}) ;
+        }
+
+        /**
+         * @brief Score a label containing a query as a subsequence with the word separators marked in advance.
+         * @param [in] text The case-folded code units of label.
+         * @param [in] n The number of code units of label.
+         * @param [in] separators The bits marked by find_word_separators for the buffer containing the label.
+         * @param [in] offset The index of the first code unit of label in the buffer.
+         * @param [in] query The case-folded code units of query.
+         * @param [in] m The number of code units of query.
+         * @param [out] score The score. A higher score is a better match.
+         * @return Returns true if the label contains the query, false otherwise.
+         * @details The characters are searched forward and backward with find_code_unit and find_last_code_unit, and the word starts are looked up in the bits. The result is identical to fuzzy_score_scalar.
+         */
+        inline bool fuzzy_score(
+                const std::uint16_t* text,
+                std::size_t n,
+                const std::uint64_t* separators,
+                std::size_t offset,
+                const std::uint16_t* query,
+                std::size_t m,
+                int& score) noexcept {
+            return score_subsequence(
+                text, n, query, m, score, find_code_unit, find_last_code_unit,
+                [separators, offset] (std::size_t k) {
+                    auto i = offset + k - 1 ;
+                    return ((separators[i / 64] >> (i % 64)) & 1) != 0 ;
+                }) ;
+        }
+
+        /**
+         * @brief Score a label containing a query as a subsequence.
+         * @param [in] text The case-folded code units of label.
+         * @param [in] n The number of code units of label.
+         * @param [in] query The case-folded code units of query.
+         * @param [in] m The number of code units of query.
+         * @param [out] score The score. A higher score is a better match.
+         * @return Returns true if the label contains the query, false otherwise.
+         * @details The word separators of the label are marked with find_word_separators first. The result is identical to fuzzy_score_scalar.
+         */
+        inline bool fuzzy_score(
+                const std::uint16_t* text,
+                std::size_t n,
+                const std::uint16_t* query,
+                std::size_t m,
+                int& score) {
+            std::vector<std::uint64_t> separators((n + 63) / 64) ;
+            find_word_separators(text, n, separators.data()) ;
+            return fuzzy_score(text, n, separators.data(), 0, query, m, score) ;
+        }
+
+        /**
+         * @brief Calculate the WCAG 2 contrast ratio.
+         * @param [in] luminance1 The relative luminance in 0 - 65535.
+         * @param [in] luminance2 The other relative luminance in 0 - 65535.
+         * @return The contrast ratio from 1 to 21.
+         */
+        inline double calculate_contrast_ratio(
+                std::uint16_t luminance1,
+                std::uint16_t luminance2) noexcept {
+            auto lighter = (std::max)(luminance1, luminance2) / 65535.0 ;
+            auto darker = (std::min)(luminance1, luminance2) / 65535.0 ;
+            return (lighter + 0.05) / (darker + 0.05) ;
+        }
+
+        /**
+         * @brief Calculate the APCA lightness contrast of text on a background.
+         * @param [in] text_color The color of text.
+         * @param [in] back_color The color of background.
+         * @return The lightness contrast Lc. It is positive for dark text on a light background and negative for light text on a dark background.
+         * @details The constants follow APCA-W3 0.0.98G, which uses the simple 2.4 gamma instead of the piecewise sRGB curve.
+         */
+        inline double calculate_apca_contrast(
+                std::uint32_t text_color,
+                std::uint32_t back_color) {
+            auto screen_luminance = [] (std::uint32_t rgb) {
+                auto y = 0.2126729 * std::pow(red_of(rgb) / 255.0, 2.4)
+                       + 0.7151522 * std::pow(green_of(rgb) / 255.0, 2.4)
+                       + 0.0721750 * std::pow(blue_of(rgb) / 255.0, 2.4) ;
+                // Soft clamp near black
+                return y < 0.022 ? y + std::pow(0.022 - y, 1.414) : y ;
+            } ;
+            auto text_y = screen_luminance(text_color) ;
+            auto back_y = screen_luminance(back_color) ;
+            if(std::abs(back_y - text_y) < 0.0005) {
+                return 0.0 ;
+            }
+            if(back_y > text_y) {
+                auto s = (std::pow(back_y, 0.56) - std::pow(text_y, 0.57)) * 1.14 ;
+                return s < 0.1 ? 0.0 : (s - 0.027) * 100.0 ;
+            }
+            auto s = (std::pow(back_y, 0.65) - std::pow(text_y, 0.62)) * 1.14 ;
+            return s > -0.1 ? 0.0 : (s + 0.027) * 100.0 ;
+        }
+
+        /**
+         * @brief Contrast metrics to compare colors.
+         */
+        enum class ContrastMetric : unsigned char
+        {
+            //! WCAG 2 contrast ratio
+            WCAG,
+            //! Absolute value of APCA lightness contrast
+            APCA,
+        } ;
+
+        /**
+         * @brief Pick the color with the best contrast against a background.
+         * @param [in] back_color The color of background.
+         * @param [in] candidates The candidate colors.
+         * @param [in] n The number of candidates.
+         * @param [in] metric The contrast metric.
+         * @return The best candidate. If there is no candidate, returns invalid_color.
+         * @details If the contrasts are equal, the earlier candidate is picked.
+         */
+        inline std::uint32_t pick_contrast_color(
+                std::uint32_t back_color,
+                const std::uint32_t* candidates,
+                std::size_t n,
+                ContrastMetric metric=ContrastMetric::APCA) {
+            auto back_luminance = calculate_luminance(back_color) ;
+            std::uint32_t best_color = invalid_color ;
+            auto best_contrast = -1.0 ;
+            for(std::size_t i = 0 ; i < n ; i ++) {
+                auto contrast = metric == ContrastMetric::WCAG
+                    ? calculate_contrast_ratio(calculate_luminance(candidates[i]), back_luminance)
+                    : std::abs(calculate_apca_contrast(candidates[i], back_color)) ;
+                if(contrast > best_contrast) {
+                    best_contrast = contrast ;
+                    best_color = candidates[i] ;
+                }
+            }
+            return best_color ;
+        }
+
+        /**
+         * @brief Color in the OKLab perceptual color space.
+         */
+        struct OKLab {
+            //! Perceptual lightness in 0 - 1
+            double L ;
+            //! Green-red axis
+            double a ;
+            //! Blue-yellow axis
+            double b ;
+
+            constexpr OKLab(double lightness, double green_red, double blue_yellow) noexcept
+            : L(lightness), a(green_red), b(blue_yellow)
+            {}
+        } ;
+
+        /**
+         * @brief Newton iteration of the cube root.
+         * @param [in] x A input value.
+         * @param [in] y The current estimate, which must not be less than the root.
+         * @param [in] n The number of remaining iterations.
+         * @return The estimate of the cube root.
+         */
+        inline constexpr double cbrt_newton(double x, double y, int n) noexcept {
+            return n == 0 ? y : cbrt_newton(x, y - (y * y * y - x) / (3.0 * y * y), n - 1) ;
+        }
+
+        /**
+         * @brief Calculate the cube root in constant expressions.
+         * @param [in] x A input value. Negative values are treated as zero.
+         * @return The cube root.
+         * @details Starting from above the root, the Newton iteration decreases monotonically, so it converges for all inputs in the color conversions.
+         */
+        inline constexpr double constexpr_cbrt(double x) noexcept {
+            return x <= 0.0 ? 0.0 : cbrt_newton(x, x > 1.0 ? x : 1.0, 40) ;
+        }
+
+        /**
+         * @brief Calculate the cube.
+         */
+        inline constexpr double cube(double x) noexcept {
+            return x * x * x ;
+        }
+
+        inline constexpr OKLab lms2oklab(double l, double m, double s) noexcept {
+            return OKLab(
+                0.2104542553 * l + 0.7936177850 * m - 0.0040720468 * s,
+                1.9779984951 * l - 2.4285922050 * m + 0.4505937099 * s,
+                0.0259040371 * l + 0.7827717662 * m - 0.8086757660 * s) ;
+        }
+
+        /**
+         * @brief Convert linear-light sRGB to OKLab.
+         * @param [in] r The linear red in 0 - 1.
+         * @param [in] g The linear green in 0 - 1.
+         * @param [in] b The linear blue in 0 - 1.
+         * @return The OKLab color.
+         */
+        inline constexpr OKLab linear2oklab(double r, double g, double b) noexcept {
+            return lms2oklab(
+                constexpr_cbrt(0.4122214708 * r + 0.5363325363 * g + 0.0514459929 * b),
+                constexpr_cbrt(0.2119034982 * r + 0.6806995451 * g + 0.1073969566 * b),
+                constexpr_cbrt(0.0883024619 * r + 0.2817188376 * g + 0.6299787005 * b)) ;
+        }
+
+        /**
+         * @brief Convert COLORREF to OKLab.
+         * @param [in] rgb A input rgb value.
+         * @return The OKLab color.
+         */
+        inline constexpr OKLab colorref2oklab(std::uint32_t rgb) noexcept {
+            return linear2oklab(
+                srgb2linear(red_of(rgb)) / 65535.0,
+                srgb2linear(green_of(rgb)) / 65535.0,
+                srgb2linear(blue_of(rgb)) / 65535.0) ;
+        }
+
+        inline constexpr int lower_bound_linear(std::uint16_t value, int first, int last) noexcept {
+            return first >= last ? first
+                : (srgb2linear(static_cast<unsigned char>((first + last) / 2)) < value
+                    ? lower_bound_linear(value, (first + last) / 2 + 1, last)
+                    : lower_bound_linear(value, first, (first + last) / 2)) ;
+        }
+
+        inline constexpr unsigned char nearest_srgb(std::uint16_t value, int upper) noexcept {
+            return static_cast<unsigned char>(
+                upper == 0 || srgb2linear(static_cast<unsigned char>(upper)) - value
+                        <= value - srgb2linear(static_cast<unsigned char>(upper - 1))
+                    ? upper : upper - 1) ;
+        }
+
+        /**
+         * @brief Convert linear light to an 8-bit sRGB channel.
+         * @param [in] linear The linear-light value in 0 - 1. It is clamped.
+         * @return The nearest gamma-encoded channel.
+         * @details The inverse is found by binary search over the linearization table instead of a power function.
+         */
+        inline constexpr unsigned char linear2srgb(double linear) noexcept {
+            return linear <= 0.0 ? 0 : linear >= 1.0 ? 255
+                : nearest_srgb(
+                    static_cast<std::uint16_t>(linear * 65535.0 + 0.5),
+                    lower_bound_linear(static_cast<std::uint16_t>(linear * 65535.0 + 0.5), 0, 255)) ;
+        }
+
+        inline constexpr std::uint32_t lms2colorref(double l, double m, double s) noexcept {
+            return static_cast<std::uint32_t>(
+                linear2srgb(4.0767416621 * l - 3.3077115913 * m + 0.2309699292 * s))
+                | (static_cast<std::uint32_t>(
+                    linear2srgb(-1.2684380046 * l + 2.6097574011 * m - 0.3413193965 * s)) << 8)
+                | (static_cast<std::uint32_t>(
+                    linear2srgb(-0.0041960863 * l - 0.7034186147 * m + 1.7076147010 * s)) << 16) ;
+        }
+
+        /**
+         * @brief Convert OKLab to COLORREF.
+         * @param [in] lab A input OKLab color.
+         * @return The rgb value. The colors out of the sRGB gamut are clipped.
+         */
+        inline constexpr std::uint32_t oklab2colorref(const OKLab& lab) noexcept {
+            return lms2colorref(
+                cube(lab.L + 0.3963377774 * lab.a + 0.2158037573 * lab.b),
+                cube(lab.L - 0.1055613458 * lab.a - 0.0638541728 * lab.b),
+                cube(lab.L - 0.0894841775 * lab.a - 1.2914855480 * lab.b)) ;
+        }
+
+        /**
+         * @brief Create a tone of the color by changing its lightness.
+         * @param [in] lab The base color.
+         * @param [in] delta The change of lightness. The result is clamped to 0 - 1.
+         * @param [in] chroma_scale The scale of chroma.
+         * @return The rgb value of the tone.
+         */
+        inline constexpr std::uint32_t create_tone(
+                const OKLab& lab,
+                double delta,
+                double chroma_scale=1.0) noexcept {
+            return oklab2colorref(OKLab(
+                lab.L + delta < 0.0 ? 0.0 : lab.L + delta > 1.0 ? 1.0 : lab.L + delta,
+                lab.a * chroma_scale,
+                lab.b * chroma_scale)) ;
+        }
+
+        /**
+         * @brief The DPI at 100% scaling.
+         */
+        constexpr unsigned int default_dpi = 96 ;
+
+        /**
+         * @brief Scale a size in pixels at 96 DPI to the DPI.
+         * @param [in] value The size at 96 DPI.
+         * @param [in] dpi The target DPI.
+         * @return The scaled size rounded to the nearest integer.
+         */
+        inline constexpr long scale_for_dpi(long value, unsigned int dpi) noexcept {
+            return value >= 0
+                ? static_cast<long>((static_cast<long long>(value) * dpi + default_dpi / 2) / default_dpi)
+                : -scale_for_dpi(-value, dpi) ;
+        }
+
+        /**
+         * @brief Round the DPI to the nearest scaling step of 25%.
+         * @param [in] dpi A input DPI.
+         * @return The DPI bucket, which is a multiple of 24 and not less than 24.
+         * @details The resources are shared among DPIs in the same bucket.
+         */
+        inline constexpr unsigned int to_dpi_bucket(unsigned int dpi) noexcept {
+            return dpi < 36 ? 24 : (dpi + 12) / 24 * 24 ;
+        }
+    }
+
+
+    /**
+     * @brief Current tray status
+     */
+    enum class TrayStatus : unsigned char
+    {
+        //! The tray is working properly.
+        RUNNING,
+
+        //! The tray is trying to exit successfully.
+        SHOULD_STOP,
+
+        //! The tray has errors.
+        FAILED,
+
+        //! The tray is stopped successfully.
+        STOPPED,
+    } ;
+
+    /**
+     * @brief Style of the value bar drawn inside a menu.
+     */
+    enum class BarStyle : unsigned char
+    {
+        //! The menu has no value bar.
+        NONE,
+
+        //! The menu shows a read-only progress bar.
+        PROGRESS,
+
+        //! The menu shows a slider that can be changed by the user.
+        SLIDER,
+    } ;
+
+    /**
+     * @brief Class to coalesce hover transitions of menus.
+     * @details While the mouse cursor sweeps across the menus, only the latest hovered menu is applied, at most once per frame interval. The menus that the cursor passed over in the meantime are never painted. All methods take the current time so that the state can be driven by any clock.
+     */
+    class HoverCoalescer {
+    public:
+        using time_point = std::chrono::steady_clock::time_point ;
+
+    private:
+        std::chrono::milliseconds frame_interval_ ;
+        std::chrono::milliseconds intent_delay_ ;
+
+        int applied_index_ ;
+        bool applied_once_ ;
+        time_point last_applied_ ;
+
+        int pending_index_ ;
+        bool has_pending_ ;
+        time_point pending_since_ ;
+
+        std::size_t avoided_repaints_ ;
+
+    public:
+        /**
+         * @brief Create hover coalescer.
+         * @param [in] frame_interval Minimum interval between two applied transitions.
+         * @param [in] intent_delay Time for which the cursor must rest on a menu before it is applied.
+         */
+        explicit HoverCoalescer(
+            std::chrono::milliseconds frame_interval=std::chrono::milliseconds(16),
+            std::chrono::milliseconds intent_delay=std::chrono::milliseconds(0))
+        : frame_interval_(frame_interval),
+          intent_delay_(intent_delay),
+          applied_index_(-1),
+          applied_once_(false),
+          last_applied_(),
+          pending_index_(-1),
+          has_pending_(false),
+          pending_since_(),
+          avoided_repaints_(0)
+        {}
+
+        /**
+         * @brief Change the timing policy.
+         * @param [in] frame_interval Minimum interval between two applied transitions.
+         * @param [in] intent_delay Time for which the cursor must rest on a menu before it is applied.
+         */
+        void set_policy(
+                std::chrono::milliseconds frame_interval,
+                std::chrono::milliseconds intent_delay) noexcept {
+            frame_interval_ = frame_interval ;
+            intent_delay_ = intent_delay ;
+        }
+
+        /**
+         * @brief Request a transition to the menu under the cursor.
+         * @param [in] index The index of the hovered menu.
+         * @param [in] now The current time.
+         * @details If another transition is still pending, it is discarded without being painted.
+         */
+        void request(int index, time_point now) noexcept {
+            if(has_pending_) {
+                if(index == pending_index_) {
+                    return ;
+                }
+                // The pending menu would have been painted twice (ON and OFF).
+                avoided_repaints_ += 2 ;
+                has_pending_ = false ;
+            }
+            if(index == applied_index_) {
+                return ;
+            }
+            pending_index_ = index ;
+            pending_since_ = now ;
+            has_pending_ = true ;
+        }
+
+        /**
+         * @brief Take out the transition to be applied at this time.
+         * @param [in] now The current time.
+         * @param [out] index The index of the menu to be selected.
+         * @return Returns true if a transition should be applied, false otherwise.
+         */
+        bool poll(time_point now, int& index) noexcept {
+            if(!has_pending_) {
+                return false ;
+            }
+            if(now - pending_since_ < intent_delay_) {
+                return false ;
+            }
+            if(applied_once_ && now - last_applied_ < frame_interval_) {
+                return false ;
+            }
+            commit(pending_index_, now) ;
+            index = applied_index_ ;
+            return true ;
+        }
+
+        /**
+         * @brief Apply a transition immediately.
+         * @param [in] index The index of the menu to be selected.
+         * @param [in] now The current time.
+         * @details Used for the keyboard selection, which must not be delayed. Any pending transition is discarded.
+         */
+        void commit(int index, time_point now) noexcept {
+            applied_index_ = index ;
+            applied_once_ = true ;
+            last_applied_ = now ;
+            has_pending_ = false ;
+        }
+
+        /**
+         * @brief Forget the selection and any pending transition.
+         */
+        void reset() noexcept {
+            applied_index_ = -1 ;
+            has_pending_ = false ;
+        }
+
+        /**
+         * @brief Refer to the index of the currently applied menu.
+         * @return The index, or -1 if no menu is selected.
+         */
+        int current() const noexcept {
+            return applied_index_ ;
+        }
+
+        /**
+         * @brief Check if a transition is waiting to be applied.
+         * @return Returns true if a transition is pending, false otherwise.
+         */
+        bool has_pending() const noexcept {
+            return has_pending_ ;
+        }
+
+        /**
+         * @brief Refer to the number of menu repaints that were skipped by coalescing.
+         * @return The number of avoided repaints.
+         */
+        std::size_t count_avoided_repaints() const noexcept {
+            return avoided_repaints_ ;
+        }
+    } ;
+
+    /**
+     * @brief Class to cache the widths of menus and track the widest one.
+     * @details Updating a width costs O(1) unless the widest menu becomes narrower.
+     */
+    class WidthCache {
+    private:
+        std::vector<long> widths_ ;
+        long max_ ;
+        std::size_t max_count_ ;
+
+    public:
+        WidthCache()
+        : widths_(),
+          max_(0),
+          max_count_(0)
+        {}
+
+        /**
+         * @brief Remove all widths.
+         */
+        void clear() noexcept {
+            widths_.clear() ;
+            max_ = 0 ;
+            max_count_ = 0 ;
+        }
+
+        /**
+         * @brief Append a width.
+         * @param [in] width The width of a new menu.
+         * @return Returns true if the maximum width is changed, false otherwise.
+         */
+        bool push_back(long width) {
+            widths_.push_back(width) ;
+            if(widths_.size() == 1 || width > max_) {
+                max_ = width ;
+                max_count_ = 1 ;
+                return true ;
+            }
+            if(width == max_) {
+                max_count_ ++ ;
+            }
+            return false ;
+        }
+
+        /**
+         * @brief Update the width of a menu.
+         * @param [in] index The index of menu.
+         * @param [in] width The new width.
+         * @return Returns true if the maximum width is changed, false otherwise.
+         */
+        bool update(std::size_t index, long width) {
+            auto old_width = widths_[index] ;
+            if(old_width == width) {
+                return false ;
+            }
+            widths_[index] = width ;
+
+            if(width > max_) {
+                max_ = width ;
+                max_count_ = 1 ;
+                return true ;
+            }
+            if(width == max_) {
+                max_count_ ++ ;
+                return false ;
+            }
+            if(old_width == max_ && -- max_count_ == 0) {
+                // The widest menu became narrower, so find the next one.
+                recalculate() ;
+                return true ;
+            }
+            return false ;
+        }
+
+        /**
+         * @brief Refer to the maximum width.
+         * @return The maximum width, or zero if empty.
+         */
+        long max_width() const noexcept {
+            return max_ ;
+        }
+
+        /**
+         * @brief Refer to the width of a menu.
+         * @param [in] index The index of menu.
+         * @return The width.
+         */
+        long at(std::size_t index) const {
+            return widths_[index] ;
+        }
+
+        /**
+         * @brief Returns the number of widths.
+         * @return The number of widths.
+         */
+        std::size_t size() const noexcept {
+            return widths_.size() ;
+        }
+
+    private:
+        void recalculate() noexcept {
+            max_ = 0 ;
+            max_count_ = 0 ;
+            for(auto w : widths_) {
+                if(max_count_ == 0 || w > max_) {
+                    max_ = w ;
+                    max_count_ = 1 ;
+                }
+                else if(w == max_) {
+                    max_count_ ++ ;
+                }
+            }
+        }
+    } ;
+
+    /**
+     * @brief Class to arrange menus in columns.
+     * @details The menus are filled column by column from the top. The width of each column is cached as the maximum width of its menus, so a change of one menu updates only its column.
+     */
+    class GridLayout {
+    private:
+        std::size_t max_rows_ ;
+        std::size_t count_ ;
+        std::vector<WidthCache> columns_ ;
+
+    public:
+        /**
+         * @brief Create grid layout.
+         * @param [in] max_rows The maximum number of rows in a column. Zero means a single column.
+         */
+        explicit GridLayout(std::size_t max_rows=0)
+        : max_rows_(max_rows),
+          count_(0),
+          columns_()
+        {}
+
+        /**
+         * @brief Change the maximum number of rows. All widths are removed.
+         * @param [in] max_rows The maximum number of rows in a column. Zero means a single column.
+         */
+        void set_max_rows(std::size_t max_rows) noexcept {
+            max_rows_ = max_rows ;
+            clear() ;
+        }
+
+        /**
+         * @brief Remove all widths.
+         */
+        void clear() noexcept {
+            count_ = 0 ;
+            columns_.clear() ;
+        }
+
+        /**
+         * @brief Append the width of a menu.
+         * @param [in] width The width of a new menu.
+         * @return Returns true if a column is added or the width of the last column is changed.
+         */
+        bool push_back(long width) {
+            if(max_rows_ == 0 ? columns_.empty() : count_ % max_rows_ == 0) {
+                columns_.emplace_back() ;
+            }
+            count_ ++ ;
+            return columns_.back().push_back(width) ;
+        }
+
+        /**
+         * @brief Update the width of a menu.
+         * @param [in] index The index of menu.
+         * @param [in] width The new width.
+         * @param [out] column The column of the menu.
+         * @return Returns true if the width of the column is changed, false otherwise.
+         */
+        bool update(std::size_t index, long width, std::size_t& column) {
+            column = column_of(index) ;
+            return columns_[column].update(row_of(index), width) ;
+        }
+
+        /**
+         * @brief Returns the number of menus.
+         * @return The number of menus.
+         */
+        std::size_t size() const noexcept {
+            return count_ ;
+        }
+
+        /**
+         * @brief Returns the number of columns.
+         * @return The number of columns.
+         */
+        std::size_t count_columns() const noexcept {
+            return columns_.size() ;
+        }
+
+        /**
+         * @brief Returns the number of rows of the first column, which is the tallest.
+         * @return The number of rows.
+         */
+        std::size_t count_rows() const noexcept {
+            return columns_.empty() ? 0 : columns_.front().size() ;
+        }
+
+        /**
+         * @brief Refer to the width of a column.
+         * @param [in] column The index of column.
+         * @return The maximum width of menus in the column.
+         */
+        long column_width(std::size_t column) const {
+            return columns_[column].max_width() ;
+        }
+
+        /**
+         * @brief Get the column of a menu.
+         * @param [in] index The index of menu.
+         * @return The index of column.
+         */
+        std::size_t column_of(std::size_t index) const noexcept {
+            return max_rows_ == 0 ? 0 : index / max_rows_ ;
+        }
+
+        /**
+         * @brief Get the row of a menu.
+         * @param [in] index The index of menu.
+         * @return The index of row.
+         */
+        std::size_t row_of(std::size_t index) const noexcept {
+            return max_rows_ == 0 ? index : index % max_rows_ ;
+        }
+
+        /**
+         * @brief Get the index of the first menu in a column.
+         * @param [in] column The index of column.
+         * @return The index of menu.
+         */
+        std::size_t first_of(std::size_t column) const noexcept {
+            return max_rows_ == 0 ? 0 : column * max_rows_ ;
+        }
+
+        /**
+         * @brief Get the menu in the adjacent column on the same row.
+         * @param [in] index The index of the current menu.
+         * @param [in] right True to move right, false to move left.
+         * @return The index of menu. It wraps around at both ends, and the last menu is selected if the row does not exist in the last column.
+         */
+        std::size_t move_horizontally(std::size_t index, bool right) const noexcept {
+            auto columns = count_columns() ;
+            if(columns <= 1) {
+                return index ;
+            }
+            auto column = column_of(index) ;
+            column = right ? (column + 1) % columns : (column + columns - 1) % columns ;
+            return (std::min)(first_of(column) + row_of(index), count_ - 1) ;
+        }
+    } ;
+
+    /**
+     * @brief Class to map a scrollable window of rows onto a large list of items.
+     * @details Only the rows in the window are bound to items, so the cost of scrolling does not depend on the number of items.
+     */
+    class VirtualList {
+    private:
+        //! The rotation of one wheel notch, which is the same as WHEEL_DELTA
+        static constexpr int wheel_delta_ = 120 ;
+
+        std::size_t count_ ;
+        std::size_t rows_ ;
+        std::size_t offset_ ;
+        int wheel_remainder_ ;
+
+    public:
+        /**
+         * @brief Create virtual list.
+         * @param [in] count The number of items.
+         * @param [in] rows The number of rows in the window.
+         */
+        explicit VirtualList(std::size_t count=0, std::size_t rows=0)
+        : count_(count),
+          rows_(rows),
+          offset_(0),
+          wheel_remainder_(0)
+        {}
+
+        /**
+         * @brief Change the number of items. The offset is clamped so that the window stays filled.
+         * @param [in] count The number of items.
+         * @return Returns true if the offset is changed, false otherwise.
+         */
+        bool resize(std::size_t count) noexcept {
+            count_ = count ;
+            return scroll_by(0) ;
+        }
+
+        /**
+         * @brief Returns the number of items.
+         * @return The number of items.
+         */
+        std::size_t size() const noexcept {
+            return count_ ;
+        }
+
+        /**
+         * @brief Returns the number of rows in the window.
+         * @return The number of rows.
+         */
+        std::size_t count_rows() const noexcept {
+            return rows_ ;
+        }
+
+        /**
+         * @brief Returns the index of the item in the first row.
+         * @return The index of item.
+         */
+        std::size_t offset() const noexcept {
+            return offset_ ;
+        }
+
+        /**
+         * @brief Returns the largest offset with which the window is filled.
+         * @return The index of item.
+         */
+        std::size_t max_offset() const noexcept {
+            return count_ > rows_ ? count_ - rows_ : 0 ;
+        }
+
+        /**
+         * @brief Get the item bound to a row.
+         * @param [in] row The index of row in the window.
+         * @return The index of item.
+         */
+        std::size_t index_of(std::size_t row) const noexcept {
+            return offset_ + row ;
+        }
+
+        /**
+         * @brief Check whether an item is bound to a row.
+         * @param [in] row The index of row in the window.
+         * @return Returns true if the row shows an item, false if it is empty.
+         */
+        bool is_bound(std::size_t row) const noexcept {
+            return row < rows_ && index_of(row) < count_ ;
+        }
+
+        /**
+         * @brief Scroll the window by some rows.
+         * @param [in] lines The number of rows. A negative value scrolls toward the first item.
+         * @return Returns true if the offset is changed, false otherwise.
+         */
+        bool scroll_by(long lines) noexcept {
+            auto limit = max_offset() ;
+            std::size_t offset ;
+            if(lines < 0) {
+                auto distance = static_cast<std::size_t>(-(lines + 1)) + 1 ;
+                offset = offset_ > distance ? offset_ - distance : 0 ;
+            }
+            else {
+                auto distance = static_cast<std::size_t>(lines) ;
+                offset = offset_ + (std::min)(distance, limit) ;
+            }
+            offset = (std::min)(offset, limit) ;
+            if(offset == offset_) {
+                return false ;
+            }
+            offset_ = offset ;
+            return true ;
+        }
+
+        /**
+         * @brief Scroll the window by the least rows so that an item is shown.
+         * @param [in] index The index of item.
+         * @return Returns true if the offset is changed, false otherwise.
+         */
+        bool scroll_to(std::size_t index) noexcept {
+            if(index < offset_) {
+                offset_ = index ;
+                return true ;
+            }
+            if(rows_ > 0 && index >= offset_ + rows_ && index < count_) {
+                offset_ = (std::min)(index - rows_ + 1, max_offset()) ;
+                return true ;
+            }
+            return false ;
+        }
+
+        /**
+         * @brief Scroll the window by one row when the cursor is moved beyond an edge of the window.
+         * @param [in] row The row of the cursor.
+         * @param [in] forward True to move toward the last item, false to move toward the first item.
+         * @return Returns true if the window is scrolled, false if the cursor should be moved normally.
+         */
+        bool scroll_past_edge(std::size_t row, bool forward) noexcept {
+            if(forward) {
+                return row + 1 == rows_ && scroll_by(1) ;
+            }
+            return row == 0 && scroll_by(-1) ;
+        }
+
+        /**
+         * @brief Scroll the window by the rotation of mouse wheel.
+         * @param [in] delta The rotation in multiples or fractions of WHEEL_DELTA. A positive value scrolls toward the first item.
+         * @param [in] lines_per_notch The number of rows per WHEEL_DELTA.
+         * @return Returns true if the offset is changed, false otherwise.
+         * @details The rotation smaller than WHEEL_DELTA from high-resolution wheels is accumulated until it reaches a notch.
+         */
+        bool scroll_by_wheel(int delta, long lines_per_notch) noexcept {
+            if((delta > 0 && wheel_remainder_ < 0) || (delta < 0 && wheel_remainder_ > 0)) {
+                // The direction is reversed.
+                wheel_remainder_ = 0 ;
+            }
+            wheel_remainder_ += delta ;
+            auto notches = wheel_remainder_ / wheel_delta_ ;
+            wheel_remainder_ %= wheel_delta_ ;
+            return scroll_by(-notches * lines_per_notch) ;
+        }
+    } ;
+
+    /**
+     * @brief Class to find labels by a typed prefix.
+     * @details The case-folded labels are kept in a sorted array, so the labels starting with a prefix are a contiguous range found by binary search in O(log n). The array is built once by sorting and then updated by inserting and erasing single entries. The array is also split into blocks of consecutive entries with their items sorted, so the smallest item after another in a range is found in O(b + m / b log b) for m labels in the range and blocks of b entries.
+     */
+    class PrefixIndex {
+    private:
+        struct Entry {
+            std::wstring label ;
+            std::size_t item ;
+        } ;
+        std::vector<Entry> entries_ ;
+
+        //! The entries of a block, which are the entries from the end of the previous block
+        struct Block {
+            //! The position after the last entry of the block
+            std::size_t end ;
+            //! The items of the entries in ascending order
+            std::vector<std::size_t> items ;
+        } ;
+        std::vector<Block> blocks_ ;
+
+        //! The number of entries in a rebuilt block. A block is split by rebuilding when it doubles.
+        static constexpr std::size_t block_size_ = 256 ;
+
+        static bool less(const Entry& lhs, const Entry& rhs) noexcept {
+            return lhs.label < rhs.label || (lhs.label == rhs.label && lhs.item < rhs.item) ;
+        }
+
+        std::size_t lower_bound(const std::wstring& label, std::size_t item) const {
+            Entry key{label, item} ;
+            return static_cast<std::size_t>(std::distance(
+                entries_.begin(),
+                std::lower_bound(entries_.begin(), entries_.end(), key, less))) ;
+        }
+
+        bool starts_with(std::size_t position, const std::wstring& prefix) const noexcept {
+            if(position >= entries_.size()) {
+                return false ;
+            }
+            const auto& label = entries_[position].label ;
+            return label.size() >= prefix.size()
+                && label.compare(0, prefix.size(), prefix) == 0 ;
+        }
+
+        std::size_t end_of_prefix(std::size_t begin, const std::wstring& prefix) const {
+            return static_cast<std::size_t>(std::distance(
+                entries_.begin(),
+                std::partition_point(
+                    entries_.begin() + static_cast<std::ptrdiff_t>(begin), entries_.end(),
+                    [&prefix] (const Entry& entry) {
+                        return entry.label.size() >= prefix.size()
+                            && entry.label.compare(0, prefix.size(), prefix) == 0 ;
+                    }))) ;
+        }
+
+        void build_blocks() {
+            const std::size_t size = block_size_ ;
+            blocks_.clear() ;
+            blocks_.reserve((entries_.size() + size - 1) / size) ;
+            for(std::size_t begin = 0 ; begin < entries_.size() ; begin += size) {
+                Block block{(std::min)(begin + size, entries_.size()), std::vector<std::size_t>()} ;
+                block.items.reserve(block.end - begin) ;
+                for(auto i = begin ; i < block.end ; i ++) {
+                    block.items.push_back(entries_[i].item) ;
+                }
+                std::sort(block.items.begin(), block.items.end()) ;
+                blocks_.push_back(std::move(block)) ;
+            }
+        }
+
+        //! Find the first block ending after a position.
+        std::size_t find_block(std::size_t position) const noexcept {
+            return static_cast<std::size_t>(std::distance(
+                blocks_.begin(),
+                std::upper_bound(
+                    blocks_.begin(), blocks_.end(), position,
+                    [] (std::size_t p, const Block& block) {return p < block.end ;}))) ;
+        }
+
+        void insert_block(std::size_t position, std::size_t item) {
+            const std::size_t size = block_size_ ;
+            if(blocks_.empty()) {
+                build_blocks() ;
+                return ;
+            }
+            auto k = (std::min)(find_block(position), blocks_.size() - 1) ;
+            auto& items = blocks_[k].items ;
+            items.insert(std::upper_bound(items.begin(), items.end(), item), item) ;
+            for(auto i = k ; i < blocks_.size() ; i ++) {
+                blocks_[i].end ++ ;
+            }
+            if(items.size() > 2 * size) {
+                build_blocks() ;
+            }
+        }
+
+        void erase_block(std::size_t position, std::size_t item) {
+            auto k = find_block(position) ;
+            auto& items = blocks_[k].items ;
+            items.erase(std::lower_bound(items.begin(), items.end(), item)) ;
+            for(auto i = k ; i < blocks_.size() ; i ++) {
+                blocks_[i].end -- ;
+            }
+            if(items.empty()) {
+                blocks_.erase(blocks_.begin() + static_cast<std::ptrdiff_t>(k)) ;
+            }
+        }
+
+    public:
+        PrefixIndex()
+        : entries_(),
+          blocks_()
+        {}
+
+        /**
+         * @brief Fold the case of a character.
+         * @param [in] c The character.
+         * @return The lowercase character of ASCII, Latin-1, Greek and Cyrillic, or the same character.
+         */
+        static wchar_t fold(wchar_t c) noexcept {
+            auto u = static_cast<std::uint32_t>(c) ;
+            if((u >= 0x41 && u <= 0x5A)
+                    || (u >= 0xC0 && u <= 0xDE && u != 0xD7)
+                    || (u >= 0x391 && u <= 0x3A9 && u != 0x3A2)
+                    || (u >= 0x410 && u <= 0x42F)) {
+                return static_cast<wchar_t>(u + 0x20) ;
+            }
+            if(u >= 0x400 && u <= 0x40F) {
+                return static_cast<wchar_t>(u + 0x50) ;
+            }
+            return c ;
+        }
+
+        /**
+         * @brief Fold the case of a string.
+         * @param [in] text The string.
+         * @return The case-folded string.
+         */
+        static std::wstring fold(const std::wstring& text) {
+            std::wstring folded(text) ;
+            for(auto& c : folded) {
+                c = fold(c) ;
+            }
+            return folded ;
+        }
+
+        /**
+         * @brief Build the index from all labels at once.
+         * @param [in] labels The labels. The index of a label is used as its item.
+         * @details The empty labels are not indexed.
+         */
+        void assign(const std::vector<std::wstring>& labels) {
+            entries_.clear() ;
+            entries_.reserve(labels.size()) ;
+            for(std::size_t i = 0 ; i < labels.size() ; i ++) {
+                if(!labels[i].empty()) {
+                    entries_.push_back(Entry{fold(labels[i]), i}) ;
+                }
+            }
+            std::sort(entries_.begin(), entries_.end(), less) ;
+            build_blocks() ;
+        }
+
+        /**
+         * @brief Build the index from labels with their items at once.
+         * @param [in] items The items of labels.
+         * @param [in] labels The labels in the same order as items.
+         * @details The empty labels are not indexed. It is faster than inserting many labels one by one.
+         */
+        void assign(const std::vector<std::size_t>& items, const std::vector<std::wstring>& labels) {
+            entries_.clear() ;
+            entries_.reserve(labels.size()) ;
+            for(std::size_t i = 0 ; i < labels.size() ; i ++) {
+                if(!labels[i].empty()) {
+                    entries_.push_back(Entry{fold(labels[i]), items[i]}) ;
+                }
+            }
+            std::sort(entries_.begin(), entries_.end(), less) ;
+            build_blocks() ;
+        }
+
+        /**
+         * @brief Add a label.
+         * @param [in] item The item of label.
+         * @param [in] label The label.
+         * @return Returns true on success, false if the label is empty or already added for the item.
+         */
+        bool insert(std::size_t item, const std::wstring& label) {
+            if(label.empty()) {
+                return false ;
+            }
+            auto folded = fold(label) ;
+            auto position = lower_bound(folded, item) ;
+            if(position < entries_.size()
+                    && entries_[position].item == item && entries_[position].label == folded) {
+                return false ;
+            }
+            entries_.insert(
+                entries_.begin() + static_cast<std::ptrdiff_t>(position),
+                Entry{std::move(folded), item}) ;
+            insert_block(position, item) ;
+            return true ;
+        }
+
+        /**
+         * @brief Remove a label.
+         * @param [in] item The item of label.
+         * @param [in] label The label given when it was added.
+         * @return Returns true on success, false if there is no such label.
+         */
+        bool erase(std::size_t item, const std::wstring& label) {
+            auto folded = fold(label) ;
+            auto position = lower_bound(folded, item) ;
+            if(position >= entries_.size()
+                    || entries_[position].item != item || entries_[position].label != folded) {
+                return false ;
+            }
+            entries_.erase(entries_.begin() + static_cast<std::ptrdiff_t>(position)) ;
+            erase_block(position, item) ;
+            return true ;
+        }
+
+        /**
+         * @brief Add many labels at once.
+         * @param [in] items The items of labels, which are not in the index yet.
+         * @param [in] labels The labels in the same order as items.
+         * @details The empty labels are not indexed. Only the new labels are sorted and then merged, so it costs O(n + m log m) for m new labels.
+         */
+        void insert(const std::vector<std::size_t>& items, const std::vector<std::wstring>& labels) {
+            auto middle = entries_.size() ;
+            for(std::size_t i = 0 ; i < labels.size() ; i ++) {
+                if(!labels[i].empty()) {
+                    entries_.push_back(Entry{fold(labels[i]), items[i]}) ;
+                }
+            }
+            auto begin = entries_.begin() + static_cast<std::ptrdiff_t>(middle) ;
+            std::sort(begin, entries_.end(), less) ;
+            std::inplace_merge(entries_.begin(), begin, entries_.end(), less) ;
+            build_blocks() ;
+        }
+
+        /**
+         * @brief Remove the labels of the items from a count.
+         * @param [in] count The number of items kept. The labels whose items are not less than it are removed.
+         */
+        void truncate(std::size_t count) {
+            entries_.erase(
+                std::remove_if(
+                    entries_.begin(), entries_.end(),
+                    [count] (const Entry& entry) {return entry.item >= count ;}),
+                entries_.end()) ;
+            build_blocks() ;
+        }
+
+        /**
+         * @brief Find the first label in the sorted order starting with a prefix.
+         * @param [in] prefix The prefix.
+         * @param [out] item The item of the found label.
+         * @return Returns true on success, false if no label starts with the prefix.
+         */
+        bool first(const std::wstring& prefix, std::size_t& item) const {
+            auto folded = fold(prefix) ;
+            auto position = lower_bound(folded, 0) ;
+            if(!starts_with(position, folded)) {
+                return false ;
+            }
+            item = entries_[position].item ;
+            return true ;
+        }
+
+        /**
+         * @brief Find the next label in the sorted order starting with a prefix.
+         * @param [in] prefix The prefix.
+         * @param [in] label The label of the current item.
+         * @param [in] current The current item.
+         * @param [in] inclusive True to find the current item itself if it matches.
+         * @param [out] item The item of the found label.
+         * @return Returns true on success, false if no later label starts with the prefix. It does not wrap around.
+         */
+        bool next(
+                const std::wstring& prefix,
+                const std::wstring& label,
+                std::size_t current,
+                bool inclusive,
+                std::size_t& item) const {
+            auto folded = fold(prefix) ;
+            auto position = (std::max)(lower_bound(fold(label), current), lower_bound(folded, 0)) ;
+            if(!inclusive && position < entries_.size() && entries_[position].item == current) {
+                position ++ ;
+            }
+            if(!starts_with(position, folded)) {
+                return false ;
+            }
+            item = entries_[position].item ;
+            return true ;
+        }
+
+        /**
+         * @brief Find the label starting with a prefix whose item has the smallest rank after a rank.
+         * @param [in] prefix The prefix.
+         * @param [in] rank Function with the signature `std::size_t(std::size_t)` to get the rank of an item, such as its display position.
+         * @param [in] after The rank to search after.
+         * @param [in] inclusive True to find the item with the same rank as after.
+         * @param [out] item The item of the found label.
+         * @return Returns true on success, false if no label after the rank starts with the prefix. It does not wrap around.
+         * @details The labels starting with the prefix are found by binary search, and then only they are scanned. If the rank grows with the item, next_item() finds the same label without scanning.
+         */
+        template <typename Rank>
+        bool next_by_rank(
+                const std::wstring& prefix,
+                Rank rank,
+                std::size_t after,
+                bool inclusive,
+                std::size_t& item) const {
+            auto folded = fold(prefix) ;
+            bool found = false ;
+            std::size_t best = 0 ;
+            for(auto position = lower_bound(folded, 0) ; starts_with(position, folded) ; position ++) {
+                auto candidate = rank(entries_[position].item) ;
+                if((candidate > after || (inclusive && candidate == after)) && (!found || candidate < best)) {
+                    found = true ;
+                    best = candidate ;
+                    item = entries_[position].item ;
+                }
+            }
+            return found ;
+        }
+
+        /**
+         * @brief Find the label starting with a prefix whose item is the smallest after an item.
+         * @param [in] prefix The prefix.
+         * @param [in] after The item to search after.
+         * @param [in] inclusive True to find the item after itself if it matches.
+         * @param [out] item The item of the found label.
+         * @return Returns true on success, false if no label after the item starts with the prefix. It does not wrap around.
+         * @details The blocks inside the range of the prefix are searched by binary search of their items, and only the entries of the blocks at both ends are scanned.
+         */
+        bool next_item(
+                const std::wstring& prefix,
+                std::size_t after,
+                bool inclusive,
+                std::size_t& item) const {
+            auto folded = fold(prefix) ;
+            auto first = lower_bound(folded, 0) ;
+            auto last = end_of_prefix(first, folded) ;
+            bool found = false ;
+            std::size_t best = 0 ;
+            auto consider = [after, inclusive, &found, &best] (std::size_t candidate) {
+                if((candidate > after || (inclusive && candidate == after)) && (!found || candidate < best)) {
+                    found = true ;
+                    best = candidate ;
+                }
+            } ;
+            auto k = find_block(first) ;
+            auto begin = k == 0 ? 0 : blocks_[k - 1].end ;
+            for( ; k < blocks_.size() && begin < last ; k ++) {
+                auto end = blocks_[k].end ;
+                if(begin >= first && end <= last) {
+                    const auto& items = blocks_[k].items ;
+                    auto itr = inclusive
+                        ? std::lower_bound(items.begin(), items.end(), after)
+                        : std::upper_bound(items.begin(), items.end(), after) ;
+                    if(itr != items.end()) {
+                        consider(*itr) ;
+                    }
+                }
+                else {
+                    for(auto position = (std::max)(begin, first) ; position < (std::min)(end, last) ; position ++) {
+                        consider(entries_[position].item) ;
+                    }
+                }
+                begin = end ;
+            }
+            if(found) {
+                item = best ;
+            }
+            return found ;
+        }
+
+        /**
+         * @brief Returns the number of labels.
+         * @return The number of labels.
+         */
+        std::size_t size() const noexcept {
+            return entries_.size() ;
+        }
+
+        /**
+         * @brief Remove all labels.
+         */
+        void clear() noexcept {
+            entries_.clear() ;
+            blocks_.clear() ;
+        }
+    } ;
+
+    /**
+     * @brief Class to collect the characters typed to jump to a menu.
+     * @details The characters typed within the timeout of each other are joined into a prefix. Typing the same character repeatedly cycles through the labels starting with it. All methods take the current time so that the state can be driven by any clock.
+     */
+    class TypeAhead {
+    public:
+        using time_point = std::chrono::steady_clock::time_point ;
+
+    private:
+        std::chrono::milliseconds timeout_ ;
+        std::wstring typed_ ;
+        time_point last_typed_ ;
+
+    public:
+        /**
+         * @brief Create type-ahead buffer.
+         * @param [in] timeout The time after which the next character starts a new prefix.
+         */
+        explicit TypeAhead(std::chrono::milliseconds timeout=std::chrono::milliseconds(1000))
+        : timeout_(timeout),
+          typed_(),
+          last_typed_()
+        {}
+
+        /**
+         * @brief Change the timeout.
+         * @param [in] timeout The time after which the next character starts a new prefix.
+         */
+        void set_timeout(std::chrono::milliseconds timeout) noexcept {
+            timeout_ = timeout ;
+        }
+
+        /**
+         * @brief Add a typed character.
+         * @param [in] c The character.
+         * @param [in] now The current time.
+         */
+        void type(wchar_t c, time_point now) {
+            if(!typed_.empty() && now - last_typed_ >= timeout_) {
+                typed_.clear() ;
+            }
+            typed_.push_back(PrefixIndex::fold(c)) ;
+            last_typed_ = now ;
+        }
+
+        /**
+         * @brief Check whether the same character is typed repeatedly.
+         * @return Returns true if more than one character is typed and all of them are the same, false otherwise.
+         */
+        bool is_cycling() const noexcept {
+            return typed_.size() > 1
+                && typed_.find_first_not_of(typed_[0]) == std::wstring::npos ;
+        }
+
+        /**
+         * @brief Get the prefix to search for.
+         * @return The typed characters, or only the first one while cycling.
+         */
+        std::wstring prefix() const {
+            return is_cycling() ? typed_.substr(0, 1) : typed_ ;
+        }
+
+        /**
+         * @brief Check whether the current menu may be kept if it matches.
+         * @return Returns true if the latest character extends the prefix, false if the search should start after the current menu.
+         */
+        bool extends() const noexcept {
+            return typed_.size() > 1 && !is_cycling() ;
+        }
+
+        /**
+         * @brief Forget the typed characters.
+         */
+        void reset() noexcept {
+            typed_.clear() ;
+        }
+    } ;
+
+    /**
+     * @brief Result of fuzzy matching of a label.
+     */
+    struct FuzzyMatch {
+        //! The item of label
+        std::size_t item ;
+        //! The score. A higher score is a better match.
+        int score ;
+    } ;
+
+    /**
+     * @brief Class to filter labels by fuzzy matching, where the characters of a query must appear in a label in order.
+     * @details The case-folded labels are stored in one contiguous buffer of UTF-16 code units with a 64-bit character mask per label and a bit per code unit marking the word separators. A query first drops the labels missing any of its characters by comparing the masks, and then only the rest are scored. When the query is extended, only the previous matches are tested again. The matches are ranked lazily, so only the shown ones are sorted.
+     */
+    class FuzzyMatcher {
+    private:
+        std::vector<std::uint16_t> text_ ;
+        std::vector<std::size_t> offsets_ ;
+        std::vector<std::uint64_t> masks_ ;
+        std::vector<std::uint64_t> separators_ ;
+
+        std::vector<std::uint16_t> query_ ;
+        bool filtered_ ;
+        std::vector<std::uint32_t> candidates_ ;
+        std::vector<FuzzyMatch> matches_ ;
+        std::size_t count_scored_ ;
+
+        //! The matches whose first count_ranked_ elements are in the ranked order
+        std::vector<FuzzyMatch> ranked_ ;
+        std::size_t count_ranked_ ;
+
+        static bool is_better(const FuzzyMatch& lhs, const FuzzyMatch& rhs) noexcept {
+            return lhs.score > rhs.score || (lhs.score == rhs.score && lhs.item < rhs.item) ;
+        }
+
+        void mark_separators() {
+            separators_.resize((text_.size() + 63) / 64) ;
+            util::find_word_separators(text_.data(), text_.size(), separators_.data()) ;
+        }
+
+        static void append_folded(const std::wstring& text, std::vector<std::uint16_t>& units) {
+            for(auto c : text) {
+                auto u = static_cast<std::uint32_t>(PrefixIndex::fold(c)) ;
+                if(u > 0xFFFF) {
+                    // The wide characters beyond the BMP are stored as surrogate pairs.
+                    u -= 0x10000 ;
+                    units.push_back(static_cast<std::uint16_t>(0xD800 + (u >> 10))) ;
+                    units.push_back(static_cast<std::uint16_t>(0xDC00 + (u & 0x3FF))) ;
+                }
+                else {
+                    units.push_back(static_cast<std::uint16_t>(u)) ;
+                }
+            }
+        }
+
+        static std::uint64_t mask_of(const std::uint16_t* units, std::size_t n) noexcept {
+            std::uint64_t mask = 0 ;
+            for(std::size_t i = 0 ; i < n ; i ++) {
+                auto c = units[i] ;
+                std::uint64_t bit ;
+                if(c >= 'a' && c <= 'z') {
+                    bit = c - 'a' ;
+                }
+                else if(c >= '0' && c <= '9') {
+                    bit = 26 + (c - '0') ;
+                }
+                else {
+                    bit = 36 + c % 28 ;
+                }
+                mask |= std::uint64_t(1) << bit ;
+            }
+            return mask ;
+        }
+
+    public:
+        FuzzyMatcher()
+        : text_(),
+          offsets_(1, 0),
+          masks_(),
+          separators_(),
+          query_(),
+          filtered_(false),
+          candidates_(),
+          matches_(),
+          count_scored_(0),
+          ranked_(),
+          count_ranked_(0)
+        {}
+
+        /**
+         * @brief Store all labels at once.
+         * @param [in] labels The labels. The index of a label is used as its item.
+         * @details The previous query and matches are forgotten.
+         */
+        void assign(const std::vector<std::wstring>& labels) {
+            text_.clear() ;
+            offsets_.assign(1, 0) ;
+            masks_.clear() ;
+            offsets_.reserve(labels.size() + 1) ;
+            masks_.reserve(labels.size()) ;
+            for(const auto& label : labels) {
+                auto first = text_.size() ;
+                append_folded(label, text_) ;
+                masks_.push_back(mask_of(text_.data() + first, text_.size() - first)) ;
+                offsets_.push_back(text_.size()) ;
+            }
+            mark_separators() ;
+            reset() ;
+        }
+
+        /**
+         * @brief Store labels after the current ones.
+         * @param [in] labels The labels. Their items follow the current labels.
+         * @details The previous query and matches are forgotten.
+         */
+        void append(const std::vector<std::wstring>& labels) {
+            for(const auto& label : labels) {
+                auto first = text_.size() ;
+                append_folded(label, text_) ;
+                masks_.push_back(mask_of(text_.data() + first, text_.size() - first)) ;
+                offsets_.push_back(text_.size()) ;
+            }
+            mark_separators() ;
+            reset() ;
+        }
+
+        /**
+         * @brief Remove the labels of the items from a count.
+         * @param [in] count The number of labels kept.
+         * @details The previous query and matches are forgotten.
+         */
+        void truncate(std::size_t count) {
+            if(count < masks_.size()) {
+                masks_.resize(count) ;
+                offsets_.resize(count + 1) ;
+                text_.resize(offsets_.back()) ;
+                mark_separators() ;
+            }
+            reset() ;
+        }
+
+        /**
+         * @brief Replace a label.
+         * @param [in] item The item of label.
+         * @param [in] label The new label.
+         * @return Returns true on success, false if there is no such item.
+         * @details The labels after it are shifted in the buffer, so it costs O(n). The previous query and matches are forgotten.
+         */
+        bool replace(std::size_t item, const std::wstring& label) {
+            if(item >= masks_.size()) {
+                return false ;
+            }
+            std::vector<std::uint16_t> units ;
+            append_folded(label, units) ;
+            auto begin = text_.begin() + static_cast<std::ptrdiff_t>(offsets_[item]) ;
+            auto end = text_.begin() + static_cast<std::ptrdiff_t>(offsets_[item + 1]) ;
+            auto old_size = offsets_[item + 1] - offsets_[item] ;
+            text_.insert(text_.erase(begin, end), units.begin(), units.end()) ;
+            for(auto i = item + 1 ; i < offsets_.size() ; i ++) {
+                offsets_[i] = offsets_[i] + units.size() - old_size ;
+            }
+            masks_[item] = mask_of(units.data(), units.size()) ;
+            mark_separators() ;
+            reset() ;
+            return true ;
+        }
+
+        /**
+         * @brief Find the labels matching a query.
+         * @param [in] query The query. The case is ignored.
+         * @details If the query extends the previous one, only the previous matches are tested. An empty query matches all labels with the score of zero.
+         */
+        void filter(const std::wstring& query) {
+            std::vector<std::uint16_t> units ;
+            append_folded(query, units) ;
+            auto query_mask = mask_of(units.data(), units.size()) ;
+
+            auto extends = filtered_ && units.size() >= query_.size()
+                && std::equal(query_.begin(), query_.end(), units.begin()) ;
+            if(extends) {
+                // A label containing the extended query also contains the previous one.
+                candidates_.clear() ;
+                for(const auto& match : matches_) {
+                    if((masks_[match.item] & query_mask) == query_mask) {
+                        candidates_.push_back(static_cast<std::uint32_t>(match.item)) ;
+                    }
+                }
+            }
+            else {
+                util::filter_by_mask(masks_.data(), masks_.size(), query_mask, candidates_) ;
+            }
+
+            matches_.clear() ;
+            for(auto item : candidates_) {
+                int score ;
+                if(util::fuzzy_score(
+                        text_.data() + offsets_[item], offsets_[item + 1] - offsets_[item],
+                        separators_.data(), offsets_[item], units.data(), units.size(), score)) {
+                    matches_.push_back(FuzzyMatch{item, score}) ;
+                }
+            }
+            count_scored_ += candidates_.size() ;
+            query_.swap(units) ;
+            filtered_ = true ;
+            ranked_.clear() ;
+            count_ranked_ = 0 ;
+        }
+
+        /**
+         * @brief Refer to the matches of the latest query.
+         * @return The matches in the order of items.
+         */
+        const std::vector<FuzzyMatch>& matches() const noexcept {
+            return matches_ ;
+        }
+
+        /**
+         * @brief Rank the best matches of the latest query.
+         * @param [in] count The number of best matches needed.
+         * @return The number of ranked matches, which is at least count unless there are fewer matches.
+         * @details The ranked matches are kept until the next query, and only the matches after them are sorted to rank more. The ranked count is at least doubled each time, so ranking page by page costs O(n log k) in total for k ranked matches.
+         */
+        std::size_t rank(std::size_t count) {
+            if(count_ranked_ == 0 && ranked_.size() != matches_.size()) {
+                ranked_ = matches_ ;
+            }
+            if(count > count_ranked_) {
+                auto next = (std::min)((std::max)(count, count_ranked_ * 2), ranked_.size()) ;
+                auto begin = ranked_.begin() + static_cast<std::ptrdiff_t>(count_ranked_) ;
+                std::partial_sort(
+                    begin, ranked_.begin() + static_cast<std::ptrdiff_t>(next), ranked_.end(), is_better) ;
+                count_ranked_ = next ;
+            }
+            return count_ranked_ ;
+        }
+
+        /**
+         * @brief Refer to a ranked match.
+         * @param [in] position The position in the ranked order, which must be less than the count returned by rank.
+         * @return The match.
+         */
+        const FuzzyMatch& ranked(std::size_t position) const noexcept {
+            return ranked_[position] ;
+        }
+
+        /**
+         * @brief Get the best matches of the latest query.
+         * @param [in] limit The maximum number of matches.
+         * @param [out] ranked The matches in descending order of score. The ties are in the order of items.
+         * @details The matches ranked by the previous calls are not sorted again.
+         */
+        void rank(std::size_t limit, std::vector<FuzzyMatch>& ranked) {
+            auto count = (std::min)(rank(limit), limit) ;
+            ranked.assign(ranked_.begin(), ranked_.begin() + static_cast<std::ptrdiff_t>(count)) ;
+        }
+
+        /**
+         * @brief Forget the latest query, so that the next query tests all labels.
+         */
+        void reset() noexcept {
+            query_.clear() ;
+            filtered_ = false ;
+            candidates_.clear() ;
+            matches_.clear() ;
+            ranked_.clear() ;
+            count_ranked_ = 0 ;
+        }
+
+        /**
+         * @brief Returns the number of labels.
+         * @return The number of labels.
+         */
+        std::size_t size() const noexcept {
+            return masks_.size() ;
+        }
+
+        /**
+         * @brief Get the number of labels scored so far.
+         * @return The total number of labels passed to the scoring.
+         */
+        std::size_t count_scored() const noexcept {
+            return count_scored_ ;
+        }
+    } ;
+
+    /**
+     * @brief Handle to an element of SlotMap.
+     * @details The generation distinguishes the element from the elements later stored in the same slot, so a handle to a removed element never refers to another element.
+     */
+    struct SlotHandle {
+        //! The index of slot.
+        std::uint32_t index ;
+
+        //! The generation of slot when the element was stored. Zero means a null handle.
+        std::uint32_t generation ;
+
+        /**
+         * @brief Check whether the handle is null.
+         * @return Returns true if the handle is null, false otherwise.
+         */
+        bool is_null() const noexcept {
+            return generation == 0 ;
+        }
+    } ;
+
+    inline bool operator==(const SlotHandle& lhs, const SlotHandle& rhs) noexcept {
+        return lhs.index == rhs.index && lhs.generation == rhs.generation ;
+    }
+
+    inline bool operator!=(const SlotHandle& lhs, const SlotHandle& rhs) noexcept {
+        return !(lhs == rhs) ;
+    }
+
+    /**
+     * @brief Container of ordered elements with stable references and generational handles.
+     * @details The elements are stored in slots of std::deque, which are never moved, so references to elements are valid until the elements are removed. The free slots are reused. The order is an intrusive doubly linked list through the slots, so inserting, removing and moving by handle and lookup by handle are O(1). The positions are cached in a vector, which is rebuilt in O(n) by the first positional access after the order is changed in the middle. Appending and removing the last element keep the cache.
+     */
+    template <typename Type>
+    class SlotMap {
+    private:
+        static constexpr std::uint32_t npos_ = 0xFFFFFFFF ;
+
+        struct Slot {
+            Type value ;
+            std::uint32_t generation ;
+            std::uint32_t prev ;
+            std::uint32_t next ;
+            //! The position in the order, which is valid while the cache is valid
+            mutable std::uint32_t position ;
+            bool occupied ;
+        } ;
+
+        std::deque<Slot> slots_ ;
+        std::vector<std::uint32_t> free_ ;
+        std::uint32_t head_ ;
+        std::uint32_t tail_ ;
+        std::size_t size_ ;
+        mutable std::vector<std::uint32_t> order_ ;
+        mutable bool order_valid_ ;
+
+        template <bool Const>
+        class Iterator {
+        private:
+            using Slots = typename std::conditional<Const, const std::deque<Slot>, std::deque<Slot>>::type ;
+            Slots* slots_ ;
+            std::vector<std::uint32_t>::const_iterator itr_ ;
+
+            friend class SlotMap ;
+
+            Iterator(Slots* slots, std::vector<std::uint32_t>::const_iterator itr) noexcept
+            : slots_(slots),
+              itr_(itr)
+            {}
+
+        public:
+            using iterator_category = std::random_access_iterator_tag ;
+            using value_type = Type ;
+            using difference_type = std::ptrdiff_t ;
+            using pointer = typename std::conditional<Const, const Type*, Type*>::type ;
+            using reference = typename std::conditional<Const, const Type&, Type&>::type ;
+
+            Iterator() noexcept
+            : slots_(nullptr),
+              itr_()
+            {}
+
+            // Conversion from iterator to const_iterator
+            template <bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+            Iterator(const Iterator<OtherConst>& other) noexcept
+            : slots_(other.slots_),
+              itr_(other.itr_)
+            {}
+
+            reference operator*() const {
+                return (*slots_)[*itr_].value ;
+            }
+            pointer operator->() const {
+                return &(*slots_)[*itr_].value ;
+            }
+            reference operator[](difference_type n) const {
+                return (*slots_)[itr_[n]].value ;
+            }
+
+            Iterator& operator++() noexcept {
+                ++ itr_ ;
+                return *this ;
+            }
+            Iterator operator++(int) noexcept {
+                auto tmp = *this ;
+                ++ itr_ ;
+                return tmp ;
+            }
+            Iterator& operator--() noexcept {
+                -- itr_ ;
+                return *this ;
+            }
+            Iterator operator--(int) noexcept {
+                auto tmp = *this ;
+                -- itr_ ;
+                return tmp ;
+            }
+            Iterator& operator+=(difference_type n) noexcept {
+                itr_ += n ;
+                return *this ;
+            }
+            Iterator& operator-=(difference_type n) noexcept {
+                itr_ -= n ;
+                return *this ;
+            }
+            Iterator operator+(difference_type n) const noexcept {
+                return Iterator(slots_, itr_ + n) ;
+            }
+            friend Iterator operator+(difference_type n, const Iterator& itr) noexcept {
+                return itr + n ;
+            }
+            Iterator operator-(difference_type n) const noexcept {
+                return Iterator(slots_, itr_ - n) ;
+            }
+            difference_type operator-(const Iterator& other) const noexcept {
+                return itr_ - other.itr_ ;
+            }
+
+            bool operator==(const Iterator& other) const noexcept {
+                return itr_ == other.itr_ ;
+            }
+            bool operator!=(const Iterator& other) const noexcept {
+                return itr_ != other.itr_ ;
+            }
+            bool operator<(const Iterator& other) const noexcept {
+                return itr_ < other.itr_ ;
+            }
+            bool operator>(const Iterator& other) const noexcept {
+                return itr_ > other.itr_ ;
+            }
+            bool operator<=(const Iterator& other) const noexcept {
+                return itr_ <= other.itr_ ;
+            }
+            bool operator>=(const Iterator& other) const noexcept {
+                return itr_ >= other.itr_ ;
+            }
+        } ;
+
+        void ensure_order() const {
+            if(order_valid_) {
+                return ;
+            }
+            order_.clear() ;
+            order_.reserve(size_) ;
+            for(auto index = head_ ; index != npos_ ; index = slots_[index].next) {
+                slots_[index].position = static_cast<std::uint32_t>(order_.size()) ;
+                order_.push_back(index) ;
+            }
+            order_valid_ = true ;
+        }
+
+        std::uint32_t allocate(Type&& value) {
+            std::uint32_t index ;
+            if(!free_.empty()) {
+                index = free_.back() ;
+                free_.pop_back() ;
+                slots_[index].value = std::move(value) ;
+            }
+            else {
+                index = static_cast<std::uint32_t>(slots_.size()) ;
+                slots_.push_back(Slot{std::move(value), 0, npos_, npos_, 0, false}) ;
+            }
+            slots_[index].occupied = true ;
+            return index ;
+        }
+
+        // Link a slot before another slot, or at the end if next is npos_.
+        void link(std::uint32_t index, std::uint32_t next) noexcept {
+            auto& slot = slots_[index] ;
+            slot.next = next ;
+            slot.prev = next == npos_ ? tail_ : slots_[next].prev ;
+            if(slot.prev == npos_) {
+                head_ = index ;
+            }
+            else {
+                slots_[slot.prev].next = index ;
+            }
+            if(next == npos_) {
+                tail_ = index ;
+            }
+            else {
+                slots_[next].prev = index ;
+            }
+            size_ ++ ;
+
+            if(order_valid_ && next == npos_) {
+                // Appending keeps the cached positions.
+                slot.position = static_cast<std::uint32_t>(order_.size()) ;
+                order_.push_back(index) ;
+            }
+            else {
+                order_valid_ = false ;
+            }
+        }
+
+        void unlink(std::uint32_t index) noexcept {
+            auto& slot = slots_[index] ;
+            if(order_valid_ && index == tail_) {
+                // Removing the last element keeps the cached positions.
+                order_.pop_back() ;
+            }
+            else {
+                order_valid_ = false ;
+            }
+
+            if(slot.prev == npos_) {
+                head_ = slot.next ;
+            }
+            else {
+                slots_[slot.prev].next = slot.next ;
+            }
+            if(slot.next == npos_) {
+                tail_ = slot.prev ;
+            }
+            else {
+                slots_[slot.next].prev = slot.prev ;
+            }
+            slot.prev = npos_ ;
+            slot.next = npos_ ;
+            size_ -- ;
+        }
+
+        void release(std::uint32_t index) {
+            auto& slot = slots_[index] ;
+            slot.value = Type() ;
+            slot.occupied = false ;
+            // Wrap so that the generation of handles, which is one more, never becomes zero.
+            slot.generation = (slot.generation + 1) % 0xFFFFFFFFu ;
+        }
+
+    public:
+        using iterator = Iterator<false> ;
+        using const_iterator = Iterator<true> ;
+
+        SlotMap()
+        : slots_(),
+          free_(),
+          head_(npos_),
+          tail_(npos_),
+          size_(0),
+          order_(),
+          order_valid_(true)
+        {}
+
+        /**
+         * @brief Insert an element before a position.
+         * @param [in] position The position in the order. It must not be greater than the number of elements.
+         * @param [in] value The element.
+         * @return The handle of the element.
+         * @details Finding the position is O(1) while the cached positions are valid. Use insert_before to insert in O(1) regardless of the cache.
+         */
+        SlotHandle insert(std::size_t position, Type value) {
+            if(position >= size_) {
+                return push_back(std::move(value)) ;
+            }
+            return insert_before(handle_at(position), std::move(value)) ;
+        }
+
+        /**
+         * @brief Insert an element before another element in O(1).
+         * @param [in] next The handle of the element to be next. A null or stale handle appends the element.
+         * @param [in] value The element.
+         * @return The handle of the element.
+         */
+        SlotHandle insert_before(const SlotHandle& next, Type value) {
+            std::uint32_t next_index = npos_ ;
+            if(contains(next)) {
+                next_index = next.index ;
+            }
+            auto index = allocate(std::move(value)) ;
+            link(index, next_index) ;
+            return SlotHandle{index, slots_[index].generation + 1} ;
+        }
+
+        /**
+         * @brief Append an element in O(1).
+         * @param [in] value The element.
+         * @return The handle of the element.
+         */
+        SlotHandle push_back(Type value) {
+            return insert_before(SlotHandle{0, 0}, std::move(value)) ;
+        }
+
+        /**
+         * @brief Move an element to another position. The handles are kept.
+         * @param [in] from The current position of the element.
+         * @param [in] to The new position of the element.
+         */
+        void move(std::size_t from, std::size_t to) {
+            if(from == to) {
+                return ;
+            }
+            auto handle = handle_at(from) ;
+            auto next = to + 1 < size_
+                ? handle_at(from < to ? to + 1 : to) : SlotHandle{0, 0} ;
+            move_before(handle, next) ;
+        }
+
+        /**
+         * @brief Move an element before another element in O(1). The handles are kept.
+         * @param [in] handle The handle of the element to be moved.
+         * @param [in] next The handle of the element to be next. A null or stale handle moves the element to the end.
+         * @return Returns true on success, false if the handle is stale.
+         */
+        bool move_before(const SlotHandle& handle, const SlotHandle& next) {
+            if(!contains(handle)) {
+                return false ;
+            }
+            std::uint32_t next_index = npos_ ;
+            if(contains(next)) {
+                next_index = next.index ;
+            }
+            if(next_index == handle.index || slots_[handle.index].next == next_index) {
+                return true ;
+            }
+            unlink(handle.index) ;
+            link(handle.index, next_index) ;
+            return true ;
+        }
+
+        /**
+         * @brief Remove an element in O(1). Its resources are released immediately.
+         * @param [in] handle The handle of the element.
+         * @return Returns true on success, false if the handle is stale.
+         */
+        bool erase(const SlotHandle& handle) {
+            if(!contains(handle)) {
+                return false ;
+            }
+            unlink(handle.index) ;
+            release(handle.index) ;
+            free_.push_back(handle.index) ;
+            return true ;
+        }
+
+        /**
+         * @brief Remove all elements.
+         * @details The slots are kept and their generations are advanced, so the handles issued before are stale and never refer to new elements.
+         */
+        void clear() {
+            for(auto index = head_ ; index != npos_ ; index = slots_[index].next) {
+                release(index) ;
+            }
+            // The lowest slots are reused first.
+            free_.clear() ;
+            for(auto index = slots_.size() ; index-- > 0 ; ) {
+                slots_[index].prev = npos_ ;
+                slots_[index].next = npos_ ;
+                free_.push_back(static_cast<std::uint32_t>(index)) ;
+            }
+            head_ = npos_ ;
+            tail_ = npos_ ;
+            size_ = 0 ;
+            order_.clear() ;
+            order_valid_ = true ;
+        }
+
+        /**
+         * @brief Refer to an element by handle.
+         * @param [in] handle The handle of the element.
+         * @return The pointer to the element, or nullptr if the handle is stale.
+         */
+        Type* find(const SlotHandle& handle) noexcept {
+            if(!contains(handle)) {
+                return nullptr ;
+            }
+            return &slots_[handle.index].value ;
+        }
+
+        /**
+         * @brief Refer to an element by handle.
+         * @param [in] handle The handle of the element.
+         * @return The pointer to the element, or nullptr if the handle is stale.
+         */
+        const Type* find(const SlotHandle& handle) const noexcept {
+            if(!contains(handle)) {
+                return nullptr ;
+            }
+            return &slots_[handle.index].value ;
+        }
+
+        /**
+         * @brief Check whether the element of a handle exists.
+         * @param [in] handle The handle of the element.
+         * @return Returns true if the element exists, false otherwise.
+         */
+        bool contains(const SlotHandle& handle) const noexcept {
+            return handle.index < slots_.size()
+                && slots_[handle.index].occupied
+                && slots_[handle.index].generation + 1 == handle.generation ;
+        }
+
+        /**
+         * @brief Get the position of an element in the order.
+         * @param [in] handle The handle of the element.
+         * @param [out] position The position.
+         * @return Returns true on success, false if the handle is stale.
+         */
+        bool find_position(const SlotHandle& handle, std::size_t& position) const {
+            if(!contains(handle)) {
+                return false ;
+            }
+            ensure_order() ;
+            position = slots_[handle.index].position ;
+            return true ;
+        }
+
+        /**
+         * @brief Get the handle of an element by position.
+         * @param [in] position The position in the order.
+         * @return The handle of the element.
+         */
+        SlotHandle handle_at(std::size_t position) const {
+            ensure_order() ;
+            auto index = order_[position] ;
+            return SlotHandle{index, slots_[index].generation + 1} ;
+        }
+
+        /**
+         * @brief Get the handle of the element after another element in O(1).
+         * @param [in] handle The handle of the element.
+         * @return The handle of the next element, or a null handle if it is the last one or the handle is stale.
+         */
+        SlotHandle next_of(const SlotHandle& handle) const noexcept {
+            if(!contains(handle) || slots_[handle.index].next == npos_) {
+                return SlotHandle{0, 0} ;
+            }
+            auto index = slots_[handle.index].next ;
+            return SlotHandle{index, slots_[index].generation + 1} ;
+        }
+
+        Type& operator[](std::size_t position) {
+            ensure_order() ;
+            return slots_[order_[position]].value ;
+        }
+
+        const Type& operator[](std::size_t position) const {
+            ensure_order() ;
+            return slots_[order_[position]].value ;
+        }
+
+        Type& front() {
+            return slots_[head_].value ;
+        }
+
+        const Type& front() const {
+            return slots_[head_].value ;
+        }
+
+        Type& back() {
+            return slots_[tail_].value ;
+        }
+
+        const Type& back() const {
+            return slots_[tail_].value ;
+        }
+
+        /**
+         * @brief Returns the number of elements.
+         * @return The number of elements.
+         */
+        std::size_t size() const noexcept {
+            return size_ ;
+        }
+
+        /**
+         * @brief Check whether the container is empty.
+         * @return Returns true if there is no element, false otherwise.
+         */
+        bool empty() const noexcept {
+            return size_ == 0 ;
+        }
+
+        /**
+         * @brief Returns the number of slots including free ones.
+         * @return The number of slots.
+         */
+        std::size_t count_slots() const noexcept {
+            return slots_.size() ;
+        }
+
+        iterator begin() {
+            ensure_order() ;
+            return iterator(&slots_, order_.cbegin()) ;
+        }
+
+        iterator end() {
+            ensure_order() ;
+            return iterator(&slots_, order_.cend()) ;
+        }
+
+        const_iterator begin() const {
+            ensure_order() ;
+            return const_iterator(&slots_, order_.cbegin()) ;
+        }
+
+        const_iterator end() const {
+            ensure_order() ;
+            return const_iterator(&slots_, order_.cend()) ;
+        }
+
+        const_iterator cbegin() const {
+            return begin() ;
+        }
+
+        const_iterator cend() const {
+            return end() ;
+        }
+    } ;
+
+    /**
+     * @brief Table of the per-menu state touched on every update, stored as contiguous arrays.
+     * @details Hit testing, keyboard navigation and command dispatch only read the identifiers, window handles and flags here, so they do not load the labels and callbacks of FluentMenu. The rows are in the display order of menus. Window is the type of window handle, which is HWND in FluentTray.
+     */
+    template <typename Window>
+    class MenuHotTable {
+    private:
+        static constexpr std::uint32_t npos_ = 0xFFFFFFFF ;
+        static constexpr std::uint8_t slider_flag_ = 0x01 ;
+        static constexpr std::uint8_t submenu_flag_ = 0x02 ;
+
+        std::vector<std::uint16_t> ids_ ;
+        std::vector<Window> windows_ ;
+        std::vector<std::uint8_t> flags_ ;
+        std::vector<std::uint32_t> index_of_id_ ;
+
+        template <typename Row>
+        static void move_row(std::vector<Row>& rows, std::size_t from, std::size_t to) {
+            auto first = rows.begin() ;
+            auto f = static_cast<std::ptrdiff_t>(from) ;
+            auto t = static_cast<std::ptrdiff_t>(to) ;
+            if(from < to) {
+                std::rotate(first + f, first + f + 1, first + t + 1) ;
+            }
+            else if(to < from) {
+                std::rotate(first + t, first + f, first + f + 1) ;
+            }
+        }
+
+        void reindex(std::size_t first, std::size_t last) {
+            for(auto i = first ; i < last ; i ++) {
+                index_of_id_[ids_[i]] = static_cast<std::uint32_t>(i) ;
+            }
+        }
+
+    public:
+        MenuHotTable()
+        : ids_(),
+          windows_(),
+          flags_(),
+          index_of_id_()
+        {}
+
+        /**
+         * @brief Insert a row before a position.
+         * @param [in] position The index of menu. It must not be greater than the number of rows.
+         * @param [in] id The identifier of menu from 1 to 65535.
+         * @param [in] window The window handle of menu.
+         */
+        void insert(std::size_t position, std::size_t id, Window window) {
+            auto offset = static_cast<std::ptrdiff_t>(position) ;
+            ids_.insert(ids_.begin() + offset, static_cast<std::uint16_t>(id)) ;
+            windows_.insert(windows_.begin() + offset, window) ;
+            flags_.insert(flags_.begin() + offset, 0) ;
+            if(index_of_id_.size() <= ids_[position]) {
+                const std::uint32_t none = npos_ ;
+                index_of_id_.resize(ids_[position] + std::size_t(1), none) ;
+            }
+            reindex(position, ids_.size()) ;
+        }
+
+        /**
+         * @brief Append a row.
+         * @param [in] id The identifier of menu from 1 to 65535.
+         * @param [in] window The window handle of menu.
+         */
+        void push_back(std::size_t id, Window window) {
+            insert(ids_.size(), id, window) ;
+        }
+
+        /**
+         * @brief Remove a row.
+         * @param [in] position The index of menu.
+         */
+        void erase(std::size_t position) {
+            index_of_id_[ids_[position]] = npos_ ;
+            auto offset = static_cast<std::ptrdiff_t>(position) ;
+            ids_.erase(ids_.begin() + offset) ;
+            windows_.erase(windows_.begin() + offset) ;
+            flags_.erase(flags_.begin() + offset) ;
+            reindex(position, ids_.size()) ;
+        }
+
+        /**
+         * @brief Move a row to another position.
+         * @param [in] from The current index of menu.
+         * @param [in] to The new index of menu.
+         * @details Only the rows between the two positions are reindexed.
+         */
+        void move(std::size_t from, std::size_t to) {
+            auto first = (std::min)(from, to) ;
+            auto last = (std::max)(from, to) + 1 ;
+            move_row(ids_, from, to) ;
+            move_row(windows_, from, to) ;
+            move_row(flags_, from, to) ;
+            reindex(first, last) ;
+        }
+
+        /**
+         * @brief Replace all rows at once.
+         * @param [in] ids The identifiers of menus from 1 to 65535 in the display order.
+         * @param [in] windows The window handles of menus in the same order.
+         * @details The flags of the identifiers already in the table are kept, and the new ones have no flag. It runs in O(n) however many rows are changed.
+         */
+        void assign(const std::vector<std::size_t>& ids, const std::vector<Window>& windows) {
+            std::vector<std::uint8_t> flags(ids.size(), 0) ;
+            for(std::size_t i = 0 ; i < ids.size() ; i ++) {
+                std::size_t index ;
+                if(find_by_id(ids[i], index)) {
+                    flags[i] = flags_[index] ;
+                }
+            }
+            for(auto id : ids_) {
+                index_of_id_[id] = npos_ ;
+            }
+            ids_.clear() ;
+            for(auto id : ids) {
+                ids_.push_back(static_cast<std::uint16_t>(id)) ;
+                if(index_of_id_.size() <= id) {
+                    const std::uint32_t none = npos_ ;
+                    index_of_id_.resize(id + 1, none) ;
+                }
+            }
+            windows_ = windows ;
+            flags_ = std::move(flags) ;
+            reindex(0, ids_.size()) ;
+        }
+
+        /**
+         * @brief Remove all rows.
+         */
+        void clear() noexcept {
+            ids_.clear() ;
+            windows_.clear() ;
+            flags_.clear() ;
+            index_of_id_.clear() ;
+        }
+
+        /**
+         * @brief Returns the number of rows.
+         * @return The number of rows.
+         */
+        std::size_t size() const noexcept {
+            return ids_.size() ;
+        }
+
+        /**
+         * @brief Find a menu by identifier in O(1).
+         * @param [in] id The identifier of menu.
+         * @param [out] index The index of menu.
+         * @return Returns true on success, false if there is no such menu.
+         */
+        bool find_by_id(std::size_t id, std::size_t& index) const noexcept {
+            if(id >= index_of_id_.size() || index_of_id_[id] == npos_) {
+                return false ;
+            }
+            index = index_of_id_[id] ;
+            return true ;
+        }
+
+        /**
+         * @brief Find a menu by its window in O(1).
+         * @param [in] id The control identifier of the window, which is given by GetDlgCtrlID.
+         * @param [in] window The window handle.
+         * @param [out] index The index of menu.
+         * @return Returns true on success, false if the window is not a menu.
+         * @details The identifier alone may belong to an unrelated window, so the handle is also compared.
+         */
+        bool find_by_window(std::size_t id, Window window, std::size_t& index) const noexcept {
+            return find_by_id(id, index) && windows_[index] == window ;
+        }
+
+        /**
+         * @brief Refer to the identifier of a menu.
+         * @param [in] index The index of menu.
+         * @return The identifier.
+         */
+        std::size_t id(std::size_t index) const noexcept {
+            return ids_[index] ;
+        }
+
+        /**
+         * @brief Refer to the window handle of a menu.
+         * @param [in] index The index of menu.
+         * @return The window handle.
+         */
+        Window window(std::size_t index) const noexcept {
+            return windows_[index] ;
+        }
+
+        /**
+         * @brief Mark whether a menu has a slider, which takes the left and right keys.
+         * @param [in] index The index of menu.
+         * @param [in] slider True if the menu has a slider.
+         */
+        void set_slider(std::size_t index, bool slider) noexcept {
+            flags_[index] = static_cast<std::uint8_t>(
+                slider ? (flags_[index] | slider_flag_) : (flags_[index] & ~slider_flag_)) ;
+        }
+
+        /**
+         * @brief Check whether a menu has a slider.
+         * @param [in] index The index of menu.
+         * @return Returns true if the menu has a slider, false otherwise.
+         */
+        bool is_slider(std::size_t index) const noexcept {
+            return (flags_[index] & slider_flag_) != 0 ;
+        }
+
+        /**
+         * @brief Mark whether a menu opens a submenu, which keeps the menu window open when clicked.
+         * @param [in] index The index of menu.
+         * @param [in] submenu True if the menu opens a submenu.
+         */
+        void set_submenu(std::size_t index, bool submenu) noexcept {
+            flags_[index] = static_cast<std::uint8_t>(
+                submenu ? (flags_[index] | submenu_flag_) : (flags_[index] & ~submenu_flag_)) ;
+        }
+
+        /**
+         * @brief Check whether a menu opens a submenu.
+         * @param [in] index The index of menu.
+         * @return Returns true if the menu opens a submenu, false otherwise.
+         */
+        bool is_submenu(std::size_t index) const noexcept {
+            return (flags_[index] & submenu_flag_) != 0 ;
+        }
+    } ;
+
+    /**
+     * @brief Class to allocate the identifiers of menus, which WM_COMMAND carries in 16 bits.
+     * @details The released identifiers are reused in the order of release, so the identifier of a removed menu is reused as late as possible and a command already posted for it is unlikely to reach a new menu.
+     */
+    class MenuIdAllocator {
+    private:
+        std::size_t max_id_ ;
+        std::size_t next_id_ ;
+        std::deque<std::uint16_t> free_ ;
+        std::vector<bool> allocated_ ;
+
+    public:
+        /**
+         * @brief Create identifier allocator.
+         * @param [in] max_id The maximum identifier from 1 to 65535.
+         */
+        explicit MenuIdAllocator(std::size_t max_id=0xFFFF)
+        : max_id_((std::min)(max_id, static_cast<std::size_t>(0xFFFF))),
+          next_id_(1),
+          free_(),
+          allocated_(1, false)
+        {}
+
+        /**
+         * @brief Allocate an unused identifier.
+         * @param [out] id The identifier from 1.
+         * @return Returns true on success, false if all identifiers are used.
+         */
+        bool allocate(std::size_t& id) {
+            if(!free_.empty()) {
+                id = free_.front() ;
+                free_.pop_front() ;
+            }
+            else if(next_id_ <= max_id_) {
+                id = next_id_ ++ ;
+                allocated_.push_back(false) ;
+            }
+            else {
+                return false ;
+            }
+            allocated_[id] = true ;
+            return true ;
+        }
+
+        /**
+         * @brief Release an identifier to be reused.
+         * @param [in] id The allocated identifier.
+         * @return Returns true on success, false if the identifier is not allocated.
+         */
+        bool release(std::size_t id) {
+            if(!is_allocated(id)) {
+                return false ;
+            }
+            allocated_[id] = false ;
+            free_.push_back(static_cast<std::uint16_t>(id)) ;
+            return true ;
+        }
+
+        /**
+         * @brief Check whether an identifier is in use.
+         * @param [in] id The identifier.
+         * @return Returns true if the identifier is allocated, false otherwise.
+         */
+        bool is_allocated(std::size_t id) const noexcept {
+            return id < allocated_.size() && allocated_[id] ;
+        }
+
+        /**
+         * @brief Returns the number of identifiers in use.
+         * @return The number of identifiers.
+         */
+        std::size_t size() const noexcept {
+            return next_id_ - 1 - free_.size() ;
+        }
+
+        /**
+         * @brief Release all identifiers.
+         */
+        void clear() {
+            next_id_ = 1 ;
+            free_.clear() ;
+            allocated_.assign(1, false) ;
+        }
+    } ;
+
+    /**
+     * @brief Kinds of operations to turn a sequence into another.
+     */
+    enum class DiffOpType : unsigned char {
+        //! Remove the element at from
+        REMOVE,
+
+        //! Insert the desired element at to
+        INSERT,
+
+        //! Move the element at from to to
+        MOVE
+    } ;
+
+    /**
+     * @brief Operation on the live sequence. The indices are valid when the operations are applied in order.
+     */
+    struct DiffOp {
+        //! The kind of operation
+        DiffOpType type ;
+        //! The current index of the removed or moved element
+        std::size_t from ;
+        //! The new index of the inserted or moved element
+        std::size_t to ;
+        //! The index in the desired sequence of the inserted or moved element
+        std::size_t source ;
+    } ;
+
+    /**
+     * @brief Class to find the operations turning a keyed sequence into the desired one.
+     * @details The elements are matched by key. The matched elements forming the longest increasing subsequence of the desired order stay still, so the number of moves is minimal. The indices of operations are counted with a Fenwick tree over the final order of elements, so a diff runs in O(n log n). The buffers are kept for the next diff.
+     */
+    template <typename Key, typename Hash=std::hash<Key>>
+    class KeyedDiff {
+    private:
+        static constexpr std::size_t npos_ = static_cast<std::size_t>(-1) ;
+
+        // An element is ordered by the live index of the still element or the end it is placed before,
+        // and then by the order of placement, in which the later ones come first.
+        using OrderKey = std::pair<std::size_t, std::size_t> ;
+
+        std::unordered_map<Key, std::size_t, Hash> desired_index_ ;
+        std::size_t desired_size_ ;
+        std::vector<std::size_t> live_of_desired_ ;
+        std::vector<std::size_t> order_ ;  // The desired indices in the live order
+        std::vector<std::size_t> tails_ ;
+        std::vector<std::size_t> previous_ ;
+        std::vector<bool> still_ ;
+        std::vector<OrderKey> placed_key_ ;  // The order key of each desired element after placing it
+        std::vector<OrderKey> keys_ ;  // All order keys, sorted
+        std::vector<std::size_t> tree_ ;  // Fenwick tree of the present elements over keys_
+
+        void mark_longest_increasing() {
+            // Patience sorting keeps the index in order_ of the smallest tail of each length.
+            const std::size_t none = npos_ ;
+            tails_.clear() ;
+            previous_.assign(order_.size(), none) ;
+            for(std::size_t i = 0 ; i < order_.size() ; i ++) {
+                auto itr = std::lower_bound(
+                    tails_.begin(), tails_.end(), order_[i],
+                    [this] (std::size_t tail, std::size_t value) {
+                        return order_[tail] < value ;
+                    }) ;
+                if(itr != tails_.begin()) {
+                    previous_[i] = *(itr - 1) ;
+                }
+                if(itr == tails_.end()) {
+                    tails_.push_back(i) ;
+                }
+                else {
+                    *itr = i ;
+                }
+            }
+            still_.assign(desired_size_, false) ;
+            for(auto i = tails_.empty() ? none : tails_.back() ; i != none ; i = previous_[i]) {
+                still_[order_[i]] = true ;
+            }
+        }
+
+        OrderKey live_key(std::size_t desired) const noexcept {
+            const std::size_t last = npos_ ;
+            return OrderKey(live_of_desired_[desired], last) ;
+        }
+
+        // The key of the element after the desired element, or the end.
+        OrderKey anchor_key(std::size_t desired, std::size_t end) const noexcept {
+            if(desired + 1 >= desired_size_) {
+                const std::size_t last = npos_ ;
+                return OrderKey(end, last) ;
+            }
+            return still_[desired + 1] ? live_key(desired + 1) : placed_key_[desired + 1] ;
+        }
+
+        std::size_t compress(const OrderKey& key) const {
+            return static_cast<std::size_t>(
+                std::lower_bound(keys_.begin(), keys_.end(), key) - keys_.begin()) ;
+        }
+
+        void mark_present(std::size_t index, bool present) noexcept {
+            for(auto i = index + 1 ; i <= tree_.size() ; i += i & (~i + 1)) {
+                if(present) {
+                    tree_[i - 1] ++ ;
+                }
+                else {
+                    tree_[i - 1] -- ;
+                }
+            }
+        }
+
+        // The number of present elements ordered before the key.
+        std::size_t count_before(std::size_t index) const noexcept {
+            std::size_t count = 0 ;
+            for(auto i = index ; i > 0 ; i -= i & (~i + 1)) {
+                count += tree_[i - 1] ;
+            }
+            return count ;
+        }
+
+    public:
+        KeyedDiff()
+        : desired_index_(),
+          desired_size_(0),
+          live_of_desired_(),
+          order_(),
+          tails_(),
+          previous_(),
+          still_(),
+          placed_key_(),
+          keys_(),
+          tree_()
+        {}
+
+        /**
+         * @brief Set the desired sequence.
+         * @param [in] desired The keys of the desired elements.
+         * @return Returns true on success, false if a key is duplicated.
+         */
+        bool set_desired(const std::vector<Key>& desired) {
+            desired_index_.clear() ;
+            desired_index_.reserve(desired.size()) ;
+            for(std::size_t i = 0 ; i < desired.size() ; i ++) {
+                if(!desired_index_.emplace(desired[i], i).second) {
+                    desired_index_.clear() ;
+                    desired_size_ = 0 ;
+                    return false ;
+                }
+            }
+            desired_size_ = desired.size() ;
+            return true ;
+        }
+
+        /**
+         * @brief Find an element of the desired sequence by key.
+         * @param [in] key The key.
+         * @param [out] index The index in the desired sequence.
+         * @return Returns true on success, false if the key is not desired.
+         */
+        bool find(const Key& key, std::size_t& index) const {
+            auto itr = desired_index_.find(key) ;
+            if(itr == desired_index_.end()) {
+                return false ;
+            }
+            index = itr->second ;
+            return true ;
+        }
+
+        /**
+         * @brief Find the live element matched with a desired element by the last diff.
+         * @param [in] desired The index in the desired sequence.
+         * @param [out] live The index in the live sequence.
+         * @return Returns true on success, false if the desired element is inserted.
+         */
+        bool find_live(std::size_t desired, std::size_t& live) const noexcept {
+            if(desired >= live_of_desired_.size() || live_of_desired_[desired] == npos_) {
+                return false ;
+            }
+            live = live_of_desired_[desired] ;
+            return true ;
+        }
+
+        /**
+         * @brief Calculate the operations turning the live sequence into the desired one.
+         * @param [in] live The keys of the live elements. The elements whose keys are not desired or duplicated are removed.
+         * @param [out] ops The removals in descending order of index, followed by the insertions and moves. Each inserted or moved element is placed just before the next desired element, which is already in place, or at the end.
+         */
+        void diff(const std::vector<Key>& live, std::vector<DiffOp>& ops) {
+            const std::size_t none = npos_ ;
+            ops.clear() ;
+
+            // Match the live elements with the desired ones.
+            live_of_desired_.assign(desired_size_, none) ;
+            order_.clear() ;
+            for(std::size_t i = 0 ; i < live.size() ; i ++) {
+                std::size_t desired ;
+                if(find(live[i], desired) && live_of_desired_[desired] == none) {
+                    live_of_desired_[desired] = i ;
+                    order_.push_back(desired) ;
+                }
+            }
+            for(auto i = live.size() ; i > 0 ; i --) {
+                std::size_t desired ;
+                if(!find(live[i - 1], desired) || live_of_desired_[desired] != i - 1) {
+                    ops.push_back(DiffOp{DiffOpType::REMOVE, i - 1, 0, 0}) ;
+                }
+            }
+
+            mark_longest_increasing() ;
+
+            // Each element is placed before its next sibling from the end, whose position is already final,
+            // so the order of all elements is known before any index is counted.
+            placed_key_.assign(desired_size_, OrderKey(none, none)) ;
+            keys_.clear() ;
+            for(auto desired : order_) {
+                keys_.push_back(live_key(desired)) ;
+            }
+            std::size_t placements = 0 ;
+            for(auto desired = desired_size_ ; desired > 0 ; desired --) {
+                auto current = desired - 1 ;
+                if(still_[current]) {
+                    continue ;
+                }
+                placements ++ ;
+                placed_key_[current] = OrderKey(anchor_key(current, live.size()).first, none - placements) ;
+                keys_.push_back(placed_key_[current]) ;
+            }
+            std::sort(keys_.begin(), keys_.end()) ;
+
+            tree_.assign(keys_.size(), 0) ;
+            for(auto desired : order_) {
+                mark_present(compress(live_key(desired)), true) ;
+            }
+            for(auto desired = desired_size_ ; desired > 0 ; desired --) {
+                auto current = desired - 1 ;
+                if(still_[current]) {
+                    continue ;
+                }
+                auto placed = compress(placed_key_[current]) ;
+                if(live_of_desired_[current] == none) {
+                    auto to = count_before(placed) ;
+                    mark_present(placed, true) ;
+                    ops.push_back(DiffOp{DiffOpType::INSERT, 0, to, current}) ;
+                    continue ;
+                }
+                auto origin = compress(live_key(current)) ;
+                auto from = count_before(origin) ;
+                mark_present(origin, false) ;
+                auto to = count_before(placed) ;
+                mark_present(placed, true) ;
+                if(from != to) {
+                    ops.push_back(DiffOp{DiffOpType::MOVE, from, to, current}) ;
+                }
+            }
+        }
+    } ;
+
+    /**
+     * @brief Class to keep keys in the order of recent use and expire the oldest ones.
+     */
+    template <typename Key>
+    class LruSet {
+    private:
+        std::vector<Key> keys_ ;  // The most recent one is the last.
+
+    public:
+        LruSet()
+        : keys_()
+        {}
+
+        /**
+         * @brief Mark a key as used most recently.
+         * @param [in] key The key.
+         * @return Returns true if the key is added, false if it is already contained.
+         */
+        bool touch(const Key& key) {
+            auto itr = std::find(keys_.begin(), keys_.end(), key) ;
+            if(itr == keys_.end()) {
+                keys_.push_back(key) ;
+                return true ;
+            }
+            std::rotate(itr, itr + 1, keys_.end()) ;
+            return false ;
+        }
+
+        /**
+         * @brief Remove a key.
+         * @param [in] key The key.
+         * @return Returns true on success, false if the key is not contained.
+         */
+        bool erase(const Key& key) {
+            auto itr = std::find(keys_.begin(), keys_.end(), key) ;
+            if(itr == keys_.end()) {
+                return false ;
+            }
+            keys_.erase(itr) ;
+            return true ;
+        }
+
+        /**
+         * @brief Check whether a key is contained.
+         * @param [in] key The key.
+         * @return Returns true if the key is contained, false otherwise.
+         */
+        bool contains(const Key& key) const {
+            return std::find(keys_.begin(), keys_.end(), key) != keys_.end() ;
+        }
+
+        /**
+         * @brief Expire the least recently used keys.
+         * @param [in] capacity The number of keys to keep.
+         * @param [in] expire Function called with each expired key from the oldest. It returns false to keep the key, such as a key in use.
+         * @return The number of expired keys.
+         */
+        template <typename Expire>
+        std::size_t trim(std::size_t capacity, Expire expire) {
+            std::size_t count = 0 ;
+            for(std::size_t i = 0 ; i < keys_.size() && keys_.size() > capacity ; ) {
+                if(expire(keys_[i])) {
+                    keys_.erase(keys_.begin() + static_cast<std::ptrdiff_t>(i)) ;
+                    count ++ ;
+                }
+                else {
+                    i ++ ;
+                }
+            }
+            return count ;
+        }
+
+        /**
+         * @brief Refer to the keys from the least recently used.
+         * @return The keys.
+         */
+        const std::vector<Key>& keys() const noexcept {
+            return keys_ ;
+        }
+
+        /**
+         * @brief Returns the number of keys.
+         * @return The number of keys.
+         */
+        std::size_t size() const noexcept {
+            return keys_.size() ;
+        }
+    } ;
+
+    /**
+     * @brief Class to create a resource for each node on first use and release the least recently used ones.
+     * @details Adding a node only reserves an empty entry, so the nodes never used cost no resources. The created resources are kept in LruSet until they are trimmed or released.
+     */
+    template <typename Resource>
+    class LazyCache {
+    private:
+        std::vector<std::unique_ptr<Resource>> resources_ ;
+        LruSet<std::size_t> warm_ ;
+        std::size_t count_created_ ;
+
+    public:
+        LazyCache()
+        : resources_(),
+          warm_(),
+          count_created_(0)
+        {}
+
+        /**
+         * @brief Add a node without creating its resource.
+         * @return The identifier of node.
+         */
+        std::size_t add() {
+            resources_.emplace_back() ;
+            return resources_.size() - 1 ;
+        }
+
+        /**
+         * @brief Refer to the resource of a node.
+         * @param [in] node The identifier of node.
+         * @return The pointer to the resource, or nullptr if it is not created.
+         */
+        Resource* find(std::size_t node) const noexcept {
+            return node < resources_.size() ? resources_[node].get() : nullptr ;
+        }
+
+        /**
+         * @brief Get the resource of a node, creating it if necessary.
+         * @param [in] node The identifier of node.
+         * @param [in] create Function to create the resource. It takes std::unique_ptr<Resource>& to store the resource and returns false on failure.
+         * @return The pointer to the resource, or nullptr on failure.
+         */
+        template <typename Create>
+        Resource* get(std::size_t node, Create create) {
+            if(node >= resources_.size()) {
+                return nullptr ;
+            }
+            if(!resources_[node]) {
+                std::unique_ptr<Resource> resource ;
+                if(!create(resource) || !resource) {
+                    return nullptr ;
+                }
+                resources_[node] = std::move(resource) ;
+                count_created_ ++ ;
+            }
+            warm_.touch(node) ;
+            return resources_[node].get() ;
+        }
+
+        /**
+         * @brief Release the resource of a node.
+         * @param [in] node The identifier of node.
+         * @param [in] destroy Function called with the resource before it is deleted.
+         */
+        template <typename Destroy>
+        void release(std::size_t node, Destroy destroy) {
+            if(auto resource = find(node)) {
+                destroy(*resource) ;
+                resources_[node].reset() ;
+            }
+            warm_.erase(node) ;
+        }
+
+        /**
+         * @brief Release the least recently used resources.
+         * @param [in] keep The number of resources to keep.
+         * @param [in] destroy Function called with the node and its resource before it is deleted. It returns false to keep the resource, such as one in use.
+         * @return The number of released resources.
+         */
+        template <typename Destroy>
+        std::size_t trim(std::size_t keep, Destroy destroy) {
+            return warm_.trim(keep, [this, &destroy] (std::size_t node) {
+                if(!destroy(node, *resources_[node])) {
+                    return false ;
+                }
+                resources_[node].reset() ;
+                return true ;
+            }) ;
+        }
+
+        /**
+         * @brief Refer to the nodes with resources from the least recently used.
+         * @return The identifiers of nodes.
+         */
+        const std::vector<std::size_t>& keys() const noexcept {
+            return warm_.keys() ;
+        }
+
+        /**
+         * @brief Returns the number of nodes.
+         * @return The number of nodes.
+         */
+        std::size_t size() const noexcept {
+            return resources_.size() ;
+        }
+
+        /**
+         * @brief Returns the number of existing resources.
+         * @return The number of resources.
+         */
+        std::size_t count_live() const noexcept {
+            return warm_.size() ;
+        }
+
+        /**
+         * @brief Returns the number of resources created so far.
+         * @return The number of creations including the released ones.
+         */
+        std::size_t count_created() const noexcept {
+            return count_created_ ;
+        }
+    } ;
+
+    /**
+     * @brief Class to track the chain of open submenus and the selected item in each of them.
+     * @details Level 0 is the submenu opened from the menu window. Opening a submenu at a level closes the submenus at and below the level first.
+     */
+    class CascadeState {
+    private:
+        std::vector<std::size_t> path_ ;
+        std::vector<int> selections_ ;
+
+    public:
+        CascadeState()
+        : path_(),
+          selections_()
+        {}
+
+        /**
+         * @brief Returns the number of open submenus.
+         * @return The depth of the chain.
+         */
+        std::size_t depth() const noexcept {
+            return path_.size() ;
+        }
+
+        /**
+         * @brief Refer to the open submenu at a level.
+         * @param [in] level The level less than depth().
+         * @return The identifier of submenu.
+         */
+        std::size_t node_at(std::size_t level) const noexcept {
+            return path_[level] ;
+        }
+
+        /**
+         * @brief Find the level of an open submenu.
+         * @param [in] node The identifier of submenu.
+         * @param [out] level The level.
+         * @return Returns true if the submenu is open, false otherwise.
+         */
+        bool find_level(std::size_t node, std::size_t& level) const noexcept {
+            auto itr = std::find(path_.begin(), path_.end(), node) ;
+            if(itr == path_.end()) {
+                return false ;
+            }
+            level = static_cast<std::size_t>(itr - path_.begin()) ;
+            return true ;
+        }
+
+        /**
+         * @brief Check whether a submenu is open.
+         * @param [in] node The identifier of submenu.
+         * @return Returns true if the submenu is open, false otherwise.
+         */
+        bool is_open(std::size_t node) const noexcept {
+            std::size_t level ;
+            return find_level(node, level) ;
+        }
+
+        /**
+         * @brief Open a submenu at a level without selection.
+         * @param [in] level The level, which must not be greater than depth().
+         * @param [in] node The identifier of submenu.
+         * @param [in] close Function called with each closed submenu and its selected item from the deepest.
+         * @return Returns true on success, false if it fails to close.
+         */
+        template <typename Close>
+        bool open(std::size_t level, std::size_t node, Close close) {
+            if(!close_from(level, close)) {
+                return false ;
+            }
+            path_.push_back(node) ;
+            selections_.push_back(-1) ;
+            return true ;
+        }
+
+        /**
+         * @brief Close the submenus at and below a level.
+         * @param [in] level The shallowest level to close.
+         * @param [in] close Function called with each closed submenu and its selected item from the deepest. It returns true on success.
+         * @return Returns true on success, false if close fails.
+         */
+        template <typename Close>
+        bool close_from(std::size_t level, Close close) {
+            while(path_.size() > level) {
+                auto node = path_.back() ;
+                auto selection = selections_.back() ;
+                path_.pop_back() ;
+                selections_.pop_back() ;
+                if(!close(node, selection)) {
+                    return false ;
+                }
+            }
+            return true ;
+        }
+
+        /**
+         * @brief Refer to the selected item of an open submenu.
+         * @param [in] level The level less than depth().
+         * @return The index of item, or -1 if nothing is selected.
+         */
+        int selection(std::size_t level) const noexcept {
+            return selections_[level] ;
+        }
+
+        /**
+         * @brief Select an item of an open submenu.
+         * @param [in] level The level less than depth().
+         * @param [in] index The index of item, or -1 to clear the selection.
+         * @return The previously selected index.
+         */
+        int select(std::size_t level, int index) noexcept {
+            auto previous = selections_[level] ;
+            selections_[level] = index ;
+            return previous ;
+        }
+
+        /**
+         * @brief Move the selection of the deepest submenu to the next or previous item with wrap-around.
+         * @param [in] count The number of items in the submenu.
+         * @param [in] forward True to select the next item.
+         * @return The previously selected index.
+         */
+        int step(std::size_t count, bool forward) noexcept {
+            if(path_.empty() || count == 0) {
+                return -1 ;
+            }
+            auto n = static_cast<int>(count) ;
+            auto current = selections_.back() ;
+            int next ;
+            if(current < 0) {
+                next = forward ? 0 : n - 1 ;
+            }
+            else {
+                next = ((current + (forward ? 1 : -1)) % n + n) % n ;  // to be positive
+            }
+            return select(path_.size() - 1, next) ;
+        }
+    } ;
+
+    /**
+     * @brief Class to hold a boolean state per menu in packed bits and find the changed menus.
+     * @details The state to be shown and the state already applied are kept in 64-bit words. The words touched by set() are recorded, so flush() visits only them and finds the changed bits by XOR, which costs O(changed items) instead of O(all items).
+     */
+    class StateBits {
+    private:
+        static constexpr std::size_t word_bits_ = 64 ;
+
+        std::size_t size_ ;
+        std::vector<std::uint64_t> current_ ;
+        std::vector<std::uint64_t> applied_ ;
+        std::vector<std::uint64_t> dirty_ ;  // One bit per word of current_
+        std::vector<std::size_t> dirty_words_ ;
+
+        static std::uint64_t bit_of(std::size_t index) noexcept {
+            return static_cast<std::uint64_t>(1) << (index % word_bits_) ;
+        }
+
+    public:
+        /**
+         * @brief Create state bits.
+         * @param [in] size The number of menus. All states are false.
+         */
+        explicit StateBits(std::size_t size=0)
+        : size_(0),
+          current_(),
+          applied_(),
+          dirty_(),
+          dirty_words_()
+        {
+            resize(size) ;
+        }
+
+        /**
+         * @brief Change the number of menus. The added states are false and the removed states are discarded.
+         * @param [in] size The number of menus.
+         */
+        void resize(std::size_t size) {
+            auto words = (size + word_bits_ - 1) / word_bits_ ;
+            current_.resize(words, 0) ;
+            applied_.resize(words, 0) ;
+            dirty_.resize((words + word_bits_ - 1) / word_bits_, 0) ;
+            if(size < size_ && size % word_bits_ != 0) {
+                // Clear the bits beyond the size in the last word.
+                auto mask = bit_of(size) - 1 ;
+                current_.back() &= mask ;
+                applied_.back() &= mask ;
+            }
+            dirty_words_.erase(
+                std::remove_if(
+                    dirty_words_.begin(), dirty_words_.end(),
+                    [words] (std::size_t word) {return word >= words ;}),
+                dirty_words_.end()) ;
+            for(auto w = words ; w < dirty_.size() * word_bits_ ; w ++) {
+                dirty_[w / word_bits_] &= ~bit_of(w) ;
+            }
+            size_ = size ;
+        }
+
+        /**
+         * @brief Append a menu whose state is false.
+         */
+        void push_back() {
+            resize(size_ + 1) ;
+        }
+
+        /**
+         * @brief Remove all states.
+         */
+        void clear() noexcept {
+            size_ = 0 ;
+            current_.clear() ;
+            applied_.clear() ;
+            dirty_.clear() ;
+            dirty_words_.clear() ;
+        }
+
+        /**
+         * @brief Returns the number of menus.
+         * @return The number of menus.
+         */
+        std::size_t size() const noexcept {
+            return size_ ;
+        }
+
+        /**
+         * @brief Refer to the state to be shown.
+         * @param [in] index The index of menu.
+         * @return The state.
+         */
+        bool test(std::size_t index) const noexcept {
+            return (current_[index / word_bits_] & bit_of(index)) != 0 ;
+        }
+
+        /**
+         * @brief Change the state to be shown. It is applied by flush().
+         * @param [in] index The index of menu.
+         * @param [in] value The new state.
+         */
+        void set(std::size_t index, bool value) {
+            auto word = index / word_bits_ ;
+            if(value) {
+                current_[word] |= bit_of(index) ;
+            }
+            else {
+                current_[word] &= ~bit_of(index) ;
+            }
+            if(!(dirty_[word / word_bits_] & bit_of(word))) {
+                dirty_[word / word_bits_] |= bit_of(word) ;
+                dirty_words_.push_back(word) ;
+            }
+        }
+
+        /**
+         * @brief Change the state to be shown together with the applied state, for a state already shown by other means.
+         * @param [in] index The index of menu.
+         * @param [in] value The state.
+         */
+        void assign(std::size_t index, bool value) noexcept {
+            auto word = index / word_bits_ ;
+            if(value) {
+                current_[word] |= bit_of(index) ;
+                applied_[word] |= bit_of(index) ;
+            }
+            else {
+                current_[word] &= ~bit_of(index) ;
+                applied_[word] &= ~bit_of(index) ;
+            }
+        }
+
+        /**
+         * @brief Check whether any state may be different from the applied state.
+         * @return Returns true if flush() has something to visit.
+         */
+        bool is_dirty() const noexcept {
+            return !dirty_words_.empty() ;
+        }
+
+        /**
+         * @brief Returns the number of words to be visited by flush().
+         * @return The number of words.
+         */
+        std::size_t count_dirty_words() const noexcept {
+            return dirty_words_.size() ;
+        }
+
+        /**
+         * @brief Apply the changed states.
+         * @param [in] apply Function called with the index of menu and its new state for each changed state. It returns true on success.
+         * @return Returns true on success, false if apply fails. The states not applied are visited again by the next flush.
+         */
+        template <typename Apply>
+        bool flush(Apply apply) {
+            while(!dirty_words_.empty()) {
+                auto word = dirty_words_.back() ;
+                auto diff = current_[word] ^ applied_[word] ;
+                while(diff) {
+                    auto bit = util::count_trailing_zeros(diff) ;
+                    auto index = word * word_bits_ + static_cast<std::size_t>(bit) ;
+                    if(!apply(index, test(index))) {
+                        return false ;
+                    }
+                    applied_[word] ^= bit_of(index) ;
+                    diff &= diff - 1 ;
+                }
+                dirty_[word / word_bits_] &= ~bit_of(word) ;
+                dirty_words_.pop_back() ;
+            }
+            return true ;
+        }
+    } ;
+
+    /**
+     * @brief Class to defer layout and repaint until the outermost transaction ends.
+     * @details The transactions can be nested. Any number of deferred requests are merged into a single commit.
+     */
+    class UpdateBatch {
+    private:
+        std::size_t depth_ ;
+        bool layout_ ;
+        bool repaint_ ;
+        std::size_t count_deferred_ ;
+        std::size_t count_commits_ ;
+
+    public:
+        UpdateBatch()
+        : depth_(0),
+          layout_(false),
+          repaint_(false),
+          count_deferred_(0),
+          count_commits_(0)
+        {}
+
+        /**
+         * @brief Begin a transaction.
+         */
+        void begin() noexcept {
+            depth_ ++ ;
+        }
+
+        /**
+         * @brief End a transaction.
+         * @return Returns true if the outermost transaction is ended, false otherwise.
+         */
+        bool end() noexcept {
+            if(depth_ == 0) {
+                return false ;
+            }
+            depth_ -- ;
+            return depth_ == 0 ;
+        }
+
+        /**
+         * @brief Check whether a transaction is in progress.
+         * @return Returns true if the updates should be deferred.
+         */
+        bool is_open() const noexcept {
+            return depth_ > 0 ;
+        }
+
+        /**
+         * @brief Defer measuring and arranging menus, which is followed by a repaint.
+         */
+        void defer_layout() noexcept {
+            layout_ = true ;
+            repaint_ = true ;
+            count_deferred_ ++ ;
+        }
+
+        /**
+         * @brief Defer repainting menus.
+         */
+        void defer_repaint() noexcept {
+            repaint_ = true ;
+            count_deferred_ ++ ;
+        }
+
+        /**
+         * @brief Run the deferred work once.
+         * @param [in] commit Function called with whether a layout is required and whether a repaint is required. It returns true on success.
+         * @return Returns true on success or if there is nothing to do, false if commit fails.
+         */
+        template <typename Commit>
+        bool commit(Commit commit) {
+            if(!layout_ && !repaint_) {
+                return true ;
+            }
+            auto layout = layout_ ;
+            auto repaint = repaint_ ;
+            layout_ = false ;
+            repaint_ = false ;
+            count_commits_ ++ ;
+            return commit(layout, repaint) ;
+        }
+
+        /**
+         * @brief Get the number of deferred requests.
+         * @return The number of requests.
+         */
+        std::size_t count_deferred() const noexcept {
+            return count_deferred_ ;
+        }
+
+        /**
+         * @brief Get the number of commits.
+         * @return The number of commits which did some work.
+         */
+        std::size_t count_commits() const noexcept {
+            return count_commits_ ;
+        }
+    } ;
+
+    /**
+     * @brief Class to map a bounded value to the geometry of a bar.
+     * @details The positions are relative to the left edge of the bar, so it can be used for any drawing backend.
+     */
+    class ValueBar {
+    private:
+        int minimum_ ;
+        int maximum_ ;
+        int value_ ;
+        int step_ ;
+
+    public:
+        /**
+         * @brief Create value bar.
+         * @param [in] minimum The minimum value.
+         * @param [in] maximum The maximum value.
+         * @param [in] value The initial value.
+         * @param [in] step The increment used for the keyboard and snapping.
+         */
+        explicit ValueBar(
+            int minimum=0,
+            int maximum=100,
+            int value=0,
+            int step=1)
+        : minimum_(minimum),
+          maximum_((std::max)(minimum, maximum)),
+          value_(minimum),
+          step_((std::max)(step, 1))
+        {
+            set_value(value) ;
+        }
+
+        /**
+         * @brief Set the value clamped into the range.
+         * @param [in] value The new value.
+         * @return Returns true if the value is changed, false otherwise.
+         */
+        bool set_value(int value) noexcept {
+            auto clamped = (std::min)((std::max)(value, minimum_), maximum_) ;
+            if(clamped == value_) {
+                return false ;
+            }
+            value_ = clamped ;
+            return true ;
+        }
+
+        /**
+         * @brief Refer to the current value.
+         * @return The value.
+         */
+        int value() const noexcept {
+            return value_ ;
+        }
+
+        /**
+         * @brief Refer to the minimum value.
+         * @return The minimum value.
+         */
+        int minimum() const noexcept {
+            return minimum_ ;
+        }
+
+        /**
+         * @brief Refer to the maximum value.
+         * @return The maximum value.
+         */
+        int maximum() const noexcept {
+            return maximum_ ;
+        }
+
+        /**
+         * @brief Refer to the step of value.
+         * @return The step.
+         */
+        int step() const noexcept {
+            return step_ ;
+        }
+
+        /**
+         * @brief Convert a value to the filled length of the bar.
+         * @param [in] value The value.
+         * @param [in] width The width of the bar in pixels.
+         * @return The filled length in pixels, rounded to the nearest pixel.
+         */
+        int to_pixels(int value, int width) const noexcept {
+            if(maximum_ == minimum_ || width <= 0) {
+                return 0 ;
+            }
+            auto clamped = (std::min)((std::max)(value, minimum_), maximum_) ;
+            auto range = static_cast<long long>(maximum_) - minimum_ ;
+            auto offset = static_cast<long long>(clamped) - minimum_ ;
+            return static_cast<int>((offset * width + range / 2) / range) ;
+        }
+
+        /**
+         * @brief Convert the current value to the filled length of the bar.
+         * @param [in] width The width of the bar in pixels.
+         * @return The filled length in pixels.
+         */
+        int to_pixels(int width) const noexcept {
+            return to_pixels(value_, width) ;
+        }
+
+        /**
+         * @brief Convert a position on the bar to the value snapped to the step.
+         * @param [in] x The position relative to the left edge of the bar.
+         * @param [in] width The width of the bar in pixels.
+         * @return The value.
+         */
+        int from_pixels(int x, int width) const noexcept {
+            if(width <= 0) {
+                return minimum_ ;
+            }
+            auto pos = static_cast<long long>((std::min)((std::max)(x, 0), width)) ;
+            auto range = static_cast<long long>(maximum_) - minimum_ ;
+            auto offset = (pos * range + width / 2) / width ;
+            offset = (offset + step_ / 2) / step_ * step_ ;
+            return static_cast<int>((std::min)(minimum_ + offset, static_cast<long long>(maximum_))) ;
+        }
+
+        /**
+         * @brief Calculate the span of the bar to be redrawn when the value is changed.
+         * @param [in] old_value The value before the change.
+         * @param [in] new_value The value after the change.
+         * @param [in] width The width of the bar in pixels.
+         * @param [in] thumb_width The width of the thumb centered on the filled edge, or zero for a progress bar.
+         * @param [out] left The left edge of the span relative to the bar.
+         * @param [out] right The right edge of the span relative to the bar.
+         * @return Returns true if there is a span to be redrawn, false otherwise.
+         */
+        bool calculate_dirty_span(
+                int old_value,
+                int new_value,
+                int width,
+                int thumb_width,
+                int& left,
+                int& right) const noexcept {
+            auto old_fill = to_pixels(old_value, width) ;
+            auto new_fill = to_pixels(new_value, width) ;
+            if(old_fill == new_fill) {
+                return false ;
+            }
+            auto half_thumb = (thumb_width + 1) / 2 ;
+            left = (std::max)((std::min)(old_fill, new_fill) - half_thumb, 0) ;
+            right = (std::min)((std::max)(old_fill, new_fill) + half_thumb, width) ;
+            return left < right ;
+        }
+    } ;
+
+    /**
+     * @brief Class to schedule the frames of an animated icon.
+     * @details The frames advance according to the elapsed time, and the update rate is capped to the maximum rate. The animation pauses while the session is locked or the display is off. All methods take the current time so that the state can be driven by any clock.
+     */
+    class FrameScheduler {
+    public:
+        using time_point = std::chrono::steady_clock::time_point ;
+
+    private:
+        std::size_t frame_count_ ;
+        std::size_t frame_ ;
+        std::chrono::milliseconds frame_interval_ ;
+        unsigned int max_rate_ ;
+
+        bool running_ ;
+        bool session_locked_ ;
+        bool display_off_ ;
+        time_point last_update_ ;
+
+        std::size_t count_updates_ ;
+
+    public:
+        /**
+         * @brief Create frame scheduler.
+         * @param [in] max_rate The maximum number of frame updates per second.
+         */
+        explicit FrameScheduler(unsigned int max_rate=20)
+        : frame_count_(0),
+          frame_(0),
+          frame_interval_(100),
+          max_rate_(max_rate),
+          running_(false),
+          session_locked_(false),
+          display_off_(false),
+          last_update_(),
+          count_updates_(0)
+        {}
+
+        /**
+         * @brief Start an animation from the first frame.
+         * @param [in] frame_count The number of frames.
+         * @param [in] frame_interval The interval between frames.
+         * @param [in] now The current time.
+         */
+        void start(
+                std::size_t frame_count,
+                std::chrono::milliseconds frame_interval,
+                time_point now) noexcept {
+            frame_count_ = frame_count ;
+            frame_interval_ = (std::max)(frame_interval, std::chrono::milliseconds(1)) ;
+            frame_ = 0 ;
+            last_update_ = now ;
+            running_ = frame_count > 0 ;
+        }
+
+        /**
+         * @brief Stop the animation.
+         */
+        void stop() noexcept {
+            running_ = false ;
+        }
+
+        /**
+         * @brief Set the maximum update rate.
+         * @param [in] max_rate The maximum number of frame updates per second. Zero means no limit.
+         */
+        void set_max_rate(unsigned int max_rate) noexcept {
+            max_rate_ = max_rate ;
+        }
+
+        /**
+         * @brief Notify whether the session is locked.
+         * @param [in] locked True if locked.
+         * @param [in] now The current time.
+         */
+        void set_session_locked(bool locked, time_point now) noexcept {
+            update_pause(locked, display_off_, now) ;
+        }
+
+        /**
+         * @brief Notify whether the display is off.
+         * @param [in] off True if the display is off.
+         * @param [in] now The current time.
+         */
+        void set_display_off(bool off, time_point now) noexcept {
+            update_pause(session_locked_, off, now) ;
+        }
+
+        /**
+         * @brief Check if the animation is started.
+         * @return Returns true if started, false otherwise.
+         */
+        bool is_running() const noexcept {
+            return running_ ;
+        }
+
+        /**
+         * @brief Check if the animation is paused by the session or display state.
+         * @return Returns true if paused, false otherwise.
+         */
+        bool is_paused() const noexcept {
+            return session_locked_ || display_off_ ;
+        }
+
+        /**
+         * @brief Check if the frames should be updated.
+         * @return Returns true if running and not paused.
+         */
+        bool is_active() const noexcept {
+            return running_ && !is_paused() ;
+        }
+
+        /**
+         * @brief Calculate the interval between updates capped by the maximum rate.
+         * @return The interval.
+         */
+        std::chrono::milliseconds update_interval() const noexcept {
+            if(max_rate_ == 0) {
+                return frame_interval_ ;
+            }
+            auto min_interval = std::chrono::milliseconds((1000 + max_rate_ - 1) / max_rate_) ;
+            return (std::max)(frame_interval_, min_interval) ;
+        }
+
+        /**
+         * @brief Advance the frame if it is time to update.
+         * @param [in] now The current time.
+         * @param [out] frame The index of frame to be shown.
+         * @return Returns true if the frame should be updated, false otherwise.
+         * @details If several frame intervals have elapsed, the frames in between are skipped.
+         */
+        bool tick(time_point now, std::size_t& frame) noexcept {
+            if(!is_active()) {
+                return false ;
+            }
+            auto elapsed = now - last_update_ ;
+            if(elapsed < update_interval()) {
+                return false ;
+            }
+
+            auto steps = static_cast<std::size_t>(elapsed / frame_interval_) ;
+            frame_ = (frame_ + steps) % frame_count_ ;
+            last_update_ += frame_interval_ * static_cast<long long>(steps) ;
+            count_updates_ ++ ;
+            frame = frame_ ;
+            return true ;
+        }
+
+        /**
+         * @brief Refer to the index of current frame.
+         * @return The index.
+         */
+        std::size_t frame() const noexcept {
+            return frame_ ;
+        }
+
+        /**
+         * @brief Returns the number of frame updates.
+         * @return The number of updates.
+         */
+        std::size_t count_updates() const noexcept {
+            return count_updates_ ;
+        }
+
+    private:
+        void update_pause(bool locked, bool off, time_point now) noexcept {
+            auto was_paused = is_paused() ;
+            session_locked_ = locked ;
+            display_off_ = off ;
+            if(was_paused && !is_paused()) {
+                // Do not catch up the frames while paused.
+                last_update_ = now ;
+            }
+        }
+    } ;
+
+    /**
+     * @brief Class to compose a count or a dot badge onto icon pixels.
+     * @details The digits are rendered from a 3x5 bitmap font. The scaled glyphs are generated only once per scale and cached. The pixels are 32-bit values in 0xAARRGGBB format.
+     */
+    class BadgeRenderer {
+    private:
+        std::uint32_t back_color_ ;
+        std::uint32_t text_color_ ;
+
+        // glyph_cache_[scale - 1][glyph] is the alpha mask of the scaled glyph.
+        std::vector<std::vector<std::vector<std::uint8_t>>> glyph_cache_ ;
+
+        static constexpr int glyph_width_ = 3 ;
+        static constexpr int glyph_height_ = 5 ;
+        static constexpr int glyph_count_ = 11 ;  // '0' - '9' and '+'
+
+    public:
+        /**
+         * @brief Create badge renderer.
+         * @param [in] back_color The color of badge in 0xAARRGGBB format.
+         * @param [in] text_color The color of digits in 0xAARRGGBB format.
+         */
+        explicit BadgeRenderer(
+            std::uint32_t back_color=0xFFC42B1C,
+            std::uint32_t text_color=0xFFFFFFFF)
+        : back_color_(back_color),
+          text_color_(text_color),
+          glyph_cache_()
+        {}
+
+        /**
+         * @brief Set the colors of badge.
+         * @param [in] back_color The color of badge in 0xAARRGGBB format.
+         * @param [in] text_color The color of digits in 0xAARRGGBB format.
+         */
+        void set_colors(std::uint32_t back_color, std::uint32_t text_color) noexcept {
+            back_color_ = back_color ;
+            text_color_ = text_color ;
+        }
+
+        /**
+         * @brief Format the count as shown on the badge.
+         * @param [in] count The count.
+         * @return "1" to "9", "9+" for larger counts, or an empty string if the count is not positive.
+         */
+        static std::string format_count(int count) {
+            if(count <= 0) {
+                return std::string() ;
+            }
+            if(count > 9) {
+                return std::string("9+") ;
+            }
+            return std::string(1, static_cast<char>('0' + count)) ;
+        }
+
+        /**
+         * @brief Compose a count badge at the bottom-right corner.
+         * @param [in] base The pixels of base icon.
+         * @param [in] width The width of icon.
+         * @param [in] height The height of icon.
+         * @param [in] count The count. If it is not positive, the base is copied as-is.
+         * @param [out] out The composed pixels. It is resized to width * height.
+         */
+        void compose_count(
+                const std::uint32_t* base,
+                int width,
+                int height,
+                int count,
+                std::vector<std::uint32_t>& out) {
+            out.assign(base, base + static_cast<std::size_t>(width) * height) ;
+            auto text = format_count(count) ;
+            if(text.empty()) {
+                return ;
+            }
+
+            auto scale = calculate_scale(width, height) ;
+            auto text_width = static_cast<int>(text.length()) * (glyph_width_ + 1) * scale - scale ;
+            auto badge_height = (glyph_height_ + 2) * scale ;
+            auto badge_width = (std::min)(
+                (std::max)(badge_height, text_width + 4 * scale), width) ;
+
+            auto left = width - badge_width ;
+            auto top = height - badge_height ;
+            fill_pill(out.data(), width, height, left, top, badge_width, badge_height) ;
+
+            auto x = left + (badge_width - text_width) / 2 ;
+            auto y = top + scale ;
+            for(auto c : text) {
+                draw_glyph(out.data(), width, height, glyph_index(c), scale, x, y) ;
+                x += (glyph_width_ + 1) * scale ;
+            }
+        }
+
+        /**
+         * @brief Compose a dot badge at the bottom-right corner.
+         * @param [in] base The pixels of base icon.
+         * @param [in] width The width of icon.
+         * @param [in] height The height of icon.
+         * @param [out] out The composed pixels. It is resized to width * height.
+         */
+        void compose_dot(
+                const std::uint32_t* base,
+                int width,
+                int height,
+                std::vector<std::uint32_t>& out) {
+            out.assign(base, base + static_cast<std::size_t>(width) * height) ;
+            auto diameter = (std::max)(4, 3 * (std::min)(width, height) / 8) ;
+            fill_pill(
+                out.data(), width, height,
+                width - diameter, height - diameter, diameter, diameter) ;
+        }
+
+        /**
+         * @brief Refer to the alpha mask of a cached glyph.
+         * @param [in] c The character '0' - '9' or '+'.
+         * @param [in] scale The integer scale of glyph.
+         * @return The mask of (3 * scale) x (5 * scale) pixels.
+         */
+        const std::vector<std::uint8_t>& glyph(char c, int scale) {
+            return cached_glyphs(scale)[glyph_index(c)] ;
+        }
+
+        /**
+         * @brief Returns the number of scales whose glyphs are cached.
+         * @return The number of cached scales.
+         */
+        std::size_t count_cached_scales() const noexcept {
+            std::size_t n = 0 ;
+            for(const auto& glyphs : glyph_cache_) {
+                if(!glyphs.empty()) {
+                    n ++ ;
+                }
+            }
+            return n ;
+        }
+
+        /**
+         * @brief Calculate the scale of glyph for the icon size.
+         * @param [in] width The width of icon.
+         * @param [in] height The height of icon.
+         * @return The integer scale. One for a 16x16 icon.
+         */
+        static int calculate_scale(int width, int height) noexcept {
+            return (std::max)(1, (std::min)(width, height) / 16) ;
+        }
+
+    private:
+        static int glyph_index(char c) noexcept {
+            if(c >= '0' && c <= '9') {
+                return c - '0' ;
+            }
+            return 10 ;
+        }
+
+        const std::vector<std::vector<std::uint8_t>>& cached_glyphs(int scale) {
+            // Each row of the 3x5 font is three bits from the most significant bit.
+            static const unsigned short font[glyph_count_] = {
+                0x7B6F, 0x2C97, 0x73E7, 0x73CF, 0x5BC9,
+                0x79CF, 0x79EF, 0x7252, 0x7BEF, 0x7BCF, 0x05D0} ;
+
+            if(glyph_cache_.size() < static_cast<std::size_t>(scale)) {
+                glyph_cache_.resize(scale) ;
+            }
+            auto& glyphs = glyph_cache_[scale - 1] ;
+            if(!glyphs.empty()) {
+                return glyphs ;
+            }
+
+            auto w = glyph_width_ * scale ;
+            auto h = glyph_height_ * scale ;
+            glyphs.resize(glyph_count_) ;
+            for(int g = 0 ; g < glyph_count_ ; g ++) {
+                auto& mask = glyphs[g] ;
+                mask.resize(static_cast<std::size_t>(w) * h) ;
+                for(int y = 0 ; y < h ; y ++) {
+                    for(int x = 0 ; x < w ; x ++) {
+                        auto bit = 14 - ((y / scale) * glyph_width_ + (x / scale)) ;
+                        mask[y * w + x] = (font[g] >> bit) & 1 ? 255 : 0 ;
+                    }
+                }
+            }
+            return glyphs ;
+        }
+
+        void draw_glyph(
+                std::uint32_t* pixels, int width, int height,
+                int index, int scale, int left, int top) {
+            const auto& mask = cached_glyphs(scale)[index] ;
+            auto w = glyph_width_ * scale ;
+            auto h = glyph_height_ * scale ;
+            for(int y = 0 ; y < h ; y ++) {
+                for(int x = 0 ; x < w ; x ++) {
+                    auto px = left + x ;
+                    auto py = top + y ;
+                    if(mask[y * w + x] && px >= 0 && px < width && py >= 0 && py < height) {
+                        pixels[py * width + px] = text_color_ ;
+                    }
+                }
+            }
+        }
+
+        void fill_pill(
+                std::uint32_t* pixels, int width, int height,
+                int left, int top, int pill_width, int pill_height) const {
+            // Compare in doubled coordinates to test the centers of pixels.
+            auto radius2 = pill_height ;
+            auto cy2 = 2 * top + pill_height ;
+            auto cx2_left = 2 * left + pill_height ;
+            auto cx2_right = 2 * (left + pill_width) - pill_height ;
+            for(int y = (std::max)(top, 0) ; y < (std::min)(top + pill_height, height) ; y ++) {
+                for(int x = (std::max)(left, 0) ; x < (std::min)(left + pill_width, width) ; x ++) {
+                    auto px2 = 2 * x + 1 ;
+                    auto py2 = 2 * y + 1 ;
+                    auto cx2 = (std::min)((std::max)(px2, cx2_left), cx2_right) ;
+                    auto dx = px2 - cx2 ;
+                    auto dy = py2 - cy2 ;
+                    if(dx * dx + dy * dy <= radius2 * radius2) {
+                        pixels[y * width + x] = back_color_ ;
+                    }
+                }
+            }
+        }
+    } ;
+
+    /**
+     * @brief Roles of the theme colors.
+     */
+    enum class ThemeColor : unsigned char
+    {
+        TEXT,
+        BACK,
+        BORDER,
+    } ;
+
+    /**
+     * @brief Class to track whether the colors derived from the system theme are up to date.
+     * @details The colors are recomputed only after the system reports a theme or colorization change. A color set by the user is pinned and never recomputed. Several invalidations before the next refresh are coalesced into one.
+     */
+    class ThemeCache {
+    private:
+        unsigned char pinned_ ;
+        bool stale_ ;
+        std::size_t generation_ ;
+        std::size_t count_invalidations_ ;
+
+        static unsigned char to_bit(ThemeColor role) noexcept {
+            return static_cast<unsigned char>(1u << static_cast<unsigned int>(role)) ;
+        }
+
+    public:
+        /**
+         * @brief Create theme cache. The cache is stale until the first refresh.
+         */
+        ThemeCache() noexcept
+        : pinned_(0),
+          stale_(true),
+          generation_(0),
+          count_invalidations_(0)
+        {}
+
+        /**
+         * @brief Pin the color set by the user.
+         * @param [in] role The role of color.
+         */
+        void pin(ThemeColor role) noexcept {
+            pinned_ = static_cast<unsigned char>(pinned_ | to_bit(role)) ;
+        }
+
+        /**
+         * @brief Check if the color is set by the user.
+         * @param [in] role The role of color.
+         * @return Returns true if pinned, false if it is determined from the theme.
+         */
+        bool is_pinned(ThemeColor role) const noexcept {
+            return (pinned_ & to_bit(role)) != 0 ;
+        }
+
+        /**
+         * @brief Mark the cached colors as stale.
+         */
+        void invalidate() noexcept {
+            stale_ = true ;
+            count_invalidations_ ++ ;
+        }
+
+        /**
+         * @brief Check if the colors must be recomputed.
+         * @return Returns true if stale, false otherwise.
+         */
+        bool is_stale() const noexcept {
+            return stale_ ;
+        }
+
+        /**
+         * @brief Mark the colors as recomputed and the menus as restyled.
+         */
+        void validate() noexcept {
+            if(stale_) {
+                stale_ = false ;
+                generation_ ++ ;
+            }
+        }
+
+        /**
+         * @brief Get the number of refreshes.
+         * @return The generation of the cached colors.
+         */
+        std::size_t generation() const noexcept {
+            return generation_ ;
+        }
+
+        /**
+         * @brief Get the number of invalidations.
+         * @return The number of invalidations including the coalesced ones.
+         */
+        std::size_t count_invalidations() const noexcept {
+            return count_invalidations_ ;
+        }
+
+        /**
+         * @brief Check if the changed setting of WM_SETTINGCHANGE affects the colors.
+         * @param [in] area The name of the changed setting area. It may be NULL.
+         * @return Returns true if the colors are affected, false otherwise.
+         */
+        static bool is_theme_setting(const wchar_t* area) noexcept {
+            return util::is_setting_area(area, L"ImmersiveColorSet") ;
+        }
+    } ;
+
+    /**
+     * @brief Tonal palette derived from a base color.
+     * @details The tones are evenly spaced in OKLab lightness and keep the hue of the base color. They are lightened on a dark base and darkened on a light base. The hover, pressed and separator tones are one, two and three steps away from the base, so a separator stays visible next to a pressed menu. The palette can be generated at compile time for fixed brand colors.
+     */
+    struct TonalPalette {
+        //! The base color
+        std::uint32_t base ;
+        //! The lightness step between adjacent tones
+        double step ;
+        //! The background color of a hovered menu
+        std::uint32_t hover ;
+        //! The background color of a pressed menu
+        std::uint32_t pressed ;
+        //! The color of separator lines
+        std::uint32_t separator ;
+        //! The color of disabled text
+        std::uint32_t disabled ;
+
+        /**
+         * @brief Generate the palette.
+         * @param [in] base_color The base color.
+         * @param [in] lightness_step The lightness step between adjacent tones.
+         */
+        constexpr TonalPalette(std::uint32_t base_color, double lightness_step) noexcept
+        : TonalPalette(util::colorref2oklab(base_color), base_color, lightness_step)
+        {}
+
+    private:
+        constexpr TonalPalette(
+                const util::OKLab& lab,
+                std::uint32_t base_color,
+                double lightness_step) noexcept
+        : base(base_color),
+          step(lightness_step),
+          hover(util::create_tone(lab, direction(lab) * lightness_step)),
+          pressed(util::create_tone(lab, direction(lab) * 2.0 * lightness_step)),
+          separator(util::create_tone(lab, direction(lab) * 3.0 * lightness_step)),
+          disabled(util::create_tone(lab, direction(lab) * 9.0 * lightness_step, 0.5))
+        {}
+
+        // The lightness of the mid gray RGB(128, 128, 128) is about 0.6.
+        static constexpr double direction(const util::OKLab& lab) noexcept {
+            return lab.L < 0.6 ? 1.0 : -1.0 ;
+        }
+    } ;
+
+    /**
+     * @brief Class to cache tonal palettes per base color.
+     * @details The palette is generated only once per base color and step. The oldest palette is discarded when the capacity is exceeded.
+     */
+    class TonalPaletteCache {
+    private:
+        std::vector<TonalPalette> palettes_ ;
+        std::size_t capacity_ ;
+        std::size_t count_generations_ ;
+
+    public:
+        /**
+         * @brief Create palette cache.
+         * @param [in] capacity The maximum number of cached palettes.
+         */
+        explicit TonalPaletteCache(std::size_t capacity=8)
+        : palettes_(),
+          capacity_((std::max)(capacity, static_cast<std::size_t>(1))),
+          count_generations_(0)
+        {}
+
+        /**
+         * @brief Get the palette of a base color.
+         * @param [in] base_color The base color.
+         * @param [in] lightness_step The lightness step between adjacent tones.
+         * @return The cached palette. The reference is valid until the next call.
+         */
+        const TonalPalette& get(std::uint32_t base_color, double lightness_step) {
+            for(const auto& palette : palettes_) {
+                if(palette.base == base_color && palette.step == lightness_step) {
+                    return palette ;
+                }
+            }
+            if(palettes_.size() >= capacity_) {
+                palettes_.erase(palettes_.begin()) ;
+            }
+            palettes_.emplace_back(base_color, lightness_step) ;
+            count_generations_ ++ ;
+            return palettes_.back() ;
+        }
+
+        /**
+         * @brief Get the number of generated palettes.
+         * @return The number of cache misses.
+         */
+        std::size_t count_generations() const noexcept {
+            return count_generations_ ;
+        }
+
+        /**
+         * @brief Discard all cached palettes.
+         */
+        void clear() noexcept {
+            palettes_.clear() ;
+        }
+    } ;
+
+    /**
+     * @brief Sizes to draw menus.
+     */
+    struct MenuMetrics {
+        //! The height of fonts
+        long font_size ;
+        //! Horizontal margins outside menus
+        long x_margin ;
+        //! Vertical margins outside menus
+        long y_margin ;
+        //! Horizontal paddings inside menus
+        long x_pad ;
+        //! Vertical paddings inside menus
+        long y_pad ;
+
+        /**
+         * @brief Scale the sizes at 96 DPI to the DPI.
+         * @param [in] dpi The target DPI.
+         * @return The scaled sizes.
+         */
+        MenuMetrics scale(unsigned int dpi) const noexcept {
+            return MenuMetrics{
+                util::scale_for_dpi(font_size, dpi),
+                util::scale_for_dpi(x_margin, dpi),
+                util::scale_for_dpi(y_margin, dpi),
+                util::scale_for_dpi(x_pad, dpi),
+                util::scale_for_dpi(y_pad, dpi)} ;
+        }
+    } ;
+
+    /**
+     * @brief Class to cache resources per DPI bucket.
+     * @details The resources are prepared once per bucket, so moving between monitors reuses them.
+     */
+    template <typename Resource>
+    class DpiCache {
+    private:
+        std::vector<std::pair<unsigned int, Resource>> entries_ ;
+        std::size_t count_creations_ ;
+
+    public:
+        DpiCache()
+        : entries_(),
+          count_creations_(0)
+        {}
+
+        /**
+         * @brief Get the resource for the DPI and prepare it if not cached.
+         * @param [in] dpi The DPI.
+         * @param [in] create Function to prepare the resource. It is called with the DPI bucket and the resource to fill and returns true on success.
+         * @return The cached resource. If failed to prepare, returns nullptr.
+         */
+        template <typename Create>
+        Resource* get(unsigned int dpi, Create create) {
+            auto bucket = util::to_dpi_bucket(dpi) ;
+            for(auto& entry : entries_) {
+                if(entry.first == bucket) {
+                    return &entry.second ;
+                }
+            }
+            Resource resource{} ;
+            if(!create(bucket, resource)) {
+                return nullptr ;
+            }
+            entries_.emplace_back(bucket, std::move(resource)) ;
+            count_creations_ ++ ;
+            return &entries_.back().second ;
+        }
+
+        /**
+         * @brief Release all resources.
+         * @param [in] release Function called with each resource to release it.
+         */
+        template <typename Release>
+        void clear(Release release) {
+            for(auto& entry : entries_) {
+                release(entry.second) ;
+            }
+            entries_.clear() ;
+        }
+
+        /**
+         * @brief Get the number of cached buckets.
+         * @return The number of buckets.
+         */
+        std::size_t size() const noexcept {
+            return entries_.size() ;
+        }
+
+        /**
+         * @brief Get the number of prepared resources.
+         * @return The number of cache misses.
+         */
+        std::size_t count_creations() const noexcept {
+            return count_creations_ ;
+        }
+    } ;
+
+    /**
+     * @brief Colors to recolor monochrome icons.
+     */
+    enum class IconTint : unsigned char
+    {
+        //! Icons are drawn as-is.
+        NONE,
+
+        //! Monochrome icons are drawn in the text color.
+        TEXT,
+
+        //! Monochrome icons are drawn in the accent color, or in the text color if the accent is not legible on the background.
+        ACCENT,
+    } ;
+
+    /**
+     * @brief Class to cache resources recolored in the color of the current theme.
+     * @details The resources are prepared once per source and color, and all of them are released when the color is changed, so recoloring happens once per theme change.
+     */
+    template <typename Key, typename Resource>
+    class TintCache {
+    private:
+        std::uint32_t color_ ;
+        std::vector<std::pair<Key, Resource>> entries_ ;
+        std::size_t count_creations_ ;
+
+    public:
+        TintCache()
+        : color_(util::invalid_color),
+          entries_(),
+          count_creations_(0)
+        {}
+
+        /**
+         * @brief Change the color. All resources are released if the color is changed.
+         * @param [in] color The new color. util::invalid_color disables recoloring.
+         * @param [in] release Function called with each resource to release it.
+         * @return Returns true if the color is changed, false otherwise.
+         */
+        template <typename Release>
+        bool set_color(std::uint32_t color, Release release) {
+            if(color == color_) {
+                return false ;
+            }
+            clear(release) ;
+            color_ = color ;
+            return true ;
+        }
+
+        /**
+         * @brief Refer to the current color.
+         * @return The color, or util::invalid_color if recoloring is disabled.
+         */
+        std::uint32_t color() const noexcept {
+            return color_ ;
+        }
+
+        /**
+         * @brief Get the resource recolored from a source and prepare it if not cached.
+         * @param [in] key The source.
+         * @param [in] create Function to prepare the resource. It is called with the source, the current color and the resource to fill and returns true on success.
+         * @return The cached resource. If failed to prepare, returns nullptr.
+         */
+        template <typename Create>
+        Resource* get(const Key& key, Create create) {
+            for(auto& entry : entries_) {
+                if(entry.first == key) {
+                    return &entry.second ;
+                }
+            }
+            Resource resource{} ;
+            if(!create(key, color_, resource)) {
+                return nullptr ;
+            }
+            entries_.emplace_back(key, std::move(resource)) ;
+            count_creations_ ++ ;
+            return &entries_.back().second ;
+        }
+
+        /**
+         * @brief Release the resource recolored from a source.
+         * @param [in] key The source.
+         * @param [in] release Function called with the resource to release it.
+         */
+        template <typename Release>
+        void erase(const Key& key, Release release) {
+            for(auto itr = entries_.begin() ; itr != entries_.end() ; itr ++) {
+                if(itr->first == key) {
+                    release(itr->second) ;
+                    entries_.erase(itr) ;
+                    return ;
+                }
+            }
+        }
+
+        /**
+         * @brief Release all resources. The color is kept.
+         * @param [in] release Function called with each resource to release it.
+         */
+        template <typename Release>
+        void clear(Release release) {
+            for(auto& entry : entries_) {
+                release(entry.second) ;
+            }
+            entries_.clear() ;
+        }
+
+        /**
+         * @brief Get the number of cached resources.
+         * @return The number of resources.
+         */
+        std::size_t size() const noexcept {
+            return entries_.size() ;
+        }
+
+        /**
+         * @brief Get the number of prepared resources.
+         * @return The number of cache misses.
+         */
+        std::size_t count_creations() const noexcept {
+            return count_creations_ ;
+        }
+    } ;
+
+    /**
+     * @brief Edges of the monitor where the taskbar is docked. The values are the same as ABE_LEFT, ABE_TOP, ABE_RIGHT and ABE_BOTTOM.
+     */
+    enum class TaskbarEdge : unsigned char
+    {
+        LEFT,
+        TOP,
+        RIGHT,
+        BOTTOM,
+    } ;
+
+    /**
+     * @brief Geometry of a monitor and its taskbar.
+     */
+    struct MonitorTopology {
+        //! The monitor rectangle in screen coordinates
+        Rect monitor ;
+        //! The work area in screen coordinates
+        Rect work ;
+        //! The edge of the taskbar
+        TaskbarEdge edge ;
+        //! The thickness of the taskbar. It is also set for an auto-hidden taskbar.
+        long taskbar_thickness ;
+    } ;
+
+    /**
+     * @brief Class to solve the position of the popup window.
+     * @details All functions are pure and depend only on the given topology.
+     */
+    class PopupPlacement {
+    public:
+        /**
+         * @brief Get the width of the area between the monitor edge and the work area.
+         * @param [in] monitor The monitor rectangle.
+         * @param [in] work The work area.
+         * @param [in] edge The edge.
+         * @return The inset in pixels.
+         */
+        static long calculate_inset(const Rect& monitor, const Rect& work, TaskbarEdge edge) noexcept {
+            switch(edge) {
+                case TaskbarEdge::LEFT:
+                    return work.left - monitor.left ;
+                case TaskbarEdge::TOP:
+                    return work.top - monitor.top ;
+                case TaskbarEdge::RIGHT:
+                    return monitor.right - work.right ;
+                default:
+                    return monitor.bottom - work.bottom ;
+            }
+        }
+
+        /**
+         * @brief Detect the taskbar edge from the difference between the monitor and the work area.
+         * @param [in] monitor The monitor rectangle.
+         * @param [in] work The work area.
+         * @param [in] fallback The edge used if the work area is not reduced, such as an auto-hidden taskbar.
+         * @return The edge with the largest inset.
+         */
+        static TaskbarEdge detect_taskbar_edge(
+                const Rect& monitor,
+                const Rect& work,
+                TaskbarEdge fallback) noexcept {
+            auto edge = fallback ;
+            auto largest = calculate_inset(monitor, work, fallback) ;
+            for(auto candidate : {TaskbarEdge::LEFT, TaskbarEdge::TOP, TaskbarEdge::RIGHT, TaskbarEdge::BOTTOM}) {
+                auto inset = calculate_inset(monitor, work, candidate) ;
+                if(inset > largest) {
+                    largest = inset ;
+                    edge = candidate ;
+                }
+            }
+            return edge ;
+        }
+
+        /**
+         * @brief Find the monitor containing the point or the nearest one.
+         * @param [in] monitors The monitors.
+         * @param [in] point The point in screen coordinates.
+         * @return The index of monitor. If there is no monitor, returns the number of monitors.
+         */
+        static std::size_t find_monitor(
+                const std::vector<MonitorTopology>& monitors,
+                Point point) noexcept {
+            auto found = monitors.size() ;
+            long long nearest = -1 ;
+            for(std::size_t i = 0 ; i < monitors.size() ; i ++) {
+                const auto& rect = monitors[i].monitor ;
+                long long dx = (std::max)({rect.left - point.x, point.x - (rect.right - 1), 0L}) ;
+                long long dy = (std::max)({rect.top - point.y, point.y - (rect.bottom - 1), 0L}) ;
+                auto distance = dx * dx + dy * dy ;
+                if(nearest < 0 || distance < nearest) {
+                    nearest = distance ;
+                    found = i ;
+                }
+            }
+            return found ;
+        }
+
+        /**
+         * @brief Calculate the rectangle of a submenu next to the menu opening it.
+         * @param [in] work The work area of the monitor with the menu.
+         * @param [in] item The rectangle of the menu opening the submenu.
+         * @param [in] width The width of submenu.
+         * @param [in] height The height of submenu.
+         * @return The submenu rectangle. It is placed on the right of the menu, or on the left if it does not fit.
+         */
+        static Rect solve_cascade(const Rect& work, const Rect& item, long width, long height) noexcept {
+            auto x = item.right ;
+            if(x + width > work.right && item.left - width >= work.left) {
+                x = item.left - width ;
+            }
+            auto y = item.top ;
+
+            // Keep the submenu on the screen.
+            x = (std::max)((std::min)(x, work.right - width), work.left) ;
+            y = (std::max)((std::min)(y, work.bottom - height), work.top) ;
+            return Rect{x, y, x + width, y + height} ;
+        }
+
+        /**
+         * @brief Calculate the popup rectangle next to the taskbar.
+         * @param [in] topology The monitor with the anchor.
+         * @param [in] anchor The point to show the popup, usually the cursor on the tray icon.
+         * @param [in] width The width of popup.
+         * @param [in] height The height of popup.
+         * @return The popup rectangle, which is clamped into the area not covered by the taskbar.
+         * @details The popup is centered on the anchor along the taskbar. There is an offset of 20% of the taskbar thickness from a bottom or right taskbar.
+         */
+        static Rect solve(
+                const MonitorTopology& topology,
+                Point anchor,
+                long width,
+                long height) noexcept {
+            auto area = topology.work ;
+            auto edge = topology.edge ;
+
+            // An auto-hidden taskbar does not reduce the work area, but covers it while shown.
+            auto inset = calculate_inset(topology.monitor, area, edge) ;
+            auto thickness = (std::max)(inset, topology.taskbar_thickness) ;
+            auto cover = thickness - inset ;
+            switch(edge) {
+                case TaskbarEdge::LEFT:
+                    area.left += cover ;
+                    break ;
+                case TaskbarEdge::TOP:
+                    area.top += cover ;
+                    break ;
+                case TaskbarEdge::RIGHT:
+                    area.right -= cover ;
+                    break ;
+                default:
+                    area.bottom -= cover ;
+                    break ;
+            }
+
+            auto x = anchor.x - width / 2 ;
+            auto y = anchor.y - height / 2 ;
+            switch(edge) {
+                case TaskbarEdge::LEFT:
+                    x = area.left ;
+                    break ;
+                case TaskbarEdge::TOP:
+                    y = area.top ;
+                    break ;
+                case TaskbarEdge::RIGHT:
+                    x = area.right - width - thickness / 5 ;
+                    break ;
+                default:
+                    y = area.bottom - height - thickness / 5 ;
+                    break ;
+            }
+
+            // Keep the popup on the screen.
+            x = (std::max)((std::min)(x, area.right - width), area.left) ;
+            y = (std::max)((std::min)(y, area.bottom - height), area.top) ;
+            return Rect{x, y, x + width, y + height} ;
+        }
+
+        /**
+         * @brief Calculate the popup rectangle on the monitor with the anchor.
+         * @param [in] monitors The monitors.
+         * @param [in] anchor The point to show the popup.
+         * @param [in] width The width of popup.
+         * @param [in] height The height of popup.
+         * @param [out] popup The popup rectangle.
+         * @return Returns true on success, false if there is no monitor.
+         */
+        static bool solve(
+                const std::vector<MonitorTopology>& monitors,
+                Point anchor,
+                long width,
+                long height,
+                Rect& popup) noexcept {
+            auto index = find_monitor(monitors, anchor) ;
+            if(index >= monitors.size()) {
+                return false ;
+            }
+            popup = solve(monitors[index], anchor, width, height) ;
+            return true ;
+        }
+    } ;
+
+    /**
+     * @brief Description of a menu to be shown, which is applied by FluentTray::reconcile_menus.
+     */
+    struct MenuSpec {
+        //! The unique key to match the menu between updates
+        std::string key ;
+        //! The UTF-8 encoded label text
+        std::string label ;
+        //! An icon path to show next to the label
+        std::string icon_path ;
+        //! Whether the menu is switchable
+        bool toggleable ;
+        //! The checkmark string of a toggleable menu
+        std::string checkmark ;
+        //! Whether a toggleable menu is checked
+        bool checked ;
+        //! Whether a separator line is shown under the menu
+        bool separator ;
+        //! Function called when a click on the menu or a check is enabled
+        std::function<bool(void)> callback ;
+        //! Function called when a check is disabled
+        std::function<bool(void)> unchecked_callback ;
+
+        /**
+         * @brief Create menu description.
+         * @param [in] key_text The unique key.
+         * @param [in] label_text The UTF-8 encoded label text.
+         */
+        explicit MenuSpec(
+            const std::string& key_text="",
+            const std::string& label_text="")
+        : key(key_text),
+          label(label_text),
+          icon_path(),
+          toggleable(false),
+          checkmark("✓"),
+          checked(false),
+          separator(false),
+          callback([] {return true ;}),
+          unchecked_callback([] {return true ;})
+        {}
+    } ;
+
+
+    /**
+     * @brief Class to hold the descriptions of cascading submenus.
+     * @details A submenu is only a list of MenuSpec until it is opened for the first time, so an unopened subtree costs only its descriptions.
+     */
+    class SubmenuTree {
+    private:
+        static constexpr std::size_t npos_ = static_cast<std::size_t>(-1) ;
+
+        struct Node {
+            std::size_t parent ;
+            std::vector<MenuSpec> items ;
+            std::vector<std::size_t> children ;
+        } ;
+        std::vector<Node> nodes_ ;
+
+    public:
+        SubmenuTree()
+        : nodes_()
+        {}
+
+        /**
+         * @brief Add a submenu opened from a menu of the menu window.
+         * @return The identifier of submenu.
+         */
+        std::size_t add_root() {
+            const std::size_t none = npos_ ;
+            nodes_.push_back(Node{none, std::vector<MenuSpec>(), std::vector<std::size_t>()}) ;
+            return nodes_.size() - 1 ;
+        }
+
+        /**
+         * @brief Append an item to a submenu.
+         * @param [in] node The identifier of submenu.
+         * @param [in] spec The description of item.
+         * @return Returns true on success, false if there is no such submenu.
+         */
+        bool add_item(std::size_t node, const MenuSpec& spec) {
+            if(node >= nodes_.size()) {
+                return false ;
+            }
+            const std::size_t none = npos_ ;
+            nodes_[node].items.push_back(spec) ;
+            nodes_[node].children.push_back(none) ;
+            return true ;
+        }
+
+        /**
+         * @brief Append an item opening a nested submenu to a submenu.
+         * @param [in] node The identifier of submenu.
+         * @param [in] spec The description of item.
+         * @param [out] child The identifier of the nested submenu.
+         * @return Returns true on success, false if there is no such submenu.
+         */
+        bool add_nested(std::size_t node, const MenuSpec& spec, std::size_t& child) {
+            if(node >= nodes_.size()) {
+                return false ;
+            }
+            child = nodes_.size() ;
+            nodes_.push_back(Node{node, std::vector<MenuSpec>(), std::vector<std::size_t>()}) ;
+            nodes_[node].items.push_back(spec) ;
+            nodes_[node].children.push_back(child) ;
+            return true ;
+        }
+
+        /**
+         * @brief Returns the number of submenus.
+         * @return The number of submenus.
+         */
+        std::size_t size() const noexcept {
+            return nodes_.size() ;
+        }
+
+        /**
+         * @brief Returns the number of items of a submenu.
+         * @param [in] node The identifier of submenu.
+         * @return The number of items.
+         */
+        std::size_t count_items(std::size_t node) const noexcept {
+            return nodes_[node].items.size() ;
+        }
+
+        /**
+         * @brief Refer to the description of an item.
+         * @param [in] node The identifier of submenu.
+         * @param [in] index The index of item.
+         * @return The description.
+         */
+        const MenuSpec& item(std::size_t node, std::size_t index) const noexcept {
+            return nodes_[node].items[index] ;
+        }
+
+        /**
+         * @brief Find the nested submenu opened by an item.
+         * @param [in] node The identifier of submenu.
+         * @param [in] index The index of item.
+         * @param [out] child The identifier of the nested submenu.
+         * @return Returns true if the item opens a submenu, false otherwise.
+         */
+        bool find_child(std::size_t node, std::size_t index, std::size_t& child) const noexcept {
+            if(node >= nodes_.size() || index >= nodes_[node].children.size()) {
+                return false ;
+            }
+            child = nodes_[node].children[index] ;
+            return child != npos_ ;
+        }
+
+        /**
+         * @brief Find the submenu containing the item opening a submenu.
+         * @param [in] node The identifier of submenu.
+         * @param [out] parent The identifier of the parent submenu.
+         * @return Returns true on success, false if the submenu is opened from the menu window.
+         */
+        bool find_parent(std::size_t node, std::size_t& parent) const noexcept {
+            if(node >= nodes_.size() || nodes_[node].parent == npos_) {
+                return false ;
+            }
+            parent = nodes_[node].parent ;
+            return true ;
+        }
+    } ;
+
+
+    /**
+     * @brief Results of a provider filling a section of menus.
+     */
+    enum class ProviderResult : unsigned char {
+        //! The data is not ready yet, so the provider is polled again later.
+        PENDING,
+
+        //! The descriptions of menus are filled.
+        READY,
+
+        //! The data cannot be obtained, so the cached descriptions are kept.
+        FAILED,
+    } ;
+
+
+    /**
+     * @brief Class to cache the descriptions of a section filled by a provider when the menus are opened.
+     * @details The cached descriptions are shown immediately, and a refresh is started only when they are older than the maximum age. The provider runs on a worker thread so that a slow one does not block the menus, and its result is taken by polling until the provider is ready or the time budget runs out, in which case the stale descriptions are kept until the next opening. All methods take the current time so that the state can be driven by any clock.
+     */
+    class SectionCache {
+    public:
+        using time_point = std::chrono::steady_clock::time_point ;
+
+    private:
+        std::chrono::milliseconds max_age_ ;
+        std::chrono::milliseconds budget_ ;
+
+        std::vector<MenuSpec> items_ ;
+        bool valid_ ;
+        time_point filled_at_ ;
+
+        bool refreshing_ ;
+        time_point started_at_ ;
+
+        //! The state shared with the worker, which outlives a moved cache.
+        struct Job {
+            std::vector<MenuSpec> items ;
+            std::atomic<bool> cancelled ;
+
+            Job()
+            : items(),
+              cancelled(false)
+            {}
+        } ;
+        std::shared_ptr<Job> job_ ;
+
+        //! The result of the worker. Its destruction joins the worker, including the destruction of the provider copied to it.
+        std::future<ProviderResult> result_ ;
+
+        std::size_t version_ ;
+        std::size_t count_refreshes_ ;
+        std::size_t count_timeouts_ ;
+
+        template <typename Provider>
+        bool start(Provider&& provider) {
+            auto job = std::make_shared<Job>() ;
+            typename std::decay<Provider>::type call(std::forward<Provider>(provider)) ;
+            // One worker runs the whole refresh, calling a pending provider again until it is done or cancelled.
+            // Each call gets an empty vector, so a pending call does not leave items for the next one.
+            auto run = [call, job] () mutable {
+                while(true) {
+                    job->items.clear() ;
+                    auto result = call(job->items) ;
+                    if(result != ProviderResult::PENDING || job->cancelled) {
+                        return result ;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1)) ;
+                }
+            } ;
+            try {
+                result_ = std::async(std::launch::async, std::move(run)) ;
+            }
+            catch(const std::system_error&) {
+                // No thread is available.
+                return false ;
+            }
+            job_ = job ;
+            return true ;
+        }
+
+        void cancel() noexcept {
+            if(job_) {
+                job_->cancelled = true ;
+            }
+        }
+
+    public:
+        /**
+         * @brief Create section cache.
+         * @param [in] max_age The age after which the descriptions are refreshed on opening.
+         * @param [in] budget The time a refresh may take before it is abandoned.
+         */
+        explicit SectionCache(
+            std::chrono::milliseconds max_age=std::chrono::milliseconds(0),
+            std::chrono::milliseconds budget=std::chrono::milliseconds(100))
+        : max_age_(max_age),
+          budget_(budget),
+          items_(),
+          valid_(false),
+          filled_at_(),
+          refreshing_(false),
+          started_at_(),
+          job_(),
+          result_(),
+          version_(0),
+          count_refreshes_(0),
+          count_timeouts_(0)
+        {}
+
+        SectionCache(SectionCache&&) = default ;
+
+        SectionCache& operator=(SectionCache&& other) {
+            if(this != &other) {
+                // The worker of this cache is stopped before its result is replaced.
+                cancel() ;
+                wait() ;
+                max_age_ = other.max_age_ ;
+                budget_ = other.budget_ ;
+                items_ = std::move(other.items_) ;
+                valid_ = other.valid_ ;
+                filled_at_ = other.filled_at_ ;
+                refreshing_ = other.refreshing_ ;
+                started_at_ = other.started_at_ ;
+                job_ = std::move(other.job_) ;
+                result_ = std::move(other.result_) ;
+                version_ = other.version_ ;
+                count_refreshes_ = other.count_refreshes_ ;
+                count_timeouts_ = other.count_timeouts_ ;
+            }
+            return *this ;
+        }
+
+        /**
+         * @brief Destroy section cache.
+         * @details The worker is cancelled and joined, so the provider may refer to the objects owned by the application. A call of the provider running at the time is waited for.
+         */
+        ~SectionCache() {
+            cancel() ;
+            wait() ;
+        }
+
+        /**
+         * @brief Notify that the menus are opened.
+         * @param [in] now The current time.
+         * @return Returns true if a refresh is started, false if the descriptions are fresh or a refresh is already running.
+         */
+        bool open(time_point now) {
+            if(refreshing_ || is_fresh(now)) {
+                return false ;
+            }
+            refreshing_ = true ;
+            started_at_ = now ;
+            return true ;
+        }
+
+        /**
+         * @brief Poll the running refresh.
+         * @param [in] now The current time.
+         * @param [in] provider Function with the signature `ProviderResult(std::vector<MenuSpec>&)` to fill the new descriptions. It is called on a worker thread with an empty vector, and never on two threads at once.
+         * @return Returns true if the descriptions are replaced, false otherwise or if no worker thread can be started.
+         * @details The first poll of a refresh starts one worker, which calls the provider again every millisecond while it returns ProviderResult::PENDING. The later polls only check the result of the worker without blocking. If no result is taken within the time budget, the refresh is abandoned and the worker stops after the current call. The next refresh takes its result if the call turns out ready, instead of calling the provider again.
+         */
+        template <typename Provider>
+        bool poll(time_point now, Provider&& provider) {
+            if(!refreshing_) {
+                return false ;
+            }
+            if(result_.valid() && result_.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                auto result = result_.get() ;
+                // The worker is joined here, which costs nothing because it has returned.
+                result_ = std::future<ProviderResult>() ;
+                switch(result) {
+                    case ProviderResult::READY:
+                        items_.swap(job_->items) ;
+                        job_.reset() ;
+                        valid_ = true ;
+                        filled_at_ = now ;
+                        refreshing_ = false ;
+                        version_ ++ ;
+                        count_refreshes_ ++ ;
+                        return true ;
+                    case ProviderResult::FAILED:
+                        job_.reset() ;
+                        refreshing_ = false ;
+                        return false ;
+                    case ProviderResult::PENDING:
+                        // The worker of an abandoned refresh is cancelled.
+                        job_.reset() ;
+                        break ;
+                }
+            }
+            if(now - started_at_ >= budget_) {
+                cancel() ;
+                refreshing_ = false ;
+                count_timeouts_ ++ ;
+                return false ;
+            }
+            if(!result_.valid() && !start(std::forward<Provider>(provider))) {
+                refreshing_ = false ;
+            }
+            return false ;
+        }
+
+        /**
+         * @brief Wait for the worker to return.
+         * @details A worker of a running refresh returns when the provider is done, so it must not be pending forever.
+         */
+        void wait() const {
+            if(result_.valid()) {
+                result_.wait() ;
+            }
+        }
+
+        /**
+         * @brief Make the descriptions stale so that the next opening refreshes them.
+         */
+        void invalidate() noexcept {
+            valid_ = false ;
+        }
+
+        /**
+         * @brief Check whether the descriptions need no refresh.
+         * @param [in] now The current time.
+         * @return Returns true if the descriptions are younger than the maximum age, false otherwise.
+         */
+        bool is_fresh(time_point now) const noexcept {
+            return valid_ && now - filled_at_ < max_age_ ;
+        }
+
+        /**
+         * @brief Check whether a refresh is running.
+         * @return Returns true if the provider is being polled, false otherwise.
+         */
+        bool is_refreshing() const noexcept {
+            return refreshing_ ;
+        }
+
+        /**
+         * @brief Refer to the cached descriptions.
+         * @return The descriptions from the latest completed refresh.
+         */
+        const std::vector<MenuSpec>& items() const noexcept {
+            return items_ ;
+        }
+
+        /**
+         * @brief Get the number of times the descriptions are replaced.
+         * @return The version of the descriptions.
+         */
+        std::size_t version() const noexcept {
+            return version_ ;
+        }
+
+        /**
+         * @brief Get the number of completed refreshes.
+         * @return The number of refreshes.
+         */
+        std::size_t count_refreshes() const noexcept {
+            return count_refreshes_ ;
+        }
+
+        /**
+         * @brief Get the number of refreshes abandoned by the time budget.
+         * @return The number of timeouts.
+         */
+        std::size_t count_timeouts() const noexcept {
+            return count_timeouts_ ;
+        }
+    } ;
+}
+
+#if defined(__GNUC__)
+#pragma GCC diagnostic warning "-Wold-style-cast"
+#endif
+
+#endif
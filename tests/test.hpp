@@ -5,6 +5,32 @@
 
 #define _FLUENT_TRAY_IGNORE_IN_TEST
 
-#include "fluent_tray.hpp"
+#include "fluent_tray_core.hpp"
+
+#include <chrono>
+
+/**
+ * @brief Fixture of a fake clock for the classes that take the current time as an argument.
+ * @details The time does not pass by itself, so the tests are deterministic.
+ */
+struct FakeClock {
+    using time_point = std::chrono::steady_clock::time_point ;
+
+    //! The origin of the fake clock
+    const time_point t0 ;
+
+    FakeClock()
+    : t0()
+    {}
+
+    /**
+     * @brief Get the time after the origin.
+     * @param [in] ms The elapsed time in milliseconds.
+     * @return The time point.
+     */
+    time_point at(long long ms) const {
+        return t0 + std::chrono::milliseconds(ms) ;
+    }
+} ;
 
 #endif
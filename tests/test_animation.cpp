@@ -0,0 +1,88 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+using namespace std::chrono ;
+
+
+TEST_CASE_FIXTURE(FakeClock, "FrameScheduler test with fake clock: ") {
+    SUBCASE("Not started") {
+        FrameScheduler scheduler ;
+        std::size_t frame = 99 ;
+        CHECK_FALSE(scheduler.is_running()) ;
+        CHECK_FALSE(scheduler.tick(at(10000), frame)) ;
+        CHECK_EQ(frame, 99) ;
+
+        // No frames
+        scheduler.start(0, milliseconds(100), t0) ;
+        CHECK_FALSE(scheduler.is_running()) ;
+    }
+
+    SUBCASE("Advance frames") {
+        FrameScheduler scheduler{0} ;
+        std::size_t frame = 99 ;
+        scheduler.start(4, milliseconds(100), t0) ;
+        CHECK(scheduler.is_active()) ;
+        CHECK_EQ(scheduler.frame(), 0) ;
+        CHECK_EQ(scheduler.update_interval(), milliseconds(100)) ;
+
+        CHECK_FALSE(scheduler.tick(at(99), frame)) ;
+        CHECK(scheduler.tick(at(100), frame)) ;
+        CHECK_EQ(frame, 1) ;
+
+        // Late timer does not accumulate the drift.
+        CHECK(scheduler.tick(at(230), frame)) ;
+        CHECK_EQ(frame, 2) ;
+        CHECK(scheduler.tick(at(300), frame)) ;
+        CHECK_EQ(frame, 3) ;
+
+        // Skip the frames in between and wrap around.
+        CHECK(scheduler.tick(at(600), frame)) ;
+        CHECK_EQ(frame, 2) ;
+        CHECK_EQ(scheduler.count_updates(), 4) ;
+
+        scheduler.stop() ;
+        CHECK_FALSE(scheduler.tick(at(10000), frame)) ;
+    }
+
+    SUBCASE("Maximum rate") {
+        FrameScheduler scheduler{10} ;
+        std::size_t frame = 0 ;
+        scheduler.start(8, milliseconds(20), t0) ;
+        CHECK_EQ(scheduler.update_interval(), milliseconds(100)) ;
+
+        // Only one update in 100 ms even though five frames have elapsed.
+        for(int ms = 0 ; ms < 100 ; ms += 20) {
+            CHECK_FALSE(scheduler.tick(at(ms), frame)) ;
+        }
+        CHECK(scheduler.tick(at(100), frame)) ;
+        CHECK_EQ(frame, 5) ;
+        CHECK_EQ(scheduler.count_updates(), 1) ;
+
+        scheduler.set_max_rate(3) ;
+        CHECK_EQ(scheduler.update_interval(), milliseconds(334)) ;
+    }
+
+    SUBCASE("Pause while locked or display off") {
+        FrameScheduler scheduler{0} ;
+        std::size_t frame = 0 ;
+        scheduler.start(4, milliseconds(100), t0) ;
+
+        scheduler.set_session_locked(true, at(50)) ;
+        CHECK(scheduler.is_paused()) ;
+        CHECK_FALSE(scheduler.is_active()) ;
+        CHECK_FALSE(scheduler.tick(at(500), frame)) ;
+
+        scheduler.set_display_off(true, at(600)) ;
+        scheduler.set_session_locked(false, at(700)) ;
+        CHECK(scheduler.is_paused()) ;
+        CHECK_FALSE(scheduler.tick(at(800), frame)) ;
+
+        // Resume without catching up the paused time.
+        scheduler.set_display_off(false, at(1000)) ;
+        CHECK(scheduler.is_active()) ;
+        CHECK_FALSE(scheduler.tick(at(1050), frame)) ;
+        CHECK(scheduler.tick(at(1100), frame)) ;
+        CHECK_EQ(frame, 1) ;
+        CHECK_EQ(scheduler.count_updates(), 1) ;
+    }
+}
@@ -0,0 +1,115 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+namespace
+{
+    const std::uint32_t base_color = 0xFF202020 ;
+    const std::uint32_t back_color = 0xFFC42B1C ;
+    const std::uint32_t text_color = 0xFFFFFFFF ;
+
+    std::size_t count_color(const std::vector<std::uint32_t>& pixels, std::uint32_t color) {
+        return static_cast<std::size_t>(
+            std::count(pixels.begin(), pixels.end(), color)) ;
+    }
+}
+
+
+TEST_CASE("BadgeRenderer test: ") {
+    SUBCASE("format_count") {
+        CHECK_EQ(BadgeRenderer::format_count(-1), "") ;
+        CHECK_EQ(BadgeRenderer::format_count(0), "") ;
+        CHECK_EQ(BadgeRenderer::format_count(1), "1") ;
+        CHECK_EQ(BadgeRenderer::format_count(9), "9") ;
+        CHECK_EQ(BadgeRenderer::format_count(10), "9+") ;
+        CHECK_EQ(BadgeRenderer::format_count(12345), "9+") ;
+    }
+
+    SUBCASE("Glyph cache") {
+        BadgeRenderer badge ;
+        CHECK_EQ(badge.count_cached_scales(), 0) ;
+
+        const auto& one = badge.glyph('1', 1) ;
+        REQUIRE_EQ(one.size(), 15) ;
+        // 010 / 110 / 010 / 010 / 111
+        const std::uint8_t expected[] = {
+            0, 255, 0,
+            255, 255, 0,
+            0, 255, 0,
+            0, 255, 0,
+            255, 255, 255} ;
+        for(std::size_t i = 0 ; i < one.size() ; i ++) {
+            CHECK_EQ(one[i], expected[i]) ;
+        }
+        CHECK_EQ(badge.count_cached_scales(), 1) ;
+
+        // Scaled glyphs are cached separately and reused.
+        const auto& eight = badge.glyph('8', 2) ;
+        CHECK_EQ(eight.size(), 60) ;
+        CHECK_EQ(&eight, &badge.glyph('8', 2)) ;
+        CHECK_EQ(badge.count_cached_scales(), 2) ;
+
+        CHECK_EQ(BadgeRenderer::calculate_scale(16, 16), 1) ;
+        CHECK_EQ(BadgeRenderer::calculate_scale(32, 32), 2) ;
+        CHECK_EQ(BadgeRenderer::calculate_scale(8, 8), 1) ;
+    }
+
+    SUBCASE("compose_count") {
+        BadgeRenderer badge{back_color, text_color} ;
+        std::vector<std::uint32_t> base(16 * 16, base_color) ;
+        std::vector<std::uint32_t> out ;
+
+        badge.compose_count(base.data(), 16, 16, 0, out) ;
+        CHECK_EQ(out, base) ;
+
+        badge.compose_count(base.data(), 16, 16, 1, out) ;
+        REQUIRE_EQ(out.size(), base.size()) ;
+
+        // The badge is 7x7 at the bottom-right corner and the top-left is untouched.
+        CHECK_EQ(out[0], base_color) ;
+        CHECK_EQ(out[8 * 16 + 8], base_color) ;
+        CHECK_EQ(count_color(out, text_color), 8) ;  // pixels of '1'
+        CHECK_GT(count_color(out, back_color), 0) ;
+        for(int y = 0 ; y < 9 ; y ++) {
+            for(int x = 0 ; x < 16 ; x ++) {
+                CHECK_EQ(out[y * 16 + x], base_color) ;
+            }
+        }
+
+        // The center of the glyph row is drawn with the text color.
+        // '1' is drawn at (11, 10) - (13, 14)
+        CHECK_EQ(out[14 * 16 + 11], text_color) ;
+        CHECK_EQ(out[14 * 16 + 13], text_color) ;
+
+        // Wider pill for "9+".
+        badge.compose_count(base.data(), 16, 16, 42, out) ;
+        std::size_t badge_pixels = 0 ;
+        for(int x = 0 ; x < 16 ; x ++) {
+            if(out[12 * 16 + x] != base_color) {
+                badge_pixels ++ ;
+            }
+        }
+        CHECK_EQ(badge_pixels, 11) ;
+    }
+
+    SUBCASE("compose_dot") {
+        BadgeRenderer badge{back_color, text_color} ;
+        std::vector<std::uint32_t> base(32 * 32, base_color) ;
+        std::vector<std::uint32_t> out ;
+        badge.compose_dot(base.data(), 32, 32, out) ;
+
+        // 12px circle at the bottom-right corner.
+        CHECK_EQ(out[26 * 32 + 26], back_color) ;
+        CHECK_EQ(out[31 * 32 + 31], base_color) ;
+        CHECK_EQ(out[19 * 32 + 19], base_color) ;
+        CHECK_EQ(count_color(out, text_color), 0) ;
+        auto area = count_color(out, back_color) ;
+        CHECK_GT(area, 100) ;
+        CHECK_LT(area, 144) ;
+    }
+
+    SUBCASE("colorref2argb") {
+        CHECK_EQ(util::colorref2argb(util::rgb(0x12, 0x34, 0x56)), 0xFF123456) ;
+        CHECK_EQ(util::colorref2argb(util::rgb(0x12, 0x34, 0x56), 0x80), 0x80123456) ;
+    }
+}
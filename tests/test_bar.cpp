@@ -0,0 +1,87 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+
+TEST_CASE("ValueBar test: ") {
+    SUBCASE("Range and clamping") {
+        ValueBar bar{0, 100, 150, 5} ;
+        CHECK_EQ(bar.minimum(), 0) ;
+        CHECK_EQ(bar.maximum(), 100) ;
+        CHECK_EQ(bar.step(), 5) ;
+        CHECK_EQ(bar.value(), 100) ;
+
+        CHECK(bar.set_value(-10)) ;
+        CHECK_EQ(bar.value(), 0) ;
+        CHECK_FALSE(bar.set_value(-20)) ;
+
+        ValueBar inverted{10, 0, 5, 0} ;
+        CHECK_EQ(inverted.maximum(), 10) ;
+        CHECK_EQ(inverted.step(), 1) ;
+    }
+
+    SUBCASE("Value to pixels") {
+        ValueBar bar{0, 100, 50} ;
+        CHECK_EQ(bar.to_pixels(200), 100) ;
+        CHECK_EQ(bar.to_pixels(0, 200), 0) ;
+        CHECK_EQ(bar.to_pixels(100, 200), 200) ;
+        CHECK_EQ(bar.to_pixels(1, 120), 1) ;
+        CHECK_EQ(bar.to_pixels(1000, 200), 200) ;
+        CHECK_EQ(bar.to_pixels(50, 0), 0) ;
+
+        ValueBar offset{-50, 50, 0} ;
+        CHECK_EQ(offset.to_pixels(100), 50) ;
+
+        ValueBar empty{5, 5, 5} ;
+        CHECK_EQ(empty.to_pixels(100), 0) ;
+    }
+
+    SUBCASE("Pixels to value") {
+        ValueBar bar{0, 100, 0, 10} ;
+        CHECK_EQ(bar.from_pixels(0, 200), 0) ;
+        CHECK_EQ(bar.from_pixels(200, 200), 100) ;
+        CHECK_EQ(bar.from_pixels(-30, 200), 0) ;
+        CHECK_EQ(bar.from_pixels(500, 200), 100) ;
+        CHECK_EQ(bar.from_pixels(95, 200), 50) ;
+        CHECK_EQ(bar.from_pixels(112, 200), 60) ;
+
+        // Round trip for every pixel.
+        ValueBar fine{0, 1000} ;
+        for(int x = 0 ; x <= 250 ; x ++) {
+            CHECK_EQ(fine.to_pixels(fine.from_pixels(x, 250), 250), x) ;
+        }
+    }
+
+    SUBCASE("Dirty span of progress bar") {
+        ValueBar bar{0, 100} ;
+        int left = -1, right = -1 ;
+        CHECK(bar.calculate_dirty_span(10, 30, 200, 0, left, right)) ;
+        CHECK_EQ(left, 20) ;
+        CHECK_EQ(right, 60) ;
+
+        CHECK(bar.calculate_dirty_span(30, 10, 200, 0, left, right)) ;
+        CHECK_EQ(left, 20) ;
+        CHECK_EQ(right, 60) ;
+
+        // Sub-pixel changes do not need to be redrawn.
+        CHECK_FALSE(bar.calculate_dirty_span(10, 10, 200, 0, left, right)) ;
+        ValueBar precise{0, 10000} ;
+        CHECK_FALSE(precise.calculate_dirty_span(5000, 5001, 200, 0, left, right)) ;
+    }
+
+    SUBCASE("Dirty span of slider") {
+        ValueBar bar{0, 100} ;
+        int left = -1, right = -1 ;
+        CHECK(bar.calculate_dirty_span(50, 60, 100, 8, left, right)) ;
+        CHECK_EQ(left, 46) ;
+        CHECK_EQ(right, 64) ;
+
+        // Clipped into the bar.
+        CHECK(bar.calculate_dirty_span(0, 1, 100, 8, left, right)) ;
+        CHECK_EQ(left, 0) ;
+        CHECK_EQ(right, 5) ;
+        CHECK(bar.calculate_dirty_span(100, 99, 100, 8, left, right)) ;
+        CHECK_EQ(left, 95) ;
+        CHECK_EQ(right, 100) ;
+    }
+}
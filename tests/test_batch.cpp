@@ -0,0 +1,92 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+TEST_CASE("UpdateBatch test: ") {
+    SUBCASE("Nested transactions") {
+        UpdateBatch batch ;
+        CHECK_FALSE(batch.is_open()) ;
+        CHECK_FALSE(batch.end()) ;
+
+        batch.begin() ;
+        batch.begin() ;
+        CHECK(batch.is_open()) ;
+        CHECK_FALSE(batch.end()) ;
+        CHECK(batch.is_open()) ;
+        CHECK(batch.end()) ;
+        CHECK_FALSE(batch.is_open()) ;
+    }
+
+    SUBCASE("Many changes are committed once") {
+        UpdateBatch batch ;
+        batch.begin() ;
+        for(int i = 0 ; i < 100 ; i ++) {
+            if(i % 3 == 0) {
+                batch.defer_layout() ;
+            }
+            else {
+                batch.defer_repaint() ;
+            }
+        }
+        CHECK(batch.end()) ;
+        CHECK_EQ(batch.count_deferred(), 100) ;
+
+        int calls = 0 ;
+        bool layout = false ;
+        bool repaint = false ;
+        auto commit = [&] (bool l, bool r) {
+            calls ++ ;
+            layout = l ;
+            repaint = r ;
+            return true ;
+        } ;
+        CHECK(batch.commit(commit)) ;
+        CHECK_EQ(calls, 1) ;
+        CHECK(layout) ;
+        CHECK(repaint) ;
+        CHECK_EQ(batch.count_commits(), 1) ;
+
+        // The deferred work is consumed.
+        CHECK(batch.commit(commit)) ;
+        CHECK_EQ(calls, 1) ;
+        CHECK_EQ(batch.count_commits(), 1) ;
+    }
+
+    SUBCASE("Repaints do not require a layout") {
+        UpdateBatch batch ;
+        batch.begin() ;
+        batch.defer_repaint() ;
+        batch.defer_repaint() ;
+        CHECK(batch.end()) ;
+
+        bool layout = true ;
+        bool repaint = false ;
+        CHECK(batch.commit([&] (bool l, bool r) {
+            layout = l ;
+            repaint = r ;
+            return true ;
+        })) ;
+        CHECK_FALSE(layout) ;
+        CHECK(repaint) ;
+    }
+
+    SUBCASE("Nothing is committed without changes") {
+        UpdateBatch batch ;
+        batch.begin() ;
+        CHECK(batch.end()) ;
+        int calls = 0 ;
+        CHECK(batch.commit([&] (bool, bool) {
+            calls ++ ;
+            return true ;
+        })) ;
+        CHECK_EQ(calls, 0) ;
+        CHECK_EQ(batch.count_commits(), 0) ;
+    }
+
+    SUBCASE("Failure of the commit is reported") {
+        UpdateBatch batch ;
+        batch.defer_layout() ;
+        CHECK_FALSE(batch.commit([] (bool, bool) {return false ;})) ;
+        CHECK_EQ(batch.count_commits(), 1) ;
+    }
+}
@@ -62,4 +62,150 @@ TEST_CASE("Bits test: ") {
 
         CHECK_EQ(value, 0x112f88fc) ;
     }
+
+    SUBCASE("count_trailing_zeros") {
+        CHECK_EQ(util::count_trailing_zeros(1), 0) ;
+        CHECK_EQ(util::count_trailing_zeros(0b101000), 3) ;
+        CHECK_EQ(util::count_trailing_zeros(0x100000000ull), 32) ;
+        CHECK_EQ(util::count_trailing_zeros(0x8000000000000000ull), 63) ;
+        CHECK_EQ(util::count_trailing_zeros(~0ull), 0) ;
+    }
+}
+
+TEST_CASE("StateBits test: ") {
+    SUBCASE("Flush only the changed states") {
+        StateBits bits{200} ;
+        CHECK_EQ(bits.size(), 200) ;
+        CHECK_FALSE(bits.is_dirty()) ;
+
+        bits.set(3, true) ;
+        bits.set(130, true) ;
+        bits.set(131, true) ;
+        bits.set(131, false) ;  // Restored before flush
+        CHECK(bits.test(3)) ;
+        CHECK(bits.test(130)) ;
+        CHECK_FALSE(bits.test(131)) ;
+        CHECK_EQ(bits.count_dirty_words(), 2) ;
+
+        std::vector<std::pair<std::size_t, bool>> changes ;
+        CHECK(bits.flush([&changes] (std::size_t index, bool value) {
+            changes.emplace_back(index, value) ;
+            return true ;
+        })) ;
+        std::sort(changes.begin(), changes.end()) ;
+        REQUIRE_EQ(changes.size(), 2) ;
+        CHECK_EQ(changes[0].first, 3) ;
+        CHECK_EQ(changes[1].first, 130) ;
+        CHECK(changes[1].second) ;
+        CHECK_FALSE(bits.is_dirty()) ;
+
+        // Nothing is changed.
+        bits.set(3, true) ;
+        changes.clear() ;
+        CHECK(bits.flush([&changes] (std::size_t index, bool value) {
+            changes.emplace_back(index, value) ;
+            return true ;
+        })) ;
+        CHECK(changes.empty()) ;
+    }
+
+    SUBCASE("Failed states are visited again") {
+        StateBits bits{10} ;
+        bits.set(1, true) ;
+        bits.set(2, true) ;
+        std::size_t calls = 0 ;
+        CHECK_FALSE(bits.flush([&calls] (std::size_t, bool) {
+            calls ++ ;
+            return false ;
+        })) ;
+        CHECK_EQ(calls, 1) ;
+        CHECK(bits.is_dirty()) ;
+
+        calls = 0 ;
+        CHECK(bits.flush([&calls] (std::size_t, bool) {
+            calls ++ ;
+            return true ;
+        })) ;
+        CHECK_EQ(calls, 2) ;
+    }
+
+    SUBCASE("Assigned states are not flushed") {
+        StateBits bits{100} ;
+        bits.set(5, true) ;
+        bits.assign(70, true) ;
+        CHECK(bits.test(70)) ;
+
+        // A pending change is dropped when the state is assigned as shown.
+        bits.set(71, true) ;
+        bits.assign(71, false) ;
+        std::vector<std::size_t> changed ;
+        CHECK(bits.flush([&changed] (std::size_t index, bool) {
+            changed.push_back(index) ;
+            return true ;
+        })) ;
+        CHECK_EQ(changed, std::vector<std::size_t>{5}) ;
+
+        bits.set(70, false) ;
+        changed.clear() ;
+        CHECK(bits.flush([&changed] (std::size_t index, bool) {
+            changed.push_back(index) ;
+            return true ;
+        })) ;
+        CHECK_EQ(changed, std::vector<std::size_t>{70}) ;
+    }
+
+    SUBCASE("Resize") {
+        StateBits bits ;
+        for(int i = 0 ; i < 70 ; i ++) {
+            bits.push_back() ;
+        }
+        bits.set(65, true) ;
+        bits.set(69, true) ;
+        bits.resize(66) ;
+        CHECK(bits.test(65)) ;
+        bits.resize(70) ;
+        CHECK_FALSE(bits.test(69)) ;
+
+        bits.resize(10) ;
+        CHECK_EQ(bits.count_dirty_words(), 0) ;
+        bits.clear() ;
+        CHECK_EQ(bits.size(), 0) ;
+    }
+
+    SUBCASE("Moving focus over 10k menus visits O(changed) words") {
+        StateBits bits{10000} ;
+        std::size_t visited = 0 ;
+        auto count = [&visited] (std::size_t, bool) {
+            visited ++ ;
+            return true ;
+        } ;
+        int focus = -1 ;
+        std::vector<bool> reference(10000, false) ;
+        std::size_t mismatches = 0 ;
+        for(int step = 0 ; step < 10000 ; step ++) {
+            auto next = (step * 37) % 10000 ;
+            if(focus >= 0) {
+                bits.set(static_cast<std::size_t>(focus), false) ;
+                reference[static_cast<std::size_t>(focus)] = false ;
+            }
+            bits.set(static_cast<std::size_t>(next), true) ;
+            reference[static_cast<std::size_t>(next)] = true ;
+            focus = next ;
+
+            // At most two words are dirty per step.
+            if(bits.count_dirty_words() > 2) {
+                mismatches ++ ;
+            }
+            bits.flush(count) ;
+        }
+        CHECK_EQ(mismatches, 0) ;
+        // The first step turns on one menu, and the others move the focus.
+        CHECK_EQ(visited, 1 + 2 * 9999) ;
+        for(std::size_t i = 0 ; i < reference.size() ; i ++) {
+            if(bits.test(i) != reference[i]) {
+                mismatches ++ ;
+            }
+        }
+        CHECK_EQ(mismatches, 0) ;
+    }
 }
@@ -4,7 +4,139 @@ using namespace fluent_tray ;
 
 
 TEST_CASE("Color test: ") {
-    auto color = RGB(124, 214, 122) ;
+    auto color = util::rgb(124, 214, 122) ;
     unsigned char expected_color = 188 ;
     CHECK_EQ(util::rgb2gray(color), expected_color) ;
 }
+
+TEST_CASE("Taskbar color sampling test: ") {
+    SUBCASE("Median") {
+        CHECK_EQ(util::calculate_median_color(nullptr, 0), 0) ;
+
+        std::vector<std::uint32_t> pixels = {
+            0xFF101010, 0xFF202020, 0xFFFFFFFF, 0xFF303030, 0xFF000000} ;
+        CHECK_EQ(util::calculate_median_color(pixels.data(), pixels.size()), 0x202020) ;
+
+        std::vector<std::uint32_t> channels = {0xFF0000FF, 0xFF00FF00, 0xFFFF0000} ;
+        CHECK_EQ(util::calculate_median_color(channels.data(), channels.size()), 0x000000) ;
+    }
+
+    SUBCASE("Robust mean ignores outliers") {
+        // Taskbar background with an icon and wallpaper bleeding.
+        std::vector<std::uint32_t> pixels(1000, 0xFF202428) ;
+        for(std::size_t i = 0 ; i < pixels.size() ; i += 2) {
+            pixels[i] = 0xFF222628 ;
+        }
+        for(std::size_t i = 100 ; i < 140 ; i ++) {
+            pixels[i] = 0xFF0078D4 ;
+        }
+        pixels[999] = 0xFFFFFFFF ;
+
+        auto color = util::calculate_robust_mean_color(pixels.data(), pixels.size()) ;
+        CHECK_EQ(color, 0x212528) ;
+        CHECK_EQ(util::argb2colorref(color), util::rgb(0x21, 0x25, 0x28)) ;
+    }
+
+    SUBCASE("Parity with the scalar reference") {
+        std::uint32_t seed = 12345 ;
+        auto next = [&seed] {
+            seed = seed * 1664525u + 1013904223u ;
+            return seed ;
+        } ;
+
+        for(std::size_t n : {0, 1, 3, 4, 5, 64, 257, 1023}) {
+            std::vector<std::uint32_t> pixels(n) ;
+            for(auto& px : pixels) {
+                // Noisy gray with random outliers.
+                auto v = 0x80 + static_cast<int>(next() % 32) - 16 ;
+                px = 0xFF000000 | (v << 16) | (v << 8) | static_cast<std::uint32_t>(v) ;
+                if(next() % 8 == 0) {
+                    px = next() ;
+                }
+            }
+            for(unsigned char tolerance : {0, 8, 24, 255}) {
+                CHECK_EQ(
+                    util::calculate_robust_mean_color(pixels.data(), n, tolerance),
+                    util::calculate_robust_mean_color_scalar(pixels.data(), n, tolerance)) ;
+            }
+        }
+    }
+}
+
+TEST_CASE("Contrast test: ") {
+    SUBCASE("sRGB linearization table") {
+        CHECK_EQ(util::srgb2linear(0), 0) ;
+        CHECK_EQ(util::srgb2linear(255), 65535) ;
+        CHECK_EQ(util::srgb2linear(10), 199) ;   // linear segment
+        CHECK_EQ(util::srgb2linear(128), 14146) ;
+        for(int v = 1 ; v < 256 ; v ++) {
+            CHECK_GT(util::srgb2linear(static_cast<unsigned char>(v)),
+                     util::srgb2linear(static_cast<unsigned char>(v - 1))) ;
+        }
+
+        // The table can be used in constant expressions.
+        static_assert(util::srgb2linear(255) == 65535, "") ;
+        static_assert(util::calculate_luminance(util::rgb(0, 0, 0)) == 0, "") ;
+    }
+
+    SUBCASE("Luminance") {
+        CHECK_EQ(util::calculate_luminance(util::rgb(0, 0, 0)), 0) ;
+        CHECK_GE(util::calculate_luminance(util::rgb(255, 255, 255)), 65530) ;
+        CHECK_LT(util::calculate_luminance(util::rgb(0, 0, 255)),
+                 util::calculate_luminance(util::rgb(255, 0, 0))) ;
+        CHECK_LT(util::calculate_luminance(util::rgb(255, 0, 0)),
+                 util::calculate_luminance(util::rgb(0, 255, 0))) ;
+    }
+
+    SUBCASE("Parity of batch luminance with the scalar reference") {
+        std::uint32_t seed = 6789 ;
+        for(std::size_t n : {0, 1, 7, 8, 9, 64, 1001}) {
+            std::vector<std::uint32_t> pixels(n) ;
+            for(auto& px : pixels) {
+                seed = seed * 1664525u + 1013904223u ;
+                px = seed ;
+            }
+            if(n > 0) {
+                pixels[0] = 0xFFFFFFFF ;
+            }
+            std::vector<std::uint16_t> actual(n), expected(n) ;
+            util::calculate_luminances(pixels.data(), n, actual.data()) ;
+            util::calculate_luminances_scalar(pixels.data(), n, expected.data()) ;
+            CHECK_EQ(actual, expected) ;
+        }
+    }
+
+    SUBCASE("WCAG contrast ratio") {
+        auto black = util::calculate_luminance(util::rgb(0, 0, 0)) ;
+        auto white = util::calculate_luminance(util::rgb(255, 255, 255)) ;
+        CHECK_EQ(util::calculate_contrast_ratio(white, black), doctest::Approx(21.0).epsilon(0.001)) ;
+        CHECK_EQ(util::calculate_contrast_ratio(black, white), doctest::Approx(21.0).epsilon(0.001)) ;
+        CHECK_EQ(util::calculate_contrast_ratio(white, white), doctest::Approx(1.0)) ;
+
+        // #777777 on white is about 4.48:1.
+        auto gray = util::calculate_luminance(util::rgb(0x77, 0x77, 0x77)) ;
+        CHECK_EQ(util::calculate_contrast_ratio(gray, white), doctest::Approx(4.48).epsilon(0.01)) ;
+    }
+
+    SUBCASE("APCA contrast") {
+        auto black = util::rgb(0, 0, 0) ;
+        auto white = util::rgb(255, 255, 255) ;
+        CHECK_EQ(util::calculate_apca_contrast(black, white), doctest::Approx(106.04).epsilon(0.01)) ;
+        CHECK_EQ(util::calculate_apca_contrast(white, black), doctest::Approx(-107.88).epsilon(0.01)) ;
+        CHECK_EQ(util::calculate_apca_contrast(white, white), 0.0) ;
+    }
+
+    SUBCASE("Pick the best candidate") {
+        const std::uint32_t candidates[] = {util::rgb(0, 0, 0), util::rgb(255, 255, 255)} ;
+        CHECK_EQ(util::pick_contrast_color(util::rgb(32, 32, 32), candidates, 2), util::rgb(255, 255, 255)) ;
+        CHECK_EQ(util::pick_contrast_color(util::rgb(240, 240, 240), candidates, 2), util::rgb(0, 0, 0)) ;
+        CHECK_EQ(util::pick_contrast_color(util::rgb(0, 0, 0), candidates, 0), util::invalid_color) ;
+
+        // A mid-tone orange has a higher WCAG contrast with black text,
+        // though its gray value is below 128.
+        auto orange = util::rgb(0xE0, 0x70, 0x00) ;
+        CHECK_LT(util::rgb2gray(orange), 128) ;
+        CHECK_EQ(util::pick_contrast_color(
+            orange, candidates, 2, util::ContrastMetric::WCAG), util::rgb(0, 0, 0)) ;
+    }
+}
@@ -0,0 +1,214 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+namespace
+{
+    // Apply the operations by position.
+    std::vector<int> apply(
+            std::vector<int> live,
+            const std::vector<int>& desired,
+            const std::vector<DiffOp>& ops) {
+        for(const auto& op : ops) {
+            switch(op.type) {
+                case DiffOpType::REMOVE:
+                    live.erase(live.begin() + static_cast<std::ptrdiff_t>(op.from)) ;
+                    break ;
+                case DiffOpType::INSERT:
+                    live.insert(
+                        live.begin() + static_cast<std::ptrdiff_t>(op.to),
+                        desired[op.source]) ;
+                    break ;
+                case DiffOpType::MOVE: {
+                    auto key = live[op.from] ;
+                    live.erase(live.begin() + static_cast<std::ptrdiff_t>(op.from)) ;
+                    live.insert(live.begin() + static_cast<std::ptrdiff_t>(op.to), key) ;
+                    break ;
+                }
+            }
+        }
+        return live ;
+    }
+
+    // Apply the operations by handle as FluentTray::reconcile_menus does.
+    std::vector<int> apply_by_handle(
+            const KeyedDiff<int>& diff,
+            const std::vector<int>& live,
+            const std::vector<int>& desired,
+            const std::vector<DiffOp>& ops) {
+        SlotMap<int> slots ;
+        std::vector<SlotHandle> live_handles ;
+        for(auto key : live) {
+            live_handles.push_back(slots.push_back(key)) ;
+        }
+        std::vector<SlotHandle> placed(desired.size(), SlotHandle{0, 0}) ;
+        for(std::size_t i = 0 ; i < desired.size() ; i ++) {
+            std::size_t index ;
+            if(diff.find_live(i, index)) {
+                placed[i] = live_handles[index] ;
+            }
+        }
+        auto next_of = [&placed] (std::size_t source) {
+            return source + 1 < placed.size() ? placed[source + 1] : SlotHandle{0, 0} ;
+        } ;
+        for(const auto& op : ops) {
+            switch(op.type) {
+                case DiffOpType::REMOVE:
+                    slots.erase(live_handles[op.from]) ;
+                    break ;
+                case DiffOpType::INSERT:
+                    placed[op.source] = slots.insert_before(next_of(op.source), desired[op.source]) ;
+                    break ;
+                case DiffOpType::MOVE:
+                    slots.move_before(placed[op.source], next_of(op.source)) ;
+                    break ;
+            }
+        }
+        return std::vector<int>(slots.begin(), slots.end()) ;
+    }
+
+    std::size_t count_ops(const std::vector<DiffOp>& ops, DiffOpType type) {
+        return static_cast<std::size_t>(std::count_if(
+            ops.begin(), ops.end(),
+            [type] (const DiffOp& op) {return op.type == type ;})) ;
+    }
+
+    // The length of the longest increasing subsequence of the desired indices in the live order.
+    std::size_t count_still(const std::vector<int>& live, const std::vector<int>& desired) {
+        std::vector<std::size_t> order ;
+        for(auto key : live) {
+            auto itr = std::find(desired.begin(), desired.end(), key) ;
+            if(itr != desired.end()) {
+                order.push_back(static_cast<std::size_t>(itr - desired.begin())) ;
+            }
+        }
+        std::vector<std::size_t> tails ;
+        for(auto value : order) {
+            auto itr = std::lower_bound(tails.begin(), tails.end(), value) ;
+            if(itr == tails.end()) {
+                tails.push_back(value) ;
+            }
+            else {
+                *itr = value ;
+            }
+        }
+        return tails.size() ;
+    }
+}
+
+TEST_CASE("KeyedDiff test: ") {
+    KeyedDiff<int> diff ;
+    std::vector<DiffOp> ops ;
+
+    SUBCASE("Same sequences need no operation") {
+        std::vector<int> keys{1, 2, 3, 4} ;
+        CHECK(diff.set_desired(keys)) ;
+        diff.diff(keys, ops) ;
+        CHECK(ops.empty()) ;
+    }
+
+    SUBCASE("One moved element is one move") {
+        std::vector<int> live{1, 2, 3, 4, 5, 6} ;
+        std::vector<int> desired{1, 5, 2, 3, 4, 6} ;
+        CHECK(diff.set_desired(desired)) ;
+        diff.diff(live, ops) ;
+        CHECK_EQ(ops.size(), 1) ;
+        CHECK(ops[0].type == DiffOpType::MOVE) ;
+        CHECK_EQ(apply(live, desired, ops), desired) ;
+    }
+
+    SUBCASE("Insertions and removals") {
+        std::vector<int> live{1, 2, 3, 4} ;
+        std::vector<int> desired{0, 2, 5, 4, 6} ;
+        CHECK(diff.set_desired(desired)) ;
+        diff.diff(live, ops) ;
+        CHECK_EQ(count_ops(ops, DiffOpType::REMOVE), 2) ;
+        CHECK_EQ(count_ops(ops, DiffOpType::INSERT), 3) ;
+        CHECK_EQ(count_ops(ops, DiffOpType::MOVE), 0) ;
+        CHECK_EQ(apply(live, desired, ops), desired) ;
+
+        // The removals come first in descending order.
+        CHECK(ops[0].type == DiffOpType::REMOVE) ;
+        CHECK(ops[1].type == DiffOpType::REMOVE) ;
+        CHECK_GT(ops[0].from, ops[1].from) ;
+    }
+
+    SUBCASE("Reversed sequence") {
+        std::vector<int> live, desired ;
+        for(int i = 0 ; i < 100 ; i ++) {
+            live.push_back(i) ;
+            desired.push_back(99 - i) ;
+        }
+        CHECK(diff.set_desired(desired)) ;
+        diff.diff(live, ops) ;
+        CHECK_EQ(count_ops(ops, DiffOpType::MOVE), 99) ;
+        CHECK_EQ(apply(live, desired, ops), desired) ;
+    }
+
+    SUBCASE("Duplicated keys") {
+        CHECK_FALSE(diff.set_desired(std::vector<int>{1, 2, 1})) ;
+
+        std::vector<int> desired{1, 2} ;
+        CHECK(diff.set_desired(desired)) ;
+        std::vector<int> live{2, 1, 2} ;
+        diff.diff(live, ops) ;
+        CHECK_EQ(count_ops(ops, DiffOpType::REMOVE), 1) ;
+        CHECK_EQ(apply(live, desired, ops), desired) ;
+
+        std::size_t index ;
+        CHECK(diff.find(2, index)) ;
+        CHECK_EQ(index, 1) ;
+        CHECK_FALSE(diff.find(3, index)) ;
+    }
+
+    SUBCASE("Random edits of a large sequence") {
+        std::uint32_t seed = 2024 ;
+        auto next = [&seed] (std::size_t n) {
+            seed = seed * 1664525u + 1013904223u ;
+            return static_cast<std::size_t>(seed >> 8) % n ;
+        } ;
+
+        std::vector<int> live ;
+        for(int i = 0 ; i < 5000 ; i ++) {
+            live.push_back(i) ;
+        }
+        int next_key = 5000 ;
+        bool ok = true ;
+        for(int round = 0 ; round < 20 ; round ++) {
+            // Regenerate the description with a few changes like an application would.
+            auto desired = live ;
+            for(int k = 0 ; k < 50 ; k ++) {
+                auto i = next(desired.size()) ;
+                switch(next(3)) {
+                    case 0:
+                        desired.erase(desired.begin() + static_cast<std::ptrdiff_t>(i)) ;
+                        break ;
+                    case 1:
+                        desired.insert(desired.begin() + static_cast<std::ptrdiff_t>(i), next_key ++) ;
+                        break ;
+                    default: {
+                        auto key = desired[i] ;
+                        desired.erase(desired.begin() + static_cast<std::ptrdiff_t>(i)) ;
+                        desired.insert(
+                            desired.begin() + static_cast<std::ptrdiff_t>(next(desired.size() + 1)), key) ;
+                        break ;
+                    }
+                }
+            }
+
+            if(!diff.set_desired(desired)) {
+                ok = false ;
+                break ;
+            }
+            diff.diff(live, ops) ;
+            auto kept = live.size() - count_ops(ops, DiffOpType::REMOVE) ;
+            ok = ok
+                && apply(live, desired, ops) == desired
+                && apply_by_handle(diff, live, desired, ops) == desired
+                && count_ops(ops, DiffOpType::MOVE) == kept - count_still(live, desired)
+                && count_ops(ops, DiffOpType::INSERT) == desired.size() - kept ;
+            live = desired ;
+        }
+        CHECK(ok) ;
+    }
+}
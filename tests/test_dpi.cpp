@@ -0,0 +1,109 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+
+TEST_CASE("DPI scaling test: ") {
+    SUBCASE("Scale sizes") {
+        CHECK_EQ(util::scale_for_dpi(10, 96), 10) ;
+        CHECK_EQ(util::scale_for_dpi(10, 120), 13) ;   // 12.5 is rounded up
+        CHECK_EQ(util::scale_for_dpi(10, 144), 15) ;
+        CHECK_EQ(util::scale_for_dpi(5, 168), 9) ;     // 8.75
+        CHECK_EQ(util::scale_for_dpi(20, 192), 40) ;
+        CHECK_EQ(util::scale_for_dpi(0, 192), 0) ;
+
+        // Negative font heights keep the sign.
+        CHECK_EQ(util::scale_for_dpi(-10, 120), -13) ;
+
+        static_assert(util::scale_for_dpi(10, 192) == 20, "") ;
+    }
+
+    SUBCASE("DPI buckets") {
+        CHECK_EQ(util::to_dpi_bucket(96), 96) ;
+        CHECK_EQ(util::to_dpi_bucket(100), 96) ;
+        CHECK_EQ(util::to_dpi_bucket(107), 96) ;
+        CHECK_EQ(util::to_dpi_bucket(108), 120) ;
+        CHECK_EQ(util::to_dpi_bucket(120), 120) ;
+        CHECK_EQ(util::to_dpi_bucket(144), 144) ;
+        CHECK_EQ(util::to_dpi_bucket(192), 192) ;
+        CHECK_EQ(util::to_dpi_bucket(0), 24) ;
+        for(unsigned int dpi = 36 ; dpi < 1000 ; dpi ++) {
+            auto bucket = util::to_dpi_bucket(dpi) ;
+            CHECK_EQ(bucket % 24, 0) ;
+            CHECK_LE(bucket, dpi + 12) ;
+            CHECK_GT(bucket + 12, dpi) ;
+        }
+    }
+
+    SUBCASE("Scale menu metrics") {
+        MenuMetrics metrics{20, 5, 5, 10, 5} ;
+        auto scaled = metrics.scale(144) ;
+        CHECK_EQ(scaled.font_size, 30) ;
+        CHECK_EQ(scaled.x_margin, 8) ;
+        CHECK_EQ(scaled.y_margin, 8) ;
+        CHECK_EQ(scaled.x_pad, 15) ;
+        CHECK_EQ(scaled.y_pad, 8) ;
+
+        auto same = metrics.scale(96) ;
+        CHECK_EQ(same.font_size, metrics.font_size) ;
+        CHECK_EQ(same.x_pad, metrics.x_pad) ;
+    }
+}
+
+TEST_CASE("DpiCache test: ") {
+    struct Resource {
+        unsigned int bucket ;
+        int id ;
+    } ;
+
+    int next_id = 0 ;
+    auto create = [&next_id] (unsigned int bucket, Resource& res) {
+        res.bucket = bucket ;
+        res.id = next_id ++ ;
+        return true ;
+    } ;
+
+    SUBCASE("Reuse prepared resources") {
+        DpiCache<Resource> cache ;
+        auto res = cache.get(96, create) ;
+        REQUIRE(res != nullptr) ;
+        CHECK_EQ(res->bucket, 96) ;
+        CHECK_EQ(res->id, 0) ;
+
+        // Moving to a 150% monitor and back.
+        CHECK_EQ(cache.get(144, create)->id, 1) ;
+        CHECK_EQ(cache.get(96, create)->id, 0) ;
+        CHECK_EQ(cache.get(144, create)->id, 1) ;
+
+        // Same bucket
+        CHECK_EQ(cache.get(100, create)->id, 0) ;
+
+        CHECK_EQ(cache.size(), 2) ;
+        CHECK_EQ(cache.count_creations(), 2) ;
+    }
+
+    SUBCASE("Failure is not cached") {
+        DpiCache<Resource> cache ;
+        auto fail = [] (unsigned int, Resource&) {return false ;} ;
+        CHECK(cache.get(120, fail) == nullptr) ;
+        CHECK_EQ(cache.size(), 0) ;
+        CHECK_EQ(cache.get(120, create)->bucket, 120) ;
+        CHECK_EQ(cache.count_creations(), 1) ;
+    }
+
+    SUBCASE("Release all resources") {
+        DpiCache<Resource> cache ;
+        cache.get(96, create) ;
+        cache.get(192, create) ;
+
+        std::vector<int> released ;
+        cache.clear([&released] (Resource& res) {
+            released.push_back(res.id) ;
+        }) ;
+        CHECK_EQ(released, std::vector<int>{0, 1}) ;
+        CHECK_EQ(cache.size(), 0) ;
+
+        // Prepared again after clearing.
+        CHECK_EQ(cache.get(96, create)->id, 2) ;
+    }
+}
@@ -0,0 +1,308 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+namespace
+{
+    std::uint32_t next_random(std::uint32_t& seed) {
+        seed = seed * 1664525u + 1013904223u ;
+        return seed >> 8 ;
+    }
+
+    std::wstring make_label(std::uint32_t& seed, std::uint32_t max_length) {
+        static const wchar_t letters[] = L"abcdeABCDE -_.xyz" ;
+        std::wstring label ;
+        auto length = next_random(seed) % max_length ;
+        for(std::uint32_t i = 0 ; i < length ; i ++) {
+            label.push_back(letters[next_random(seed) % 17]) ;
+        }
+        return label ;
+    }
+
+    std::vector<std::uint16_t> to_units(const std::wstring& text) {
+        std::vector<std::uint16_t> units ;
+        for(auto c : PrefixIndex::fold(text)) {
+            units.push_back(static_cast<std::uint16_t>(c)) ;
+        }
+        return units ;
+    }
+
+    bool is_subsequence(const std::vector<std::uint16_t>& text, const std::vector<std::uint16_t>& query) {
+        std::size_t qi = 0 ;
+        for(auto c : text) {
+            if(qi < query.size() && c == query[qi]) {
+                qi ++ ;
+            }
+        }
+        return qi == query.size() ;
+    }
+
+    bool same_matches(const std::vector<FuzzyMatch>& lhs, const std::vector<FuzzyMatch>& rhs) {
+        if(lhs.size() != rhs.size()) {
+            return false ;
+        }
+        for(std::size_t i = 0 ; i < lhs.size() ; i ++) {
+            if(lhs[i].item != rhs[i].item || lhs[i].score != rhs[i].score) {
+                return false ;
+            }
+        }
+        return true ;
+    }
+}
+
+TEST_CASE("Fuzzy kernel test: ") {
+    SUBCASE("Find code unit parity") {
+        std::uint32_t seed = 1 ;
+        std::vector<std::uint16_t> text(300) ;
+        for(auto& c : text) {
+            c = static_cast<std::uint16_t>(next_random(seed) % 40 + 0x60) ;
+        }
+        text[200] = 0xFFEE ;
+        for(std::size_t offset = 0 ; offset < 9 ; offset ++) {
+            for(std::size_t n = 0 ; n + offset <= text.size() ; n += 7) {
+                for(std::uint16_t c : {std::uint16_t(0x61), std::uint16_t(0x87), std::uint16_t(0xFFEE), std::uint16_t(0x20)}) {
+                    CHECK_EQ(
+                        util::find_code_unit(text.data() + offset, n, c),
+                        util::find_code_unit_scalar(text.data() + offset, n, c)) ;
+                }
+            }
+        }
+    }
+
+    SUBCASE("Find last code unit parity") {
+        std::uint32_t seed = 5 ;
+        std::vector<std::uint16_t> text(300) ;
+        for(auto& c : text) {
+            c = static_cast<std::uint16_t>(next_random(seed) % 40 + 0x60) ;
+        }
+        text[20] = 0xFFEE ;
+        for(std::size_t offset = 0 ; offset < 9 ; offset ++) {
+            for(std::size_t n = 0 ; n + offset <= text.size() ; n += 7) {
+                for(std::uint16_t c : {std::uint16_t(0x61), std::uint16_t(0x87), std::uint16_t(0xFFEE), std::uint16_t(0x20)}) {
+                    CHECK_EQ(
+                        util::find_last_code_unit(text.data() + offset, n, c),
+                        util::find_last_code_unit_scalar(text.data() + offset, n, c)) ;
+                }
+            }
+        }
+    }
+
+    SUBCASE("Word separator parity") {
+        std::uint32_t seed = 6 ;
+        auto text = to_units(make_label(seed, 1000)) ;
+        for(std::size_t offset = 0 ; offset < 17 ; offset ++) {
+            for(std::size_t n = 0 ; n + offset <= text.size() ; n += 13) {
+                std::vector<std::uint64_t> simd((n + 63) / 64, ~std::uint64_t(0)) ;
+                std::vector<std::uint64_t> scalar((n + 63) / 64) ;
+                util::find_word_separators(text.data() + offset, n, simd.data()) ;
+                util::find_word_separators_scalar(text.data() + offset, n, scalar.data()) ;
+                CHECK_EQ(simd, scalar) ;
+            }
+        }
+    }
+
+    SUBCASE("Mask filter parity") {
+        std::uint32_t seed = 2 ;
+        std::vector<std::uint64_t> masks(1001) ;
+        for(auto& mask : masks) {
+            mask = (std::uint64_t(next_random(seed)) << 40) | (std::uint64_t(next_random(seed)) << 16) | next_random(seed) ;
+        }
+        for(int round = 0 ; round < 50 ; round ++) {
+            auto query = masks[next_random(seed) % masks.size()] & ((std::uint64_t(1) << (round % 64)) | (std::uint64_t(1) << 45) | 0x11) ;
+            for(std::size_t n : {std::size_t(0), std::size_t(1), std::size_t(2), std::size_t(3), masks.size()}) {
+                std::vector<std::uint32_t> simd, scalar ;
+                util::filter_by_mask(masks.data(), n, query, simd) ;
+                util::filter_by_mask_scalar(masks.data(), n, query, scalar) ;
+                CHECK_EQ(simd, scalar) ;
+            }
+        }
+    }
+
+    SUBCASE("Score parity with the scalar reference") {
+        std::uint32_t seed = 3 ;
+        for(int round = 0 ; round < 3000 ; round ++) {
+            auto text = to_units(make_label(seed, 40)) ;
+            auto query = to_units(make_label(seed, 5)) ;
+            int simd_score = -1 ;
+            int scalar_score = -2 ;
+            auto simd = util::fuzzy_score(text.data(), text.size(), query.data(), query.size(), simd_score) ;
+            auto scalar = util::fuzzy_score_scalar(text.data(), text.size(), query.data(), query.size(), scalar_score) ;
+            CHECK_EQ(simd, scalar) ;
+            CHECK_EQ(simd, is_subsequence(text, query)) ;
+            if(simd) {
+                CHECK_EQ(simd_score, scalar_score) ;
+            }
+        }
+    }
+
+    SUBCASE("Score parity of labels in a shared buffer") {
+        std::uint32_t seed = 8 ;
+        std::vector<std::uint16_t> buffer ;
+        std::vector<std::size_t> offsets(1, 0) ;
+        for(int i = 0 ; i < 500 ; i ++) {
+            auto label = to_units(make_label(seed, 40)) ;
+            buffer.insert(buffer.end(), label.begin(), label.end()) ;
+            offsets.push_back(buffer.size()) ;
+        }
+        std::vector<std::uint64_t> separators((buffer.size() + 63) / 64) ;
+        util::find_word_separators(buffer.data(), buffer.size(), separators.data()) ;
+        for(int round = 0 ; round < 3000 ; round ++) {
+            auto i = next_random(seed) % 500 ;
+            auto query = to_units(make_label(seed, 5)) ;
+            auto text = buffer.data() + offsets[i] ;
+            auto n = offsets[i + 1] - offsets[i] ;
+            int simd_score = -1 ;
+            int scalar_score = -2 ;
+            auto simd = util::fuzzy_score(text, n, separators.data(), offsets[i], query.data(), query.size(), simd_score) ;
+            auto scalar = util::fuzzy_score_scalar(text, n, query.data(), query.size(), scalar_score) ;
+            CHECK_EQ(simd, scalar) ;
+            if(simd) {
+                CHECK_EQ(simd_score, scalar_score) ;
+            }
+        }
+    }
+
+    SUBCASE("Scores prefer word starts and consecutive characters") {
+        auto score_of = [] (const std::wstring& label, const std::wstring& query) {
+            auto text = to_units(label) ;
+            auto units = to_units(query) ;
+            int score = 0 ;
+            CHECK(util::fuzzy_score(text.data(), text.size(), units.data(), units.size(), score)) ;
+            return score ;
+        } ;
+        CHECK_GT(score_of(L"Open Folder", L"of"), score_of(L"Proof", L"of")) ;
+        CHECK_GT(score_of(L"settings", L"set"), score_of(L"selected", L"set")) ;
+        CHECK_GT(score_of(L"exit", L"ex"), score_of(L"e--x", L"ex")) ;
+    }
+}
+
+TEST_CASE("FuzzyMatcher test: ") {
+    SUBCASE("Match and rank") {
+        FuzzyMatcher matcher ;
+        matcher.assign({L"Open Folder", L"Proof", L"Exit", L"open file", L""}) ;
+        CHECK_EQ(matcher.size(), 5) ;
+
+        matcher.filter(L"OF") ;
+        CHECK_EQ(matcher.matches().size(), 3) ;
+        std::vector<FuzzyMatch> ranked ;
+        matcher.rank(2, ranked) ;
+        REQUIRE_EQ(ranked.size(), 2) ;
+        CHECK_EQ(ranked[0].item, 0) ;
+        CHECK_EQ(ranked[1].item, 3) ;
+        CHECK_GT(ranked[1].score, matcher.matches()[1].score) ;
+
+        matcher.filter(L"") ;
+        CHECK_EQ(matcher.matches().size(), 5) ;
+        matcher.filter(L"zz") ;
+        CHECK(matcher.matches().empty()) ;
+    }
+
+    SUBCASE("Ranking page by page gives the same order as ranking at once") {
+        std::uint32_t seed = 10 ;
+        std::vector<std::wstring> labels ;
+        for(int i = 0 ; i < 20000 ; i ++) {
+            labels.push_back(make_label(seed, 16)) ;
+        }
+        FuzzyMatcher matcher ;
+        matcher.assign(labels) ;
+        matcher.filter(L"ab") ;
+
+        auto all = matcher.matches() ;
+        std::sort(all.begin(), all.end(), [] (const FuzzyMatch& lhs, const FuzzyMatch& rhs) {
+            return lhs.score > rhs.score || (lhs.score == rhs.score && lhs.item < rhs.item) ;
+        }) ;
+        REQUIRE(all.size() > 100) ;
+        bool same = true ;
+        for(std::size_t page = 20 ; page < all.size() + 20 ; page += 20) {
+            auto count = matcher.rank(page) ;
+            CHECK(count >= (std::min)(page, all.size())) ;
+            for(std::size_t i = page - 20 ; i < (std::min)(page, all.size()) ; i ++) {
+                same = same && matcher.ranked(i).item == all[i].item && matcher.ranked(i).score == all[i].score ;
+            }
+        }
+        CHECK(same) ;
+
+        // A new query ranks from scratch.
+        matcher.filter(L"abc") ;
+        std::vector<FuzzyMatch> ranked ;
+        matcher.rank(5, ranked) ;
+        CHECK(ranked.size() <= 5) ;
+        for(std::size_t i = 1 ; i < ranked.size() ; i ++) {
+            CHECK(ranked[i - 1].score >= ranked[i].score) ;
+        }
+    }
+
+    SUBCASE("Labels are added, removed and replaced incrementally") {
+        std::uint32_t seed = 9 ;
+        std::vector<std::wstring> labels ;
+        for(int i = 0 ; i < 2000 ; i ++) {
+            labels.push_back(make_label(seed, 12)) ;
+        }
+        FuzzyMatcher incremental ;
+        incremental.assign(std::vector<std::wstring>(labels.begin(), labels.begin() + 1500)) ;
+        incremental.append(std::vector<std::wstring>(labels.begin() + 1500, labels.end())) ;
+        incremental.truncate(1800) ;
+        labels.resize(1800) ;
+        labels[7] = L"Open Folder" ;
+        labels[1799] = L"" ;
+        CHECK(incremental.replace(7, L"Open Folder")) ;
+        CHECK(incremental.replace(1799, L"")) ;
+        CHECK_FALSE(incremental.replace(1800, L"x")) ;
+
+        FuzzyMatcher full ;
+        full.assign(labels) ;
+        CHECK_EQ(incremental.size(), full.size()) ;
+        for(const auto query : {L"of", L"a", L"bd-", L""}) {
+            incremental.filter(query) ;
+            full.filter(query) ;
+            CHECK(same_matches(incremental.matches(), full.matches())) ;
+        }
+    }
+
+    SUBCASE("Extended queries reuse the previous matches") {
+        std::uint32_t seed = 4 ;
+        std::vector<std::wstring> labels ;
+        for(int i = 0 ; i < 100000 ; i ++) {
+            labels.push_back(make_label(seed, 24)) ;
+        }
+        FuzzyMatcher incremental ;
+        incremental.assign(labels) ;
+
+        const std::wstring query = L"a-bde" ;
+        for(std::size_t length = 1 ; length <= query.size() ; length ++) {
+            auto prefix = query.substr(0, length) ;
+            auto scored = incremental.count_scored() ;
+            auto previous = incremental.matches().size() ;
+            incremental.filter(prefix) ;
+            if(length > 1) {
+                // Only the previous matches are scored again.
+                CHECK(incremental.count_scored() - scored <= previous) ;
+            }
+
+            FuzzyMatcher full ;
+            full.assign(labels) ;
+            full.filter(prefix) ;
+            CHECK(same_matches(incremental.matches(), full.matches())) ;
+
+            // Parity with a naive scan of all labels
+            std::size_t expected = 0 ;
+            auto units = to_units(prefix) ;
+            for(const auto& label : labels) {
+                expected += is_subsequence(to_units(label), units) ? 1 : 0 ;
+            }
+            CHECK_EQ(incremental.matches().size(), expected) ;
+        }
+
+        // A query not extending the previous one tests all labels again.
+        auto scored = incremental.count_scored() ;
+        incremental.filter(L"x") ;
+        CHECK_GT(incremental.count_scored() - scored, incremental.matches().size() / 2) ;
+
+        std::vector<FuzzyMatch> ranked ;
+        incremental.rank(10, ranked) ;
+        CHECK_EQ(ranked.size(), 10) ;
+        for(std::size_t i = 1 ; i < ranked.size() ; i ++) {
+            CHECK(ranked[i - 1].score >= ranked[i].score) ;
+        }
+    }
+}
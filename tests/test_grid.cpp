@@ -0,0 +1,98 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+
+TEST_CASE("GridLayout test: ") {
+    SUBCASE("Single column") {
+        GridLayout grid ;
+        CHECK(grid.push_back(100)) ;
+        CHECK_FALSE(grid.push_back(80)) ;
+        CHECK(grid.push_back(120)) ;
+        CHECK_EQ(grid.size(), 3) ;
+        CHECK_EQ(grid.count_columns(), 1) ;
+        CHECK_EQ(grid.count_rows(), 3) ;
+        CHECK_EQ(grid.column_width(0), 120) ;
+        CHECK_EQ(grid.column_of(2), 0) ;
+        CHECK_EQ(grid.row_of(2), 2) ;
+        CHECK_EQ(grid.move_horizontally(1, true), 1) ;
+    }
+
+    SUBCASE("Column-major filling") {
+        GridLayout grid{4} ;
+        for(long width : {10, 20, 30, 40, 50, 60, 70, 80, 90, 15}) {
+            grid.push_back(width) ;
+        }
+        CHECK_EQ(grid.count_columns(), 3) ;
+        CHECK_EQ(grid.count_rows(), 4) ;
+        CHECK_EQ(grid.column_width(0), 40) ;
+        CHECK_EQ(grid.column_width(1), 80) ;
+        CHECK_EQ(grid.column_width(2), 90) ;
+
+        CHECK_EQ(grid.column_of(5), 1) ;
+        CHECK_EQ(grid.row_of(5), 1) ;
+        CHECK_EQ(grid.first_of(2), 8) ;
+    }
+
+    SUBCASE("Incremental update of one column") {
+        GridLayout grid{3} ;
+        for(long width : {10, 20, 30, 40, 50, 60}) {
+            grid.push_back(width) ;
+        }
+
+        std::size_t column = 99 ;
+        // Not the widest in the column
+        CHECK_FALSE(grid.update(3, 45, column)) ;
+        CHECK_EQ(column, 1) ;
+        CHECK_EQ(grid.column_width(1), 60) ;
+
+        // The widest label is changed only in the first column.
+        CHECK(grid.update(1, 35, column)) ;
+        CHECK_EQ(column, 0) ;
+        CHECK_EQ(grid.column_width(0), 35) ;
+        CHECK_EQ(grid.column_width(1), 60) ;
+
+        CHECK(grid.update(5, 5, column)) ;
+        CHECK_EQ(column, 1) ;
+        CHECK_EQ(grid.column_width(1), 50) ;
+    }
+
+    SUBCASE("New column is reported") {
+        GridLayout grid{2} ;
+        CHECK(grid.push_back(10)) ;
+        CHECK_FALSE(grid.push_back(5)) ;
+        CHECK(grid.push_back(1)) ;  // Added the second column
+        CHECK_EQ(grid.count_columns(), 2) ;
+    }
+
+    SUBCASE("Horizontal navigation") {
+        // 0 4 8
+        // 1 5 9
+        // 2 6
+        // 3 7
+        GridLayout grid{4} ;
+        for(int i = 0 ; i < 10 ; i ++) {
+            grid.push_back(10) ;
+        }
+        CHECK_EQ(grid.move_horizontally(1, true), 5) ;
+        CHECK_EQ(grid.move_horizontally(5, true), 9) ;
+        CHECK_EQ(grid.move_horizontally(9, true), 1) ;   // wrap around
+        CHECK_EQ(grid.move_horizontally(1, false), 9) ;
+        CHECK_EQ(grid.move_horizontally(9, false), 5) ;
+
+        // The row does not exist in the last column.
+        CHECK_EQ(grid.move_horizontally(6, true), 9) ;
+        CHECK_EQ(grid.move_horizontally(3, false), 9) ;
+    }
+
+    SUBCASE("Change the maximum rows") {
+        GridLayout grid{2} ;
+        grid.push_back(10) ;
+        grid.push_back(10) ;
+        grid.push_back(10) ;
+        grid.set_max_rows(0) ;
+        CHECK_EQ(grid.size(), 0) ;
+        CHECK_EQ(grid.count_columns(), 0) ;
+        CHECK_EQ(grid.count_rows(), 0) ;
+    }
+}
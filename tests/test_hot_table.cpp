@@ -0,0 +1,153 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+namespace
+{
+    // The table only stores and compares the handles, so integers stand in for HWND.
+    using FakeWindow = std::uintptr_t ;
+
+    FakeWindow fake_window(std::size_t n) {
+        return 0x1000 + 16 * n ;
+    }
+}
+
+TEST_CASE("MenuHotTable test: ") {
+    SUBCASE("Lookup by identifier and window") {
+        MenuHotTable<FakeWindow> table ;
+        table.push_back(1, fake_window(1)) ;
+        table.push_back(2, fake_window(2)) ;
+        table.push_back(5, fake_window(5)) ;
+        CHECK_EQ(table.size(), 3) ;
+
+        std::size_t index ;
+        CHECK(table.find_by_id(5, index)) ;
+        CHECK_EQ(index, 2) ;
+        CHECK_EQ(table.window(index), fake_window(5)) ;
+        CHECK_EQ(table.id(index), 5) ;
+        CHECK_FALSE(table.find_by_id(3, index)) ;
+        CHECK_FALSE(table.find_by_id(100, index)) ;
+        CHECK_FALSE(table.find_by_id(0, index)) ;
+
+        CHECK(table.find_by_window(2, fake_window(2), index)) ;
+        CHECK_EQ(index, 1) ;
+        // Same identifier of an unrelated window
+        CHECK_FALSE(table.find_by_window(2, fake_window(7), index)) ;
+    }
+
+    SUBCASE("Insert and erase keep the indices") {
+        MenuHotTable<FakeWindow> table ;
+        for(std::size_t id = 1 ; id <= 5 ; id ++) {
+            table.push_back(id, fake_window(id)) ;
+        }
+        table.insert(1, 9, fake_window(9)) ;  // 1 9 2 3 4 5
+        table.erase(3) ;                       // 1 9 2 4 5
+
+        const std::size_t expected[] = {1, 9, 2, 4, 5} ;
+        REQUIRE_EQ(table.size(), 5) ;
+        for(std::size_t i = 0 ; i < 5 ; i ++) {
+            std::size_t index ;
+            CHECK_EQ(table.id(i), expected[i]) ;
+            CHECK(table.find_by_id(expected[i], index)) ;
+            CHECK_EQ(index, i) ;
+        }
+        std::size_t index ;
+        CHECK_FALSE(table.find_by_id(3, index)) ;
+
+        table.clear() ;
+        CHECK_EQ(table.size(), 0) ;
+        CHECK_FALSE(table.find_by_id(1, index)) ;
+    }
+
+    SUBCASE("Move keeps the rows together") {
+        MenuHotTable<FakeWindow> table ;
+        for(std::size_t id = 1 ; id <= 5 ; id ++) {
+            table.push_back(id, fake_window(id)) ;
+        }
+        table.set_slider(0, true) ;
+        table.move(0, 3) ;
+        CHECK_EQ(table.id(3), 1) ;
+        CHECK_EQ(table.window(3), fake_window(1)) ;
+        CHECK(table.is_slider(3)) ;
+        CHECK_FALSE(table.is_slider(0)) ;
+
+        table.move(4, 0) ;
+        const std::size_t expected[] = {5, 2, 3, 4, 1} ;
+        for(std::size_t i = 0 ; i < 5 ; i ++) {
+            std::size_t index ;
+            CHECK(table.find_by_id(expected[i], index)) ;
+            CHECK_EQ(index, i) ;
+            CHECK_EQ(table.id(i), expected[i]) ;
+        }
+    }
+
+    SUBCASE("Slider flags") {
+        MenuHotTable<FakeWindow> table ;
+        table.push_back(1, fake_window(1)) ;
+        table.push_back(2, fake_window(2)) ;
+        CHECK_FALSE(table.is_slider(0)) ;
+        table.set_slider(1, true) ;
+        CHECK(table.is_slider(1)) ;
+        CHECK_FALSE(table.is_slider(0)) ;
+
+        // Flags move with the rows.
+        table.insert(0, 3, fake_window(3)) ;
+        CHECK(table.is_slider(2)) ;
+        table.set_slider(2, false) ;
+        CHECK_FALSE(table.is_slider(2)) ;
+
+        table.set_submenu(2, true) ;
+        CHECK(table.is_submenu(2)) ;
+        CHECK_FALSE(table.is_slider(2)) ;
+        table.set_slider(2, true) ;
+        CHECK(table.is_submenu(2)) ;
+    }
+
+    SUBCASE("Assign keeps the flags of kept menus") {
+        MenuHotTable<FakeWindow> table ;
+        for(std::size_t id = 1 ; id <= 4 ; id ++) {
+            table.push_back(id, fake_window(id)) ;
+        }
+        table.set_slider(1, true) ;
+        table.set_submenu(3, true) ;
+
+        // Menu 1 is removed, menu 9 is inserted and the others are reordered.
+        table.assign({4, 9, 2, 3}, {fake_window(4), fake_window(9), fake_window(2), fake_window(3)}) ;
+        CHECK_EQ(table.size(), 4) ;
+        std::size_t index ;
+        CHECK_FALSE(table.find_by_id(1, index)) ;
+        CHECK(table.find_by_window(9, fake_window(9), index)) ;
+        CHECK_EQ(index, 1) ;
+        CHECK(table.find_by_id(2, index)) ;
+        CHECK_EQ(index, 2) ;
+        CHECK(table.is_slider(2)) ;
+        CHECK(table.is_submenu(0)) ;
+        CHECK_FALSE(table.is_slider(1)) ;
+        CHECK_FALSE(table.is_submenu(1)) ;
+        CHECK_FALSE(table.is_slider(3)) ;
+    }
+
+    SUBCASE("Parity with linear scan over 10k menus") {
+        MenuHotTable<FakeWindow> table ;
+        std::vector<std::size_t> ids ;
+        for(std::size_t i = 0 ; i < 10000 ; i ++) {
+            // Identifiers are not in the display order after menus are inserted.
+            auto id = 1 + (i * 7919) % 10000 ;
+            ids.push_back(id) ;
+            table.push_back(id, fake_window(id)) ;
+        }
+        std::size_t mismatches = 0 ;
+        for(std::size_t id = 0 ; id <= 10001 ; id ++) {
+            auto itr = std::find(ids.begin(), ids.end(), id) ;
+            std::size_t index ;
+            auto found = table.find_by_window(id, fake_window(id), index) ;
+            if(found != (itr != ids.end())) {
+                mismatches ++ ;
+            }
+            else if(found && index != static_cast<std::size_t>(itr - ids.begin())) {
+                mismatches ++ ;
+            }
+        }
+        CHECK_EQ(mismatches, 0) ;
+    }
+}
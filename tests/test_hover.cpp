@@ -0,0 +1,87 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+using namespace std::chrono ;
+
+
+TEST_CASE_FIXTURE(FakeClock, "HoverCoalescer test with fake clock: ") {
+    SUBCASE("Apply immediately without frame history") {
+        HoverCoalescer hover ;
+        int index = -1 ;
+        CHECK_FALSE(hover.poll(t0, index)) ;
+
+        hover.request(3, t0) ;
+        CHECK(hover.has_pending()) ;
+        CHECK(hover.poll(t0, index)) ;
+        CHECK_EQ(index, 3) ;
+        CHECK_EQ(hover.current(), 3) ;
+        CHECK_FALSE(hover.has_pending()) ;
+        CHECK_EQ(hover.count_avoided_repaints(), 0) ;
+    }
+
+    SUBCASE("At most one transition per frame") {
+        HoverCoalescer hover{milliseconds(16)} ;
+        int index = -1 ;
+        hover.request(0, t0) ;
+        CHECK(hover.poll(t0, index)) ;
+
+        // Sweep over menus 1, 2, 3 and 4 within one frame.
+        for(int i = 1 ; i <= 4 ; i ++) {
+            hover.request(i, at(i)) ;
+            CHECK_FALSE(hover.poll(at(i), index)) ;
+        }
+        CHECK_EQ(hover.current(), 0) ;
+
+        CHECK(hover.poll(at(16), index)) ;
+        CHECK_EQ(index, 4) ;
+
+        // Menus 1, 2 and 3 were never painted.
+        CHECK_EQ(hover.count_avoided_repaints(), 6) ;
+    }
+
+    SUBCASE("Returning to the applied menu cancels the transition") {
+        HoverCoalescer hover{milliseconds(16)} ;
+        int index = -1 ;
+        hover.request(2, t0) ;
+        CHECK(hover.poll(t0, index)) ;
+
+        hover.request(3, at(1)) ;
+        hover.request(2, at(2)) ;
+        CHECK_FALSE(hover.has_pending()) ;
+        CHECK_FALSE(hover.poll(at(100), index)) ;
+        CHECK_EQ(hover.current(), 2) ;
+        CHECK_EQ(hover.count_avoided_repaints(), 2) ;
+    }
+
+    SUBCASE("Hover intent delay") {
+        HoverCoalescer hover{milliseconds(0), milliseconds(100)} ;
+        int index = -1 ;
+        hover.request(1, t0) ;
+        CHECK_FALSE(hover.poll(at(50), index)) ;
+
+        // Moving to another menu restarts the delay.
+        hover.request(2, at(60)) ;
+        CHECK_FALSE(hover.poll(at(120), index)) ;
+        CHECK(hover.poll(at(160), index)) ;
+        CHECK_EQ(index, 2) ;
+        CHECK_EQ(hover.count_avoided_repaints(), 2) ;
+    }
+
+    SUBCASE("Keyboard selection is applied immediately") {
+        HoverCoalescer hover{milliseconds(16)} ;
+        int index = -1 ;
+        hover.request(5, t0) ;
+        hover.commit(1, t0) ;
+        CHECK_EQ(hover.current(), 1) ;
+        CHECK_FALSE(hover.has_pending()) ;
+        CHECK_FALSE(hover.poll(at(100), index)) ;
+
+        hover.reset() ;
+        CHECK_EQ(hover.current(), -1) ;
+
+        hover.set_policy(milliseconds(0), milliseconds(0)) ;
+        hover.request(1, at(1)) ;
+        CHECK(hover.poll(at(1), index)) ;
+        CHECK_EQ(index, 1) ;
+    }
+}
@@ -0,0 +1,224 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+namespace
+{
+    // Fixed-pitch extents to emulate GetTextExtentExPointW.
+    std::vector<int> make_extents(const std::wstring& text, int advance=10) {
+        std::vector<int> extents(text.length()) ;
+        for(std::size_t i = 0 ; i < text.length() ; i ++) {
+            extents[i] = static_cast<int>(i + 1) * advance ;
+        }
+        return extents ;
+    }
+}
+
+
+TEST_CASE("Label dirty span test: ") {
+    int left = -1, right = -1 ;
+
+    SUBCASE("Same label") {
+        std::wstring text(L"Queue: 12") ;
+        CHECK_FALSE(util::calculate_dirty_span(
+            text, make_extents(text), text, make_extents(text), left, right)) ;
+    }
+
+    SUBCASE("Same width in the middle") {
+        std::wstring old_text(L"Queue: 12 jobs") ;
+        std::wstring new_text(L"Queue: 47 jobs") ;
+        CHECK(util::calculate_dirty_span(
+            old_text, make_extents(old_text),
+            new_text, make_extents(new_text), left, right)) ;
+        CHECK_EQ(left, 70) ;
+        CHECK_EQ(right, 90) ;
+    }
+
+    SUBCASE("Longer label moves the suffix") {
+        std::wstring old_text(L"Queue: 9 jobs") ;
+        std::wstring new_text(L"Queue: 10 jobs") ;
+        CHECK(util::calculate_dirty_span(
+            old_text, make_extents(old_text),
+            new_text, make_extents(new_text), left, right)) ;
+        CHECK_EQ(left, 70) ;
+        CHECK_EQ(right, 140) ;
+    }
+
+    SUBCASE("Shorter label clears the old tail") {
+        std::wstring old_text(L"100%") ;
+        std::wstring new_text(L"10") ;
+        CHECK(util::calculate_dirty_span(
+            old_text, make_extents(old_text),
+            new_text, make_extents(new_text), left, right)) ;
+        CHECK_EQ(left, 20) ;
+        CHECK_EQ(right, 40) ;
+    }
+
+    SUBCASE("Repeated characters") {
+        std::wstring old_text(L"aaa") ;
+        std::wstring new_text(L"aaaa") ;
+        CHECK(util::calculate_dirty_span(
+            old_text, make_extents(old_text),
+            new_text, make_extents(new_text), left, right)) ;
+        CHECK_EQ(left, 30) ;
+        CHECK_EQ(right, 40) ;
+    }
+
+    SUBCASE("Not measured") {
+        std::wstring old_text(L"abc") ;
+        std::wstring new_text(L"abd") ;
+        CHECK(util::calculate_dirty_span(
+            old_text, std::vector<int>{},
+            new_text, make_extents(new_text), left, right)) ;
+        CHECK_EQ(left, 0) ;
+        CHECK_EQ(right, 30) ;
+    }
+}
+
+TEST_CASE("WidthCache test: ") {
+    WidthCache cache ;
+    CHECK_EQ(cache.max_width(), 0) ;
+
+    CHECK(cache.push_back(100)) ;
+    CHECK_FALSE(cache.push_back(80)) ;
+    CHECK(cache.push_back(120)) ;
+    CHECK_FALSE(cache.push_back(120)) ;
+    CHECK_EQ(cache.size(), 4) ;
+    CHECK_EQ(cache.max_width(), 120) ;
+
+    // Not the widest.
+    CHECK_FALSE(cache.update(1, 90)) ;
+    CHECK_FALSE(cache.update(1, 90)) ;
+
+    // One of the two widest menus becomes narrower.
+    CHECK_FALSE(cache.update(2, 60)) ;
+    CHECK_EQ(cache.max_width(), 120) ;
+
+    // The last widest menu becomes narrower.
+    CHECK(cache.update(3, 50)) ;
+    CHECK_EQ(cache.max_width(), 100) ;
+
+    CHECK(cache.update(1, 200)) ;
+    CHECK_EQ(cache.max_width(), 200) ;
+    CHECK_EQ(cache.at(1), 200) ;
+
+    cache.clear() ;
+    CHECK_EQ(cache.size(), 0) ;
+    CHECK_EQ(cache.max_width(), 0) ;
+}
+
+TEST_CASE("Label ellipsis test: ") {
+    std::size_t head = 0, tail = 0 ;
+    const std::wstring text = L"abcdefghij" ;
+    const auto extents = make_extents(text) ;
+
+    SUBCASE("Fit without truncation") {
+        CHECK_FALSE(util::calculate_ellipsis_cut(
+            text, extents, 100, 10, util::EllipsisMode::END, head, tail)) ;
+        CHECK_EQ(head, 10) ;
+        CHECK_EQ(tail, 0) ;
+
+        const std::wstring empty ;
+        CHECK_FALSE(util::calculate_ellipsis_cut(
+            empty, std::vector<int>{}, 0, 10, util::EllipsisMode::END, head, tail)) ;
+    }
+
+    SUBCASE("End ellipsis") {
+        CHECK(util::calculate_ellipsis_cut(
+            text, extents, 55, 10, util::EllipsisMode::END, head, tail)) ;
+        CHECK_EQ(head, 4) ;
+        CHECK_EQ(tail, 0) ;
+    }
+
+    SUBCASE("Middle ellipsis") {
+        CHECK(util::calculate_ellipsis_cut(
+            text, extents, 75, 10, util::EllipsisMode::MIDDLE, head, tail)) ;
+        CHECK_EQ(head, 3) ;
+        CHECK_EQ(tail, 3) ;
+    }
+
+    SUBCASE("Narrower than the ellipsis") {
+        CHECK(util::calculate_ellipsis_cut(
+            text, extents, 5, 10, util::EllipsisMode::MIDDLE, head, tail)) ;
+        CHECK_EQ(head, 0) ;
+        CHECK_EQ(tail, 0) ;
+    }
+
+    SUBCASE("Surrogate pairs are not split") {
+        // a, U+1F600, b, c, d, U+1F600, e
+        const std::wstring emoji = L"a\xD83D\xDE00" L"bcd\xD83D\xDE00" L"e" ;
+        auto emoji_extents = make_extents(emoji) ;
+
+        CHECK(util::calculate_ellipsis_cut(
+            emoji, emoji_extents, 30, 10, util::EllipsisMode::END, head, tail)) ;
+        CHECK_EQ(head, 1) ;
+
+        CHECK(util::calculate_ellipsis_cut(
+            emoji, emoji_extents, 40, 10, util::EllipsisMode::MIDDLE, head, tail)) ;
+        CHECK_EQ(head, 1) ;
+        CHECK_EQ(tail, 1) ;
+
+        CHECK(util::calculate_ellipsis_cut(
+            emoji, emoji_extents, 50, 10, util::EllipsisMode::MIDDLE, head, tail)) ;
+        CHECK_EQ(head, 1) ;
+        CHECK_EQ(tail, 3) ;
+    }
+
+    SUBCASE("Parity with linear scan over 100k labels") {
+        std::uint32_t seed = 42 ;
+        auto next = [&seed] {
+            seed = seed * 1664525u + 1013904223u ;
+            return seed >> 8 ;
+        } ;
+
+        for(int n = 0 ; n < 100000 ; n ++) {
+            std::wstring label(1 + next() % 40, L'x') ;
+            std::vector<int> label_extents(label.length()) ;
+            int sum = 0 ;
+            for(auto& extent : label_extents) {
+                sum += 3 + static_cast<int>(next() % 12) ;  // proportional font
+                extent = sum ;
+            }
+            auto max_width = static_cast<int>(next() % 300) ;
+            auto ellipsis_width = 8 ;
+            auto mode = n % 2 == 0 ? util::EllipsisMode::END : util::EllipsisMode::MIDDLE ;
+
+            auto truncated = util::calculate_ellipsis_cut(
+                label, label_extents, max_width, ellipsis_width, mode, head, tail) ;
+            if(truncated != (sum > max_width)) {
+                FAIL("truncation mismatch") ;
+            }
+            if(!truncated) {
+                continue ;
+            }
+
+            auto len = label.length() ;
+            auto width = [&] (std::size_t h, std::size_t t) {
+                auto head_width = h == 0 ? 0 : label_extents[h - 1] ;
+                auto tail_width = t == 0 ? 0 : sum - label_extents[len - t - 1] ;
+                return head_width + ellipsis_width + tail_width ;
+            } ;
+
+            // Linear scan
+            auto available = (std::max)(max_width - ellipsis_width, 0) ;
+            std::size_t expected_head = 0 ;
+            auto budget = mode == util::EllipsisMode::MIDDLE ? available / 2 : available ;
+            while(expected_head < len && label_extents[expected_head] <= budget) {
+                expected_head ++ ;
+            }
+            std::size_t expected_tail = 0 ;
+            if(mode == util::EllipsisMode::MIDDLE) {
+                while(expected_head + expected_tail < len
+                        && width(expected_head, expected_tail + 1) - ellipsis_width <= available) {
+                    expected_tail ++ ;
+                }
+            }
+            if(head != expected_head || tail != expected_tail) {
+                FAIL("cut mismatch") ;
+            }
+            if(head + tail > 0 && width(head, tail) > max_width) {
+                FAIL("too wide") ;
+            }
+        }
+    }
+}
@@ -1,7 +1,14 @@
 #include "test.hpp"
 
+#include "fluent_tray.hpp"
+
 using namespace fluent_tray ;
 
+// The brush is owned by only one menu.
+static_assert(!std::is_copy_constructible<FluentMenu>::value, "FluentMenu must not be copyable") ;
+static_assert(!std::is_copy_assignable<FluentMenu>::value, "FluentMenu must not be copyable") ;
+static_assert(std::is_move_constructible<FluentMenu>::value, "FluentMenu must be movable") ;
+
 TEST_CASE("FluentMenu Test: ") {
     SUBCASE("Constructor") {
         CHECK_NOTHROW(FluentMenu{}) ;
@@ -55,6 +62,37 @@ TEST_CASE("FluentMenu Test: ") {
 
     }
 
+    SUBCASE("set_label") {
+        FluentMenu menu ;
+        CHECK(menu.set_label("Queue: 10")) ;
+
+        std::string str{} ;
+        CHECK(menu.get_label(str)) ;
+        CHECK_EQ(str, "Queue: 10") ;
+    }
+
+    SUBCASE("value bar") {
+        FluentMenu menu ;
+        CHECK_EQ(menu.bar_style(), BarStyle::NONE) ;
+
+        int changed_value = -1 ;
+        menu.set_bar(
+            BarStyle::SLIDER, ValueBar{0, 10, 3, 2},
+            [&changed_value] (int v) {changed_value = v ; return true ;}) ;
+        CHECK_EQ(menu.bar_style(), BarStyle::SLIDER) ;
+        CHECK_EQ(menu.value(), 3) ;
+        CHECK_EQ(menu.step(), 2) ;
+
+        // Not laid out yet, so nothing is redrawn.
+        RECT dirty_rect ;
+        CHECK(menu.set_value(20, dirty_rect)) ;
+        CHECK_EQ(menu.value(), 10) ;
+        CHECK_EQ(dirty_rect.left, dirty_rect.right) ;
+
+        CHECK(menu.process_value_event()) ;
+        CHECK_EQ(changed_value, 10) ;
+    }
+
     SUBCASE("Callback") {
         CHECK_NOTHROW(FluentMenu{}) ;
 
@@ -0,0 +1,145 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+namespace
+{
+    // The table only stores and compares the handles, so integers stand in for HWND.
+    using FakeWindow = std::uintptr_t ;
+
+    FakeWindow fake_window(std::size_t n) {
+        return 0x1000 + 16 * n ;
+    }
+}
+
+TEST_CASE("MenuIdAllocator test: ") {
+    SUBCASE("Identifiers are reused in the order of release") {
+        MenuIdAllocator ids ;
+        std::size_t id ;
+        for(std::size_t i = 1 ; i <= 4 ; i ++) {
+            CHECK(ids.allocate(id)) ;
+            CHECK_EQ(id, i) ;
+        }
+        CHECK(ids.release(3)) ;
+        CHECK(ids.release(1)) ;
+        CHECK_FALSE(ids.release(1)) ;
+        CHECK_FALSE(ids.release(0)) ;
+        CHECK_FALSE(ids.release(100)) ;
+        CHECK_EQ(ids.size(), 2) ;
+
+        CHECK(ids.allocate(id)) ;
+        CHECK_EQ(id, 3) ;
+        CHECK(ids.allocate(id)) ;
+        CHECK_EQ(id, 1) ;
+        CHECK(ids.allocate(id)) ;
+        CHECK_EQ(id, 5) ;
+        CHECK(ids.is_allocated(5)) ;
+        CHECK_FALSE(ids.is_allocated(6)) ;
+    }
+
+    SUBCASE("Exhaustion and recovery") {
+        MenuIdAllocator ids(3) ;
+        std::size_t id ;
+        CHECK(ids.allocate(id)) ;
+        CHECK(ids.allocate(id)) ;
+        CHECK(ids.allocate(id)) ;
+        CHECK_FALSE(ids.allocate(id)) ;
+        CHECK(ids.release(2)) ;
+        CHECK(ids.allocate(id)) ;
+        CHECK_EQ(id, 2) ;
+
+        ids.clear() ;
+        CHECK_EQ(ids.size(), 0) ;
+        CHECK(ids.allocate(id)) ;
+        CHECK_EQ(id, 1) ;
+    }
+
+    SUBCASE("Identifiers stay within 16 bits over a long session") {
+        MenuIdAllocator ids ;
+        std::vector<std::size_t> live ;
+        std::size_t id ;
+        for(int i = 0 ; i < 40 ; i ++) {
+            CHECK(ids.allocate(id)) ;
+            live.push_back(id) ;
+        }
+        // Rebuilding a section of ten menus 100000 times never exhausts the identifiers.
+        bool ok = true ;
+        for(int round = 0 ; round < 100000 ; round ++) {
+            for(std::size_t i = 30 ; i < live.size() ; i ++) {
+                ok = ok && ids.release(live[i]) ;
+            }
+            for(std::size_t i = 30 ; i < live.size() ; i ++) {
+                ok = ok && ids.allocate(live[i]) && live[i] >= 1 && live[i] <= 0xFFFF ;
+            }
+        }
+        CHECK(ok) ;
+        CHECK_EQ(ids.size(), 40) ;
+    }
+}
+
+TEST_CASE("Dynamic menu ordering test: ") {
+    SUBCASE("Random insert, remove and move against a reference") {
+        // The same operations as FluentTray::insert_menu, remove_menu and move_menu.
+        MenuIdAllocator ids ;
+        SlotMap<std::size_t> menus ;
+        MenuHotTable<FakeWindow> hot ;
+        std::vector<std::size_t> reference ;
+
+        std::uint32_t seed = 12345 ;
+        auto next = [&seed] (std::size_t n) {
+            seed = seed * 1664525u + 1013904223u ;
+            return static_cast<std::size_t>(seed >> 8) % n ;
+        } ;
+
+        std::size_t mismatches = 0 ;
+        for(int step = 0 ; step < 20000 ; step ++) {
+            auto op = next(3) ;
+            if(op == 0 || reference.empty()) {
+                std::size_t id ;
+                if(!ids.allocate(id)) {
+                    mismatches ++ ;
+                    break ;
+                }
+                auto position = next(reference.size() + 1) ;
+                hot.insert(position, id, fake_window(id)) ;
+                menus.insert(position, id) ;
+                reference.insert(reference.begin() + static_cast<std::ptrdiff_t>(position), id) ;
+            }
+            else if(op == 1) {
+                auto index = next(reference.size()) ;
+                ids.release(hot.id(index)) ;
+                hot.erase(index) ;
+                menus.erase(menus.handle_at(index)) ;
+                reference.erase(reference.begin() + static_cast<std::ptrdiff_t>(index)) ;
+            }
+            else {
+                auto from = next(reference.size()) ;
+                auto to = next(reference.size()) ;
+                hot.move(from, to) ;
+                menus.move(from, to) ;
+                auto id = reference[from] ;
+                reference.erase(reference.begin() + static_cast<std::ptrdiff_t>(from)) ;
+                reference.insert(reference.begin() + static_cast<std::ptrdiff_t>(to), id) ;
+            }
+
+            if(ids.size() != reference.size() || menus.size() != reference.size()) {
+                mismatches ++ ;
+                continue ;
+            }
+            // Check only a few rows per step to keep the test fast.
+            for(int k = 0 ; k < 4 && !reference.empty() ; k ++) {
+                auto i = next(reference.size()) ;
+                std::size_t index ;
+                if(menus[i] != reference[i]
+                        || hot.id(i) != reference[i]
+                        || !hot.find_by_window(reference[i], fake_window(reference[i]), index)
+                        || index != i
+                        || !ids.is_allocated(reference[i])) {
+                    mismatches ++ ;
+                }
+            }
+        }
+        CHECK_EQ(mismatches, 0) ;
+        CHECK_EQ(std::vector<std::size_t>(menus.begin(), menus.end()), reference) ;
+    }
+}
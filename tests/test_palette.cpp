@@ -0,0 +1,112 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+
+TEST_CASE("OKLab conversion test: ") {
+    SUBCASE("Cube root") {
+        CHECK_EQ(util::constexpr_cbrt(0.0), 0.0) ;
+        CHECK_EQ(util::constexpr_cbrt(-1.0), 0.0) ;
+        for(double x : {1e-9, 1e-4, 0.008, 0.5, 1.0, 27.0}) {
+            CHECK_EQ(util::constexpr_cbrt(x), doctest::Approx(std::cbrt(x))) ;
+        }
+    }
+
+    SUBCASE("Reference values") {
+        auto white = util::colorref2oklab(util::rgb(255, 255, 255)) ;
+        CHECK_EQ(white.L, doctest::Approx(1.0).epsilon(0.001)) ;
+        CHECK_EQ(white.a, doctest::Approx(0.0).epsilon(0.001)) ;
+        CHECK_EQ(white.b, doctest::Approx(0.0).epsilon(0.001)) ;
+
+        auto red = util::colorref2oklab(util::rgb(255, 0, 0)) ;
+        CHECK_EQ(red.L, doctest::Approx(0.6280).epsilon(0.001)) ;
+        CHECK_EQ(red.a, doctest::Approx(0.2249).epsilon(0.001)) ;
+        CHECK_EQ(red.b, doctest::Approx(0.1258).epsilon(0.001)) ;
+    }
+
+    SUBCASE("Linear to sRGB by table search") {
+        for(int v = 0 ; v < 256 ; v ++) {
+            auto c = static_cast<unsigned char>(v) ;
+            CHECK_EQ(util::linear2srgb(util::srgb2linear(c) / 65535.0), c) ;
+        }
+        CHECK_EQ(util::linear2srgb(-0.5), 0) ;
+        CHECK_EQ(util::linear2srgb(1.5), 255) ;
+    }
+
+    SUBCASE("Round trip") {
+        for(int r = 0 ; r < 256 ; r += 15) {
+            for(int g = 0 ; g < 256 ; g += 15) {
+                for(int b = 0 ; b < 256 ; b += 15) {
+                    auto color = util::rgb(r, g, b) ;
+                    CHECK_EQ(util::oklab2colorref(util::colorref2oklab(color)), color) ;
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Tonal palette test: ") {
+    SUBCASE("Generated at compile time") {
+        constexpr TonalPalette palette(util::rgb(0x20, 0x20, 0x20), 10 / 255.0) ;
+        static_assert(palette.base == util::rgb(0x20, 0x20, 0x20), "") ;
+        static_assert(palette.hover != palette.base, "") ;
+        CHECK_EQ(palette.step, 10 / 255.0) ;
+    }
+
+    SUBCASE("Dark base is lightened evenly") {
+        TonalPalette palette(util::rgb(0x20, 0x20, 0x20), 10 / 255.0) ;
+        auto base = util::colorref2oklab(palette.base) ;
+        auto hover = util::colorref2oklab(palette.hover) ;
+        auto pressed = util::colorref2oklab(palette.pressed) ;
+        CHECK_EQ(hover.L - base.L, doctest::Approx(10 / 255.0).epsilon(0.1)) ;
+        CHECK_EQ(pressed.L - hover.L, doctest::Approx(10 / 255.0).epsilon(0.1)) ;
+
+        // A gray stays gray.
+        CHECK_EQ(util::red_of(palette.hover), util::green_of(palette.hover)) ;
+        CHECK_EQ(util::green_of(palette.hover), util::blue_of(palette.hover)) ;
+        CHECK_GT(util::colorref2oklab(palette.disabled).L, pressed.L) ;
+    }
+
+    SUBCASE("Every role has its own tone") {
+        TonalPalette palette(util::rgb(0x20, 0x20, 0x20), 10 / 255.0) ;
+        auto hover = util::colorref2oklab(palette.hover) ;
+        auto pressed = util::colorref2oklab(palette.pressed) ;
+        auto separator = util::colorref2oklab(palette.separator) ;
+        CHECK_NE(palette.pressed, palette.hover) ;
+        CHECK_NE(palette.separator, palette.pressed) ;
+        CHECK_LT(hover.L, pressed.L) ;
+        CHECK_LT(pressed.L, separator.L) ;
+        CHECK_EQ(separator.L - pressed.L, doctest::Approx(10 / 255.0).epsilon(0.1)) ;
+    }
+
+    SUBCASE("Light base is darkened") {
+        TonalPalette palette(util::rgb(0xF3, 0xF3, 0xF3), 10 / 255.0) ;
+        CHECK_LT(util::colorref2oklab(palette.hover).L, util::colorref2oklab(palette.base).L) ;
+        CHECK_LT(util::colorref2oklab(palette.separator).L, util::colorref2oklab(palette.hover).L) ;
+    }
+
+    SUBCASE("Hue of an accent is kept") {
+        TonalPalette palette(util::rgb(0x00, 0x3E, 0x92), 10 / 255.0) ;
+        auto base = util::colorref2oklab(palette.base) ;
+        auto hover = util::colorref2oklab(palette.hover) ;
+        CHECK_GT(hover.L, base.L) ;
+        CHECK_EQ(std::atan2(hover.b, hover.a), doctest::Approx(std::atan2(base.b, base.a)).epsilon(0.02)) ;
+        CHECK_GT(util::blue_of(palette.hover), util::red_of(palette.hover)) ;
+    }
+
+    SUBCASE("Cache per base color") {
+        TonalPaletteCache cache(2) ;
+        auto hover = cache.get(util::rgb(0x20, 0x20, 0x20), 0.04).hover ;
+        CHECK_EQ(cache.count_generations(), 1) ;
+        CHECK_EQ(cache.get(util::rgb(0x20, 0x20, 0x20), 0.04).hover, hover) ;
+        CHECK_EQ(cache.count_generations(), 1) ;
+
+        cache.get(util::rgb(0x20, 0x20, 0x20), 0.08) ;
+        cache.get(util::rgb(0xF3, 0xF3, 0xF3), 0.04) ;
+        CHECK_EQ(cache.count_generations(), 3) ;
+
+        // The oldest palette was discarded.
+        cache.get(util::rgb(0x20, 0x20, 0x20), 0.04) ;
+        CHECK_EQ(cache.count_generations(), 4) ;
+    }
+}
@@ -0,0 +1,237 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+namespace
+{
+    const TaskbarEdge edges[] = {
+        TaskbarEdge::LEFT, TaskbarEdge::TOP, TaskbarEdge::RIGHT, TaskbarEdge::BOTTOM} ;
+
+    Rect make_taskbar_rect(const Rect& monitor, TaskbarEdge edge, long thickness) {
+        auto rect = monitor ;
+        switch(edge) {
+            case TaskbarEdge::LEFT:
+                rect.right = rect.left + thickness ;
+                break ;
+            case TaskbarEdge::TOP:
+                rect.bottom = rect.top + thickness ;
+                break ;
+            case TaskbarEdge::RIGHT:
+                rect.left = rect.right - thickness ;
+                break ;
+            default:
+                rect.top = rect.bottom - thickness ;
+                break ;
+        }
+        return rect ;
+    }
+
+    Rect make_visible_area(const Rect& monitor, TaskbarEdge edge, long thickness) {
+        auto rect = monitor ;
+        switch(edge) {
+            case TaskbarEdge::LEFT:
+                rect.left += thickness ;
+                break ;
+            case TaskbarEdge::TOP:
+                rect.top += thickness ;
+                break ;
+            case TaskbarEdge::RIGHT:
+                rect.right -= thickness ;
+                break ;
+            default:
+                rect.bottom -= thickness ;
+                break ;
+        }
+        return rect ;
+    }
+
+    MonitorTopology make_topology(
+            const Rect& monitor, TaskbarEdge edge, long thickness, bool autohide) {
+        MonitorTopology topology ;
+        topology.monitor = monitor ;
+        topology.work = autohide ? monitor : make_visible_area(monitor, edge, thickness) ;
+        topology.edge = edge ;
+        topology.taskbar_thickness = thickness ;
+        return topology ;
+    }
+
+    bool contains(const Rect& outer, const Rect& inner) {
+        return outer.left <= inner.left && inner.right <= outer.right
+            && outer.top <= inner.top && inner.bottom <= outer.bottom ;
+    }
+
+    bool intersects(const Rect& a, const Rect& b) {
+        return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom ;
+    }
+}
+
+
+TEST_CASE("Popup placement test: ") {
+    SUBCASE("Detect the taskbar edge") {
+        Rect monitor{0, 0, 1920, 1080} ;
+        for(auto edge : edges) {
+            auto work = make_visible_area(monitor, edge, 48) ;
+            CHECK_EQ(PopupPlacement::detect_taskbar_edge(monitor, work, TaskbarEdge::BOTTOM), edge) ;
+            CHECK_EQ(PopupPlacement::calculate_inset(monitor, work, edge), 48) ;
+        }
+
+        // Auto-hidden taskbar
+        CHECK_EQ(PopupPlacement::detect_taskbar_edge(monitor, monitor, TaskbarEdge::TOP), TaskbarEdge::TOP) ;
+    }
+
+    SUBCASE("Find the monitor") {
+        std::vector<MonitorTopology> monitors = {
+            make_topology(Rect{0, 0, 1920, 1080}, TaskbarEdge::BOTTOM, 48, false),
+            make_topology(Rect{-1280, -200, 0, 824}, TaskbarEdge::BOTTOM, 48, false)} ;
+        CHECK_EQ(PopupPlacement::find_monitor(monitors, Point{100, 100}), 0) ;
+        CHECK_EQ(PopupPlacement::find_monitor(monitors, Point{-1, 0}), 1) ;
+        CHECK_EQ(PopupPlacement::find_monitor(monitors, Point{0, 1079}), 0) ;
+
+        // Out of all monitors
+        CHECK_EQ(PopupPlacement::find_monitor(monitors, Point{3000, 500}), 0) ;
+        CHECK_EQ(PopupPlacement::find_monitor(monitors, Point{-5000, -300}), 1) ;
+
+        Rect popup ;
+        CHECK_FALSE(PopupPlacement::solve(std::vector<MonitorTopology>{}, Point{0, 0}, 10, 10, popup)) ;
+    }
+
+    SUBCASE("Same position as before for a bottom taskbar") {
+        auto topology = make_topology(Rect{0, 0, 1920, 1080}, TaskbarEdge::BOTTOM, 40, false) ;
+        auto popup = PopupPlacement::solve(topology, Point{1500, 1060}, 200, 300) ;
+        CHECK_EQ(popup.left, 1400) ;
+        CHECK_EQ(popup.top, 1080 - (300 + 12 * 40 / 10)) ;
+    }
+
+    SUBCASE("Cascading submenus") {
+        const Rect work{0, 0, 1920, 1040} ;
+
+        // On the right of the menu
+        auto rect = PopupPlacement::solve_cascade(work, Rect{1500, 600, 1700, 630}, 150, 200) ;
+        CHECK_EQ(rect.left, 1700) ;
+        CHECK_EQ(rect.top, 600) ;
+        CHECK_EQ(rect.right - rect.left, 150) ;
+
+        // Flipped to the left near the right edge
+        rect = PopupPlacement::solve_cascade(work, Rect{1700, 600, 1900, 630}, 150, 200) ;
+        CHECK_EQ(rect.left, 1550) ;
+
+        // Kept above the bottom of the work area
+        rect = PopupPlacement::solve_cascade(work, Rect{100, 1000, 300, 1030}, 150, 200) ;
+        CHECK_EQ(rect.left, 300) ;
+        CHECK_EQ(rect.bottom, 1040) ;
+
+        // Too wide for both sides
+        rect = PopupPlacement::solve_cascade(Rect{0, 0, 400, 400}, Rect{100, 0, 300, 30}, 250, 100) ;
+        CHECK_EQ(rect.left, 150) ;
+    }
+
+    SUBCASE("Exhaustive matrix") {
+        const std::vector<std::vector<Rect>> layouts = {
+            {Rect{0, 0, 1920, 1080}},
+            {Rect{0, 0, 1920, 1080}, Rect{-1280, -200, 0, 824}},
+            {Rect{0, 0, 2560, 1440}, Rect{0, -1440, 2560, 0}},
+            {Rect{0, 0, 1366, 768}, Rect{1366, 0, 3286, 1080}, Rect{3286, 300, 4054, 1666}}} ;
+        const long thickness = 48 ;
+
+        std::size_t cases = 0 ;
+        for(const auto& layout : layouts) {
+            for(auto edge : edges) {
+                for(auto autohide : {false, true}) {
+                    std::vector<MonitorTopology> monitors ;
+                    for(const auto& rect : layout) {
+                        monitors.push_back(make_topology(rect, edge, thickness, autohide)) ;
+                    }
+
+                    for(std::size_t m = 0 ; m < layout.size() ; m ++) {
+                        const auto& monitor = layout[m] ;
+                        auto taskbar = make_taskbar_rect(monitor, edge, thickness) ;
+                        auto area = make_visible_area(monitor, edge, thickness) ;
+
+                        std::vector<Point> anchors ;
+                        for(long fx : {0, 1, 2, 3, 4}) {
+                            for(long fy : {0, 1, 2, 3, 4}) {
+                                anchors.push_back(Point{
+                                    monitor.left + fx * (monitor.right - monitor.left - 1) / 4,
+                                    monitor.top + fy * (monitor.bottom - monitor.top - 1) / 4}) ;
+                            }
+                        }
+                        // Icons on the taskbar
+                        for(long f : {1, 2, 3}) {
+                            anchors.push_back(Point{
+                                taskbar.left + f * (taskbar.right - taskbar.left) / 4,
+                                taskbar.top + f * (taskbar.bottom - taskbar.top) / 4}) ;
+                        }
+
+                        const std::vector<std::pair<long, long>> sizes = {
+                            {200, 300}, {1, 1}, {area.right - area.left, 100},
+                            {400, area.bottom - area.top}, {5000, 5000}} ;
+
+                        for(const auto& anchor : anchors) {
+                            for(const auto& size : sizes) {
+                                auto width = size.first ;
+                                auto height = size.second ;
+
+                                Rect popup ;
+                                REQUIRE(PopupPlacement::solve(monitors, anchor, width, height, popup)) ;
+                                cases ++ ;
+
+                                // The size is kept.
+                                CHECK_EQ(popup.right - popup.left, width) ;
+                                CHECK_EQ(popup.bottom - popup.top, height) ;
+
+                                auto fits_x = width <= area.right - area.left ;
+                                auto fits_y = height <= area.bottom - area.top ;
+                                if(fits_x && fits_y) {
+                                    // On the monitor with the anchor and not covered by the taskbar.
+                                    CHECK(contains(area, popup)) ;
+                                    CHECK_FALSE(intersects(taskbar, popup)) ;
+                                }
+                                if(!fits_x) {
+                                    CHECK_EQ(popup.left, area.left) ;
+                                }
+                                if(!fits_y) {
+                                    CHECK_EQ(popup.top, area.top) ;
+                                }
+                                if(!fits_x || !fits_y) {
+                                    continue ;
+                                }
+
+                                // Next to the taskbar
+                                switch(edge) {
+                                    case TaskbarEdge::LEFT:
+                                        CHECK_EQ(popup.left, area.left) ;
+                                        break ;
+                                    case TaskbarEdge::TOP:
+                                        CHECK_EQ(popup.top, area.top) ;
+                                        break ;
+                                    case TaskbarEdge::RIGHT:
+                                        CHECK_EQ(popup.right, (std::max)(area.right - thickness / 5, area.left + width)) ;
+                                        break ;
+                                    default:
+                                        CHECK_EQ(popup.bottom, (std::max)(area.bottom - thickness / 5, area.top + height)) ;
+                                        break ;
+                                }
+
+                                // Centered on the anchor along the taskbar unless clamped.
+                                auto horizontal = edge == TaskbarEdge::TOP || edge == TaskbarEdge::BOTTOM ;
+                                if(horizontal) {
+                                    auto x = anchor.x - width / 2 ;
+                                    if(area.left <= x && x + width <= area.right) {
+                                        CHECK_EQ(popup.left, x) ;
+                                    }
+                                }
+                                else {
+                                    auto y = anchor.y - height / 2 ;
+                                    if(area.top <= y && y + height <= area.bottom) {
+                                        CHECK_EQ(popup.top, y) ;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        CHECK_EQ(cases, 8 * 8 * 28 * 5) ;  // monitors * (edges * autohide) * anchors * sizes
+    }
+}
@@ -0,0 +1,248 @@
+#include "test.hpp"
+
+#include <mutex>
+#include <set>
+
+using namespace fluent_tray ;
+
+namespace
+{
+    // Provider whose result is decided by the test. It fills the items even when pending.
+    // The result may be changed while a worker calls it, and the keys only while no worker runs.
+    struct FakeProvider {
+        std::atomic<ProviderResult> result ;
+        std::vector<std::string> keys ;
+        std::atomic<int> pending ;
+        std::atomic<int> calls ;
+        std::mutex mutex ;
+        std::set<std::thread::id> threads ;
+
+        FakeProvider(ProviderResult result_, const std::vector<std::string>& keys_, int pending_)
+        : result(result_),
+          keys(keys_),
+          pending(pending_),
+          calls(0),
+          mutex(),
+          threads()
+        {}
+
+        ProviderResult operator()(std::vector<MenuSpec>& items) {
+            auto count = ++ calls ;
+            {
+                std::lock_guard<std::mutex> lock(mutex) ;
+                threads.insert(std::this_thread::get_id()) ;
+            }
+            for(const auto& key : keys) {
+                items.push_back(MenuSpec(key, key)) ;
+            }
+            return count <= pending ? ProviderResult::PENDING : result.load() ;
+        }
+    } ;
+
+    // Start the provider and take its result, as two updates of the tray do.
+    bool refresh(SectionCache& cache, FakeClock::time_point now, FakeProvider& provider) {
+        cache.poll(now, std::ref(provider)) ;
+        cache.wait() ;
+        return cache.poll(now, std::ref(provider)) ;
+    }
+
+    // Poll at the same time until the refresh ends, as the updates of the tray do.
+    bool poll_until(SectionCache& cache, FakeClock::time_point now, FakeProvider& provider) {
+        for(int i = 0 ; i < 10000 ; i ++) {
+            if(cache.poll(now, std::ref(provider))) {
+                return true ;
+            }
+            if(!cache.is_refreshing()) {
+                return false ;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1)) ;
+        }
+        return false ;
+    }
+
+    std::vector<std::string> keys_of(const SectionCache& cache) {
+        std::vector<std::string> keys ;
+        for(const auto& item : cache.items()) {
+            keys.push_back(item.key) ;
+        }
+        return keys ;
+    }
+}
+
+TEST_CASE_FIXTURE(FakeClock, "SectionCache test: ") {
+    using std::chrono::milliseconds ;
+
+    SUBCASE("The first opening fills the section") {
+        SectionCache cache(milliseconds(1000), milliseconds(50)) ;
+        FakeProvider provider{ProviderResult::READY, {"a", "b"}, 0} ;
+        CHECK_FALSE(cache.is_fresh(at(0))) ;
+        CHECK(cache.open(at(0))) ;
+        CHECK(cache.is_refreshing()) ;
+
+        // The provider is started on a worker thread by the first poll and its result is taken by the next one.
+        CHECK_FALSE(cache.poll(at(0), std::ref(provider))) ;
+        cache.wait() ;
+        auto on_worker = provider.threads.count(std::this_thread::get_id()) == 0 ;
+        CHECK(on_worker) ;
+        CHECK(cache.poll(at(0), std::ref(provider))) ;
+        CHECK_FALSE(cache.is_refreshing()) ;
+        CHECK_EQ(keys_of(cache), std::vector<std::string>{"a", "b"}) ;
+        CHECK_EQ(cache.version(), 1) ;
+    }
+
+    SUBCASE("Fresh items are shown without calling the provider") {
+        SectionCache cache(milliseconds(1000), milliseconds(50)) ;
+        FakeProvider provider{ProviderResult::READY, {"a"}, 0} ;
+        cache.open(at(0)) ;
+        refresh(cache, at(0), provider) ;
+
+        CHECK_FALSE(cache.open(at(999))) ;
+        CHECK_FALSE(cache.poll(at(999), std::ref(provider))) ;
+        CHECK_EQ(provider.calls.load(), 1) ;
+        CHECK_EQ(cache.version(), 1) ;
+    }
+
+    SUBCASE("Stale items are kept while the refresh is pending") {
+        SectionCache cache(milliseconds(100), milliseconds(50)) ;
+        FakeProvider provider{ProviderResult::READY, {"a"}, 0} ;
+        cache.open(at(0)) ;
+        refresh(cache, at(0), provider) ;
+
+        provider.result = ProviderResult::PENDING ;
+        provider.keys = {"b", "a"} ;
+        CHECK(cache.open(at(100))) ;
+        CHECK_FALSE(cache.poll(at(100), std::ref(provider))) ;
+        CHECK_FALSE(cache.poll(at(120), std::ref(provider))) ;
+        CHECK(cache.is_refreshing()) ;
+        CHECK_EQ(keys_of(cache), std::vector<std::string>{"a"}) ;
+
+        // Opening again does not start another refresh.
+        CHECK_FALSE(cache.open(at(130))) ;
+
+        // The items filled by the pending calls are not kept.
+        provider.result = ProviderResult::READY ;
+        CHECK(poll_until(cache, at(140), provider)) ;
+        CHECK_EQ(keys_of(cache), std::vector<std::string>{"b", "a"}) ;
+        CHECK_EQ(cache.version(), 2) ;
+        CHECK(cache.is_fresh(at(239))) ;
+        CHECK_FALSE(cache.is_fresh(at(240))) ;
+    }
+
+    SUBCASE("A refresh is abandoned after the time budget") {
+        SectionCache cache(milliseconds(0), milliseconds(50)) ;
+        FakeProvider provider{ProviderResult::READY, {"a"}, 0} ;
+        cache.open(at(0)) ;
+        refresh(cache, at(0), provider) ;
+
+        provider.result = ProviderResult::PENDING ;
+        CHECK(cache.open(at(10))) ;
+        CHECK_FALSE(cache.poll(at(10), std::ref(provider))) ;
+        CHECK_FALSE(cache.poll(at(59), std::ref(provider))) ;
+        CHECK(cache.is_refreshing()) ;
+        CHECK_FALSE(cache.poll(at(60), std::ref(provider))) ;
+        CHECK_FALSE(cache.is_refreshing()) ;
+        CHECK_EQ(cache.count_timeouts(), 1) ;
+
+        // The stale items survive and the worker stops calling the provider.
+        cache.wait() ;
+        auto calls = provider.calls.load() ;
+        CHECK_FALSE(cache.poll(at(70), std::ref(provider))) ;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5)) ;
+        CHECK_EQ(provider.calls.load(), calls) ;
+        CHECK_EQ(keys_of(cache), std::vector<std::string>{"a"}) ;
+
+        // The next opening retries.
+        CHECK(cache.open(at(80))) ;
+    }
+
+    SUBCASE("One worker calls a pending provider across many polls") {
+        SectionCache cache(milliseconds(0), milliseconds(50)) ;
+        FakeProvider provider{ProviderResult::READY, {"a"}, 20} ;
+        CHECK(cache.open(at(0))) ;
+        for(int i = 0 ; i < 100 ; i ++) {
+            cache.poll(at(0), std::ref(provider)) ;
+        }
+        CHECK(poll_until(cache, at(0), provider)) ;
+
+        // The calls are counted by the provider, not by the polls.
+        CHECK_EQ(provider.calls.load(), 21) ;
+        CHECK_EQ(provider.threads.size(), 1) ;
+        CHECK_EQ(keys_of(cache), std::vector<std::string>{"a"}) ;
+    }
+
+    SUBCASE("A failed refresh keeps the items") {
+        SectionCache cache(milliseconds(0), milliseconds(50)) ;
+        FakeProvider provider{ProviderResult::READY, {"a"}, 0} ;
+        cache.open(at(0)) ;
+        refresh(cache, at(0), provider) ;
+
+        provider.result = ProviderResult::FAILED ;
+        cache.open(at(1)) ;
+        CHECK_FALSE(refresh(cache, at(1), provider)) ;
+        CHECK_FALSE(cache.is_refreshing()) ;
+        CHECK_EQ(cache.version(), 1) ;
+        CHECK_EQ(cache.count_timeouts(), 0) ;
+        CHECK_EQ(keys_of(cache), std::vector<std::string>{"a"}) ;
+    }
+
+    SUBCASE("Invalidation makes fresh items stale") {
+        SectionCache cache(milliseconds(1000), milliseconds(50)) ;
+        FakeProvider provider{ProviderResult::READY, {"a"}, 0} ;
+        cache.open(at(0)) ;
+        refresh(cache, at(0), provider) ;
+        CHECK(cache.is_fresh(at(10))) ;
+
+        cache.invalidate() ;
+        CHECK_FALSE(cache.is_fresh(at(10))) ;
+        CHECK_EQ(keys_of(cache), std::vector<std::string>{"a"}) ;
+        CHECK(cache.open(at(10))) ;
+        CHECK(refresh(cache, at(10), provider)) ;
+        CHECK_EQ(cache.count_refreshes(), 2) ;
+    }
+
+    SUBCASE("A slow provider does not block polling") {
+        SectionCache cache(milliseconds(0), milliseconds(50)) ;
+        std::promise<void> gate ;
+        auto opened = gate.get_future().share() ;
+        int calls = 0 ;
+        auto provider = [opened, &calls] (std::vector<MenuSpec>& items) {
+            calls ++ ;
+            opened.wait() ;
+            items.push_back(MenuSpec("a", "a")) ;
+            return ProviderResult::READY ;
+        } ;
+
+        CHECK(cache.open(at(0))) ;
+        CHECK_FALSE(cache.poll(at(0), provider)) ;
+        CHECK_FALSE(cache.poll(at(10), provider)) ;
+        CHECK_FALSE(cache.poll(at(50), provider)) ;
+        CHECK_FALSE(cache.is_refreshing()) ;
+        CHECK_EQ(cache.count_timeouts(), 1) ;
+
+        // The next refresh takes the result of the abandoned call instead of calling the provider again.
+        CHECK(cache.open(at(60))) ;
+        gate.set_value() ;
+        cache.wait() ;
+        CHECK(cache.poll(at(60), provider)) ;
+        CHECK_EQ(calls, 1) ;
+        CHECK_EQ(keys_of(cache), std::vector<std::string>{"a"}) ;
+    }
+
+    SUBCASE("Refreshed items are patched with few operations") {
+        SectionCache cache(milliseconds(0), milliseconds(50)) ;
+        FakeProvider provider{ProviderResult::READY, {"a", "b", "c", "d"}, 0} ;
+        cache.open(at(0)) ;
+        refresh(cache, at(0), provider) ;
+        auto live = keys_of(cache) ;
+
+        provider.keys = {"a", "c", "d", "e"} ;
+        cache.open(at(1)) ;
+        CHECK(refresh(cache, at(1), provider)) ;
+
+        KeyedDiff<std::string> diff ;
+        CHECK(diff.set_desired(keys_of(cache))) ;
+        std::vector<DiffOp> ops ;
+        diff.diff(live, ops) ;
+        CHECK_EQ(ops.size(), 2) ;
+    }
+}
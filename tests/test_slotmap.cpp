@@ -0,0 +1,253 @@
+#include "test.hpp"
+
+#include <memory>
+
+using namespace fluent_tray ;
+
+
+TEST_CASE("SlotMap test: ") {
+    SUBCASE("Insert and lookup") {
+        SlotMap<std::string> map ;
+        CHECK(map.empty()) ;
+        auto a = map.push_back("a") ;
+        auto b = map.push_back("b") ;
+        auto c = map.insert(0, "c") ;
+        CHECK_EQ(map.size(), 3) ;
+        CHECK_EQ(map[0], "c") ;
+        CHECK_EQ(map[1], "a") ;
+        CHECK_EQ(map[2], "b") ;
+        CHECK_EQ(map.front(), "c") ;
+        CHECK_EQ(map.back(), "b") ;
+
+        REQUIRE(map.find(b)) ;
+        CHECK_EQ(*map.find(b), "b") ;
+        CHECK(map.handle_at(0) == c) ;
+
+        std::size_t position ;
+        CHECK(map.find_position(a, position)) ;
+        CHECK_EQ(position, 1) ;
+
+        CHECK(SlotHandle{0, 0}.is_null()) ;
+        CHECK_FALSE(a.is_null()) ;
+        CHECK_FALSE(map.contains(SlotHandle{0, 0})) ;
+        CHECK_FALSE(map.contains(SlotHandle{100, 1})) ;
+    }
+
+    SUBCASE("Stale handles") {
+        SlotMap<std::string> map ;
+        auto a = map.push_back("a") ;
+        auto b = map.push_back("b") ;
+        CHECK(map.erase(a)) ;
+        CHECK_FALSE(map.erase(a)) ;
+        CHECK_EQ(map.find(a), nullptr) ;
+        CHECK_EQ(map.size(), 1) ;
+        CHECK_EQ(map[0], "b") ;
+
+        // The slot is reused with a new generation.
+        auto c = map.push_back("c") ;
+        CHECK_EQ(c.index, a.index) ;
+        CHECK(c != a) ;
+        CHECK_EQ(map.count_slots(), 2) ;
+        CHECK_EQ(map.find(a), nullptr) ;
+        REQUIRE(map.find(c)) ;
+        CHECK_EQ(*map.find(c), "c") ;
+        CHECK_EQ(*map.find(b), "b") ;
+    }
+
+    SUBCASE("Erase releases the element") {
+        auto resource = std::make_shared<int>(1) ;
+        SlotMap<std::shared_ptr<int>> map ;
+        auto handle = map.push_back(resource) ;
+        CHECK_EQ(resource.use_count(), 2) ;
+        map.erase(handle) ;
+        CHECK_EQ(resource.use_count(), 1) ;
+
+        map.push_back(resource) ;
+        map.clear() ;
+        CHECK_EQ(resource.use_count(), 1) ;
+        CHECK(map.empty()) ;
+    }
+
+    SUBCASE("Clear makes the handles stale") {
+        SlotMap<std::string> map ;
+        auto a = map.push_back("a") ;
+        auto b = map.push_back("b") ;
+        map.clear() ;
+        CHECK(map.empty()) ;
+        CHECK_FALSE(map.contains(a)) ;
+        CHECK_FALSE(map.contains(b)) ;
+
+        // The slots are kept and reused with new generations.
+        auto c = map.push_back("c") ;
+        CHECK_EQ(c.index, a.index) ;
+        CHECK(c != a) ;
+        CHECK_EQ(map.count_slots(), 2) ;
+        CHECK_EQ(map.find(a), nullptr) ;
+        CHECK_EQ(*map.find(c), "c") ;
+    }
+
+    SUBCASE("Move keeps the handles") {
+        SlotMap<int> map ;
+        std::vector<SlotHandle> handles ;
+        for(int i = 0 ; i < 5 ; i ++) {
+            handles.push_back(map.push_back(i)) ;
+        }
+        map.move(0, 3) ;
+        CHECK_EQ(std::vector<int>(map.begin(), map.end()), std::vector<int>{1, 2, 3, 0, 4}) ;
+        map.move(4, 1) ;
+        CHECK_EQ(std::vector<int>(map.begin(), map.end()), std::vector<int>{1, 4, 2, 3, 0}) ;
+        map.move(2, 2) ;
+        CHECK_EQ(std::vector<int>(map.begin(), map.end()), std::vector<int>{1, 4, 2, 3, 0}) ;
+
+        std::size_t position ;
+        CHECK(map.find_position(handles[0], position)) ;
+        CHECK_EQ(position, 4) ;
+        CHECK(map.find_position(handles[4], position)) ;
+        CHECK_EQ(position, 1) ;
+        CHECK_EQ(*map.find(handles[4]), 4) ;
+    }
+
+    SUBCASE("Operations by handle") {
+        SlotMap<int> map ;
+        auto b = map.push_back(2) ;
+        auto a = map.insert_before(b, 1) ;
+        auto d = map.push_back(4) ;
+        auto c = map.insert_before(d, 3) ;
+        CHECK_EQ(std::vector<int>(map.begin(), map.end()), std::vector<int>{1, 2, 3, 4}) ;
+        CHECK(map.next_of(a) == b) ;
+        CHECK(map.next_of(d).is_null()) ;
+
+        CHECK(map.move_before(d, a)) ;
+        CHECK(map.move_before(b, SlotHandle{0, 0})) ;
+        CHECK_EQ(std::vector<int>(map.begin(), map.end()), std::vector<int>{4, 1, 3, 2}) ;
+        CHECK_EQ(map.front(), 4) ;
+        CHECK_EQ(map.back(), 2) ;
+
+        map.erase(c) ;
+        CHECK_FALSE(map.move_before(c, a)) ;
+        std::size_t position ;
+        CHECK(map.find_position(b, position)) ;
+        CHECK_EQ(position, 2) ;
+    }
+
+    SUBCASE("Same order as a vector under random operations") {
+        SlotMap<int> map ;
+        std::vector<int> expected ;
+        std::vector<SlotHandle> handles ;  // in the same order as expected
+        std::uint32_t seed = 7 ;
+        auto next = [&seed] (std::size_t n) {
+            seed = seed * 1664525u + 1013904223u ;
+            return static_cast<std::size_t>(seed >> 8) % n ;
+        } ;
+        for(int step = 0 ; step < 5000 ; step ++) {
+            auto op = next(4) ;
+            if(op == 0 || handles.empty()) {
+                auto at = next(handles.size() + 1) ;
+                auto next_handle = at < handles.size() ? handles[at] : SlotHandle{0, 0} ;
+                auto handle = map.insert_before(next_handle, step) ;
+                handles.insert(handles.begin() + static_cast<std::ptrdiff_t>(at), handle) ;
+                expected.insert(expected.begin() + static_cast<std::ptrdiff_t>(at), step) ;
+            }
+            else if(op == 1) {
+                auto at = next(handles.size()) ;
+                CHECK(map.erase(handles[at])) ;
+                handles.erase(handles.begin() + static_cast<std::ptrdiff_t>(at)) ;
+                expected.erase(expected.begin() + static_cast<std::ptrdiff_t>(at)) ;
+            }
+            else if(op == 2) {
+                auto from = next(handles.size()) ;
+                auto to = next(handles.size()) ;
+                map.move(from, to) ;
+                auto handle = handles[from] ;
+                auto value = expected[from] ;
+                handles.erase(handles.begin() + static_cast<std::ptrdiff_t>(from)) ;
+                expected.erase(expected.begin() + static_cast<std::ptrdiff_t>(from)) ;
+                handles.insert(handles.begin() + static_cast<std::ptrdiff_t>(to), handle) ;
+                expected.insert(expected.begin() + static_cast<std::ptrdiff_t>(to), value) ;
+            }
+            else {
+                auto at = next(handles.size()) ;
+                std::size_t position ;
+                REQUIRE(map.find_position(handles[at], position)) ;
+                CHECK_EQ(position, at) ;
+                CHECK(map.handle_at(at) == handles[at]) ;
+            }
+        }
+        CHECK_EQ(std::vector<int>(map.begin(), map.end()), expected) ;
+    }
+
+    SUBCASE("Stable references") {
+        SlotMap<std::unique_ptr<int>> map ;
+        map.push_back(std::unique_ptr<int>(new int(42))) ;
+        auto& first = map.front() ;
+        auto address = &first ;
+        auto handle = map.handle_at(0) ;
+        for(int i = 0 ; i < 10000 ; i ++) {
+            map.push_back(std::unique_ptr<int>(new int(i))) ;
+        }
+        CHECK_EQ(&map.front(), address) ;
+        CHECK_EQ(map.find(handle), address) ;
+        CHECK_EQ(*first, 42) ;
+    }
+
+    SUBCASE("Random-access iterator") {
+        SlotMap<int> map ;
+        for(int i = 0 ; i < 10 ; i ++) {
+            map.push_back(i) ;
+        }
+        map.erase(map.handle_at(3)) ;
+        map.insert(0, 100) ;
+
+        std::vector<int> values(map.begin(), map.end()) ;
+        CHECK(values == std::vector<int>{100, 0, 1, 2, 4, 5, 6, 7, 8, 9}) ;
+
+        auto itr = map.begin() ;
+        CHECK_EQ(*(itr + 4), 4) ;
+        CHECK_EQ(itr[2], 1) ;
+        CHECK_EQ(map.end() - map.begin(), 10) ;
+        CHECK_EQ(std::distance(map.cbegin(), map.cend()), 10) ;
+        CHECK(map.begin() < map.end()) ;
+
+        SlotMap<int>::const_iterator citr = map.begin() ;
+        CHECK(citr == map.cbegin()) ;
+
+        CHECK_EQ(*std::find(map.begin(), map.end(), 7), 7) ;
+        CHECK(std::is_sorted(map.begin() + 1, map.end())) ;
+
+        for(auto& value : map) {
+            value *= 2 ;
+        }
+        CHECK_EQ(map[1], 0) ;
+        CHECK_EQ(map.back(), 18) ;
+
+        std::vector<int> reversed(
+            std::reverse_iterator<SlotMap<int>::iterator>(map.end()),
+            std::reverse_iterator<SlotMap<int>::iterator>(map.begin())) ;
+        CHECK_EQ(reversed.front(), 18) ;
+        CHECK_EQ(reversed.back(), 200) ;
+    }
+
+    SUBCASE("Many inserts and removals") {
+        SlotMap<std::size_t> map ;
+        std::vector<SlotHandle> handles ;
+        for(std::size_t i = 0 ; i < 100000 ; i ++) {
+            handles.push_back(map.push_back(i)) ;
+        }
+        // Remove the back half and insert again, so that the slots are reused.
+        std::size_t erased = 0 ;
+        for(std::size_t i = handles.size() ; i-- > 50000 ; ) {
+            if(map.erase(handles[i])) {
+                erased ++ ;
+            }
+        }
+        CHECK_EQ(erased, 50000) ;
+        for(std::size_t i = 0 ; i < 50000 ; i ++) {
+            map.push_back(i) ;
+        }
+        CHECK_EQ(map.size(), 100000) ;
+        CHECK_EQ(map.count_slots(), 100000) ;
+        CHECK_EQ(map.find(handles[99999]), nullptr) ;
+        REQUIRE(map.find(handles[49999])) ;
+        CHECK_EQ(*map.find(handles[49999]), 49999) ;
+    }
+}
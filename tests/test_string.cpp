@@ -1,5 +1,7 @@
 #include "test.hpp"
 
+#include "fluent_tray.hpp"
+
 using namespace fluent_tray ;
 
 
@@ -0,0 +1,232 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+TEST_CASE("SubmenuTree test: ") {
+    SUBCASE("Nested submenus") {
+        SubmenuTree tree ;
+        auto root = tree.add_root() ;
+        CHECK(tree.add_item(root, MenuSpec("a", "A"))) ;
+        std::size_t nested ;
+        CHECK(tree.add_nested(root, MenuSpec("b", "B"), nested)) ;
+        CHECK(tree.add_item(nested, MenuSpec("c", "C"))) ;
+        CHECK_FALSE(tree.add_item(100, MenuSpec())) ;
+
+        CHECK_EQ(tree.size(), 2) ;
+        CHECK_EQ(tree.count_items(root), 2) ;
+        CHECK_EQ(tree.item(root, 1).label, "B") ;
+
+        std::size_t child ;
+        CHECK_FALSE(tree.find_child(root, 0, child)) ;
+        CHECK(tree.find_child(root, 1, child)) ;
+        CHECK_EQ(child, nested) ;
+        CHECK_FALSE(tree.find_child(root, 2, child)) ;
+
+        std::size_t parent ;
+        CHECK(tree.find_parent(nested, parent)) ;
+        CHECK_EQ(parent, root) ;
+        CHECK_FALSE(tree.find_parent(root, parent)) ;
+    }
+}
+
+TEST_CASE("CascadeState test: ") {
+    std::vector<std::pair<std::size_t, int>> closed ;
+    auto close = [&closed] (std::size_t node, int selection) {
+        closed.emplace_back(node, selection) ;
+        return true ;
+    } ;
+
+    SUBCASE("Open, select and close") {
+        CascadeState cascade ;
+        CHECK_EQ(cascade.depth(), 0) ;
+        CHECK(cascade.open(0, 10, close)) ;
+        CHECK_EQ(cascade.selection(0), -1) ;
+
+        // The selection wraps around.
+        CHECK_EQ(cascade.step(3, true), -1) ;
+        CHECK_EQ(cascade.selection(0), 0) ;
+        cascade.step(3, false) ;
+        CHECK_EQ(cascade.selection(0), 2) ;
+        cascade.step(3, true) ;
+        CHECK_EQ(cascade.selection(0), 0) ;
+
+        CHECK(cascade.open(1, 20, close)) ;
+        CHECK(cascade.open(2, 30, close)) ;
+        CHECK_EQ(cascade.depth(), 3) ;
+        CHECK(cascade.is_open(20)) ;
+        std::size_t level ;
+        CHECK(cascade.find_level(30, level)) ;
+        CHECK_EQ(level, 2) ;
+        CHECK(closed.empty()) ;
+
+        // Opening a sibling closes the deeper submenus first.
+        cascade.select(2, 1) ;
+        CHECK(cascade.open(1, 21, close)) ;
+        REQUIRE_EQ(closed.size(), 2) ;
+        CHECK_EQ(closed[0], std::make_pair(std::size_t(30), 1)) ;
+        CHECK_EQ(closed[1], std::make_pair(std::size_t(20), -1)) ;
+        CHECK_EQ(cascade.depth(), 2) ;
+        CHECK_EQ(cascade.node_at(1), 21) ;
+        CHECK_FALSE(cascade.is_open(20)) ;
+
+        // The selection of the parent is kept.
+        CHECK_EQ(cascade.selection(0), 0) ;
+
+        closed.clear() ;
+        CHECK(cascade.close_from(0, close)) ;
+        CHECK_EQ(closed.size(), 2) ;
+        CHECK_EQ(cascade.depth(), 0) ;
+        CHECK_EQ(cascade.step(3, true), -1) ;
+    }
+
+    SUBCASE("Failure to close stops closing") {
+        CascadeState cascade ;
+        cascade.open(0, 1, close) ;
+        cascade.open(1, 2, close) ;
+        CHECK_FALSE(cascade.close_from(0, [] (std::size_t, int) {return false ;})) ;
+        CHECK_EQ(cascade.depth(), 1) ;
+    }
+}
+
+TEST_CASE("LruSet test: ") {
+    SUBCASE("Expire the least recently used keys") {
+        LruSet<int> lru ;
+        CHECK(lru.touch(1)) ;
+        CHECK(lru.touch(2)) ;
+        CHECK(lru.touch(3)) ;
+        CHECK_FALSE(lru.touch(1)) ;
+        CHECK_EQ(lru.keys(), std::vector<int>{2, 3, 1}) ;
+
+        std::vector<int> expired ;
+        CHECK_EQ(lru.trim(2, [&expired] (int key) {
+            expired.push_back(key) ;
+            return true ;
+        }), 1) ;
+        CHECK_EQ(expired, std::vector<int>{2}) ;
+        CHECK_EQ(lru.keys(), std::vector<int>{3, 1}) ;
+    }
+
+    SUBCASE("Keys in use are kept") {
+        LruSet<int> lru ;
+        for(int i = 0 ; i < 5 ; i ++) {
+            lru.touch(i) ;
+        }
+        // The open submenus are not expired even under memory pressure.
+        CHECK_EQ(lru.trim(0, [] (int key) {return key % 2 == 0 ;}), 3) ;
+        CHECK_EQ(lru.keys(), std::vector<int>{1, 3}) ;
+        CHECK(lru.erase(1)) ;
+        CHECK_FALSE(lru.erase(1)) ;
+        CHECK_FALSE(lru.contains(1)) ;
+        CHECK(lru.contains(3)) ;
+    }
+}
+
+namespace
+{
+    //! Stand-in for a submenu popup that counts the windows of its items.
+    struct FakeSubmenu {
+        std::size_t windows ;
+    } ;
+
+    //! Build a tree of the given size with a nested submenu every ten items and a cache node per submenu.
+    void build_tree(std::size_t size, SubmenuTree& tree, LazyCache<FakeSubmenu>& cache) {
+        auto node = tree.add_root() ;
+        cache.add() ;
+        for(std::size_t i = 0 ; i < size ; i ++) {
+            if(i % 10 == 9) {
+                std::size_t nested ;
+                tree.add_nested(node, MenuSpec(), nested) ;
+                cache.add() ;
+                node = nested ;
+            }
+            else {
+                tree.add_item(node, MenuSpec()) ;
+            }
+        }
+    }
+}
+
+TEST_CASE("LazyCache test: ") {
+    std::size_t windows = 0 ;
+    std::size_t destroyed = 0 ;
+
+    SUBCASE("Only opened submenus are materialized") {
+        for(std::size_t size = 10 ; size <= 100000 ; size *= 10) {
+            SubmenuTree tree ;
+            LazyCache<FakeSubmenu> cache ;
+            build_tree(size, tree, cache) ;
+            CHECK_EQ(cache.size(), tree.size()) ;
+            CHECK_EQ(cache.count_created(), 0) ;
+            CHECK_EQ(cache.count_live(), 0) ;
+
+            // Open the first three levels of the chain, whatever the size of tree is.
+            windows = 0 ;
+            for(int repeat = 0 ; repeat < 2 ; repeat ++) {
+                for(std::size_t node = 0 ; node < 3 && node < tree.size() ; node ++) {
+                    auto submenu = cache.get(node, [&tree, &windows, node] (std::unique_ptr<FakeSubmenu>& created) {
+                        created.reset(new FakeSubmenu{tree.count_items(node)}) ;
+                        windows += created->windows ;
+                        return true ;
+                    }) ;
+                    REQUIRE(submenu != nullptr) ;
+                    CHECK_EQ(submenu->windows, tree.count_items(node)) ;
+                }
+            }
+            const auto opened = (std::min)(tree.size(), static_cast<std::size_t>(3)) ;
+            CHECK_EQ(cache.count_created(), opened) ;
+            CHECK_EQ(cache.count_live(), opened) ;
+            CHECK_LE(windows, 30) ;
+        }
+    }
+
+    SUBCASE("Failed creation leaves nothing behind") {
+        LazyCache<FakeSubmenu> cache ;
+        auto node = cache.add() ;
+        CHECK_EQ(cache.get(node, [] (std::unique_ptr<FakeSubmenu>&) { return false ; }), nullptr) ;
+        CHECK_EQ(cache.get(node + 1, [] (std::unique_ptr<FakeSubmenu>&) { return true ; }), nullptr) ;
+        CHECK_EQ(cache.find(node), nullptr) ;
+        CHECK_EQ(cache.count_created(), 0) ;
+        CHECK_EQ(cache.count_live(), 0) ;
+    }
+
+    SUBCASE("Trim and release") {
+        LazyCache<FakeSubmenu> cache ;
+        for(int i = 0 ; i < 4 ; i ++) {
+            cache.add() ;
+        }
+        auto create = [] (std::unique_ptr<FakeSubmenu>& created) {
+            created.reset(new FakeSubmenu{1}) ;
+            return true ;
+        } ;
+        for(std::size_t node = 0 ; node < 4 ; node ++) {
+            cache.get(node, create) ;
+        }
+        cache.get(0, create) ;
+
+        // Node 1 is the least recently used, but it is in use.
+        auto in_use = [&destroyed] (std::size_t node, FakeSubmenu&) {
+            if(node == 1) {
+                return false ;
+            }
+            destroyed ++ ;
+            return true ;
+        } ;
+        CHECK_EQ(cache.trim(2, in_use), 2) ;
+        CHECK_EQ(destroyed, 2) ;
+        CHECK_EQ(cache.count_live(), 2) ;
+        CHECK_NE(cache.find(0), nullptr) ;
+        CHECK_NE(cache.find(1), nullptr) ;
+        CHECK_EQ(cache.find(2), nullptr) ;
+        CHECK_EQ(cache.find(3), nullptr) ;
+
+        cache.release(0, [&destroyed] (FakeSubmenu&) { destroyed ++ ; }) ;
+        CHECK_EQ(destroyed, 3) ;
+        CHECK_EQ(cache.find(0), nullptr) ;
+        CHECK_EQ(cache.count_live(), 1) ;
+
+        // A released submenu is created again on the next open.
+        cache.get(0, create) ;
+        CHECK_EQ(cache.count_created(), 5) ;
+        CHECK_EQ(cache.count_live(), 2) ;
+    }
+}
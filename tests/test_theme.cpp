@@ -0,0 +1,66 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+
+TEST_CASE("ThemeCache test: ") {
+    SUBCASE("Stale until the first refresh") {
+        ThemeCache theme ;
+        CHECK(theme.is_stale()) ;
+        CHECK_EQ(theme.generation(), 0) ;
+
+        theme.validate() ;
+        CHECK_FALSE(theme.is_stale()) ;
+        CHECK_EQ(theme.generation(), 1) ;
+
+        // No refresh without any change.
+        theme.validate() ;
+        CHECK_EQ(theme.generation(), 1) ;
+    }
+
+    SUBCASE("Coalesce invalidations") {
+        ThemeCache theme ;
+        theme.validate() ;
+
+        // WM_SETTINGCHANGE, WM_THEMECHANGED and WM_DWMCOLORIZATIONCOLORCHANGED
+        // are often reported together for one dark/light switch.
+        theme.invalidate() ;
+        theme.invalidate() ;
+        theme.invalidate() ;
+        CHECK(theme.is_stale()) ;
+        CHECK_EQ(theme.count_invalidations(), 3) ;
+
+        theme.validate() ;
+        CHECK_FALSE(theme.is_stale()) ;
+        CHECK_EQ(theme.generation(), 2) ;
+    }
+
+    SUBCASE("Pin colors set by the user") {
+        ThemeCache theme ;
+        CHECK_FALSE(theme.is_pinned(ThemeColor::TEXT)) ;
+        CHECK_FALSE(theme.is_pinned(ThemeColor::BACK)) ;
+        CHECK_FALSE(theme.is_pinned(ThemeColor::BORDER)) ;
+
+        theme.pin(ThemeColor::BACK) ;
+        CHECK_FALSE(theme.is_pinned(ThemeColor::TEXT)) ;
+        CHECK(theme.is_pinned(ThemeColor::BACK)) ;
+        CHECK_FALSE(theme.is_pinned(ThemeColor::BORDER)) ;
+
+        theme.pin(ThemeColor::BORDER) ;
+        CHECK(theme.is_pinned(ThemeColor::BACK)) ;
+        CHECK(theme.is_pinned(ThemeColor::BORDER)) ;
+
+        // Pinned colors are kept across refreshes.
+        theme.validate() ;
+        CHECK(theme.is_pinned(ThemeColor::BACK)) ;
+    }
+
+    SUBCASE("Filter WM_SETTINGCHANGE areas") {
+        CHECK(ThemeCache::is_theme_setting(L"ImmersiveColorSet")) ;
+        CHECK_FALSE(ThemeCache::is_theme_setting(nullptr)) ;
+        CHECK_FALSE(ThemeCache::is_theme_setting(L"")) ;
+        CHECK_FALSE(ThemeCache::is_theme_setting(L"Immersive")) ;
+        CHECK_FALSE(ThemeCache::is_theme_setting(L"ImmersiveColorSetX")) ;
+        CHECK_FALSE(ThemeCache::is_theme_setting(L"Environment")) ;
+    }
+}
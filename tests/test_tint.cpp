@@ -0,0 +1,106 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+
+TEST_CASE("Icon tint test: ") {
+    SUBCASE("Monochrome detection") {
+        // An antialiased black glyph on a transparent background
+        std::vector<std::uint32_t> glyph = {
+            0x00000000, 0x40000000, 0xFF000000, 0xFF010101,
+            0x80000000, 0x00FFFFFF, 0x20FF0000, 0xFF000000} ;
+        CHECK(util::is_monochrome_pixels(glyph.data(), glyph.size())) ;
+
+        // A visible pixel of another color
+        glyph[5] = 0xFFFF0000 ;
+        CHECK_FALSE(util::is_monochrome_pixels(glyph.data(), glyph.size())) ;
+
+        // Fully transparent icon
+        std::vector<std::uint32_t> empty(16, 0x00FFFFFF) ;
+        CHECK_FALSE(util::is_monochrome_pixels(empty.data(), empty.size())) ;
+        CHECK_FALSE(util::is_monochrome_pixels(empty.data(), 0)) ;
+
+        // White glyph with slight noise within the tolerance
+        std::vector<std::uint32_t> white = {0xFFFFFFFF, 0xFFF8F8F8, 0x80FAFFFA} ;
+        CHECK(util::is_monochrome_pixels(white.data(), white.size())) ;
+        CHECK_FALSE(util::is_monochrome_pixels(white.data(), white.size(), 4)) ;
+    }
+
+    SUBCASE("Recolor keeps alpha") {
+        std::vector<std::uint32_t> src = {0x00000000, 0x40000000, 0xFF000000, 0x80123456} ;
+        std::vector<std::uint32_t> dst(src.size()) ;
+        util::recolor_pixels(src.data(), dst.data(), src.size(), util::rgb(0x11, 0x22, 0x33)) ;
+        CHECK_EQ(dst[0], 0x00112233) ;
+        CHECK_EQ(dst[1], 0x40112233) ;
+        CHECK_EQ(dst[2], 0xFF112233) ;
+        CHECK_EQ(dst[3], 0x80112233) ;
+
+        // In place
+        util::recolor_pixels(src.data(), src.data(), src.size(), util::rgb(0xFF, 0xFF, 0xFF)) ;
+        CHECK_EQ(src[2], 0xFFFFFFFF) ;
+    }
+
+    SUBCASE("Parity with the scalar reference") {
+        std::uint32_t seed = 40 ;
+        auto next = [&seed] {
+            seed = seed * 1664525u + 1013904223u ;
+            return seed ;
+        } ;
+
+        for(std::size_t n : {0, 1, 3, 4, 5, 31, 256, 1025}) {
+            std::vector<std::uint32_t> src(n) ;
+            for(auto& px : src) {
+                px = next() ;
+            }
+            std::uint32_t color = next() & 0x00FFFFFF ;
+            std::vector<std::uint32_t> expected(n), actual(n) ;
+            util::recolor_pixels_scalar(src.data(), expected.data(), n, color) ;
+            util::recolor_pixels(src.data(), actual.data(), n, color) ;
+            CHECK(expected == actual) ;
+        }
+    }
+}
+
+TEST_CASE("TintCache test: ") {
+    TintCache<int, std::uint32_t> cache ;
+    std::size_t released = 0 ;
+    auto release = [&released] (std::uint32_t&) {released ++ ;} ;
+    auto create = [] (int key, std::uint32_t color, std::uint32_t& out) {
+        out = static_cast<std::uint32_t>(key) ^ color ;
+        return true ;
+    } ;
+
+    CHECK_EQ(cache.color(), util::invalid_color) ;
+    CHECK(cache.set_color(util::rgb(255, 255, 255), release)) ;
+    CHECK_FALSE(cache.set_color(util::rgb(255, 255, 255), release)) ;
+
+    // Recolored once per source while the theme is not changed.
+    for(int paint = 0 ; paint < 100 ; paint ++) {
+        for(int key = 1 ; key <= 3 ; key ++) {
+            auto res = cache.get(key, create) ;
+            REQUIRE(res) ;
+            CHECK_EQ(*res, static_cast<std::uint32_t>(key) ^ util::rgb(255, 255, 255)) ;
+        }
+    }
+    CHECK_EQ(cache.size(), 3) ;
+    CHECK_EQ(cache.count_creations(), 3) ;
+
+    cache.erase(2, release) ;
+    CHECK_EQ(released, 1) ;
+    CHECK_EQ(cache.size(), 2) ;
+    cache.erase(2, release) ;
+    CHECK_EQ(released, 1) ;
+
+    // The theme is changed.
+    CHECK(cache.set_color(util::rgb(0, 0, 0), release)) ;
+    CHECK_EQ(released, 3) ;
+    CHECK_EQ(cache.size(), 0) ;
+    auto res = cache.get(1, create) ;
+    REQUIRE(res) ;
+    CHECK_EQ(*res, 1) ;
+    CHECK_EQ(cache.count_creations(), 4) ;
+
+    // Failure is not cached.
+    CHECK_EQ(cache.get(5, [] (int, std::uint32_t, std::uint32_t&) {return false ;}), nullptr) ;
+    CHECK_EQ(cache.size(), 1) ;
+}
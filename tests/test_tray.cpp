@@ -1,5 +1,7 @@
 #include "test.hpp"
 
+#include "fluent_tray.hpp"
+
 #include <string.h>
 
 using namespace fluent_tray ;
@@ -73,6 +75,21 @@ TEST_CASE("FluentTray Test: ") {
 
         (tray.begin() + 2)->check() ;
         CHECK((tray.begin() + 2)->is_checked()) ;
+
+        // The checks set in a transaction are repainted when it ends.
+        tray.begin_update() ;
+        CHECK(tray.set_checked(2, false)) ;
+        CHECK_FALSE((tray.begin() + 2)->is_checked()) ;
+        CHECK(tray.set_checked(2, true)) ;
+        CHECK(tray.end_update()) ;
+        CHECK((tray.begin() + 2)->is_checked()) ;
+        CHECK_FALSE(tray.set_checked(100, true)) ;
+
+        CHECK(tray.set_label(0, "menu1 updated")) ;
+        std::string str4 ;
+        CHECK(tray.begin()->get_label(str4)) ;
+        CHECK_EQ(str4, "menu1 updated") ;
+        CHECK_FALSE(tray.set_label(3, "out of range")) ;
     }
 
     SUBCASE("status") {
@@ -146,6 +163,95 @@ TEST_CASE("FluentTray Test: ") {
         tray.stop() ;
     }
 
+    SUBCASE("value menus") {
+        FluentTray tray ;
+        CHECK(tray.create_tray("test_value_menus", "")) ;
+
+        CHECK(tray.add_progress_menu("sync", "", 0, 200)) ;
+        CHECK(tray.add_slider_menu("throttle", "", 0, 10, 5, 1)) ;
+        CHECK_EQ(tray.front().bar_style(), BarStyle::PROGRESS) ;
+        CHECK_EQ(tray.back().bar_style(), BarStyle::SLIDER) ;
+
+        CHECK(tray.set_menu_value(0, 120)) ;
+        CHECK_EQ(tray.front().value(), 120) ;
+        CHECK(tray.set_menu_value(1, -3)) ;
+        CHECK_EQ(tray.back().value(), 0) ;
+        CHECK_FALSE(tray.set_menu_value(2, 1)) ;
+    }
+
+    SUBCASE("batched updates") {
+        FluentTray tray ;
+        CHECK(tray.create_tray("test_batched_updates", "")) ;
+        for(int i = 0 ; i < 10 ; i ++) {
+            CHECK(tray.add_menu("menu" + std::to_string(i))) ;
+        }
+        CHECK(tray.add_slider_menu("throttle", "", 0, 10, 5, 1)) ;
+
+        // Layout passes happen only while the menu window is shown.
+        REQUIRE(tray.show_menu_window()) ;
+        auto passes = tray.count_layout_passes() ;
+
+        // Fourteen mutations, each of which would arrange the menus outside a transaction.
+        tray.begin_update() ;
+        for(int i = 0 ; i < 10 ; i ++) {
+            CHECK(tray.set_label(i, "a much longer label of menu" + std::to_string(i))) ;
+        }
+        CHECK(tray.set_menu_value(10, 7)) ;
+        CHECK(tray.insert_menu(0, "inserted")) ;
+        CHECK(tray.move_menu(0, 5)) ;
+        CHECK(tray.remove_menu(5)) ;
+        CHECK_EQ(tray.count_layout_passes(), passes) ;
+        CHECK(tray.end_update()) ;
+        CHECK_EQ(tray.count_layout_passes(), passes + 1) ;
+
+        CHECK(tray.hide_menu_window()) ;
+    }
+
+    SUBCASE("submenus") {
+        FluentTray tray ;
+        CHECK(tray.create_tray("test_submenus", "")) ;
+
+        std::size_t submenu ;
+        CHECK(tray.add_submenu("more", "", submenu)) ;
+        std::size_t nested = submenu ;
+        for(int i = 0 ; i < 1000 ; i ++) {
+            if(i % 10 == 9) {
+                CHECK(tray.add_nested_submenu(nested, MenuSpec("", "nested"), nested)) ;
+            }
+            else {
+                CHECK(tray.add_submenu_menu(nested, MenuSpec("", "item"))) ;
+            }
+        }
+
+        // No submenu is opened, so no window is created.
+        CHECK_EQ(tray.count_created_submenus(), 0) ;
+        CHECK_EQ(tray.count_warm_submenus(), 0) ;
+        CHECK_EQ(tray.trim_submenus(0), 0) ;
+    }
+
+    SUBCASE("badge") {
+        FluentTray tray ;
+        CHECK(tray.create_tray("test_badge", "")) ;
+
+        // No badge is shown, so nothing has to be updated.
+        CHECK(tray.clear_badge()) ;
+        CHECK(tray.set_badge_color(RGB(0, 120, 212))) ;
+
+        // There is no icon to put the badge on.
+        CHECK_FALSE(tray.set_badge(3)) ;
+        CHECK_FALSE(tray.set_badge_dot()) ;
+    }
+
+    SUBCASE("icon animation") {
+        FluentTray tray ;
+        CHECK(tray.create_tray("test_icon_animation", "")) ;
+
+        // There is no icon to animate.
+        CHECK_FALSE(tray.start_icon_animation({"demo/assets/icon.ico"})) ;
+        CHECK_FALSE(tray.is_icon_animating()) ;
+        CHECK(tray.stop_icon_animation()) ;
+    }
+
     SUBCASE("balloon_tip") {
         FluentTray tray ;
         CHECK(tray.create_tray("test_balloon_tip")) ;
@@ -0,0 +1,359 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+namespace
+{
+    std::wstring make_label(std::uint32_t& seed) {
+        std::wstring label ;
+        seed = seed * 1664525u + 1013904223u ;
+        auto length = 1 + (seed >> 24) % 8 ;
+        for(std::uint32_t i = 0 ; i < length ; i ++) {
+            seed = seed * 1664525u + 1013904223u ;
+            // A few letters in both cases to make many shared prefixes.
+            auto letter = static_cast<wchar_t>(L'a' + (seed >> 24) % 4) ;
+            label.push_back((seed >> 16) % 2 ? letter : static_cast<wchar_t>(letter - 0x20)) ;
+        }
+        return label ;
+    }
+}
+
+TEST_CASE("PrefixIndex test: ") {
+    SUBCASE("Case folding") {
+        CHECK_EQ(PrefixIndex::fold(L'A'), L'a') ;
+        CHECK_EQ(PrefixIndex::fold(L'z'), L'z') ;
+        CHECK_EQ(PrefixIndex::fold(L'1'), L'1') ;
+        CHECK_EQ(PrefixIndex::fold(L'É'), L'é') ;
+        CHECK_EQ(PrefixIndex::fold(L'×'), L'×') ;
+        CHECK_EQ(PrefixIndex::fold(L'Δ'), L'δ') ;
+        CHECK_EQ(PrefixIndex::fold(L'Ж'), L'ж') ;
+        CHECK_EQ(PrefixIndex::fold(L'Ё'), L'ё') ;
+        CHECK(PrefixIndex::fold(std::wstring(L"Open Folder")) == L"open folder") ;
+    }
+
+    SUBCASE("Find labels by prefix") {
+        PrefixIndex index ;
+        index.assign({L"Settings", L"Exit", L"Save", L"", L"search"}) ;
+        CHECK_EQ(index.size(), 4) ;
+
+        std::size_t item ;
+        CHECK(index.first(L"S", item)) ;
+        CHECK_EQ(item, 2) ;
+        CHECK(index.first(L"se", item)) ;
+        CHECK_EQ(item, 4) ;
+        CHECK(index.first(L"SET", item)) ;
+        CHECK_EQ(item, 0) ;
+        CHECK_FALSE(index.first(L"x", item)) ;
+        CHECK_FALSE(index.first(L"settings!", item)) ;
+    }
+
+    SUBCASE("Next label after the current one") {
+        PrefixIndex index ;
+        index.assign({L"Settings", L"Exit", L"Save", L"search"}) ;
+
+        std::size_t item ;
+        CHECK(index.next(L"s", L"Save", 2, false, item)) ;
+        CHECK_EQ(item, 3) ;
+        CHECK(index.next(L"s", L"search", 3, false, item)) ;
+        CHECK_EQ(item, 0) ;
+        CHECK_FALSE(index.next(L"s", L"Settings", 0, false, item)) ;
+
+        // The current label is kept while the prefix still matches it.
+        CHECK(index.next(L"se", L"search", 3, true, item)) ;
+        CHECK_EQ(item, 3) ;
+        CHECK(index.next(L"set", L"search", 3, true, item)) ;
+        CHECK_EQ(item, 0) ;
+
+        // From a label after the matches, the search does not wrap around.
+        CHECK_FALSE(index.next(L"e", L"Save", 2, false, item)) ;
+        // From a label before the matches, the first match is found.
+        CHECK(index.next(L"s", L"Exit", 1, false, item)) ;
+        CHECK_EQ(item, 2) ;
+    }
+
+    SUBCASE("Incremental updates") {
+        PrefixIndex index ;
+        CHECK(index.insert(7, L"Beta")) ;
+        CHECK(index.insert(3, L"alpha")) ;
+        CHECK(index.insert(5, L"Alpha")) ;
+        CHECK_FALSE(index.insert(5, L"ALPHA")) ;
+        CHECK_FALSE(index.insert(9, L"")) ;
+        CHECK_EQ(index.size(), 3) ;
+
+        std::size_t item ;
+        CHECK(index.first(L"a", item)) ;
+        CHECK_EQ(item, 3) ;
+        CHECK(index.next(L"a", L"alpha", 3, false, item)) ;
+        CHECK_EQ(item, 5) ;
+
+        CHECK_FALSE(index.erase(3, L"Beta")) ;
+        CHECK(index.erase(3, L"ALPHA")) ;
+        CHECK(index.first(L"a", item)) ;
+        CHECK_EQ(item, 5) ;
+
+        // A relabeled item is found by its new label only.
+        CHECK(index.erase(7, L"Beta")) ;
+        CHECK(index.insert(7, L"Gamma")) ;
+        CHECK_FALSE(index.first(L"b", item)) ;
+        CHECK(index.first(L"g", item)) ;
+        CHECK_EQ(item, 7) ;
+
+        index.clear() ;
+        CHECK_EQ(index.size(), 0) ;
+    }
+
+    SUBCASE("Many labels are added and removed at once") {
+        std::uint32_t seed = 3 ;
+        std::vector<std::wstring> labels ;
+        for(int i = 0 ; i < 1000 ; i ++) {
+            labels.push_back(make_label(seed)) ;
+        }
+        PrefixIndex incremental ;
+        std::vector<std::size_t> items ;
+        std::vector<std::wstring> added ;
+        for(std::size_t i = 0 ; i < labels.size() ; i ++) {
+            items.push_back(i) ;
+            added.push_back(labels[i]) ;
+            if(items.size() == 300 || i + 1 == labels.size()) {
+                incremental.insert(items, added) ;
+                items.clear() ;
+                added.clear() ;
+            }
+        }
+        PrefixIndex full ;
+        full.assign(labels) ;
+        CHECK_EQ(incremental.size(), full.size()) ;
+
+        // The merged index visits the labels in the same order as the sorted one.
+        std::size_t expected ;
+        std::size_t item ;
+        bool found = full.first(L"b", expected) ;
+        CHECK_EQ(incremental.first(L"b", item), found) ;
+        while(found) {
+            CHECK_EQ(item, expected) ;
+            found = full.next(L"b", labels[expected], expected, false, expected) ;
+            CHECK_EQ(incremental.next(L"b", labels[item], item, false, item), found) ;
+        }
+
+        incremental.truncate(500) ;
+        labels.resize(500) ;
+        full.assign(labels) ;
+        CHECK_EQ(incremental.size(), full.size()) ;
+        CHECK(incremental.first(L"a", item)) ;
+        CHECK(full.first(L"a", expected)) ;
+        CHECK_EQ(item, expected) ;
+    }
+
+    SUBCASE("Next label by rank") {
+        PrefixIndex index ;
+        index.assign({L"Settings", L"Exit", L"Save", L"search"}) ;
+        auto rank = [] (std::size_t item) {return item ;} ;
+
+        std::size_t item ;
+        CHECK(index.next_by_rank(L"s", rank, 0, true, item)) ;
+        CHECK_EQ(item, 0) ;
+        CHECK(index.next_by_rank(L"s", rank, 0, false, item)) ;
+        CHECK_EQ(item, 2) ;
+        CHECK(index.next_by_rank(L"s", rank, 2, false, item)) ;
+        CHECK_EQ(item, 3) ;
+        CHECK_FALSE(index.next_by_rank(L"s", rank, 3, false, item)) ;
+
+        // A reversed rank visits the items from the bottom.
+        auto reversed = [] (std::size_t item_) {return 3 - item_ ;} ;
+        CHECK(index.next_by_rank(L"s", reversed, 0, true, item)) ;
+        CHECK_EQ(item, 3) ;
+    }
+
+    SUBCASE("Cycling by rank visits every match in display order over 100000 labels") {
+        std::uint32_t seed = 11 ;
+        std::vector<std::wstring> labels ;
+        for(int i = 0 ; i < 100000 ; i ++) {
+            labels.push_back(make_label(seed)) ;
+        }
+        PrefixIndex index ;
+        index.assign(labels) ;
+        auto rank = [] (std::size_t item) {return item ;} ;
+
+        std::vector<std::size_t> expected ;
+        for(std::size_t i = 0 ; i < labels.size() ; i ++) {
+            if(PrefixIndex::fold(labels[i]).compare(0, 2, L"cb") == 0) {
+                expected.push_back(i) ;
+            }
+        }
+        std::vector<std::size_t> visited ;
+        std::size_t item ;
+        bool found = index.next_by_rank(L"CB", rank, 0, true, item) ;
+        while(found) {
+            visited.push_back(item) ;
+            found = index.next_by_rank(L"CB", rank, item, false, item) ;
+        }
+        CHECK(visited == expected) ;
+    }
+
+    SUBCASE("Next item agrees with the scan by rank while labels change") {
+        std::uint32_t seed = 5 ;
+        std::vector<std::wstring> labels ;
+        for(int i = 0 ; i < 5000 ; i ++) {
+            labels.push_back(make_label(seed)) ;
+        }
+        PrefixIndex index ;
+        index.assign(labels) ;
+        auto rank = [] (std::size_t item) {return item ;} ;
+
+        auto check = [&index, &rank, &seed] {
+            for(int query = 0 ; query < 20 ; query ++) {
+                auto prefix = make_label(seed).substr(0, 1 + query % 3) ;
+                seed = seed * 1664525u + 1013904223u ;
+                auto after = static_cast<std::size_t>((seed >> 8) % 6000) ;
+                auto inclusive = (seed >> 4) % 2 == 0 ;
+                std::size_t expected = 0 ;
+                std::size_t item = 0 ;
+                auto found = index.next_by_rank(prefix, rank, after, inclusive, expected) ;
+                CHECK_EQ(index.next_item(prefix, after, inclusive, item), found) ;
+                if(found) {
+                    CHECK_EQ(item, expected) ;
+                }
+            }
+        } ;
+        check() ;
+
+        // Refreshing single items moves entries between the blocks, and growing one block splits it.
+        for(int i = 0 ; i < 2000 ; i ++) {
+            seed = seed * 1664525u + 1013904223u ;
+            auto item = (seed >> 8) % labels.size() ;
+            auto label = i < 1000 ? make_label(seed) : std::wstring(L"dddd") ;
+            CHECK(index.erase(item, labels[item])) ;
+            CHECK(index.insert(item, label)) ;
+            labels[item] = label ;
+        }
+        check() ;
+
+        std::vector<std::size_t> items ;
+        std::vector<std::wstring> added ;
+        for(std::size_t i = labels.size() ; i < 6000 ; i ++) {
+            items.push_back(i) ;
+            added.push_back(make_label(seed)) ;
+        }
+        index.insert(items, added) ;
+        check() ;
+        index.truncate(3000) ;
+        check() ;
+    }
+
+    SUBCASE("Cycling by item through labels with one shared prefix") {
+        PrefixIndex index ;
+        std::vector<std::wstring> labels ;
+        for(int i = 0 ; i < 100000 ; i ++) {
+            labels.push_back(L"Item " + std::to_wstring(i)) ;
+        }
+        index.assign(labels) ;
+
+        std::size_t item ;
+        CHECK(index.next_item(L"i", 0, true, item)) ;
+        CHECK_EQ(item, 0) ;
+        bool ordered = true ;
+        for(std::size_t i = 1 ; i < labels.size() ; i ++) {
+            std::size_t next ;
+            ordered = ordered && index.next_item(L"i", item, false, next) && next == i ;
+            item = next ;
+        }
+        CHECK(ordered) ;
+        CHECK_FALSE(index.next_item(L"i", item, false, item)) ;
+        CHECK(index.next_item(L"item 99", 1000, false, item)) ;
+        CHECK_EQ(item, 9900) ;
+    }
+
+    SUBCASE("Same results as a linear scan over 100000 labels") {
+        std::uint32_t seed = 7 ;
+        std::vector<std::wstring> labels ;
+        for(int i = 0 ; i < 100000 ; i ++) {
+            labels.push_back(make_label(seed)) ;
+        }
+        PrefixIndex index ;
+        index.assign(labels) ;
+
+        // The linear scan finds the smallest label starting with the prefix.
+        auto scan = [&labels] (const std::wstring& prefix, std::size_t& found) {
+            auto folded_prefix = PrefixIndex::fold(prefix) ;
+            bool any = false ;
+            std::wstring best ;
+            for(std::size_t i = 0 ; i < labels.size() ; i ++) {
+                auto folded = PrefixIndex::fold(labels[i]) ;
+                if(folded.compare(0, folded_prefix.size(), folded_prefix) != 0) {
+                    continue ;
+                }
+                if(!any || folded < best) {
+                    any = true ;
+                    best = folded ;
+                    found = i ;
+                }
+            }
+            return any ;
+        } ;
+
+        for(int query = 0 ; query < 50 ; query ++) {
+            auto prefix = make_label(seed) ;
+            std::size_t expected = 0 ;
+            std::size_t item = 0 ;
+            auto any = scan(prefix, expected) ;
+            CHECK_EQ(index.first(prefix, item), any) ;
+            if(any) {
+                CHECK_EQ(item, expected) ;
+            }
+        }
+
+        // Cycling with the same character visits every matching label once.
+        std::size_t matches = 0 ;
+        for(const auto& label : labels) {
+            matches += PrefixIndex::fold(label)[0] == L'c' ? 1 : 0 ;
+        }
+        std::size_t visited = 0 ;
+        std::size_t item ;
+        bool found = index.first(L"C", item) ;
+        while(found) {
+            visited ++ ;
+            found = index.next(L"C", labels[item], item, false, item) ;
+        }
+        CHECK_EQ(visited, matches) ;
+    }
+}
+
+TEST_CASE_FIXTURE(FakeClock, "TypeAhead test: ") {
+    using std::chrono::milliseconds ;
+
+    SUBCASE("Characters are joined within the timeout") {
+        TypeAhead typing(milliseconds(500)) ;
+        typing.type(L'S', at(0)) ;
+        CHECK(typing.prefix() == L"s") ;
+        CHECK_FALSE(typing.extends()) ;
+        typing.type(L'e', at(400)) ;
+        CHECK(typing.prefix() == L"se") ;
+        CHECK(typing.extends()) ;
+
+        typing.type(L'x', at(900)) ;
+        CHECK(typing.prefix() == L"x") ;
+        CHECK_FALSE(typing.extends()) ;
+    }
+
+    SUBCASE("The same character cycles") {
+        TypeAhead typing(milliseconds(500)) ;
+        typing.type(L's', at(0)) ;
+        typing.type(L'S', at(100)) ;
+        typing.type(L's', at(200)) ;
+        CHECK(typing.is_cycling()) ;
+        CHECK(typing.prefix() == L"s") ;
+        CHECK_FALSE(typing.extends()) ;
+
+        typing.type(L'a', at(300)) ;
+        CHECK_FALSE(typing.is_cycling()) ;
+        CHECK(typing.prefix() == L"sssa") ;
+    }
+
+    SUBCASE("Reset") {
+        TypeAhead typing ;
+        typing.type(L'a', at(0)) ;
+        typing.reset() ;
+        typing.type(L'b', at(1)) ;
+        CHECK(typing.prefix() == L"b") ;
+    }
+}
@@ -0,0 +1,120 @@
+#include "test.hpp"
+
+using namespace fluent_tray ;
+
+namespace
+{
+    // The rotation of one wheel notch, which is WHEEL_DELTA on Windows.
+    constexpr int wheel_delta = 120 ;
+}
+
+TEST_CASE("VirtualList test: ") {
+    SUBCASE("Scroll by rows") {
+        VirtualList list{100000, 10} ;
+        CHECK_EQ(list.offset(), 0) ;
+        CHECK_EQ(list.max_offset(), 99990) ;
+
+        CHECK_FALSE(list.scroll_by(-1)) ;
+        CHECK(list.scroll_by(5)) ;
+        CHECK_EQ(list.offset(), 5) ;
+        CHECK_EQ(list.index_of(3), 8) ;
+
+        CHECK(list.scroll_by(1000000)) ;
+        CHECK_EQ(list.offset(), 99990) ;
+        CHECK_FALSE(list.scroll_by(1)) ;
+        CHECK(list.is_bound(9)) ;
+        CHECK_FALSE(list.is_bound(10)) ;
+
+        CHECK(list.scroll_by(-1000000)) ;
+        CHECK_EQ(list.offset(), 0) ;
+    }
+
+    SUBCASE("Fewer items than rows") {
+        VirtualList list{3, 10} ;
+        CHECK_EQ(list.max_offset(), 0) ;
+        CHECK_FALSE(list.scroll_by(1)) ;
+        CHECK(list.is_bound(2)) ;
+        CHECK_FALSE(list.is_bound(3)) ;
+    }
+
+    SUBCASE("Resize") {
+        VirtualList list{1000, 10} ;
+        list.scroll_by(995) ;
+        CHECK_EQ(list.offset(), 990) ;
+        CHECK(list.resize(500)) ;
+        CHECK_EQ(list.offset(), 490) ;
+        CHECK_FALSE(list.resize(2000)) ;
+        CHECK_EQ(list.offset(), 490) ;
+        CHECK(list.resize(0)) ;
+        CHECK_EQ(list.offset(), 0) ;
+        CHECK_FALSE(list.is_bound(0)) ;
+    }
+
+    SUBCASE("Scroll to an item") {
+        VirtualList list{100000, 10} ;
+        CHECK_FALSE(list.scroll_to(9)) ;
+        CHECK(list.scroll_to(10)) ;
+        CHECK_EQ(list.offset(), 1) ;
+        CHECK(list.scroll_to(50000)) ;
+        CHECK_EQ(list.offset(), 49991) ;
+        CHECK(list.scroll_to(49000)) ;
+        CHECK_EQ(list.offset(), 49000) ;
+        CHECK_FALSE(list.scroll_to(49005)) ;
+        CHECK_FALSE(list.scroll_to(100000)) ;
+        CHECK_EQ(list.offset(), 49000) ;
+    }
+
+    SUBCASE("Scroll past the edges by keys") {
+        VirtualList list{20, 5} ;
+        // The cursor moves normally inside the window.
+        CHECK_FALSE(list.scroll_past_edge(2, true)) ;
+        CHECK_FALSE(list.scroll_past_edge(0, false)) ;
+
+        for(int i = 0 ; i < 15 ; i ++) {
+            CHECK(list.scroll_past_edge(4, true)) ;
+        }
+        CHECK_EQ(list.offset(), 15) ;
+        CHECK_FALSE(list.scroll_past_edge(4, true)) ;
+
+        CHECK(list.scroll_past_edge(0, false)) ;
+        CHECK_EQ(list.offset(), 14) ;
+    }
+
+    SUBCASE("Mouse wheel") {
+        VirtualList list{100000, 10} ;
+        CHECK(list.scroll_by_wheel(-wheel_delta, 3)) ;
+        CHECK_EQ(list.offset(), 3) ;
+        CHECK(list.scroll_by_wheel(wheel_delta, 3)) ;
+        CHECK_EQ(list.offset(), 0) ;
+
+        // Fractions of a notch from high-resolution wheels are accumulated.
+        CHECK_FALSE(list.scroll_by_wheel(-wheel_delta / 4, 3)) ;
+        CHECK_FALSE(list.scroll_by_wheel(-wheel_delta / 4, 3)) ;
+        CHECK_FALSE(list.scroll_by_wheel(-wheel_delta / 4, 3)) ;
+        CHECK(list.scroll_by_wheel(-wheel_delta / 4, 3)) ;
+        CHECK_EQ(list.offset(), 3) ;
+
+        // The remainder is dropped when the direction is reversed.
+        CHECK_FALSE(list.scroll_by_wheel(-wheel_delta / 2, 3)) ;
+        CHECK_FALSE(list.scroll_by_wheel(wheel_delta / 2, 3)) ;
+        CHECK(list.scroll_by_wheel(wheel_delta / 2, 3)) ;
+        CHECK_EQ(list.offset(), 0) ;
+    }
+
+    SUBCASE("Bound rows do not depend on the number of items") {
+        for(std::size_t count : {100, 100000}) {
+            VirtualList list{count, 12} ;
+            std::size_t bound = 0 ;
+            while(list.scroll_by(7)) {
+                for(std::size_t row = 0 ; row < list.count_rows() ; row ++) {
+                    if(list.is_bound(row)) {
+                        bound ++ ;
+                    }
+                }
+            }
+            // Each scroll rebinds only the rows in the window.
+            auto scrolls = (list.max_offset() + 6) / 7 ;
+            CHECK_EQ(bound, scrolls * list.count_rows()) ;
+        }
+    }
+}